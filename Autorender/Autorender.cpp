@@ -39,6 +39,7 @@
 #include "../reaper/localize.h"
 #include "../SnM/SnM_Dlg.h"
 #include "../Prompt.h"
+#include "../Breeder/BR_ThreadPool.h"
 #include "../../WDL/projectcontext.h"
 
 #define TAGLIB_STATIC
@@ -207,6 +208,7 @@ string GetProjectName(){
 
 void GetProjectString(WDL_FastString* prjStr){
 	char str[4096];
+	prjStr->Set( "" );
 	EnumProjects(-1, str, MAX_PATH);	
 
 	ProjectStateContext* prj = ProjectCreateFileRead( str );
@@ -223,15 +225,55 @@ void GetProjectString(WDL_FastString* prjStr){
     delete prj;
 }
 
-void WriteProjectFile( string filename, WDL_FastString* prjStr ){
-	//CheckDirTree( filename, true ); This done in GetQueuedRenders
-	ProjectStateContext* outProject = ProjectCreateFileWrite( filename.c_str() );	
+// Writes the render project in a single pass over the project string: values of the top level
+// parameters in params are replaced (missing ones get added) and, when regions are given,
+// project regions are replaced by the regions to render, named after their output file, so a
+// single render job with the $region pattern renders all of them
+bool WriteRenderProject( string filename, WDL_FastString* prjStr, map<string,string> &params, vector<RenderTrack> *regions, int trackNumberPad ){
+	ProjectStateContext* outProject = ProjectCreateFileWrite( filename.c_str() );
+	if( !outProject ) return false;
+
 	char line[4096];
-	int pos = 0;	
+	int pos = 0, depth = 0;
+	bool regionsWritten = !regions;
+	set<string> paramsWritten;
+	LineParser lp(false);
+
 	while( GetChunkLine( prjStr->Get(), line, 4096, &pos, false ) ){
-		outProject->AddLine("%s",line);
+		if( line[0] == '<' ){
+			depth++;
+		} else if( line[0] == '>' ){
+			if( depth == 1 ){
+				// End of the project, add what wasn't found
+				for( map<string,string>::iterator it = params.begin(); it != params.end(); ++it ){
+					if( paramsWritten.find( it->first ) == paramsWritten.end() ) outProject->AddLine( "%s %s", it->first.c_str(), it->second.c_str() );
+				}
+			}
+			depth--;
+		} else if( depth == 1 && !lp.parse( line ) && lp.getnumtokens() ){
+			map<string,string>::iterator it = params.find( lp.gettoken_str(0) );
+			if( it != params.end() ){
+				outProject->AddLine( "%s %s", it->first.c_str(), it->second.c_str() );
+				paramsWritten.insert( it->first );
+				continue;
+			}
+			if( regions && strcmp( lp.gettoken_str(0), "MARKER" ) == 0 && ( lp.gettoken_int(4) & 1 ) ){
+				if( !regionsWritten ){
+					for( unsigned int i = 0; i < regions->size(); i++ ){
+						WDL_FastString regionName;
+						makeEscapedConfigString( (*regions)[i].getFileName( "", trackNumberPad ).c_str(), &regionName );
+						outProject->AddLine( "MARKER %d %.14f %s 1", i + 1, (*regions)[i].trackStartTime, regionName.Get() );
+						outProject->AddLine( "MARKER %d %.14f \"\" 1", i + 1, (*regions)[i].trackEndTime );
+					}
+					regionsWritten = true;
+				}
+				continue;
+			}
+		}
+		outProject->AddLine( "%s", line );
 	}
-    delete outProject;
+	delete outProject;
+	return true;
 }
 
 /*
@@ -250,22 +292,6 @@ void WDLStringReplaceLine( WDL_FastString *prjStr, int pos, const char *oldLine,
 	prjStr->Insert( newLine, startPos );
 }
 
-void SetProjectParameter( WDL_FastString *prjStr, string param, string paramValue ){
-	char line[4096];
-	int pos = 0;
-	LineParser lp(false);
-
-	while( GetChunkLine( prjStr->Get(), line, 4096, &pos, false ) ){
-		if( !lp.parse( line ) && lp.getnumtokens() ) {		
-			if ( strcmp( lp.gettoken_str(0), param.c_str() ) == 0) {
-				string replacementStr = param + string( " " ) + paramValue + string( "\n" );				
-				WDLStringReplaceLine( prjStr, pos, line, replacementStr.c_str() );
-				break;
-			}
-		}
-	}	
-}
-
 string GetProjectParameterValueStr( WDL_FastString *prjStr, string param, int token = 1 ){
 	char line[4096];
 	int pos = 0;
@@ -592,8 +618,73 @@ void MakeMediaFilesAbsolute( WDL_FastString *prjStr ){
 }
 
 
+// Progress and duration of a render stage, printed to the debug output with TESTCODE
+void ReportStage( const char* stage, DWORD startTime, int done = 0, int total = 0 ){
+#ifdef TESTCODE
+	ostringstream msg;
+	msg << "Autorender: " << stage;
+	if( total ) msg << " " << done << "/" << total;
+	msg << " (" << ( GetTickCount() - startTime ) << " ms)";
+	PrintDebugString( msg.str() );
+#endif
+}
+
+struct AutorenderTagJob {
+	string path;
+	string title;
+	int trackNumber;
+	bool tagged;
+};
+
+// Thread procedure, tags one rendered file (TagLib is fine with different files on different threads)
+unsigned WINAPI AutorenderTagFile( void* pJob ){
+	AutorenderTagJob* job = (AutorenderTagJob*)pJob;
+#ifdef _WIN32
+	wchar_t* w_rendered_path = WideCharPlz( job->path.c_str() );
+	TagLib::FileRef f( w_rendered_path );
+#else
+	TagLib::FileRef f( job->path.c_str() );
+#endif
+	if( !f.isNull() ){
+#ifdef _WIN32
+		wchar_t* w_tag_artist = WideCharPlz( g_tag_artist.c_str() );
+		wchar_t* w_tag_album = WideCharPlz( g_tag_album.c_str() );
+		wchar_t* w_tag_genre = WideCharPlz( g_tag_genre.c_str() );
+		wchar_t* w_tag_comment = WideCharPlz( g_tag_comment.c_str() );
+		wchar_t* w_track_title = WideCharPlz( job->title.c_str() );
+
+		if( wcslen( w_tag_artist ) ) f.tag()->setArtist( w_tag_artist );
+		if( wcslen( w_tag_album ) ) f.tag()->setAlbum( w_tag_album );
+		if( wcslen( w_tag_genre ) ) f.tag()->setGenre( w_tag_genre );
+		if( wcslen( w_tag_comment ) ) f.tag()->setComment( w_tag_comment );
+
+		f.tag()->setTitle( w_track_title );
+
+		delete [] w_tag_artist;
+		delete [] w_tag_album;
+		delete [] w_tag_genre;
+		delete [] w_tag_comment;
+		delete [] w_track_title;
+#else
+		if( !g_tag_artist.empty() ) f.tag()->setArtist( g_tag_artist.c_str() );
+		if( !g_tag_album.empty() ) f.tag()->setAlbum( g_tag_album.c_str() );
+		if( !g_tag_genre.empty() ) f.tag()->setGenre( g_tag_genre.c_str() );
+		if( !g_tag_comment.empty() ) f.tag()->setComment( g_tag_comment.c_str() );
+		f.tag()->setTitle( job->title.c_str() );
+#endif
+		if( g_tag_year > 0 ) f.tag()->setYear( g_tag_year );
+		f.tag()->setTrack( job->trackNumber );
+		job->tagged = f.save();
+	}
+#ifdef _WIN32
+	delete [] w_rendered_path;
+#endif
+	return 0;
+}
+
 void AutorenderRegions(COMMAND_T*) {
 	g_doing_render = true;
+	DWORD stageTime = GetTickCount();
 
 	//Get the project config as a WDL_FastString
 	WDL_FastString prjStr;
@@ -638,9 +729,8 @@ void AutorenderRegions(COMMAND_T*) {
 	}
 
 	//Project tweaks - only do after render path check! (Don't want to overwrite users settings in the original file)
-	SetProjectParameter( &prjStr, "RENDER_ADDTOPROJ", "0" );	
-	if( !g_pref_allow_stems ) SetProjectParameter( &prjStr, "RENDER_STEMS", "0" );
 	MakeMediaFilesAbsolute( &prjStr );
+	ReportStage( "load project", stageTime );
 
 	string queuedRendersDir = GetQueuedRendersDir(); // This also checks to make sure that the dir exists
 	NukeDirFiles( queuedRendersDir, "rpp" ); // Deletes all .rpp files in the queuedRendersDir
@@ -694,7 +784,6 @@ void AutorenderRegions(COMMAND_T*) {
 	if( renderTracks.size() == 0 ){
 		//Render entire project with tagging
 		string prjNameStr = GetProjectName();
-		WDL_FastString trackPrjStr(prjStr);
 		RenderTrack renderTrack;
 		renderTrack.trackNumber = 1;
 		renderTrack.trackName = prjNameStr;
@@ -732,75 +821,69 @@ void AutorenderRegions(COMMAND_T*) {
 		trackDuplicates.clear();
 	}
 
-	//Build render queue
-	for( unsigned int i = 0; i < renderTracks.size(); i++){		
-		WDL_FastString trackPrjStr(prjStr);
-
-		string outRenderProjectPath = outRenderProjectPrefix;
-		outRenderProjectPath += GetRenderQueueTimeString() + "_" + GetProjectName() + "_";
-		outRenderProjectPath += renderTracks[i].getFileName("rpp", trackNumberPad );
-
-		string renderFilePath = g_render_path + PATH_SLASH_CHAR + renderTracks[i].getFileName( renderFileExtension, prependTrackNumberPad );						
-		SetProjectParameter( &trackPrjStr, "RENDER_FILE", "\"" + renderFilePath + "\"" );
+	//Build render project: one job renders every region, output files are named by the $region pattern
+	stageTime = GetTickCount();
+	map<string,string> renderParams;
+	WDL_FastString paramValue;
+	renderParams[ "RENDER_ADDTOPROJ" ] = "0";
+	if( !g_pref_allow_stems ) renderParams[ "RENDER_STEMS" ] = "0";
+	makeEscapedConfigString( g_render_path.c_str(), &paramValue );
+	renderParams[ "RENDER_FILE" ] = paramValue.Get();
+	if( renderTracks[0].entireProject ){
+		makeEscapedConfigString( renderTracks[0].getFileName( "", prependTrackNumberPad ).c_str(), &paramValue );
+		renderParams[ "RENDER_PATTERN" ] = paramValue.Get();
+		renderParams[ "RENDER_RANGE" ] = "1 0 0"; //Render entire project
+	} else {
+		renderParams[ "RENDER_PATTERN" ] = "$region";
+		renderParams[ "RENDER_RANGE" ] = "3 0 0"; //Render project regions
+	}
 
-		if( renderTracks[i].entireProject ){
-			SetProjectParameter( &trackPrjStr, "RENDER_RANGE", "1 0 0" ); //Render entire project			
-		} else {
-			ostringstream renderRange;
-			renderRange << "0 " << renderTracks[i].trackStartTime << " " << renderTracks[i].trackEndTime;
-			SetProjectParameter( &trackPrjStr, "RENDER_RANGE", renderRange.str() );	
-		}
-		
-		WriteProjectFile( outRenderProjectPath, &trackPrjStr );
+	string outRenderProjectPath = outRenderProjectPrefix;
+	outRenderProjectPath += GetRenderQueueTimeString() + "_" + GetProjectName() + ".rpp";
+	if( !WriteRenderProject( outRenderProjectPath, &prjStr, renderParams, renderTracks[0].entireProject ? NULL : &renderTracks, prependTrackNumberPad ) ){
+		MessageBox( GetMainHwnd(), __LOCALIZE("Couldn't write the render project to the QueuedRenders directory.","sws_mbox"), __LOCALIZE("Autorender - Error","sws_mbox"), MB_OK );
+		g_doing_render = false;
+		return;
 	}
+	ReportStage( "build render project", stageTime );
 
+	stageTime = GetTickCount();
 	Main_OnCommand( 41207, 0 ); //Render all queued renders
+	ReportStage( "render", stageTime );
+
+	// Tag! Files are independent, tag them on a worker pool
+	stageTime = GetTickCount();
+	vector<AutorenderTagJob> tagJobs( renderTracks.size() );
+	for( unsigned int i = 0; i < renderTracks.size(); i++){
+		tagJobs[i].path = g_render_path + PATH_SLASH_CHAR + renderTracks[i].getFileName( renderFileExtension, prependTrackNumberPad );
+		tagJobs[i].title = renderTracks[i].trackName;
+		tagJobs[i].trackNumber = i + 1;
+		tagJobs[i].tagged = false;
+	}
 
-	// Tag!
-	for( unsigned int i = 0; i < renderTracks.size(); i++){		
-		string renderedFilePath = g_render_path + PATH_SLASH_CHAR + renderTracks[i].getFileName( renderFileExtension, prependTrackNumberPad );
-#ifdef _WIN32
-		wchar_t* w_rendered_path = WideCharPlz( renderedFilePath.c_str() );
-		TagLib::FileRef f( w_rendered_path );
-#else
-		TagLib::FileRef f( renderedFilePath.c_str() );
-#endif
-		if( !f.isNull() ){
-#ifdef _WIN32
-			wchar_t* w_tag_artist = WideCharPlz( g_tag_artist.c_str() );
-			wchar_t* w_tag_album = WideCharPlz( g_tag_album.c_str() );
-			wchar_t* w_tag_genre = WideCharPlz( g_tag_genre.c_str() );
-			wchar_t* w_tag_comment = WideCharPlz( g_tag_comment.c_str() );
-			wchar_t* w_track_title = WideCharPlz( renderTracks[i].trackName.c_str() );
-
-			if( wcslen( w_tag_artist ) ) f.tag()->setArtist( w_tag_artist );
-			if( wcslen( w_tag_album ) ) f.tag()->setAlbum( w_tag_album );
-			if( wcslen( w_tag_genre ) ) f.tag()->setGenre( w_tag_genre );
-			if( wcslen( w_tag_comment ) ) f.tag()->setComment( w_tag_comment );
-
-			f.tag()->setTitle( w_track_title );
-			
-			delete [] w_tag_artist;
-			delete [] w_tag_album;
-			delete [] w_tag_genre;
-			delete [] w_tag_comment;
-			delete [] w_track_title;
-#else
-			if( !g_tag_artist.empty() ) f.tag()->setArtist( g_tag_artist.c_str() );
-			if( !g_tag_album.empty() ) f.tag()->setAlbum( g_tag_album.c_str() );
-			if( !g_tag_genre.empty() ) f.tag()->setGenre( g_tag_genre.c_str() );
-			if( !g_tag_comment.empty() ) f.tag()->setComment( g_tag_comment.c_str() );
-			f.tag()->setTitle( renderTracks[i].trackName.c_str() );
-#endif			
-			if( g_tag_year > 0 ) f.tag()->setYear( g_tag_year );
-			f.tag()->setTrack( i + 1 );
-			f.save();
-		} else {
-			//throw error?
+	// Tag the first file here: TagLib creates its (not thread safe) singletons for the format on first use
+	AutorenderTagFile( &tagJobs[0] );
+	BR_ThreadPool tagPool;
+	vector<HANDLE> tagHandles( tagJobs.size(), (HANDLE)NULL );
+	for( unsigned int i = 1; i < tagJobs.size(); i++){
+		tagHandles[i] = tagPool.Queue( AutorenderTagFile, &tagJobs[i] );
+		if( !tagHandles[i] ) AutorenderTagFile( &tagJobs[i] );
+	}
+
+	int tagErrors = 0;
+	for( unsigned int i = 0; i < tagJobs.size(); i++){
+		if( tagHandles[i] ){
+			WaitForSingleObject( tagHandles[i], INFINITE );
+			CloseHandle( tagHandles[i] );
 		}
-#ifdef _WIN32
-		delete [] w_rendered_path;
-#endif
+		if( !tagJobs[i].tagged ) tagErrors++;
+		ReportStage( "tag", stageTime, i + 1, (int)tagJobs.size() );
+	}
+
+	if( tagErrors ){
+		char msg[256];
+		sprintf( msg, __LOCALIZE_VERFMT("Couldn't tag %d of %d rendered file(s).","sws_mbox"), tagErrors, (int)tagJobs.size() );
+		MessageBox( GetMainHwnd(), msg, __LOCALIZE("Autorender - Error","sws_mbox"), MB_OK );
 	}
 
 	OpenRenderPath( NULL );
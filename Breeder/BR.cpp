@@ -166,6 +166,7 @@ static COMMAND_T g_commandTable[] =
 	{ { DEFACCEL, "SWS/BR: Delete envelope points between grid (obey time selection, if any)" },                              "BR_ENV_DEL_PT_NO_GRID_TS",           EnvPointsGrid, NULL, BINARY(0011)},
 	{ { DEFACCEL, "SWS/BR: Insert envelope points on grid using shape of the previous point" },                               "BR_ENV_INS_PT_GRID",                 CreateEnvPointsGrid, NULL, 0},
 	{ { DEFACCEL, "SWS/BR: Insert envelope points on grid using shape of the previous point (obey time selection, if any)" }, "BR_ENV_INS_PT_GRID_TS",              CreateEnvPointsGrid, NULL, 1},
+	{ { DEFACCEL, "SWS/BR: Simplify envelope (obey time selection, if any)..." },                                            "BR_ENV_SIMPLIFY_TS",                 SimplifyEnv, NULL},
 
 	{ { DEFACCEL, "SWS/BR: Shift envelope point selection left" },                                                            "BR_ENV_SHIFT_SEL_LEFT",              ShiftEnvSelection, NULL, -1},
 	{ { DEFACCEL, "SWS/BR: Shift envelope point selection right" },                                                           "BR_ENV_SHIFT_SEL_RIGHT",             ShiftEnvSelection, NULL, 1},
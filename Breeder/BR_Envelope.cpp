@@ -34,6 +34,11 @@
 #include "BR_Util.h"
 #include "../reaper/localize.h"
 
+/******************************************************************************
+* Constants                                                                   *
+******************************************************************************/
+const char* const SIMPLIFY_KEY = "BR - SimplifyEnvelope";
+
 /******************************************************************************
 * Continuous action: set envelope point value to mouse                        *
 ******************************************************************************/
@@ -779,6 +784,34 @@ void CreateEnvPointsGrid (COMMAND_T* ct)
 		Undo_OnStateChangeEx2(NULL, SWS_CMD_SHORTNAME(ct), UNDO_STATE_TRACKCFG, -1);
 }
 
+void SimplifyEnv (COMMAND_T* ct)
+{
+	BR_Envelope envelope(GetSelectedEnvelope(NULL));
+	if (envelope.CountPoints() < 3 || envelope.IsTempo())
+		return;
+
+	char reply[64];
+	GetPrivateProfileString("SWS", SIMPLIFY_KEY, "0.001", reply, sizeof(reply), get_ini_file());
+	if (!GetUserInputs(__LOCALIZE("SWS/BR - Simplify envelope","sws_mbox"), 1, __LOCALIZE("Max error (envelope value units)","sws_mbox"), reply, sizeof(reply)))
+		return;
+
+	double maxError = AltAtof(reply);
+	if (maxError < 0)
+		return;
+	WritePrivateProfileString("SWS", SIMPLIFY_KEY, reply, get_ini_file());
+
+	envelope.Sort();
+	int startId, endId;
+	if (!envelope.GetPointsInTimeSelection(&startId, &endId))
+	{
+		startId = 0;
+		endId   = envelope.CountPoints()-1;
+	}
+
+	if (envelope.Simplify(startId, endId, maxError) && envelope.Commit())
+		Undo_OnStateChangeEx2(NULL, SWS_CMD_SHORTNAME(ct), UNDO_STATE_TRACKCFG, -1);
+}
+
 void ShiftEnvSelection (COMMAND_T* ct)
 {
 	BR_Envelope envelope(GetSelectedEnvelope(NULL));
@@ -782,33 +782,114 @@ double BR_Envelope::ValueAtPosition (double position)
 
 		case BEZIER:
 		{
-			int id0 = (m_sorted) ? (id-1)     : (this->FindPrevious(t1, 0));
-			int id3 = (m_sorted) ? (nextId+1) : (this->FindNext(t2, 0));
-			double t0 = (!this->ValidateId(id0)) ? (t1) : (m_points[id0].position);
-			double v0 = (!this->ValidateId(id0)) ? (v1) : (m_points[id0].value);
-			double t3 = (!this->ValidateId(id3)) ? (t2) : (m_points[id3].position);
-			double v3 = (!this->ValidateId(id3)) ? (v2) : (m_points[id3].value);
-
-			double x1, x2, y1, y2, empty;
-			LICE_Bezier_FindCardinalCtlPts(0.25, t0, t1, t2, v0, v1, v2, &empty, &x1, &empty, &y1);
-			LICE_Bezier_FindCardinalCtlPts(0.25, t1, t2, t3, v1, v2, v3, &x2, &empty, &y2, &empty);
-
-			double tension = m_points[id].bezier;
-			x1 += tension * ((tension > 0) ? (t2-x1) : (x1-t1));
-			x2 += tension * ((tension > 0) ? (t2-x2) : (x2-t1));
-			y1 -= tension * ((tension > 0) ? (y1-v1) : (v2-y1));
-			y2 -= tension * ((tension > 0) ? (y2-v1) : (v2-y2));
-
-			x1 = SetToBounds(x1, t1, t2);
-			x2 = SetToBounds(x2, t1, t2);
-			y1 = SetToBounds(y1, this->MinValue(), this->MaxValue());
-			y2 = SetToBounds(y2, this->MinValue(), this->MaxValue());
+			double x1, x2, y1, y2;
+			this->GetBezierControlPoints(id, nextId, &x1, &x2, &y1, &y2);
 			return LICE_CBezier_GetY(t1, x1, x2, t2, v1, y1, y2, v2, position);
 		}
 	}
 	return 0;
 }
 
+void BR_Envelope::ValuesAtPositions (double position, double step, int count, double* values, int* cursor /*= NULL*/)
+{
+	if (count <= 0 || !values)
+		return;
+
+	// Searching for every position is slow so fall back only when there is no other choice
+	if (!m_sorted)
+	{
+		for (int i = 0; i < count; ++i)
+			values[i] = this->ValueAtPosition(position + i * step);
+		return;
+	}
+
+	if (m_count <= 0)
+	{
+		double value = this->CenterValue();
+		for (int i = 0; i < count; ++i)
+			values[i] = value;
+		return;
+	}
+
+	position -= m_takeEnvOffset;
+
+	// Cursor holds previous point id from the last call - since positions only move forward between successive calls we just advance it
+	int id = (cursor && *cursor >= -1 && *cursor < m_count && (*cursor == -1 || m_points[*cursor].position < position)) ? (*cursor) : (this->FindPrevious(position, 0));
+
+	int i = 0;
+	while (i < count)
+	{
+		double currentPos = position + i * step;
+		while (id + 1 < m_count && m_points[id+1].position < currentPos)
+			++id;
+
+		// Before first point or after last point the value doesn't change
+		if (id == -1 || id + 1 >= m_count)
+		{
+			double value = (id == -1) ? (m_points[0].value) : (m_points[id].value);
+			double end   = (id == -1) ? (m_points[0].position) : (numeric_limits<double>::max());
+			while (i < count && position + i * step <= end)
+				values[i++] = value;
+			continue;
+		}
+
+		int nextId = id + 1;
+		double t1 = m_points[id].position;
+		double t2 = m_points[nextId].position;
+		double v1 = m_points[id].value;
+		double v2 = m_points[nextId].value;
+		int shape = m_points[id].shape;
+
+		// Number of positions that fall inside the segment (end of transition is handled separately)
+		int segmentEnd = i;
+		while (segmentEnd < count && position + segmentEnd * step < t2)
+			++segmentEnd;
+
+		// Bezier segments aren't flat even with equal end values (control points come from neighbouring points)
+		if (shape == SQUARE || (v1 == v2 && shape != BEZIER))
+		{
+			for (; i < segmentEnd; ++i)
+				values[i] = v1;
+		}
+		else if (shape == LINEAR && !m_tempoMap)
+		{
+			double slope = (v2 - v1) / (t2 - t1);
+			for (; i < segmentEnd; ++i)
+				values[i] = v1 + slope * (position + i * step - t1);
+		}
+		else if (shape == BEZIER)
+		{
+			double x1, x2, y1, y2;
+			this->GetBezierControlPoints(id, nextId, &x1, &x2, &y1, &y2);
+			for (; i < segmentEnd; ++i)
+				values[i] = LICE_CBezier_GetY(t1, x1, x2, t2, v1, y1, y2, v2, position + i * step);
+		}
+		else
+		{
+			double len = t2 - t1;
+			for (; i < segmentEnd; ++i)
+			{
+				double currentPos = position + i * step;
+				double t = (currentPos - t1) / len;
+				switch (shape)
+				{
+					case LINEAR:         values[i] = TempoAtPosition(v1, v2, t1, t2, currentPos); break;
+					case FAST_END:       values[i] = v1 + (v2 - v1) * (t*t*t);                    break;
+					case FAST_START:     values[i] = v1 + (v2 - v1) * (1 - (1-t)*(1-t)*(1-t));    break;
+					case SLOW_START_END: values[i] = v1 + (v2 - v1) * (t*t * (3 - 2*t));          break;
+					default:             values[i] = 0;                                           break;
+				}
+			}
+		}
+
+		// Position at the end of transition?
+		if (i < count && position + i * step == t2)
+			values[i++] = m_points[this->LastPointAtPos(nextId)].value;
+	}
+
+	WritePtr(cursor, id);
+}
+
 double BR_Envelope::NormalizedDisplayValue (double value)
 {
 	double min = this->LaneMinValue();
@@ -1417,6 +1498,51 @@ int BR_Envelope::FindFirstPoint ()
 	}
 }
 
+void BR_Envelope::GetBezierControlPoints (int id, int nextId, double* x1, double* x2, double* y1, double* y2)
+{
+	/* no bounds checking - internal function so caller handles before calling */
+	double t1 = m_points[id].position;
+	double t2 = m_points[nextId].position;
+	double v1 = m_points[id].value;
+	double v2 = m_points[nextId].value;
+
+	int id0 = (m_sorted) ? (id-1)     : (this->FindPrevious(t1, 0));
+	int id3 = (m_sorted) ? (nextId+1) : (this->FindNext(t2, 0));
+	double t0 = (!this->ValidateId(id0)) ? (t1) : (m_points[id0].position);
+	double v0 = (!this->ValidateId(id0)) ? (v1) : (m_points[id0].value);
+	double t3 = (!this->ValidateId(id3)) ? (t2) : (m_points[id3].position);
+	double v3 = (!this->ValidateId(id3)) ? (v2) : (m_points[id3].value);
+
+	double empty;
+	LICE_Bezier_FindCardinalCtlPts(0.25, t0, t1, t2, v0, v1, v2, &empty, x1, &empty, y1);
+	LICE_Bezier_FindCardinalCtlPts(0.25, t1, t2, t3, v1, v2, v3, x2, &empty, y2, &empty);
+
+	double tension = m_points[id].bezier;
+	*x1 += tension * ((tension > 0) ? (t2-*x1) : (*x1-t1));
+	*x2 += tension * ((tension > 0) ? (t2-*x2) : (*x2-t1));
+	*y1 -= tension * ((tension > 0) ? (*y1-v1) : (v2-*y1));
+	*y2 -= tension * ((tension > 0) ? (*y2-v1) : (v2-*y2));
+
+	*x1 = SetToBounds(*x1, t1, t2);
+	*x2 = SetToBounds(*x2, t1, t2);
+	*y1 = SetToBounds(*y1, this->MinValue(), this->MaxValue());
+	*y2 = SetToBounds(*y2, this->MinValue(), this->MaxValue());
+}
+
+int BR_Envelope::Simplify (int startId, int endId, double maxError)
+{
+	if (m_tempoMap || !this->ValidateId(startId) || !this->ValidateId(endId) || endId - startId < 2)
+		return 0;
+
+	int count = m_count;
+	SimplifyEnvPoints(m_points, maxError, this->MinValue(), this->MaxValue(), startId, endId);
+	m_count = (int)m_points.size();
+
+	if (m_count != count)
+		m_update = true;
+	return count - m_count;
+}
+
 int BR_Envelope::LastPointAtPos (int id)
 {
 	/* no bounds checking - internal function so caller handles before calling */
@@ -2370,6 +2496,175 @@ int CountTrackEnvelopePanels (MediaTrack* track)
 	return count;
 }
 
+/******************************************************************************
+* Point reduction                                                             *
+******************************************************************************/
+static bool IsSimplifiable (const BR_EnvPoint& point)
+{
+	return point.shape == LINEAR || (point.shape == BEZIER && point.bezier == 0);
+}
+
+static double SegmentError (const vector<BR_EnvPoint>& points, int prevId, int id, int nextId, int followingId, int shape, double minValue, double maxValue, int* worstId = NULL)
+{
+	/* Max distance of points between id and nextId from the segment - prevId and followingId  *
+	*  are used for bezier control points, same as Reaper does (see GetBezierControlPoints())  */
+	double t1 = points[id].position;
+	double t2 = points[nextId].position;
+	double v1 = points[id].value;
+	double v2 = points[nextId].value;
+
+	double x1 = t1, x2 = t2, y1 = v1, y2 = v2;
+	if (shape == BEZIER)
+	{
+		double empty;
+		LICE_Bezier_FindCardinalCtlPts(0.25, points[prevId].position, t1, t2, points[prevId].value, v1, v2, &empty, &x1, &empty, &y1);
+		LICE_Bezier_FindCardinalCtlPts(0.25, t1, t2, points[followingId].position, v1, v2, points[followingId].value, &x2, &empty, &y2, &empty);
+		x1 = SetToBounds(x1, t1, t2);
+		x2 = SetToBounds(x2, t1, t2);
+		y1 = SetToBounds(y1, minValue, maxValue);
+		y2 = SetToBounds(y2, minValue, maxValue);
+	}
+
+	double error = 0;
+	for (int i = id + 1; i < nextId; ++i)
+	{
+		double value;
+		if (shape == BEZIER)
+			value = LICE_CBezier_GetY(t1, x1, x2, t2, v1, y1, y2, v2, points[i].position);
+		else
+			value = (t2 > t1) ? (v1 + (v2 - v1) * (points[i].position - t1) / (t2 - t1)) : (v1);
+
+		if (abs(value - points[i].value) > error)
+		{
+			error = abs(value - points[i].value);
+			WritePtr(worstId, i);
+		}
+	}
+	return error;
+}
+
+void SimplifyEnvPoints (vector<BR_EnvPoint>& points, double maxError, double minValue, double maxValue, int startId /*= 0*/, int endId /*= -1*/, bool allowBezier /*= true*/)
+{
+	int count = (int)points.size();
+	if (endId < 0 || endId >= count)
+		endId = count - 1;
+	if (startId < 0 || endId - startId < 2 || maxError < 0)
+		return;
+
+	// Points that have to stay: range edges, points around segments of other shapes and jumps (points at the same position)
+	vector<bool> fixed(count, false);
+	for (int i = 0; i < count; ++i)
+	{
+		if (i <= startId || i >= endId)
+			fixed[i] = true;
+		else if (!IsSimplifiable(points[i-1]) || !IsSimplifiable(points[i]))
+			fixed[i] = true;
+		else if (points[i].position == points[i-1].position || points[i].position == points[i+1].position)
+			fixed[i] = true;
+	}
+
+	// Ramer-Douglas-Peucker with linear segments
+	vector<bool> kept(fixed);
+	vector<pair<int,int> > segments;
+	for (int i = startId + 1, lastId = startId; i <= endId; ++i)
+	{
+		if (kept[i])
+		{
+			if (i - lastId > 1)
+				segments.push_back(make_pair(lastId, i));
+			lastId = i;
+		}
+	}
+	while (!segments.empty())
+	{
+		pair<int,int> segment = segments.back();
+		segments.pop_back();
+
+		int worstId = -1;
+		if (SegmentError(points, segment.first, segment.first, segment.second, segment.second, LINEAR, minValue, maxValue, &worstId) > maxError)
+		{
+			kept[worstId] = true;
+			if (worstId - segment.first > 1)
+				segments.push_back(make_pair(segment.first, worstId));
+			if (segment.second - worstId > 1)
+				segments.push_back(make_pair(worstId, segment.second));
+		}
+	}
+
+	// Kept points as linked list, ends point to themselves so bezier segments get the same control points as in Reaper
+	vector<int> prevIds(count), nextIds(count), shapes(count);
+	for (int i = 0, lastId = -1; i < count; ++i)
+	{
+		shapes[i] = points[i].shape;
+		if (kept[i])
+		{
+			prevIds[i] = (lastId >= 0) ? lastId : i;
+			if (lastId >= 0)
+				nextIds[lastId] = i;
+			nextIds[i] = i;
+			lastId = i;
+		}
+	}
+
+	// Choose shape of segments that lost points
+	for (int id = startId; id < endId; id = nextIds[id])
+	{
+		int nextId = nextIds[id];
+		if (nextId - id < 2)
+			continue;
+
+		shapes[id] = LINEAR;
+		if (allowBezier && SegmentError(points, prevIds[id], id, nextId, nextIds[nextId], BEZIER, minValue, maxValue) <= SegmentError(points, id, id, nextId, nextId, LINEAR, minValue, maxValue))
+			shapes[id] = BEZIER;
+	}
+
+	// Bezier segments can usually span more points than linear ones, try removing remaining points one by one
+	for (int id = nextIds[startId]; id < endId; id = nextIds[id])
+	{
+		if (fixed[id])
+			continue;
+
+		int prevId = prevIds[id];
+		int nextId = nextIds[id];
+		int shape = -1;
+		if (allowBezier && SegmentError(points, prevIds[prevId], prevId, nextId, nextIds[nextId], BEZIER, minValue, maxValue) <= maxError)
+			shape = BEZIER;
+		else if (SegmentError(points, prevId, prevId, nextId, nextId, LINEAR, minValue, maxValue) <= maxError)
+			shape = LINEAR;
+
+		// Neighboring bezier segments get different control points
+		int prevPrevId = prevIds[prevId];
+		if (shape != -1 && prevPrevId != prevId && shapes[prevPrevId] == BEZIER && SegmentError(points, prevIds[prevPrevId], prevPrevId, prevId, nextId, BEZIER, minValue, maxValue) > maxError)
+			shape = -1;
+		if (shape != -1 && nextIds[nextId] != nextId && shapes[nextId] == BEZIER && SegmentError(points, prevId, nextId, nextIds[nextId], nextIds[nextIds[nextId]], BEZIER, minValue, maxValue) > maxError)
+			shape = -1;
+
+		if (shape != -1)
+		{
+			kept[id] = false;
+			shapes[prevId] = shape;
+			nextIds[prevId] = nextId;
+			prevIds[nextId] = prevId;
+		}
+	}
+
+	vector<BR_EnvPoint> simplified;
+	simplified.reserve(count);
+	for (int i = 0; i < count; ++i)
+	{
+		if (kept[i])
+		{
+			simplified.push_back(points[i]);
+			if (simplified.back().shape != shapes[i])
+			{
+				simplified.back().shape  = shapes[i];
+				simplified.back().bezier = 0;
+			}
+		}
+	}
+	points.swap(simplified);
+}
+
 /******************************************************************************
 * Tempo                                                                       *
 ******************************************************************************/
@@ -149,11 +149,13 @@ public:
 
 	/* Points properties */
 	double ValueAtPosition (double position);         // Using find functionality, so efficiency may vary (see comment about Find())
+	void ValuesAtPositions (double position, double step, int count, double* values, int* cursor = NULL); // Renders count values starting at position (spaced by step). Cursor (init to -2) keeps segment between calls when rendering successive blocks
 	double NormalizedDisplayValue (double value);     // Convert point value to 0.0 - 1.0 range as displayed in arrange
 	double RealDisplayValue (double normalizedValue); // Convert normalized display value in range 0.0 - 1.0 to real envelope value
 	double SnapValue (double value);                  // Snaps value to current settings (only relevant for take pitch envelope)
 	void GetSelectedPointsExtrema (double* minimum, double* maximum);
 	bool GetPointsInTimeSelection (int* startId, int* endId, double* tStart = NULL, double* tEnd = NULL); // Presumes points are sorted, returns false if there is no time selection (if there are no points in time selection, both ids will be -1)
+	int Simplify (int startId, int endId, double maxError); // Presumes points are sorted, removes points between startId and endId while envelope stays within maxError of them (see SimplifyEnvPoints), returns number of removed points
 
 	/* Miscellaneous */
 	bool VisibleInArrange (int* envHeight, int* yOffset, bool cacheValues = false); // Is part of the envelope visible in arrange (height calculation can be intensive (envelopes in track lane), use cacheValues if situation allows)
@@ -199,6 +201,7 @@ private:
 	struct IdPair { int first, second; };
 	int FindFirstPoint ();
 	int LastPointAtPos (int id);
+	void GetBezierControlPoints (int id, int nextId, double* x1, double* x2, double* y1, double* y2);
 	int FindNext (double position, double offset);     // used for internal stuff since position
 	int FindPrevious (double position, double offset); // offset of take envelopes has to be tracked
 	void ParseState (char* envState, size_t size);
@@ -263,6 +266,12 @@ int GetEnvType (TrackEnvelope* envelope, bool* isSend);           // for return
 int GetCurrentAutomationMode (MediaTrack* track);                 // takes global override into account
 int CountTrackEnvelopePanels (MediaTrack* track);
 
+/******************************************************************************
+* Point reduction                                                             *
+******************************************************************************/
+void SimplifyEnvPoints (vector<BR_EnvPoint>& points, double maxError, double minValue, double maxValue, int startId = 0, int endId = -1, bool allowBezier = true); // Ramer-Douglas-Peucker over sorted points: only points strictly between startId and endId on linear/bezier segments can go, remaining
+                                                                                                                                                                 // segments are set to linear or bezier (whichever is closer). Error is measured in value units at the original points' positions
+
 /******************************************************************************
 * Tempo                                                                       *
 ******************************************************************************/
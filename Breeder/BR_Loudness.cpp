@@ -28,12 +28,14 @@
 #include "stdafx.h"
 #include "BR_Loudness.h"
 #include "BR_EnvelopeUtil.h"
+#include "BR_ThreadPool.h"
 #include "BR_Util.h"
 #include "../SnM/SnM_Dlg.h"
 #include "../SnM/SnM_Util.h"
 #include "../SnM/SnM.h"
 #include "../libebur128/ebur128.h"
 #include "../reaper/localize.h"
+#include "../../WDL/sha.h"
 
 /******************************************************************************
 * Constants                                                                   *
@@ -63,6 +65,12 @@ const char* const EXPORT_FORMAT_RECENT = "BR - LoudnessExportFormat_Pattern_";
 const int EXPORT_FORMAT_RECENT_MAX      = 10;
 const int VERSION                       = 1;
 
+const char* const CACHE_DIR             = "BR_LoudnessCache";
+const char        CACHE_MAGIC[]         = {'B', 'R', 'L', 'C'};
+const int         CACHE_VERSION         = 3;
+const WDL_INT64   CACHE_MAX_SIZE        = 256 * 1024 * 1024; // bytes
+const double      CACHE_MAX_AGE         = 90 * 24 * 60 * 60; // seconds since last use
+
 // Export format wildcards
 static const char* g_wildcards[][4] =
 {
@@ -153,6 +161,12 @@ const int GO_TO_SHORTTERM             = 0xF018;
 const int GO_TO_MOMENTARY             = 0xF019;
 const int GO_TO_TRUE_PEAK             = 0xF01A;
 
+const int BLOCK_PREROLL  = 4; // 100 ms blocks decoded before edited range so K-weighting filter settles (their energies get discarded)
+const int BLOCK_POSTROLL = 2; // blocks after edited range also change because filter state carries over
+
+const double FX_LOOKAHEAD      = 1;    // track FX (limiters etc.) can change audio up to this many seconds before the edit
+const double SOURCE_POS_DELTA  = 1e-9; // item source position differences below this are ignored (rounding after trims)
+
 const int ANALYZE_TIMER     = 1;
 const int REANALYZE_TIMER   = 2;
 const int UPDATE_TIMER      = 3;
@@ -170,6 +184,599 @@ const int UPDATE_TIMER_FREQ  = 200;
 static SNM_WindowManager<BR_AnalyzeLoudnessWnd>                       g_loudnessWndManager(LOUDNESS_WND);
 static SWSProjConfig<WDL_PtrList_DeleteOnDestroy<BR_LoudnessObject> > g_analyzedObjects;
 static HWND                                                           g_normalizeWnd = NULL;
+static BR_ThreadPool*                                                 g_analyzePool  = NULL; // created on first analysis, sized to the core count
+static SWS_Mutex                                                      g_cacheMutex;          // loudness cache files get written from analyze threads
+static WDL_INT64                                                      g_cacheSize    = -1;   // running total of the cache directory size (-1 until first scanned)
+
+/******************************************************************************
+* Analyze pool                                                                *
+******************************************************************************/
+static BR_ThreadPool* GetAnalyzePool ()
+{
+	if (!g_analyzePool)
+		g_analyzePool = new BR_ThreadPool();
+	return g_analyzePool;
+}
+
+static double GetAnalyzeProgress (WDL_PtrList<BR_LoudnessObject>& objects, double finishedLen, double totalLen)
+{
+	// Objects still waiting in the pool queue report 0 progress so only query length for those actually being analyzed
+	double progress = finishedLen;
+	for (int i = 0; i < objects.GetSize(); ++i)
+	{
+		if (BR_LoudnessObject* object = objects.Get(i))
+		{
+			double objectProgress = object->GetProgress();
+			if (objectProgress > 0 && object->IsRunning())
+				progress += object->GetAudioLength() * objectProgress;
+		}
+	}
+	return (totalLen > 0) ? SetToBounds(progress / totalLen, 0.0, 1.0) : 1;
+}
+
+/******************************************************************************
+* Loudness cache                                                              *
+******************************************************************************/
+// Analyze data is cached on disk, one file per analyzed audio (named after the hash of the audio accessor and everything that
+// affects gain) so analyzing unchanged audio again doesn't have to decode it. Energies and peaks of 100 ms blocks come last so audio loaded from cache can still be re-analyzed incrementally after an edit.
+//
+// File layout (all values little-endian, ints are 32-bit, floats and doubles IEEE 754):
+//   header:     magic, version, last used time (double), integratedOnly, truePeakAnalyzed, shortTermCount, momentaryCount, blockCount,
+//               peakCount (ints), integrated, range, truePeak, truePeakPos, shortTermMax, momentaryMax (doubles)
+//   series:     short-term and momentary values (floats)
+//   blocks:     energies, then peaks and peak positions (doubles)
+//
+// Files are evicted least recently used first once the directory gets over CACHE_MAX_SIZE, or when not used for CACHE_MAX_AGE. The
+// directory is only scanned on the first write of the session and when the running size total goes over the limit
+struct BR_LoudnessCacheHeader
+{
+	int integratedOnly, truePeakAnalyzed;
+	int shortTermCount, momentaryCount;
+	int blockCount, peakCount;          // block energies hold full blocks only, peaks include the last partial block
+	double integrated, range, truePeak, truePeakPos, shortTermMax, momentaryMax;
+};
+
+const int CACHE_LAST_USED_OFFSET = sizeof(CACHE_MAGIC) + 4;
+const int CACHE_HEADER_SIZE      = sizeof(CACHE_MAGIC) + 4 + 8 + 6 * 4 + 6 * 8;
+
+static void PutCacheBytes (unsigned char* buf, WDL_UINT64 value, int bytes)
+{
+	for (int i = 0; i < bytes; ++i)
+		buf[i] = (unsigned char)((value >> (8 * i)) & 0xFF);
+}
+
+static WDL_UINT64 GetCacheBytes (const unsigned char* buf, int bytes)
+{
+	WDL_UINT64 value = 0;
+	for (int i = 0; i < bytes; ++i)
+		value |= (WDL_UINT64)buf[i] << (8 * i);
+	return value;
+}
+
+static void PutCacheInt (unsigned char* buf, int* pos, int value)
+{
+	PutCacheBytes(buf + *pos, (WDL_UINT64)(unsigned int)value, 4);
+	*pos += 4;
+}
+
+static void PutCacheDouble (unsigned char* buf, int* pos, double value)
+{
+	WDL_UINT64 bits;
+	memcpy(&bits, &value, sizeof(bits));
+	PutCacheBytes(buf + *pos, bits, 8);
+	*pos += 8;
+}
+
+static int GetCacheInt (const unsigned char* buf, int* pos)
+{
+	int value = (int)(unsigned int)GetCacheBytes(buf + *pos, 4);
+	*pos += 4;
+	return value;
+}
+
+static double GetCacheDouble (const unsigned char* buf, int* pos)
+{
+	WDL_UINT64 bits = GetCacheBytes(buf + *pos, 8);
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	*pos += 8;
+	return value;
+}
+
+static bool WriteCacheFloats (FILE* file, const vector<float>& values)
+{
+	vector<unsigned char> buf(values.size() * 4);
+	for (size_t i = 0; i < values.size(); ++i)
+	{
+		unsigned int bits;
+		memcpy(&bits, &values[i], sizeof(bits));
+		PutCacheBytes(&buf[i * 4], bits, 4);
+	}
+	return buf.empty() || fwrite(&buf[0], 1, buf.size(), file) == buf.size();
+}
+
+static bool ReadCacheFloats (FILE* file, int count, vector<double>* values)
+{
+	vector<unsigned char> buf(count * 4);
+	if (!buf.empty() && fread(&buf[0], 1, buf.size(), file) != buf.size())
+		return false;
+
+	values->resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		unsigned int bits = (unsigned int)GetCacheBytes(&buf[i * 4], 4);
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		(*values)[i] = value;
+	}
+	return true;
+}
+
+static bool WriteCacheDoubles (FILE* file, const vector<double>& values)
+{
+	vector<unsigned char> buf(values.size() * 8);
+	int pos = 0;
+	for (size_t i = 0; i < values.size(); ++i)
+		PutCacheDouble(&buf[0], &pos, values[i]);
+	return buf.empty() || fwrite(&buf[0], 1, buf.size(), file) == buf.size();
+}
+
+static bool ReadCacheDoubles (FILE* file, int count, vector<double>* values)
+{
+	vector<unsigned char> buf(count * 8);
+	if (!buf.empty() && fread(&buf[0], 1, buf.size(), file) != buf.size())
+		return false;
+
+	values->resize(count);
+	int pos = 0;
+	for (int i = 0; i < count; ++i)
+		(*values)[i] = GetCacheDouble(&buf[0], &pos);
+	return true;
+}
+
+static WDL_FastString GetLoudnessCacheDir ()
+{
+	WDL_FastString path;
+	path.SetFormatted(SNM_MAX_PATH, "%s%c%s", GetResourcePath(), PATH_SLASH_CHAR, CACHE_DIR);
+	return path;
+}
+
+static WDL_FastString GetLoudnessCachePath (const char* key, bool createDir)
+{
+	WDL_FastString path = GetLoudnessCacheDir();
+	if (createDir && !FileOrDirExists(path.Get()))
+		CreateDirectory(path.Get(), NULL);
+	path.AppendFormatted(SNM_MAX_PATH, "%c%s.bin", PATH_SLASH_CHAR, key);
+	return path;
+}
+
+static int GetLoudnessCacheSeriesSize (int count)
+{
+	return count * 4;
+}
+
+static bool WriteLoudnessCacheSeries (FILE* file, const vector<double>& values)
+{
+	vector<float> buf(values.begin(), values.end());
+	return WriteCacheFloats(file, buf);
+}
+
+static bool ReadLoudnessCacheSeries (FILE* file, int seriesOffset, int count, vector<double>* values)
+{
+	values->clear();
+	if (fseek(file, seriesOffset, SEEK_SET) != 0)
+		return false;
+	return ReadCacheFloats(file, count, values);
+}
+
+static bool GetLoudnessCacheFileInfo (const char* path, WDL_INT64* size, time_t* lastUsed)
+{
+	struct stat s;
+#ifdef _WIN32
+	if (statUTF8(path, &s))
+#else
+	if (stat(path, &s))
+#endif
+		return false;
+
+	*size     = (WDL_INT64)s.st_size;
+	*lastUsed = s.st_mtime;
+	return true;
+}
+
+// Every read rewrites the last used time in the header which also updates file's modification time, eviction goes by it
+static void TouchLoudnessCache (const char* path)
+{
+	if (FILE* file = fopenUTF8(path, "r+b"))
+	{
+		unsigned char buf[8];
+		int pos = 0;
+		PutCacheDouble(buf, &pos, (double)time(NULL));
+		if (fseek(file, CACHE_LAST_USED_OFFSET, SEEK_SET) == 0)
+			fwrite(buf, 1, sizeof(buf), file);
+		fclose(file);
+	}
+}
+
+// Returns total size of the cache directory after eviction
+static WDL_INT64 EvictLoudnessCache ()
+{
+	vector<pair<time_t,pair<WDL_INT64,WDL_FastString*> > > files;
+	WDL_PtrList_DeleteOnDestroy<WDL_FastString> paths;
+	WDL_INT64 totalSize = 0;
+	time_t now = time(NULL);
+
+	WDL_DirScan ds;
+	WDL_FastString dir = GetLoudnessCacheDir();
+	if (ds.First(dir.Get()))
+		return 0;
+	do
+	{
+		if (ds.GetCurrentIsDirectory() || !HasFileExtension(ds.GetCurrentFN(), "bin"))
+			continue;
+
+		WDL_FastString* path = paths.Add(new WDL_FastString(dir.Get()));
+		path->AppendFormatted(SNM_MAX_PATH, "%c%s", PATH_SLASH_CHAR, ds.GetCurrentFN());
+
+		WDL_INT64 size;
+		time_t lastUsed;
+		if (!GetLoudnessCacheFileInfo(path->Get(), &size, &lastUsed))
+			continue;
+
+		if (difftime(now, lastUsed) > CACHE_MAX_AGE)
+			DeleteFile(path->Get());
+		else
+		{
+			files.push_back(make_pair(lastUsed, make_pair(size, path)));
+			totalSize += size;
+		}
+	}
+	while (!ds.Next());
+
+	if (totalSize > CACHE_MAX_SIZE)
+	{
+		sort(files.begin(), files.end()); // oldest first
+		for (size_t i = 0; i < files.size() && totalSize > CACHE_MAX_SIZE; ++i)
+		{
+			if (DeleteFile(files[i].second.second->Get()))
+				totalSize -= files[i].second.first;
+		}
+	}
+	return totalSize;
+}
+
+static bool WriteLoudnessCache (const char* key, BR_LoudnessCacheHeader& header, const vector<double>& shortTermValues, const vector<double>& momentaryValues, const vector<double>& energy, const vector<double>& peak, const vector<double>& peakPos)
+{
+	if (!key || !*key)
+		return false;
+
+	SWS_SectionLock lock(&g_cacheMutex);
+	WDL_FastString path = GetLoudnessCachePath(key, true);
+
+	// Don't overwrite full analyze data with integrated loudness only
+	if (header.integratedOnly && FileOrDirExists(path.Get()))
+	{
+		TouchLoudnessCache(path.Get());
+		return false;
+	}
+
+	header.shortTermCount = (int)shortTermValues.size();
+	header.momentaryCount = (int)momentaryValues.size();
+	header.blockCount     = (int)energy.size();
+	header.peakCount      = (peakPos.size() == peak.size()) ? (int)peak.size() : 0;
+
+	unsigned char buf[CACHE_HEADER_SIZE];
+	int pos = 0;
+	memcpy(buf, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	pos += sizeof(CACHE_MAGIC);
+	PutCacheInt(buf, &pos, CACHE_VERSION);
+	PutCacheDouble(buf, &pos, (double)time(NULL));
+	PutCacheInt(buf, &pos, header.integratedOnly);
+	PutCacheInt(buf, &pos, header.truePeakAnalyzed);
+	PutCacheInt(buf, &pos, header.shortTermCount);
+	PutCacheInt(buf, &pos, header.momentaryCount);
+	PutCacheInt(buf, &pos, header.blockCount);
+	PutCacheInt(buf, &pos, header.peakCount);
+	PutCacheDouble(buf, &pos, header.integrated);
+	PutCacheDouble(buf, &pos, header.range);
+	PutCacheDouble(buf, &pos, header.truePeak);
+	PutCacheDouble(buf, &pos, header.truePeakPos);
+	PutCacheDouble(buf, &pos, header.shortTermMax);
+	PutCacheDouble(buf, &pos, header.momentaryMax);
+
+	WDL_INT64 oldSize = 0, newSize = 0;
+	time_t lastUsed;
+	if (!GetLoudnessCacheFileInfo(path.Get(), &oldSize, &lastUsed))
+		oldSize = 0;
+
+	bool success = false;
+	if (FILE* file = fopenUTF8(path.Get(), "wb"))
+	{
+		success = fwrite(buf, 1, sizeof(buf), file) == sizeof(buf)       &&
+		          WriteLoudnessCacheSeries(file, shortTermValues)         &&
+		          WriteLoudnessCacheSeries(file, momentaryValues)         &&
+		          WriteCacheDoubles(file, energy)                         &&
+		          (!header.peakCount || (WriteCacheDoubles(file, peak) && WriteCacheDoubles(file, peakPos)));
+		newSize = (WDL_INT64)ftell(file);
+		fclose(file);
+		if (!success)
+		{
+			DeleteFile(path.Get());
+			newSize = 0;
+		}
+	}
+
+	// Directory is scanned only once per session and then again only when the running total goes over the limit
+	if (g_cacheSize < 0 || g_cacheSize + newSize - oldSize > CACHE_MAX_SIZE)
+		g_cacheSize = EvictLoudnessCache();
+	else
+		g_cacheSize += newSize - oldSize;
+	return success;
+}
+
+// Block peaks end up empty if they weren't analyzed
+static bool ReadLoudnessCache (const char* key, BR_LoudnessCacheHeader* header, vector<double>* shortTermValues, vector<double>* momentaryValues, vector<double>* energy = NULL, vector<double>* peak = NULL, vector<double>* peakPos = NULL)
+{
+	if (!key || !*key)
+		return false;
+
+	SWS_SectionLock lock(&g_cacheMutex);
+	WDL_FastString path = GetLoudnessCachePath(key, false);
+
+	bool success = false;
+	if (FILE* file = fopenUTF8(path.Get(), "rb"))
+	{
+		unsigned char buf[CACHE_HEADER_SIZE];
+		int pos = sizeof(CACHE_MAGIC);
+		if (fread(buf, 1, sizeof(buf), file) == sizeof(buf) && !memcmp(buf, CACHE_MAGIC, sizeof(CACHE_MAGIC)) && GetCacheInt(buf, &pos) == CACHE_VERSION)
+		{
+			BR_LoudnessCacheHeader tmp;
+			GetCacheDouble(buf, &pos); // last used
+			tmp.integratedOnly   = GetCacheInt(buf, &pos);
+			tmp.truePeakAnalyzed = GetCacheInt(buf, &pos);
+			tmp.shortTermCount   = GetCacheInt(buf, &pos);
+			tmp.momentaryCount   = GetCacheInt(buf, &pos);
+			tmp.blockCount       = GetCacheInt(buf, &pos);
+			tmp.peakCount        = GetCacheInt(buf, &pos);
+			tmp.integrated       = GetCacheDouble(buf, &pos);
+			tmp.range            = GetCacheDouble(buf, &pos);
+			tmp.truePeak         = GetCacheDouble(buf, &pos);
+			tmp.truePeakPos      = GetCacheDouble(buf, &pos);
+			tmp.shortTermMax     = GetCacheDouble(buf, &pos);
+			tmp.momentaryMax     = GetCacheDouble(buf, &pos);
+
+			int shortTermOffset = CACHE_HEADER_SIZE;
+			int momentaryOffset = shortTermOffset + GetLoudnessCacheSeriesSize(tmp.shortTermCount);
+			int blocksOffset    = momentaryOffset + GetLoudnessCacheSeriesSize(tmp.momentaryCount);
+
+			success = tmp.shortTermCount >= 0 && tmp.momentaryCount >= 0 && tmp.blockCount >= 0 && tmp.peakCount >= 0;
+			if (success && shortTermValues && !ReadLoudnessCacheSeries(file, shortTermOffset, tmp.shortTermCount, shortTermValues)) success = false;
+			if (success && momentaryValues && !ReadLoudnessCacheSeries(file, momentaryOffset, tmp.momentaryCount, momentaryValues)) success = false;
+			if (success && energy)
+			{
+				if (peak)    peak->clear();
+				if (peakPos) peakPos->clear();
+				success = fseek(file, blocksOffset, SEEK_SET) == 0 && ReadCacheDoubles(file, tmp.blockCount, energy);
+				if (success && peak && peakPos)
+					success = ReadCacheDoubles(file, tmp.peakCount, peak) && ReadCacheDoubles(file, tmp.peakCount, peakPos);
+			}
+			if (success)
+				WritePtr(header, tmp);
+		}
+		fclose(file);
+	}
+
+	if (success)
+		TouchLoudnessCache(path.Get());
+	return success;
+}
+
+/******************************************************************************
+* Analyze blocks                                                              *
+******************************************************************************/
+// Every analysis keeps K-weighted energies of its 100 ms blocks (same as ebur128 sub-blocks that build momentary, short-term and gating
+// blocks) so after an edit only blocks in edited time range need decoding, everything else is gated again from cached energies
+static void ExtendRange (double* start, double* end, double rangeStart, double rangeEnd)
+{
+	if (rangeStart < *start) *start = rangeStart;
+	if (rangeEnd   > *end)   *end   = rangeEnd;
+}
+
+static double BlocksToLoudness (const vector<double>& energy, int end, int count)
+{
+	double sum = 0;
+	for (int i = end - count; i < end; ++i)
+		sum += energy[i];
+	return (sum > 0) ? 10 * log10(sum / count) - 0.691 : NEGATIVE_INF;
+}
+
+static bool IsSamePoint (BR_Envelope& envelope1, BR_Envelope& envelope2, int id1, int id2)
+{
+	double position1, value1, bezier1, position2, value2, bezier2;
+	int shape1, shape2;
+	envelope1.GetPoint(id1, &position1, &value1, &shape1, &bezier1);
+	envelope2.GetPoint(id2, &position2, &value2, &shape2, &bezier2);
+	return position1 == position2 && value1 == value2 && shape1 == shape2 && bezier1 == bezier2;
+}
+
+static bool GetEnvelopeEditedRange (BR_Envelope& oldEnv, BR_Envelope& newEnv, double* start, double* end)
+{
+	bool oldUsed = oldEnv.CountPoints() && oldEnv.IsActive();
+	bool newUsed = newEnv.CountPoints() && newEnv.IsActive();
+	if (oldUsed != newUsed)
+		return false;
+	if (!oldUsed)
+		return true;
+
+	int oldCount = oldEnv.CountPoints();
+	int newCount = newEnv.CountPoints();
+	int minCount = min(oldCount, newCount);
+	int first = 0;
+	int last  = 0;
+	while (first < minCount && IsSamePoint(oldEnv, newEnv, first, first))
+		++first;
+	if (first == oldCount && first == newCount)
+		return true;
+	while (last < minCount - first && IsSamePoint(oldEnv, newEnv, oldCount - 1 - last, newCount - 1 - last))
+		++last;
+
+	// Changed points also change segments around them: from the last unchanged point before them to the first unchanged one after them
+	double editStart = -numeric_limits<double>::max();
+	double editEnd   =  numeric_limits<double>::max();
+	if (first > 0) oldEnv.GetPoint(first - 1,     &editStart, NULL, NULL, NULL);
+	if (last > 0)  oldEnv.GetPoint(oldCount - last, &editEnd,   NULL, NULL, NULL);
+	ExtendRange(start, end, editStart, editEnd);
+	return true;
+}
+
+static void GetLayoutItemHash (MediaItem* item, bool takeRelative, char* hash)
+{
+	// Item chunk holds everything that affects item's audio (takes, sources, take FX, fades, MIDI events...) so hash it without lines that
+	// don't. Item bounds and source offset are compared separately so trims can be localized (see GetEditedRange) and take volume envelope
+	// is applied during analysis. Chunk is only read, lines are hashed in place
+	WDL_SHA1 sha;
+	char* chunk = GetSetObjectState(item, "");
+	int skipDepth = 0;
+	const char* line = chunk;
+	while (line && *line)
+	{
+		const char* lineEnd = strchr(line, '\n');
+		if (!lineEnd)
+			lineEnd = line + strlen(line);
+
+		const char* token = line;
+		while (token < lineEnd && (*token == ' ' || *token == '\t'))
+			++token;
+
+		if (skipDepth)
+		{
+			if      (*token == '<') ++skipDepth;
+			else if (*token == '>') --skipDepth;
+		}
+		else if (takeRelative && !strncmp(token, "<VOLENV", sizeof("<VOLENV") - 1))
+			skipDepth = 1;
+		else if (strncmp(token, "SEL ",      sizeof("SEL ")      - 1) &&
+		         strncmp(token, "IID ",      sizeof("IID ")      - 1) &&
+		         strncmp(token, "POSITION ", sizeof("POSITION ") - 1) &&
+		         strncmp(token, "LENGTH ",   sizeof("LENGTH ")   - 1) &&
+		         strncmp(token, "SOFFS ",    sizeof("SOFFS ")    - 1)
+		)
+		{
+			sha.add(token, (int)(lineEnd - token));
+		}
+		line = (*lineEnd) ? lineEnd + 1 : lineEnd;
+	}
+	FreeHeapPtr(chunk);
+	sha.result(hash);
+}
+
+static void HashObjectChunk (WDL_SHA1& sha, void* object)
+{
+	if (char* chunk = GetSetObjectState(object, ""))
+	{
+		sha.add(chunk, (int)strlen(chunk));
+		FreeHeapPtr(chunk);
+	}
+}
+
+// Everything besides items that shapes audio coming from a track: FX, routing, envelopes and (for tracks that feed into analyzed track) fader
+// settings. Analyzed track's own fader is applied during analysis and its volume envelopes are compared separately (see GetEditedRange)
+static void HashTrackRouting (WDL_SHA1& sha, MediaTrack* track, MediaTrack* analyzedTrack)
+{
+	sha.add(GetSetMediaTrackInfo(track, "GUID", NULL), sizeof(GUID));
+	sha.add(GetSetMediaTrackInfo(track, "I_NCHAN", NULL), sizeof(int));
+	sha.add(GetSetMediaTrackInfo(track, "I_FXEN", NULL), sizeof(int));
+	if (track != analyzedTrack)
+	{
+		const char* doubles[] = {"D_VOL", "D_PAN", "D_WIDTH", "D_DUALPANL", "D_DUALPANR"};
+		const char* bools[]   = {"B_MUTE", "B_PHASE", "B_MAINSEND"};
+		for (size_t i = 0; i < sizeof(doubles) / sizeof(doubles[0]); ++i)
+			sha.add(GetSetMediaTrackInfo(track, doubles[i], NULL), sizeof(double));
+		for (size_t i = 0; i < sizeof(bools) / sizeof(bools[0]); ++i)
+			sha.add(GetSetMediaTrackInfo(track, bools[i], NULL), sizeof(bool));
+		sha.add(GetSetMediaTrackInfo(track, "I_PANMODE", NULL), sizeof(int));
+		sha.add(GetSetMediaTrackInfo(track, "C_MAINSEND_OFFS", NULL), sizeof(char));
+	}
+
+	// FX are compared by their parameters (getting FX chunks means getting the whole track chunk, items included)
+	for (int i = 0; i < TrackFX_GetCount(track); ++i)
+	{
+		char name[SNM_MAX_FX_NAME_LEN] = "";
+		TrackFX_GetFXName(track, i, name, sizeof(name));
+		bool enabled = TrackFX_GetEnabled(track, i);
+		sha.add(name, (int)strlen(name));
+		sha.add(&enabled, sizeof(enabled));
+		for (int j = 0; j < TrackFX_GetNumParams(track, i); ++j)
+		{
+			double min, max;
+			double value = TrackFX_GetParam(track, i, j, &min, &max);
+			sha.add(&value, sizeof(value));
+		}
+	}
+
+	for (int i = 0; i < GetTrackNumSends(track, -1); ++i)
+	{
+		const char* doubles[] = {"D_VOL", "D_PAN"};
+		const char* ints[]    = {"I_SENDMODE", "I_SRCCHAN", "I_DSTCHAN"};
+		const char* bools[]   = {"B_MUTE", "B_PHASE", "B_MONO"};
+		if (MediaTrack* source = (MediaTrack*)GetSetTrackSendInfo(track, -1, i, "P_SRCTRACK", NULL))
+			sha.add(GetSetMediaTrackInfo(source, "GUID", NULL), sizeof(GUID));
+		for (size_t j = 0; j < sizeof(doubles) / sizeof(doubles[0]); ++j)
+			sha.add(GetSetTrackSendInfo(track, -1, i, doubles[j], NULL), sizeof(double));
+		for (size_t j = 0; j < sizeof(ints) / sizeof(ints[0]); ++j)
+			sha.add(GetSetTrackSendInfo(track, -1, i, ints[j], NULL), sizeof(int));
+		for (size_t j = 0; j < sizeof(bools) / sizeof(bools[0]); ++j)
+			sha.add(GetSetTrackSendInfo(track, -1, i, bools[j], NULL), sizeof(bool));
+	}
+
+	for (int i = 0; i < CountTrackEnvelopes(track); ++i)
+	{
+		TrackEnvelope* envelope = GetTrackEnvelope(track, i);
+		if (track != analyzedTrack || (envelope != GetVolEnv(track) && envelope != GetVolEnvPreFX(track)))
+			HashObjectChunk(sha, envelope);
+	}
+}
+
+static void AddSourceTrack (vector<MediaTrack*>& sources, MediaTrack* track)
+{
+	if (track && find(sources.begin(), sources.end(), track) == sources.end())
+		sources.push_back(track);
+}
+
+static ebur128_state* CreateLoudnessState (int channels, int samplerate, int channelMode, int mode)
+{
+	ebur128_state* loudnessState = ebur128_init((size_t)channels, (size_t)samplerate, mode);
+
+	// Ignore channels according to channel mode. Note: we can't partially request samples, i.e. channel mode is mono, but take is stereo...asking for
+	// 1 channel only won't work. We must always request the real channel count even though reaper interleaves active channels starting from 0
+	if (channelMode > 1)
+	{
+		// Mono channel modes
+		if (channelMode <= 66)
+		{
+			ebur128_set_channel(loudnessState, 0, EBUR128_LEFT);
+			for (int i = 1; i <= channels; ++i)
+				ebur128_set_channel(loudnessState, i, EBUR128_UNUSED);
+		}
+		// Stereo channel modes
+		else
+		{
+			ebur128_set_channel(loudnessState, 0, EBUR128_LEFT);
+			ebur128_set_channel(loudnessState, 1, EBUR128_RIGHT);
+			for (int i = 2; i <= channels; ++i)
+				ebur128_set_channel(loudnessState, i, EBUR128_UNUSED);
+		}
+	}
+	else
+	{
+		ebur128_set_channel(loudnessState, 0, EBUR128_LEFT);
+		ebur128_set_channel(loudnessState, 1, EBUR128_RIGHT);
+		ebur128_set_channel(loudnessState, 2, EBUR128_CENTER);
+		ebur128_set_channel(loudnessState, 3, EBUR128_LEFT_SURROUND);
+		ebur128_set_channel(loudnessState, 4, EBUR128_RIGHT_SURROUND);
+	}
+	return loudnessState;
+}
 
 /******************************************************************************
 * Loudness object                                                             *
@@ -185,6 +792,7 @@ m_shortTermMax     (NEGATIVE_INF),
 m_momentaryMax     (NEGATIVE_INF),
 m_range            (0),
 m_progress         (0),
+m_allocations      (0),
 m_running          (false),
 m_analyzed         (false),
 m_killFlag         (false),
@@ -206,6 +814,7 @@ m_shortTermMax     (NEGATIVE_INF),
 m_momentaryMax     (NEGATIVE_INF),
 m_range            (0),
 m_progress         (0),
+m_allocations      (0),
 m_running          (false),
 m_analyzed         (false),
 m_killFlag         (false),
@@ -228,6 +837,7 @@ m_shortTermMax     (NEGATIVE_INF),
 m_momentaryMax     (NEGATIVE_INF),
 m_range            (0),
 m_progress         (0),
+m_allocations      (0),
 m_running          (false),
 m_analyzed         (false),
 m_killFlag         (false),
@@ -261,9 +871,15 @@ bool BR_LoudnessObject::Analyze (bool integratedOnly, bool doTruePeak)
 
 		if (!analyzed)
 		{
+			// Same audio was already analyzed at some point (in this or any other project) so skip decoding it again
+			if (this->LoadFromCache(integratedOnly, doTruePeak))
+				return true;
+
 			this->SetRunning(true);
 			this->SetProgress(0);
-			this->SetProcess((HANDLE)_beginthreadex(NULL, 0, this->AnalyzeData, (void*)this, 0, NULL));
+			this->SetProcess(GetAnalyzePool()->Queue(this->AnalyzeData, (void*)this));
+			if (!this->GetProcess())
+				this->SetRunning(false);
 		}
 		return true;
 	}
@@ -281,7 +897,10 @@ void BR_LoudnessObject::AbortAnalyze ()
 {
 	if (this->GetProcess())
 	{
+		// If the job is still waiting in the pool queue it never starts, otherwise kill flag stops it
 		this->SetKillFlag(true);
+		if (g_analyzePool)
+			g_analyzePool->Dequeue(this->GetProcess());
 		WaitForSingleObject(this->GetProcess(), INFINITE);
 		this->SetKillFlag(false);
 		CloseHandle(this->GetProcess());
@@ -304,6 +923,12 @@ double BR_LoudnessObject::GetProgress ()
 	return m_progress;
 }
 
+int BR_LoudnessObject::GetAnalyzeAllocations ()
+{
+	SWS_SectionLock lock(&m_mutex);
+	return m_allocations;
+}
+
 double BR_LoudnessObject::GetColumnVal (int column, int mode)
 {
 	SWS_SectionLock lock(&m_mutex);
@@ -484,7 +1109,7 @@ bool BR_LoudnessObject::RestoreObject (ProjectStateContext* ctx)
 
 			this->SetGuid(guid);
 			if (lp.gettoken_int(1) == 1) this->SetTrack(GuidToTrack(&guid));
-			else                         this->SetTake(GetMediaItemTakeByGUID(NULL, &guid));
+			else                         this->SetTake(GuidToTake(&guid));
 		}
 		else if (!strcmp(lp.gettoken_str(0), PROJ_OBJECT_KEY_MEASUREMENTS))
 		{
@@ -686,7 +1311,7 @@ bool BR_LoudnessObject::IsTargetValid ()
 			return true;
 		else
 		{
-			if (MediaItem_Take* newTake = GetMediaItemTakeByGUID(NULL, &guid))
+			if (MediaItem_Take* newTake = GuidToTake(&guid))
 			{
 				if (GuidsEqual(&guid, (GUID*)GetSetMediaItemTakeInfo(newTake, "GUID", NULL)))
 					this->SetTake(newTake);
@@ -740,13 +1365,37 @@ bool BR_LoudnessObject::CreateGraph (BR_Envelope& envelope, double minLUFS, doub
 	double newMin = envelope.LaneMinValue();
 	double newMax = envelope.LaneMaxValue();
 
+	// When zoomed out so far that consecutive values would end up less than a pixel apart, use maximums of every 2^level values instead
+	double interval = (momentary) ? 0.4 : 3;
+	double step     = interval;
+	int level = 0;
+	double hZoom = GetHZoomLevel();
+	while (hZoom > 0 && step * hZoom < 1 && level < 16)
+	{
+		step *= 2;
+		++level;
+	}
+
 	vector<double> values;
 	this->GetAnalyzeData(NULL, NULL, NULL, NULL, NULL, NULL, ((momentary) ? NULL : &values), ((momentary) ? &values : NULL));
+	if (level > 0)
+	{
+		size_t span = (size_t)1 << level;
+		for (size_t i = 0; i < values.size(); i += span)
+		{
+			double maxValue = values[i];
+			for (size_t j = i + 1; j < i + span && j < values.size(); ++j)
+				if (values[j] > maxValue)
+					maxValue = values[j];
+			values[i / span] = maxValue;
+		}
+		values.resize((values.size() + span - 1) / span);
+	}
 	envelope.DeletePointsInRange(start, end);
 
 	double position = start;
 	envelope.CreatePoint(envelope.CountPoints(), position, newMin, LINEAR, 0, false);
-	position += (momentary) ? 0.4 : 3;
+	position += interval;
 
 	size_t size = values.size();
 	for (size_t i = 0; i < size; ++i)
@@ -756,7 +1405,7 @@ bool BR_LoudnessObject::CreateGraph (BR_Envelope& envelope, double minLUFS, doub
 		if (i != size-1)
 		{
 			envelope.CreatePoint(envelope.CountPoints(), position, value, LINEAR, 0, false);
-			position += (momentary) ? 0.4 : 3;
+			position += step;
 		}
 		else
 		{
@@ -961,6 +1610,8 @@ unsigned WINAPI BR_LoudnessObject::AnalyzeData (void* loudnessObject)
 	// Get take/track info
 	BR_LoudnessObject* _this = (BR_LoudnessObject*)loudnessObject;
 	BR_LoudnessObject::AudioData data = _this->GetAudioData();
+	BR_LoudnessObject::AnalyzeBlocks blocks;
+	_this->GetAnalyzeBlocks(&blocks);
 
 	bool doPan               = (data.channels > 1              && data.pan != 0)               ? (true) : (false); // tracks will always get false here (see CheckSetAudioData())
 	bool doVolEnv            = (data.volEnv.CountPoints()      && data.volEnv.IsActive())      ? (true) : (false);
@@ -968,196 +1619,268 @@ unsigned WINAPI BR_LoudnessObject::AnalyzeData (void* loudnessObject)
 	bool doFadeIn            = !(data.fadeInStart  == data.fadeInEnd);
 	bool doFadeOut           = !(data.fadeOutStart == data.fadeOutEnd);
 	bool integratedOnly      = _this->GetIntegratedOnly();
-	bool doTruePeak          = _this->GetDoTruePeak();
+	bool doTruePeak          = _this->GetDoTruePeak() && !integratedOnly;
 
-	// Prepare ebur123_state
-	ebur128_state* loudnessState = NULL;
-	int mode = (integratedOnly) ? EBUR128_MODE_I : EBUR128_MODE_M | EBUR128_MODE_S | EBUR128_MODE_I | EBUR128_MODE_LRA;
-	if (!integratedOnly && doTruePeak)
+	// ebur128_state is only used for K-weighting and peaks of 100 ms blocks, gating is done from block energies at the end
+	int mode = EBUR128_MODE_M;
+	if (doTruePeak)
 		mode |= EBUR128_MODE_TRUE_PEAK;
-	loudnessState = ebur128_init((size_t)data.channels, (size_t)data.samplerate, mode);
 
-	// Ignore channels according to channel mode. Note: we can't partially request samples, i.e. channel mode is mono, but take is stereo...asking for
-	// 1 channel only won't work. We must always request the real channel count even though reaper interleaves active channels starting from 0
-	if (data.channelMode > 1)
-	{
-		// Mono channel modes
-		if (data.channelMode <= 66)
-		{
-			ebur128_set_channel(loudnessState, 0, EBUR128_LEFT);
-			for (int i = 1; i <= data.channels; ++i)
-				ebur128_set_channel(loudnessState, i, EBUR128_UNUSED);
-		}
-		// Stereo channel modes
-		else
-		{
-			ebur128_set_channel(loudnessState, 0, EBUR128_LEFT);
-			ebur128_set_channel(loudnessState, 1, EBUR128_RIGHT);
-			for (int i = 2; i <= data.channels; ++i)
-				ebur128_set_channel(loudnessState, i, EBUR128_UNUSED);
-		}
-	}
-	else
-	{
-		ebur128_set_channel(loudnessState, 0, EBUR128_LEFT);
-		ebur128_set_channel(loudnessState, 1, EBUR128_RIGHT);
-		ebur128_set_channel(loudnessState, 2, EBUR128_CENTER);
-		ebur128_set_channel(loudnessState, 3, EBUR128_LEFT_SURROUND);
-		ebur128_set_channel(loudnessState, 4, EBUR128_RIGHT_SURROUND);
-	}
+	// Find out which blocks from the last analysis are still valid (has to be done before audio end gets extended below)
+	double editStart, editEnd;
+	int blockShift;
+	double audioEnd = data.audioEnd;
+	bool reuseBlocks = GetEditedRange(blocks, data, !_this->IsTrack(), doTruePeak, &editStart, &editEnd, &blockShift);
 
 	// This lets us get integrated reading even if the target is too short
 	bool doShortTerm = true;
-	bool doMomentary = true;
 	double effectiveEndTime = data.audioEnd;
 	if (data.audioEnd - data.audioStart < 3)
 	{
-		doShortTerm = false; // doMomentary is set during calculation
+		doShortTerm = false;
 		data.audioEnd = data.audioStart + 3;
 	}
 
-	// Fill loudnessState with samples and get momentary/short-term measurements
-	int sampleCount = data.samplerate/5;
-	int bufSz = sampleCount * data.channels;
-	int processedSamples = 0;
-	double sampleTimeLen = 1 / data.samplerate;
-	double currentTime   = data.audioStart;
-	int i = 0;
-	int momentaryFilled = 1;
-	while (currentTime < data.audioEnd && !_this->GetKillFlag())
+	// Gain that doesn't change over time is the same for every block - volume fader and pan (pan fader only affects takes, and they have no pan law!)
+	vector<double> channelGain(data.channels, data.volume);
+	if (doPan)
 	{
-		// Make sure we always fill our buffer exactly to audio end (and skip momentary/short-term intervals if not enough new samples)
-		bool skipIntervals = false;
-		if (data.audioEnd - currentTime < 0.2 + numeric_limits<double>::epsilon())
+		for (int i = 0; i < data.channels; ++i)
 		{
-			sampleCount = (int)(data.samplerate * (data.audioEnd - currentTime));
-			bufSz = sampleCount * data.channels;
-			skipIntervals = true;
+			if      (data.pan > 0 && (i % 2 == 0)) channelGain[i] *= 1 - data.pan;
+			else if (data.pan < 0 && (i % 2 == 1)) channelGain[i] *= 1 + data.pan;
 		}
+	}
 
-		// Get new 200 ms of samples
-		double* buf = new double[bufSz];
-		GetAudioAccessorSamples(data.audio, data.samplerate, data.channels, currentTime, sampleCount, buf);
+	// Audio is analyzed in 100 ms blocks (same size as ebur128 uses for sub-blocks), last block can be partial
+	int blockFrames = (data.samplerate + 5) / 10;
+	int totalFrames = (int)(data.samplerate * (data.audioEnd - data.audioStart));
+	int fullBlocks  = totalFrames / blockFrames;
+	int blockCount  = (totalFrames % blockFrames) ? fullBlocks + 1 : fullBlocks;
+	vector<double> energy(fullBlocks, 0);
+	vector<double> peak((doTruePeak) ? blockCount : 0, 0);
+	vector<double> peakPos((doTruePeak) ? blockCount : 0, -1);
+
+	// Decode only edited blocks and blocks past the old end (the old partial block included)
+	vector<pair<int,int> > ranges;
+	if (reuseBlocks)
+	{
+		// New block i is old block i + blockShift (blocks shifted out at the start are covered by edited range)
+		int reused = max(0, min((int)blocks.energy.size() - blockShift, fullBlocks));
+		double shiftLen = (double)blockShift * blockFrames / data.samplerate;
+		for (int i = max(0, -blockShift); i < reused; ++i)
+		{
+			energy[i] = blocks.energy[i + blockShift];
+			if (doTruePeak)
+			{
+				peak[i]    = blocks.peak[i + blockShift];
+				peakPos[i] = blocks.peakPos[i + blockShift] - shiftLen;
+			}
+		}
 
-		// Correct for volume, fade, and pan/volume envelopes
-		int currentChannel = 1;
-		double sampleTime = currentTime;
-		for (int j = 0; j < bufSz; ++j)
+		if (editStart <= editEnd)
+		{
+			double blockLen = (double)blockFrames / (double)data.samplerate;
+			double first = SetToBounds(floor((editStart - data.audioStart) / blockLen),                  0.0, (double)blockCount);
+			double last  = SetToBounds(ceil((editEnd - data.audioStart) / blockLen) + BLOCK_POSTROLL, 0.0, (double)blockCount);
+			if (first < last)
+				ranges.push_back(make_pair((int)first, (int)last));
+		}
+		if (reused < blockCount)
 		{
-			double adjust = 1;
+			if (ranges.size() && ranges.back().second + BLOCK_PREROLL >= reused)
+			{
+				ranges.back().first  = min(ranges.back().first, reused);
+				ranges.back().second = blockCount;
+			}
+			else
+				ranges.push_back(make_pair(reused, blockCount));
+		}
+	}
+	else
+	{
+		ranges.push_back(make_pair(0, blockCount));
+	}
 
-			// Volume envelopes
-			if (doVolPreFXEnv) adjust *= data.volEnvPreFX.ValueAtPosition(sampleTime);
-			if (doVolEnv)      adjust *= data.volEnv.ValueAtPosition(sampleTime);
+	// Everything the loop needs is allocated here so processing audio doesn't touch the heap
+	vector<double> buf(blockFrames * data.channels);
+	vector<double> gainBuf((doVolEnv || doVolPreFXEnv) ? blockFrames : 0);
+	vector<double> envBuf((doVolEnv && doVolPreFXEnv) ? blockFrames : 0);
+	if (!integratedOnly)
+	{
+		momentaryValues.reserve(fullBlocks / 4 + 1);
+		shortTermValues.reserve(fullBlocks / 30 + 1);
+	}
+	size_t momentaryCapacity = momentaryValues.capacity();
+	size_t shortTermCapacity = shortTermValues.capacity();
+	int allocations = 0;
 
-			// Volume fader
-			adjust *= data.volume;
+	int decodeCount   = 0;
+	int decodedBlocks = 0;
+	for (size_t i = 0; i < ranges.size(); ++i)
+		decodeCount += ranges[i].second - max(0, ranges[i].first - BLOCK_PREROLL);
+
+	for (size_t i = 0; i < ranges.size() && !_this->GetKillFlag(); ++i)
+	{
+		// Every range starts with clean filter state, preroll blocks only let it settle
+		int firstBlock = max(0, ranges[i].first - BLOCK_PREROLL);
+		double rangeStart = (double)firstBlock * blockFrames / data.samplerate;
+		ebur128_state* loudnessState = CreateLoudnessState(data.channels, data.samplerate, data.channelMode, mode);
+
+		// Volume envelopes get rendered once per block (not once per sample and channel), cursors keep envelope segments between blocks
+		int volEnvCursor      = -2;
+		int volEnvPreFXCursor = -2;
+		for (int block = firstBlock; block < ranges[i].second && !_this->GetKillFlag(); ++block)
+		{
+			int sampleCount = (block < fullBlocks) ? blockFrames : totalFrames - fullBlocks * blockFrames;
+			double currentTime = data.audioStart + (double)block * blockFrames / data.samplerate;
+			double sampleTimeLen = 1.0 / data.samplerate;
+			GetAudioAccessorSamples(data.audio, data.samplerate, data.channels, currentTime, sampleCount, &buf[0]);
 
-			// Pan fader (takes only)
-			if (doPan)
+			// Correct for volume, fade, and pan/volume envelopes
+			if (doVolEnv || doVolPreFXEnv)
 			{
-				if (data.pan > 0 && (currentChannel % 2 == 1))
-					adjust *= 1 - data.pan;                         // takes have no pan law!
-				else if (data.pan < 0 && (currentChannel % 2 == 0))
-					adjust *= 1 + data.pan;
-			}
+				if (doVolPreFXEnv && doVolEnv)
+				{
+					data.volEnvPreFX.ValuesAtPositions(currentTime, sampleTimeLen, sampleCount, &gainBuf[0], &volEnvPreFXCursor);
+					data.volEnv.ValuesAtPositions(currentTime, sampleTimeLen, sampleCount, &envBuf[0], &volEnvCursor);
+					for (int j = 0; j < sampleCount; ++j)
+						gainBuf[j] *= envBuf[j];
+				}
+				else if (doVolPreFXEnv)
+					data.volEnvPreFX.ValuesAtPositions(currentTime, sampleTimeLen, sampleCount, &gainBuf[0], &volEnvPreFXCursor);
+				else
+					data.volEnv.ValuesAtPositions(currentTime, sampleTimeLen, sampleCount, &gainBuf[0], &volEnvCursor);
 
-			// Fades
-//			if (doFadeIn)  adjust *= GetNormalizedFadeValue(sampleTime, data.fadeInStart,  data.fadeInEnd,  data.fadeInShape,  data.fadeInCurve,  false);
-//			if (doFadeOut) adjust *= GetNormalizedFadeValue(sampleTime, data.fadeOutStart, data.fadeOutEnd, data.fadeOutShape, data.fadeOutCurve, true);
+				// Fades
+//				if (doFadeIn)  adjust *= GetNormalizedFadeValue(sampleTime, data.fadeInStart,  data.fadeInEnd,  data.fadeInShape,  data.fadeInCurve,  false);
+//				if (doFadeOut) adjust *= GetNormalizedFadeValue(sampleTime, data.fadeOutStart, data.fadeOutEnd, data.fadeOutShape, data.fadeOutCurve, true);
 
-			buf[j] *= adjust;
+				for (int j = 0, frame = 0; frame < sampleCount; ++frame)
+				{
+					for (int channel = 0; channel < data.channels; ++channel, ++j)
+						buf[j] *= gainBuf[frame] * channelGain[channel];
+				}
+			}
+			else
+			{
+				for (int j = 0, frame = 0; frame < sampleCount; ++frame)
+				{
+					for (int channel = 0; channel < data.channels; ++channel, ++j)
+						buf[j] *= channelGain[channel];
+				}
+			}
+			ebur128_add_frames_double(loudnessState, &buf[0], sampleCount);
+
+			if (block >= ranges[i].first)
+			{
+				if (block < fullBlocks)
+					ebur128_energy_window(loudnessState, blockFrames, &energy[block]);
 
-			if (++currentChannel > data.channels)
-				currentChannel = 1;
+				if (doTruePeak)
+				{
+					peak[block]    = 0;
+					peakPos[block] = -1;
+					for (int channel = 0; channel < data.channels; ++channel)
+					{
+						double channelTruePeak, channelTruePeakPos;
+						ebur128_true_peak(loudnessState, channel, &channelTruePeak, &channelTruePeakPos);
+						if (channelTruePeak > peak[block] || peakPos[block] < 0)
+						{
+							peak[block]    = channelTruePeak;
+							peakPos[block] = rangeStart + channelTruePeakPos;
+						}
+					}
+				}
+			}
+			if (doTruePeak)
+				ebur128_reset_peaks(loudnessState);
 
-			double nextSampleTime = (currentChannel+1 > data.channels) ? (sampleTime + sampleTimeLen) : (-1);
-			if (nextSampleTime != -1)
-				sampleTime = nextSampleTime;
+			_this->SetProgress((double)(++decodedBlocks) / (double)decodeCount * 0.95); // leave last bit of progress for gating
 		}
-		ebur128_add_frames_double(loudnessState, buf, sampleCount);
-		delete[] buf;
 
-		if (!integratedOnly && !skipIntervals)
+		// Gating blocks are the only thing ebur128 allocates while adding frames, but they're never requested (see mode above)
+		allocations += (int)ebur128_heap_allocations(loudnessState);
+		assert(ebur128_heap_allocations(loudnessState) == 0);
+		ebur128_destroy(&loudnessState);
+	}
+
+	// Get integrated, loudness range and momentary/short-term measurements from block energies
+	if (!_this->GetKillFlag())
+	{
+		if (fullBlocks)
+			ebur128_loudness_global_blocks(&energy[0], fullBlocks, &integrated);
+
+		if (!integratedOnly)
 		{
-			if (!doShortTerm && doMomentary)
-			{
-				if (currentTime + 0.2 >= effectiveEndTime + numeric_limits<double>::epsilon())
-					doMomentary = false;
-			}
+			if (fullBlocks)
+				ebur128_loudness_range_blocks(&energy[0], fullBlocks, &range);
 
-			// Momentary buffer (400 ms) filled
-			if (i % 2 == momentaryFilled && doMomentary)
+			// Momentary every 400 ms, but only up to the real end if target is too short
+			for (int block = 4; block <= fullBlocks; block += 4)
 			{
-				double momentary;
-				ebur128_loudness_momentary(loudnessState, &momentary);
-				if (momentary == -HUGE_VAL)
-					momentary = NEGATIVE_INF;
+				if (!doShortTerm && data.audioStart + (double)block * blockFrames / data.samplerate >= effectiveEndTime + numeric_limits<double>::epsilon())
+					break;
+
+				double momentary = BlocksToLoudness(energy, block, 4);
 				if (momentary > momentaryMax)
 					momentaryMax = momentary;
 				momentaryValues.push_back(momentary);
 			}
 
-			// Short-term buffer (3000 ms) filled
-			if (i == 14 && doShortTerm)
+			// Short-term every 3000 ms
+			for (int block = 30; block <= fullBlocks && doShortTerm; block += 30)
 			{
-				double shortTerm;
-				ebur128_loudness_shortterm(loudnessState, &shortTerm);
-				if (shortTerm == -HUGE_VAL)
-					shortTerm = NEGATIVE_INF;
+				double shortTerm = BlocksToLoudness(energy, block, 30);
 				if (shortTerm > shortTermMax)
 					shortTermMax = shortTerm;
 				shortTermValues.push_back(shortTerm);
 			}
-		}
-
-		// This is definitely more accurate than adding 0.2 seconds every time
-		processedSamples += sampleCount;
-		currentTime = data.audioStart + ((double)processedSamples / (double)data.samplerate);
 
-		_this->SetProgress ((currentTime - data.audioStart) / (data.audioEnd - data.audioStart) * 0.95); // loudness_global and loudness_range seem rather fast and since we currently
-		if (++i == 15)                                                                                   // can't monitor their progress, leave last 10% of progress for them
-		{
-			i = 0;
-			momentaryFilled = (momentaryFilled == 1) ? (0) : (1);
-		}
-
-		// We reached the end of the file, break without checking currentTime against endTime (rounding errors could make us go through loop one more time)
-		if (skipIntervals)
-			break;
-	}
-
-	// Get integrated and loudness range
-	if (!_this->GetKillFlag())
-	{
-		ebur128_loudness_global(loudnessState, &integrated);
-		if (!integratedOnly)
-		{
-			ebur128_loudness_range(loudnessState, &range);
 			if (doTruePeak)
 			{
-				for (int i = 0; i < data.channels; ++i)
+				for (int i = 0; i < blockCount; ++i)
 				{
-					double channelTruePeak, channelTruePeakPos;
-					ebur128_true_peak(loudnessState, i, &channelTruePeak, &channelTruePeakPos);
-					if (channelTruePeak > truePeak)
+					if (peak[i] > truePeak)
 					{
-						truePeak   = channelTruePeak;
-						truePeakPos = channelTruePeakPos;
+						truePeak    = peak[i];
+						truePeakPos = peakPos[i];
 					}
 				}
 				truePeak = VAL2DB(truePeak);
 				_this->SetTruePeakAnalyzed(true);
 			}
-
 		}
 	}
-	ebur128_destroy(&loudnessState);
 
 	// Write analyze data
 	if (!_this->GetKillFlag())
 	{
+		BR_LoudnessCacheHeader header;
+		header.integratedOnly   = (integratedOnly) ? 1 : 0;
+		header.truePeakAnalyzed = (doTruePeak) ? 1 : 0;
+		header.integrated       = integrated;
+		header.range            = range;
+		header.truePeak         = truePeak;
+		header.truePeakPos      = truePeakPos;
+		header.shortTermMax     = shortTermMax;
+		header.momentaryMax     = momentaryMax;
+		WriteLoudnessCache(data.cacheKey, header, shortTermValues, momentaryValues, energy, peak, peakPos);
+
+		// Keep blocks for the next analysis
+		data.audioEnd = audioEnd;
+		blocks.energy.swap(energy);
+		blocks.peak.swap(peak);
+		blocks.peakPos.swap(peakPos);
+		blocks.truePeak  = doTruePeak;
+		blocks.audioData = data;
+		_this->SetAnalyzeBlocks(blocks);
+
+		if (momentaryValues.capacity() != momentaryCapacity) ++allocations;
+		if (shortTermValues.capacity() != shortTermCapacity) ++allocations;
+
 		_this->SetAnalyzeData(integrated, range, truePeak, truePeakPos, shortTermMax, momentaryMax, shortTermValues, momentaryValues);
+		_this->SetAnalyzeAllocations(allocations);
 		_this->SetProgress(1);
 		_this->SetRunning(false);
 		if (!integratedOnly)
@@ -1257,6 +1980,8 @@ int BR_LoudnessObject::CheckSetAudioData ()
 		audioData.fadeOutShape = fadeOutShape;
 		audioData.volEnv       = volEnv;
 		audioData.volEnvPreFX  = volEnvPreFX;
+		this->GetLayout(&audioData);
+		GetCacheKey(audioData, audioData.cacheKey);
 
 		this->SetAudioData(audioData);
 
@@ -1268,6 +1993,265 @@ int BR_LoudnessObject::CheckSetAudioData ()
 		return 1;
 }
 
+void BR_LoudnessObject::GetCacheKey (BR_LoudnessObject::AudioData& audioData, char* key)
+{
+	// Everything that makes analyze data different: audio itself, its bounds, gain and routing (note: fades are currently ignored when analyzing)
+	WDL_SHA1 sha;
+	int    ints[]    = {CACHE_VERSION, audioData.samplerate, audioData.channels, audioData.channelMode};
+	double doubles[] = {audioData.audioStart, audioData.audioEnd, audioData.volume, audioData.pan};
+	sha.add(audioData.audioHash, (int)strlen(audioData.audioHash));
+	sha.add(ints, sizeof(ints));
+	sha.add(doubles, sizeof(doubles));
+	sha.add(audioData.routingHash, sizeof(audioData.routingHash)); // FX and routing of tracks feeding the analyzed one
+
+	BR_Envelope* envelopes[] = {&audioData.volEnv, &audioData.volEnvPreFX};
+	for (int i = 0; i < 2; ++i)
+	{
+		int envInts[] = {(envelopes[i]->IsActive()) ? 1 : 0, envelopes[i]->CountPoints()};
+		sha.add(envInts, sizeof(envInts));
+
+		for (int j = 0; j < envInts[1]; ++j)
+		{
+			double point[3]; int shape;
+			envelopes[i]->GetPoint(j, &point[0], &point[1], &shape, &point[2]);
+			sha.add(point, sizeof(point));
+			sha.add(&shape, sizeof(shape));
+		}
+	}
+
+	char hash[20];
+	sha.result(hash);
+	for (int i = 0; i < 20; ++i)
+		sprintf(key + i*2, "%02X", (unsigned char)(hash[i] & 0xFF));
+	key[40] = 0;
+}
+
+bool BR_LoudnessObject::GetEditedRange (BR_LoudnessObject::AnalyzeBlocks& blocks, BR_LoudnessObject::AudioData& audioData, bool isTake, bool doTruePeak, double* start, double* end, int* blockShift)
+{
+	// Anything that changes gain of all the blocks means full re-analysis (audio end is ok, blocks past old end get analyzed anyway)
+	BR_LoudnessObject::AudioData& oldData = blocks.audioData;
+	if (blocks.energy.empty()                       ||
+	    (doTruePeak && !blocks.truePeak)            ||
+	    !oldData.layoutValid                        ||
+	    !audioData.layoutValid                      ||
+	    oldData.samplerate  != audioData.samplerate  ||
+	    oldData.channels    != audioData.channels    ||
+	    oldData.channelMode != audioData.channelMode ||
+	    oldData.audioStart  != audioData.audioStart  ||
+	    oldData.volume      != audioData.volume      ||
+	    oldData.pan         != audioData.pan         ||
+	    memcmp(oldData.routingHash, audioData.routingHash, sizeof(oldData.routingHash))
+	)
+	{
+		return false;
+	}
+
+	*start =  numeric_limits<double>::max();
+	*end   = -numeric_limits<double>::max();
+	*blockShift = 0;
+
+	// Take audio starts at item start, so trimming item start shifts the whole audio. Old blocks can still be used if it shifted by whole blocks
+	// (i.e. trimming to grid) but not if take volume envelope is used (it doesn't shift with the audio)
+	double shift = 0;
+	if (isTake)
+	{
+		if (oldData.layout.size() != 1 || audioData.layout.size() != 1)
+			return false;
+
+		shift = oldData.layout[0].sourceStart - audioData.layout[0].sourceStart;
+		if (fabs(shift) > SOURCE_POS_DELTA)
+		{
+			int blockFrames = (audioData.samplerate + 5) / 10;
+			double shiftFrames = shift * audioData.samplerate;
+			int blocksShifted = (int)floor(shiftFrames / blockFrames + 0.5);
+			if (fabs(shiftFrames - (double)blocksShifted * blockFrames) > 0.01 || (audioData.volEnv.CountPoints() && audioData.volEnv.IsActive()))
+				return false;
+
+			*blockShift = blocksShifted;
+			shift = (double)blocksShifted * blockFrames / audioData.samplerate;
+		}
+		else
+			shift = 0;
+	}
+
+	// Moved, slip edited, added, removed or changed items (different take, take FX etc...): both old and new position are edited. Trimmed items
+	// only change between their old and new edges (fades move with the edges)
+	for (size_t i = 0; i < oldData.layout.size(); ++i)
+	{
+		LayoutItem oldItem = oldData.layout[i];
+		oldItem.start       -= shift;
+		oldItem.end         -= shift;
+		oldItem.sourceStart -= shift;
+
+		bool found = false;
+		for (size_t j = 0; j < audioData.layout.size(); ++j)
+		{
+			LayoutItem& newItem = audioData.layout[j];
+			if (GuidsEqual(&oldItem.guid, &newItem.guid))
+			{
+				if (memcmp(oldItem.hash, newItem.hash, sizeof(oldItem.hash)) || (!isTake && fabs(oldItem.sourceStart - newItem.sourceStart) > SOURCE_POS_DELTA))
+				{
+					if (isTake)
+						return false;
+					ExtendRange(start, end, oldItem.start, oldItem.end);
+					ExtendRange(start, end, newItem.start, newItem.end);
+				}
+				else
+				{
+					if (oldItem.start != newItem.start)
+						ExtendRange(start, end, min(oldItem.start, newItem.start), max(oldItem.start, newItem.start) + max(oldItem.fadeIn, newItem.fadeIn));
+					if (oldItem.end != newItem.end)
+						ExtendRange(start, end, min(oldItem.end, newItem.end) - max(oldItem.fadeOut, newItem.fadeOut), max(oldItem.end, newItem.end));
+				}
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			ExtendRange(start, end, oldItem.start, oldItem.end);
+	}
+	for (size_t i = 0; i < audioData.layout.size(); ++i)
+	{
+		LayoutItem& newItem = audioData.layout[i];
+		bool found = false;
+		for (size_t j = 0; j < oldData.layout.size() && !found; ++j)
+			found = GuidsEqual(&newItem.guid, &oldData.layout[j].guid);
+		if (!found)
+			ExtendRange(start, end, newItem.start, newItem.end);
+	}
+
+	if (!GetEnvelopeEditedRange(oldData.volEnv, audioData.volEnv, start, end))
+		return false;
+	if (!GetEnvelopeEditedRange(oldData.volEnvPreFX, audioData.volEnvPreFX, start, end))
+		return false;
+
+	// Audio changed but we don't know where, be safe
+	if (*start > *end && shift == 0 && oldData.audioEnd == audioData.audioEnd && strcmp(oldData.audioHash, audioData.audioHash))
+		return false;
+
+	// Track FX tails (reverbs, delays, compressor release...) carry the edit to the end of audio, lookahead moves it slightly earlier
+	if (*start <= *end && audioData.layoutTail)
+	{
+		*start -= FX_LOOKAHEAD;
+		*end    = numeric_limits<double>::max();
+	}
+	return true;
+}
+
+void BR_LoudnessObject::GetLayout (BR_LoudnessObject::AudioData* audioData)
+{
+	audioData->layout.clear();
+	memset(audioData->routingHash, 0, sizeof(audioData->routingHash));
+	audioData->layoutValid = false;
+	audioData->layoutTail  = false;
+
+	if (MediaTrack* track = this->GetTrack())
+	{
+		// Master track gets audio from everything
+		if (track == GetMasterTrack(NULL))
+			return;
+
+		// Analyzed audio is made of items on the track itself, its folder children and tracks sending to it (and so on)
+		vector<MediaTrack*> sources(1, track);
+		for (size_t i = 0; i < sources.size(); ++i)
+		{
+			MediaTrack* source = sources[i];
+			for (int j = 0; j < GetTrackNumSends(source, -1); ++j)
+				AddSourceTrack(sources, (MediaTrack*)GetSetTrackSendInfo(source, -1, j, "P_SRCTRACK", NULL));
+
+			if (*(int*)GetSetMediaTrackInfo(source, "I_FOLDERDEPTH", NULL) == 1)
+			{
+				int depth = 1;
+				for (int id = CSurf_TrackToID(source, false) + 1; depth > 0 && id <= CountTracks(NULL); ++id)
+				{
+					MediaTrack* child = CSurf_TrackFromID(id, false);
+					AddSourceTrack(sources, child);
+					depth += *(int*)GetSetMediaTrackInfo(child, "I_FOLDERDEPTH", NULL);
+				}
+			}
+		}
+
+		WDL_SHA1 sha;
+		for (size_t i = 0; i < sources.size(); ++i)
+		{
+			MediaTrack* source = sources[i];
+			HashTrackRouting(sha, source, track);
+			if (TrackFX_GetCount(source))
+				audioData->layoutTail = true;
+
+			for (int j = 0; j < CountTrackMediaItems(source); ++j)
+			{
+				MediaItem* item = GetTrackMediaItem(source, j);
+				LayoutItem layoutItem;
+				GetLayoutItem(item, GetMediaItemInfo_Value(item, "D_POSITION"), *(GUID*)GetSetMediaItemInfo(item, "GUID", NULL), false, &layoutItem);
+				audioData->layout.push_back(layoutItem);
+			}
+		}
+		sha.result(audioData->routingHash);
+		audioData->layoutValid = true;
+	}
+	else if (MediaItem* item = this->GetItem())
+	{
+		// Take audio accessor starts at item start
+		LayoutItem layoutItem;
+		GetLayoutItem(item, audioData->audioStart, this->GetGuid(), true, &layoutItem);
+		audioData->layout.push_back(layoutItem);
+		audioData->layoutValid = true;
+	}
+}
+
+void BR_LoudnessObject::GetLayoutItem (MediaItem* item, double position, const GUID& guid, bool takeRelative, BR_LoudnessObject::LayoutItem* layoutItem)
+{
+	// Source start is where position 0 of active take's source would play. Trimming the item keeps it, moving or slip editing it doesn't
+	layoutItem->guid        = guid;
+	layoutItem->start       = position;
+	layoutItem->end         = position + GetMediaItemInfo_Value(item, "D_LENGTH");
+	layoutItem->sourceStart = position;
+	layoutItem->fadeIn      = GetEffectiveFadeLength(item, false);
+	layoutItem->fadeOut     = GetEffectiveFadeLength(item, true);
+	if (MediaItem_Take* take = GetActiveTake(item))
+	{
+		double playrate = *(double*)GetSetMediaItemTakeInfo(take, "D_PLAYRATE", NULL);
+		if (playrate > 0)
+			layoutItem->sourceStart -= *(double*)GetSetMediaItemTakeInfo(take, "D_STARTOFFS", NULL) / playrate;
+	}
+	GetLayoutItemHash(item, takeRelative, layoutItem->hash);
+}
+
+bool BR_LoudnessObject::LoadFromCache (bool integratedOnly, bool doTruePeak)
+{
+	char key[41];
+	{
+		SWS_SectionLock lock(&m_mutex);
+		lstrcpyn(key, m_audioData.cacheKey, sizeof(key));
+	}
+
+	BR_LoudnessCacheHeader header;
+	BR_LoudnessObject::AnalyzeBlocks blocks;
+	vector<double> shortTermValues, momentaryValues;
+	if (!ReadLoudnessCache(key, &header, &shortTermValues, &momentaryValues, &blocks.energy, &blocks.peak, &blocks.peakPos))
+		return false;
+
+	// Cached data has to contain everything requested (true peak is analyzed only with full analysis)
+	if (header.integratedOnly && !integratedOnly)
+		return false;
+	if (!integratedOnly && doTruePeak && !header.truePeakAnalyzed)
+		return false;
+
+	// Blocks come along so the next edit gets re-analyzed incrementally
+	blocks.truePeak  = header.truePeakAnalyzed && header.peakCount > 0;
+	blocks.audioData = this->GetAudioData();
+	this->SetAnalyzeBlocks(blocks);
+
+	this->SetAnalyzeData(header.integrated, header.range, header.truePeak, header.truePeakPos, header.shortTermMax, header.momentaryMax, shortTermValues, momentaryValues);
+	this->SetIntegratedOnly(!!header.integratedOnly);
+	this->SetTruePeakAnalyzed(!!header.truePeakAnalyzed);
+	this->SetAnalyzedStatus(!header.integratedOnly);
+	this->SetProgress(1);
+	this->SetRunning(false);
+	return true;
+}
+
 void BR_LoudnessObject::SetAudioData (const BR_LoudnessObject::AudioData& audioData)
 {
 	SWS_SectionLock lock(&m_mutex);
@@ -1292,6 +2276,24 @@ void BR_LoudnessObject::SetProgress (double progress)
 	m_progress = progress;
 }
 
+void BR_LoudnessObject::SetAnalyzeAllocations (int allocations)
+{
+	SWS_SectionLock lock(&m_mutex);
+	m_allocations = allocations;
+}
+
+void BR_LoudnessObject::SetAnalyzeBlocks (const BR_LoudnessObject::AnalyzeBlocks& blocks)
+{
+	SWS_SectionLock lock(&m_mutex);
+	m_blocks = blocks;
+}
+
+void BR_LoudnessObject::GetAnalyzeBlocks (BR_LoudnessObject::AnalyzeBlocks* blocks)
+{
+	SWS_SectionLock lock(&m_mutex);
+	*blocks = m_blocks;
+}
+
 void BR_LoudnessObject::SetAnalyzeData (double integrated, double range, double truePeak, double truePeakPos, double shortTermMax, double momentaryMax, const vector<double>& shortTermValues, const vector<double>& momentaryValues)
 {
 	SWS_SectionLock lock(&m_mutex);
@@ -1500,9 +2502,18 @@ fadeOutEnd   (0),
 fadeInCurve  (0),
 fadeOutCurve (0),
 fadeInShape  (0),
-fadeOutShape (0)
+fadeOutShape (0),
+layoutValid  (false),
+layoutTail   (false)
 {
 	memset(audioHash, 0, 128);
+	memset(cacheKey, 0, sizeof(cacheKey));
+	memset(routingHash, 0, sizeof(routingHash));
+}
+
+BR_LoudnessObject::AnalyzeBlocks::AnalyzeBlocks () :
+truePeak (false)
+{
 }
 
 /******************************************************************************
@@ -1923,12 +2934,10 @@ static WDL_DLGRET NormalizeProgressProc (HWND hwnd, UINT uMsg, WPARAM wParam, LP
 		return r;
 
 	static BR_NormalizeData* s_normalizeData = NULL;
-	static BR_LoudnessObject* s_currentItem  = NULL;
+	static WDL_PtrList<BR_LoudnessObject> s_pendingItems;
 
-	static int  s_currentItemId      = 0;
 	static bool s_analyzeInProgress  = false;
 	static double s_itemsLen         = 0;
-	static double s_currentItemLen   = 0;
 	static double s_finishedItemsLen = 0;
 
 	#ifndef _WIN32
@@ -1947,10 +2956,9 @@ static WDL_DLGRET NormalizeProgressProc (HWND hwnd, UINT uMsg, WPARAM wParam, LP
 				return 0;
 			}
 
-			s_currentItemId = 0;
+			s_pendingItems.Empty(false);
 			s_analyzeInProgress = false;
 			s_itemsLen = 0;
-			s_currentItemLen = 0;
 			s_finishedItemsLen = 0;
 
 			// Get progress data
@@ -1969,7 +2977,7 @@ static WDL_DLGRET NormalizeProgressProc (HWND hwnd, UINT uMsg, WPARAM wParam, LP
 			#endif
 
 			// Start normalizing
-			SetTimer(hwnd, ANALYZE_TIMER_FREQ, 100, NULL);
+			SetTimer(hwnd, ANALYZE_TIMER, 100, NULL);
 		}
 		break;
 
@@ -1991,10 +2999,11 @@ static WDL_DLGRET NormalizeProgressProc (HWND hwnd, UINT uMsg, WPARAM wParam, LP
 			{
 				case IDCANCEL:
 				{
-					KillTimer(hwnd, 1);
+					KillTimer(hwnd, ANALYZE_TIMER);
 					s_normalizeData = NULL;
-					if (s_currentItem)
-						s_currentItem->AbortAnalyze();
+					for (int i = 0; i < s_pendingItems.GetSize(); ++i)
+						s_pendingItems.Get(i)->AbortAnalyze();
+					s_pendingItems.Empty(false);
 					EndDialog(hwnd, 0);
 				}
 				break;
@@ -2007,77 +3016,78 @@ static WDL_DLGRET NormalizeProgressProc (HWND hwnd, UINT uMsg, WPARAM wParam, LP
 			if (!s_normalizeData)
 				return 0;
 
+			// Queue all items at once, analyze pool takes care of not running more of them than there are cores
 			if (!s_analyzeInProgress)
 			{
-				// No more objects to analyze, normalize them
-				if (s_currentItemId >= s_normalizeData->items->GetSize())
+				for (int i = 0; i < s_normalizeData->items->GetSize(); ++i)
 				{
-					bool undoTrack = false;
-					bool undoItem  = false;
-					for (int i = 0; i < s_normalizeData->items->GetSize(); ++i)
+					if (BR_LoudnessObject* item = s_normalizeData->items->Get(i))
 					{
-						if (BR_LoudnessObject* item = s_normalizeData->items->Get(i))
-						{
-							if (item->NormalizeIntegrated(s_normalizeData->targetLufs))
-							{
-								if (!undoTrack && item->IsTrack()) undoTrack = true;
-								if (!undoItem && !item->IsTrack()) undoItem = true;
-							}
-						}
-					}
-
-					if (undoTrack || undoItem)
-					{
-						if (undoTrack && !undoItem)
-							Undo_OnStateChangeEx2(NULL, __LOCALIZE("Normalize track loudness", "sws_undo"), UNDO_STATE_TRACKCFG, -1);
-						else if (!undoTrack && undoItem)
-							Undo_OnStateChangeEx2(NULL, __LOCALIZE("Normalize item loudness", "sws_undo"), UNDO_STATE_ITEMS, -1);
-						else
-							Undo_OnStateChangeEx2(NULL, __LOCALIZE("Normalize item and track loudness", "sws_undo"), UNDO_STATE_TRACKCFG | UNDO_STATE_ITEMS, -1);
+						if (item->Analyze(s_normalizeData->quickMode, false))
+							s_pendingItems.Add(item);
 					}
-
-					s_normalizeData->normalized = true;
-					UpdateTimeline();
-					EndDialog(hwnd, 0);
-					return 0;
 				}
+				s_analyzeInProgress = true;
+			}
 
-				// Start analysis of the next item
-				if (s_currentItem = s_normalizeData->items->Get(s_currentItemId))
+			for (int i = 0; i < s_pendingItems.GetSize(); ++i)
+			{
+				BR_LoudnessObject* item = s_pendingItems.Get(i);
+				if (!item->IsRunning())
 				{
-					s_currentItemLen = s_currentItem->GetAudioLength();
-					s_currentItem->Analyze(s_normalizeData->quickMode, false);
-					s_analyzeInProgress = true;
+					s_finishedItemsLen += item->GetAudioLength();
+					s_pendingItems.Delete(i--, false);
 				}
-				else
-					++s_currentItemId;
 			}
-			else
+
+			double progress = GetAnalyzeProgress(s_pendingItems, s_finishedItemsLen, s_itemsLen);
+			SendMessage(GetDlgItem(hwnd, IDC_PROGRESS), PBM_SETPOS, (int)(progress*100), 0);
+
+			// No more objects to analyze, normalize them
+			if (!s_pendingItems.GetSize())
 			{
-				if (s_currentItem->IsRunning())
+				KillTimer(hwnd, ANALYZE_TIMER);
+
+				bool undoTrack = false;
+				bool undoItem  = false;
+				for (int i = 0; i < s_normalizeData->items->GetSize(); ++i)
 				{
-					double progress = (s_finishedItemsLen + s_currentItemLen * s_currentItem->GetProgress()) / s_itemsLen;
-					SendMessage(GetDlgItem(hwnd, IDC_PROGRESS), PBM_SETPOS, (int)(progress*100), 0);
+					if (BR_LoudnessObject* item = s_normalizeData->items->Get(i))
+					{
+						if (item->NormalizeIntegrated(s_normalizeData->targetLufs))
+						{
+							if (!undoTrack && item->IsTrack()) undoTrack = true;
+							if (!undoItem && !item->IsTrack()) undoItem = true;
+						}
+					}
 				}
-				else
-				{
-					s_finishedItemsLen += s_currentItemLen;
-					double progress = s_finishedItemsLen / s_itemsLen;
-					SendMessage(GetDlgItem(hwnd, IDC_PROGRESS), PBM_SETPOS, (int)(progress*100), 0);
 
-					s_analyzeInProgress = false;
-					++s_currentItemId;
+				if (undoTrack || undoItem)
+				{
+					if (undoTrack && !undoItem)
+						Undo_OnStateChangeEx2(NULL, __LOCALIZE("Normalize track loudness", "sws_undo"), UNDO_STATE_TRACKCFG, -1);
+					else if (!undoTrack && undoItem)
+						Undo_OnStateChangeEx2(NULL, __LOCALIZE("Normalize item loudness", "sws_undo"), UNDO_STATE_ITEMS, -1);
+					else
+						Undo_OnStateChangeEx2(NULL, __LOCALIZE("Normalize item and track loudness", "sws_undo"), UNDO_STATE_TRACKCFG | UNDO_STATE_ITEMS, -1);
 				}
+
+				s_normalizeData->normalized = true;
+				s_analyzeInProgress = false;
+				UpdateTimeline();
+				EndDialog(hwnd, 0);
+				return 0;
 			}
 		}
 		break;
 
 		case WM_DESTROY:
 		{
-			KillTimer(hwnd, 1);
+			KillTimer(hwnd, ANALYZE_TIMER);
 			s_normalizeData = NULL;
-			if (s_currentItem)
-				s_currentItem->AbortAnalyze();
+			for (int i = 0; i < s_pendingItems.GetSize(); ++i)
+				s_pendingItems.Get(i)->AbortAnalyze();
+			s_pendingItems.Empty(false);
 			s_analyzeInProgress = false;
 		}
 		break;
@@ -2185,7 +3195,6 @@ void BR_AnalyzeLoudnessView::OnItemSortEnd ()
 BR_AnalyzeLoudnessWnd::BR_AnalyzeLoudnessWnd () :
 SWS_DockWnd(IDD_BR_LOUDNESS_ANALYZER, __LOCALIZE("Loudness", "sws_DLG_174"), "", SWSGetCommandID(AnalyzeLoudness)),
 m_objectsLen        (0),
-m_currentObjectId   (0),
 m_analyzeInProgress (false),
 m_list              (NULL),
 m_normalizeWnd      (NULL),
@@ -2268,16 +3277,18 @@ void BR_AnalyzeLoudnessWnd::AbortAnalyze ()
 	SendMessage(GetDlgItem(m_hwnd, IDC_PROGRESS), PBM_SETPOS, 0, 0);
 	EnableWindow(GetDlgItem(m_hwnd, IDC_ANALYZE), true);
 
-	// Make sure objects already in the list are NOT destroyed
+	// Make sure objects already in the list are NOT destroyed (but stop their analysis since all of them are queued at once)
 	for (int i = 0; i < m_analyzeQueue.GetSize(); ++i)
 	{
 		if (g_analyzedObjects.Get()->Find(m_analyzeQueue.Get(i)) != -1)
+		{
+			m_analyzeQueue.Get(i)->AbortAnalyze();
 			m_analyzeQueue.Delete(i--, false);
+		}
 	}
 	m_analyzeQueue.Empty(true);
 	m_analyzeInProgress = false;
-	m_objectsLen      = 0;
-	m_currentObjectId = 0;
+	m_objectsLen        = 0;
 }
 
 void BR_AnalyzeLoudnessWnd::AbortReanalyze ()
@@ -2287,10 +3298,11 @@ void BR_AnalyzeLoudnessWnd::AbortReanalyze ()
 	SendMessage(GetDlgItem(m_hwnd, IDC_PROGRESS), PBM_SETPOS, 0, 0);
 	EnableWindow(GetDlgItem(m_hwnd, IDC_ANALYZE), true);
 
+	for (int i = 0; i < m_reanalyzeQueue.GetSize(); ++i)
+		m_reanalyzeQueue.Get(i)->AbortAnalyze();
 	m_reanalyzeQueue.Empty(false);
 	m_analyzeInProgress = false;
-	m_objectsLen      = 0;
-	m_currentObjectId = 0;
+	m_objectsLen        = 0;
 }
 
 void BR_AnalyzeLoudnessWnd::ClearList ()
@@ -3408,126 +4420,110 @@ void BR_AnalyzeLoudnessWnd::OnCommand (WPARAM wParam, LPARAM lParam)
 
 void BR_AnalyzeLoudnessWnd::OnTimer (WPARAM wParam)
 {
-	static BR_LoudnessObject* s_currentObject      = NULL;
-	static double             s_currentObjectLen   = 0;
-	static double             s_finishedObjectsLen = 0;
+	static double s_finishedObjectsLen = 0;
 
 	if (wParam == ANALYZE_TIMER)
 	{
 		if (!m_analyzeInProgress)
 		{
-			// New analyze task began, reset variables
-			if (m_currentObjectId == 0)
-				s_finishedObjectsLen = 0;
-
-			if (!m_analyzeQueue.GetSize())
+			// New analyze task began - queue all objects at once, analyze pool makes sure only as many run as there are cores
+			s_finishedObjectsLen = 0;
+			for (int i = 0; i < m_analyzeQueue.GetSize(); ++i)
 			{
-				// Make sure list view isn't populated with invalid items (i.e. user could have deleted them during analysis)
-				for (int i = 0; i < g_analyzedObjects.Get()->GetSize(); ++i)
-				{
-					if (BR_LoudnessObject* object = g_analyzedObjects.Get()->Get(i))
-					{
-						if (!object->IsTargetValid())
-							g_analyzedObjects.Get()->Delete(i--, true);
-					}
-				}
-				this->Update();
-
-				m_analyzeInProgress = false;
-				ShowWindow(GetDlgItem(m_hwnd, IDC_PROGRESS), SW_HIDE);
-				SendMessage(GetDlgItem(m_hwnd, IDC_PROGRESS), PBM_SETPOS, 0, 0);
-				EnableWindow(GetDlgItem(m_hwnd, IDC_ANALYZE), true);
-				KillTimer(m_hwnd, ANALYZE_TIMER);
-				return;
+				if (BR_LoudnessObject* object = m_analyzeQueue.Get(i))
+					object->Analyze(false, m_properties.doTruePeak);
+				else
+					m_analyzeQueue.Delete(i--, true);
 			}
-			else
+			m_analyzeInProgress = true;
+		}
+
+		// Move finished objects to the list
+		bool update = false;
+		for (int i = 0; i < m_analyzeQueue.GetSize(); ++i)
+		{
+			BR_LoudnessObject* object = m_analyzeQueue.Get(i);
+			if (!object->IsRunning())
 			{
-				if (s_currentObject = m_analyzeQueue.Get(0))
-				{
-					s_currentObjectLen = s_currentObject->GetAudioLength();
-					s_currentObject->Analyze(false, m_properties.doTruePeak);
-					m_analyzeInProgress = true;
-				}
-				else
-					m_analyzeQueue.Delete(0, true);
-				++m_currentObjectId;
+				// Sometimes the analyzed object can already be in the list (if option to clear list upon analyzing is disabled)
+				if (g_analyzedObjects.Get()->Find(object) == -1)
+					g_analyzedObjects.Get()->Add(object);
+				s_finishedObjectsLen += object->GetAudioLength();
+				#ifdef BR_DEBUG_LOUDNESS_ALLOCATIONS
+					WDL_FastString string;
+					string.AppendFormatted(256, "%d heap allocations while analyzing %.1f s of audio\n", object->GetAnalyzeAllocations(), object->GetAudioLength());
+					ShowConsoleMsg(string.Get());
+				#endif
+				m_analyzeQueue.Delete(i--, false);
+				update = true;
 			}
 		}
-		else
+		if (update)
+			this->Update();
+
+		if (!m_analyzeQueue.GetSize())
 		{
-			// Make sure our object is still here
-			double progress = 1;
-			if (m_analyzeQueue.Find(s_currentObject) != -1 && s_currentObject->IsRunning())
-				progress = (s_finishedObjectsLen + s_currentObjectLen * s_currentObject->GetProgress()) / m_objectsLen;
-			else
+			// Make sure list view isn't populated with invalid items (i.e. user could have deleted them during analysis)
+			for (int i = 0; i < g_analyzedObjects.Get()->GetSize(); ++i)
 			{
-				if (m_analyzeQueue.Find(s_currentObject) != -1)
+				if (BR_LoudnessObject* object = g_analyzedObjects.Get()->Get(i))
 				{
-					// Sometimes the analyzed object can already be in the list (if option to clear list upon analyzing is disabled)
-					if (g_analyzedObjects.Get()->Find(s_currentObject) == -1)
-						g_analyzedObjects.Get()->Add(s_currentObject);
-					m_analyzeQueue.Delete(m_analyzeQueue.Find(s_currentObject), false);
-					this->Update();
+					if (!object->IsTargetValid())
+						g_analyzedObjects.Get()->Delete(i--, true);
 				}
-
-				s_finishedObjectsLen += s_currentObjectLen;
-				progress = s_finishedObjectsLen / m_objectsLen;
-
-				m_analyzeInProgress = false;
 			}
-			SendMessage(GetDlgItem(m_hwnd, IDC_PROGRESS), PBM_SETPOS, (int)(progress*100), 0);
+			this->Update();
+
+			m_analyzeInProgress = false;
+			ShowWindow(GetDlgItem(m_hwnd, IDC_PROGRESS), SW_HIDE);
+			SendMessage(GetDlgItem(m_hwnd, IDC_PROGRESS), PBM_SETPOS, 0, 0);
+			EnableWindow(GetDlgItem(m_hwnd, IDC_ANALYZE), true);
+			KillTimer(m_hwnd, ANALYZE_TIMER);
+			return;
 		}
+
+		double progress = GetAnalyzeProgress(m_analyzeQueue, s_finishedObjectsLen, m_objectsLen);
+		SendMessage(GetDlgItem(m_hwnd, IDC_PROGRESS), PBM_SETPOS, (int)(progress*100), 0);
 	}
 	else if (wParam == REANALYZE_TIMER)
 	{
 		if (!m_analyzeInProgress)
 		{
-			// New analyze task began, reset variables
-			if (m_currentObjectId == 0)
-				s_finishedObjectsLen = 0;
-
-			if (!m_reanalyzeQueue.GetSize())
+			s_finishedObjectsLen = 0;
+			for (int i = 0; i < m_reanalyzeQueue.GetSize(); ++i)
 			{
-				this->Update();
-				m_analyzeInProgress = false;
-				ShowWindow(GetDlgItem(m_hwnd, IDC_PROGRESS), SW_HIDE);
-				SendMessage(GetDlgItem(m_hwnd, IDC_PROGRESS), PBM_SETPOS, 0, 0);
-				EnableWindow(GetDlgItem(m_hwnd, IDC_ANALYZE), true);
-				KillTimer(m_hwnd, REANALYZE_TIMER);
-				return;
-			}
-			else
-			{
-				if (s_currentObject = m_reanalyzeQueue.Get(0))
-				{
-					s_currentObjectLen = s_currentObject->GetAudioLength();
-					s_currentObject->Analyze(false, m_properties.doTruePeak);
-					m_analyzeInProgress = true;
-				}
+				if (BR_LoudnessObject* object = m_reanalyzeQueue.Get(i))
+					object->Analyze(false, m_properties.doTruePeak);
 				else
-					m_reanalyzeQueue.Delete(0, false);
-				++m_currentObjectId;
+					m_reanalyzeQueue.Delete(i--, false);
 			}
+			m_analyzeInProgress = true;
 		}
-		else
+
+		// Objects are already in the list, just drop finished ones from the queue (user could have also deleted them in the meantime)
+		for (int i = 0; i < m_reanalyzeQueue.GetSize(); ++i)
 		{
-			// Make sure our object is still here (user could have deleted it)
-			if (m_reanalyzeQueue.Find(s_currentObject) != -1 && s_currentObject->IsRunning())
+			BR_LoudnessObject* object = m_reanalyzeQueue.Get(i);
+			if (!object->IsRunning())
 			{
-				double progress = (s_finishedObjectsLen + s_currentObjectLen * s_currentObject->GetProgress()) / m_objectsLen;
-				SendMessage(GetDlgItem(m_hwnd, IDC_PROGRESS), PBM_SETPOS, (int)(progress*100), 0);
+				s_finishedObjectsLen += object->GetAudioLength();
+				m_reanalyzeQueue.Delete(i--, false);
 			}
-			else
-			{
-				if (m_reanalyzeQueue.Find(s_currentObject) != -1)
-					m_reanalyzeQueue.Delete(m_reanalyzeQueue.Find(s_currentObject), false);
+		}
 
-				s_finishedObjectsLen += s_currentObjectLen;
-				double progress = s_finishedObjectsLen / m_objectsLen;
-				SendMessage(GetDlgItem(m_hwnd, IDC_PROGRESS), PBM_SETPOS, (int)(progress*100), 0);
-				m_analyzeInProgress = false;
-			}
+		if (!m_reanalyzeQueue.GetSize())
+		{
+			this->Update();
+			m_analyzeInProgress = false;
+			ShowWindow(GetDlgItem(m_hwnd, IDC_PROGRESS), SW_HIDE);
+			SendMessage(GetDlgItem(m_hwnd, IDC_PROGRESS), PBM_SETPOS, 0, 0);
+			EnableWindow(GetDlgItem(m_hwnd, IDC_ANALYZE), true);
+			KillTimer(m_hwnd, REANALYZE_TIMER);
+			return;
 		}
+
+		double progress = GetAnalyzeProgress(m_reanalyzeQueue, s_finishedObjectsLen, m_objectsLen);
+		SendMessage(GetDlgItem(m_hwnd, IDC_PROGRESS), PBM_SETPOS, (int)(progress*100), 0);
 	}
 	else if (wParam == UPDATE_TIMER)
 	{
@@ -3785,6 +4781,12 @@ void LoudnessExit ()
 {
 	g_loudnessWndManager.Delete();
 	g_pref.SaveGlobalPref();
+
+	if (g_analyzePool)
+	{
+		g_analyzePool->Shutdown();
+		DELETE_NULL(g_analyzePool);
+	}
 }
 
 void LoudnessUpdate (bool updatePreferencesDlg /*true*/)
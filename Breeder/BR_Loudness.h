@@ -28,6 +28,12 @@
 #pragma once
 #include "BR_EnvelopeUtil.h"
 
+/******************************************************************************
+* Uncomment to print heap allocations done by loudness analysis while         *
+* processing audio to the console (every analyzed object should report 0)     *
+******************************************************************************/
+//#define BR_DEBUG_LOUDNESS_ALLOCATIONS
+
 /******************************************************************************
 * Loudness object                                                             *
 ******************************************************************************/
@@ -44,6 +50,7 @@ public:
 	void AbortAnalyze ();
 	bool IsRunning ();
 	double GetProgress ();
+	int GetAnalyzeAllocations (); // heap allocations done by the last analysis while processing audio (buffers are allocated up front so it should be 0)
 
 	/* For populating list view in analyze loudness dialog */
 	double GetColumnVal (int column, int mode);                    // mode: 0->LUFS, 1->LU (LU will follow global format settings)
@@ -76,25 +83,56 @@ public:
 	int GetItemNumber ();
 
 private:
+	struct LayoutItem // media item that makes up analyzed audio, compared between analyses to find edited parts of it
+	{
+		GUID guid;
+		double start, end;     // in audio accessor time
+		double sourceStart;    // where active take's source would start in audio accessor time (trims don't change it)
+		double fadeIn, fadeOut;
+		char hash[20];         // everything else that affects item's audio
+	};
+
 	struct AudioData
 	{
 		AudioAccessor* audio;
 		char audioHash[128];
+		char cacheKey[41]; // identifies analyze data in the loudness cache (audio hash + everything that affects gain)
 		int samplerate, channels, channelMode;
 		double audioStart, audioEnd;
 		double volume, pan;
 		double fadeInStart, fadeOutStart, fadeInEnd,  fadeOutEnd, fadeInCurve, fadeOutCurve;
 		int fadeInShape, fadeOutShape;
 		BR_Envelope volEnv, volEnvPreFX;
+		vector<LayoutItem> layout;  // items of the analyzed track and all tracks feeding into it (folder children, receives)
+		char routingHash[20];       // FX, routing and envelopes of those tracks, any change means full re-analysis
+		bool layoutValid;           // false if edits can't be localized to items (i.e. master track), re-analysis is then always done in full
+		bool layoutTail;            // true if edits also change audio after them (track FX tails), re-analysis then continues to the end
 		AudioData();
 	};
 
+	struct AnalyzeBlocks // K-weighted energies and peaks of every 100 ms block from the last analysis, so re-analysis after an edit decodes only edited blocks
+	{
+		vector<double> energy;          // full blocks only
+		vector<double> peak, peakPos;   // last partial block included, positions are relative to audio start
+		bool truePeak;
+		AudioData audioData;            // what the blocks were analyzed from (audio accessor is not owned)
+		AnalyzeBlocks ();
+	};
+
 	static unsigned WINAPI AnalyzeData (void* loudnessObject);
+	static void GetCacheKey (AudioData& audioData, char* key); // key must be at least 41 bytes
+	static bool GetEditedRange (AnalyzeBlocks& blocks, AudioData& audioData, bool isTake, bool doTruePeak, double* start, double* end, int* blockShift); // returns false if blocks can't be reused at all, old block i + blockShift is new block i
+	static void GetLayoutItem (MediaItem* item, double position, const GUID& guid, bool takeRelative, LayoutItem* layoutItem);
+	void GetLayout (AudioData* audioData); // call from the main thread only
+	bool LoadFromCache (bool integratedOnly, bool doTruePeak);
 	int CheckSetAudioData (); // call from the main thread only, returns 0->target doesn't exist anymore, 1->old accessor still valid, 2->accessor got updated
 	void SetAudioData (const AudioData& audioData);
 	AudioData GetAudioData ();
 	void SetRunning (bool running);
 	void SetProgress (double progress);
+	void SetAnalyzeAllocations (int allocations);
+	void SetAnalyzeBlocks (const AnalyzeBlocks& blocks);
+	void GetAnalyzeBlocks (AnalyzeBlocks* blocks);
 	void SetAnalyzeData (double integrated, double range, double truePeak, double truePeakPos, double shortTermMax, double momentaryMax, const vector<double>& shortTermValues, const vector<double>& momentaryValues);
 	void GetAnalyzeData (double* integrated, double* range, double* truePeak, double* truePeakPos, double* shortTermMax, double* momentaryMax, vector<double>* shortTermValues, vector<double>* momentaryValues);
 	void SetAnalyzedStatus (bool analyzed);
@@ -127,11 +165,13 @@ private:
 	GUID m_guid;
 	double m_integrated, m_truePeak, m_truePeakPos, m_shortTermMax, m_momentaryMax, m_range;
 	double m_progress;
+	int m_allocations;
 	bool m_running, m_analyzed, m_killFlag, m_integratedOnly, m_doTruePeak, m_truePeakAnalyzed;
 	HANDLE m_process;
 	SWS_Mutex m_mutex;
 	vector<double> m_shortTermValues;
 	vector<double> m_momentaryValues;
+	AnalyzeBlocks m_blocks;
 };
 
 /******************************************************************************
@@ -271,7 +311,6 @@ protected:
 		void Save ();
 	} m_properties;
 	double m_objectsLen;
-	int m_currentObjectId;
 	bool m_analyzeInProgress;
 	BR_AnalyzeLoudnessView* m_list;
 	HWND m_normalizeWnd, m_exportFormatWnd;                                          // never delete objects in reanalyzeQueue when removing them from list!!
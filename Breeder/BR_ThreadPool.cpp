@@ -0,0 +1,201 @@
+/******************************************************************************
+/ BR_ThreadPool.cpp
+/
+/ Copyright (c) 2015 Dominik Martin Drzic
+/ http://forum.cockos.com/member.php?u=27094
+/ https://code.google.com/p/sws-extension
+/
+/ Permission is hereby granted, free of charge, to any person obtaining a copy
+/ of this software and associated documentation files (the "Software"), to deal
+/ in the Software without restriction, including without limitation the rights to
+/ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+/ of the Software, and to permit persons to whom the Software is furnished to
+/ do so, subject to the following conditions:
+/
+/ The above copyright notice and this permission notice shall be included in all
+/ copies or substantial portions of the Software.
+/
+/ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+/ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+/ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+/ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+/ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+/ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+/ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+/ OTHER DEALINGS IN THE SOFTWARE.
+/
+******************************************************************************/
+#include "stdafx.h"
+#include "BR_ThreadPool.h"
+#ifndef _WIN32
+	#include <unistd.h>
+#endif
+
+/******************************************************************************
+* Constants                                                                   *
+******************************************************************************/
+const int WORKER_WAIT_TIMEOUT = 100; // in case wake event gets consumed by other thread, idle thread rechecks the queue after this many ms
+
+/******************************************************************************
+* BR_ThreadPool                                                               *
+******************************************************************************/
+BR_ThreadPool::BR_ThreadPool (int maxThreads /*= 0*/) :
+m_wakeEvent   (CreateEvent(NULL, FALSE, FALSE, NULL)),
+m_maxThreads  ((maxThreads > 0) ? maxThreads : BR_ThreadPool::GetCoreCount()),
+m_idleThreads (0),
+m_runningJobs (0),
+m_quit        (false)
+{
+}
+
+BR_ThreadPool::~BR_ThreadPool ()
+{
+	this->Shutdown();
+	CloseHandle(m_wakeEvent);
+}
+
+HANDLE BR_ThreadPool::Queue (BR_ThreadPool::JobProc proc, void* param)
+{
+	if (!proc)
+		return NULL;
+
+	Job job;
+	job.proc  = proc;
+	job.param = param;
+	job.done  = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+	SWS_SectionLock lock(&m_mutex);
+	if (m_quit) // pool is shutting down, don't bring workers back
+	{
+		CloseHandle(job.done);
+		return NULL;
+	}
+	m_jobs.push_back(job);
+
+	// Threads are started lazily and never exceed m_maxThreads, after that jobs simply wait in the queue
+	if (m_idleThreads == 0 && (int)m_threads.size() < m_maxThreads)
+	{
+		if (HANDLE thread = (HANDLE)_beginthreadex(NULL, 0, BR_ThreadPool::WorkerThread, (void*)this, 0, NULL))
+			m_threads.push_back(thread);
+	}
+	SetEvent(m_wakeEvent);
+
+	return job.done;
+}
+
+bool BR_ThreadPool::Dequeue (HANDLE job)
+{
+	SWS_SectionLock lock(&m_mutex);
+	for (list<Job>::iterator it = m_jobs.begin(); it != m_jobs.end(); ++it)
+	{
+		if (it->done == job)
+		{
+			m_jobs.erase(it);
+			SetEvent(job);
+			return true;
+		}
+	}
+	return false;
+}
+
+void BR_ThreadPool::Shutdown ()
+{
+	vector<HANDLE> threads;
+	{
+		SWS_SectionLock lock(&m_mutex);
+		m_quit = true;
+		for (list<Job>::iterator it = m_jobs.begin(); it != m_jobs.end(); ++it)
+			SetEvent(it->done);
+		m_jobs.clear();
+		threads.swap(m_threads);
+	}
+
+	// Wake event is auto-reset so keep signaling it until every thread picks up the quit flag
+	for (size_t i = 0; i < threads.size(); ++i)
+	{
+		while (WaitForSingleObject(threads[i], 10) == WAIT_TIMEOUT)
+			SetEvent(m_wakeEvent);
+		CloseHandle(threads[i]);
+	}
+
+	SWS_SectionLock lock(&m_mutex);
+	m_idleThreads = 0;
+}
+
+int BR_ThreadPool::CountPending ()
+{
+	SWS_SectionLock lock(&m_mutex);
+	return (int)m_jobs.size();
+}
+
+int BR_ThreadPool::CountRunning ()
+{
+	SWS_SectionLock lock(&m_mutex);
+	return m_runningJobs;
+}
+
+int BR_ThreadPool::GetMaxThreads ()
+{
+	SWS_SectionLock lock(&m_mutex);
+	return m_maxThreads;
+}
+
+int BR_ThreadPool::GetCoreCount ()
+{
+	static int s_coreCount = 0;
+	if (s_coreCount == 0)
+	{
+		#ifdef _WIN32
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			s_coreCount = (int)info.dwNumberOfProcessors;
+		#else
+			s_coreCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+		#endif
+		if (s_coreCount < 1)
+			s_coreCount = 1;
+	}
+	return s_coreCount;
+}
+
+unsigned WINAPI BR_ThreadPool::WorkerThread (void* threadPool)
+{
+	BR_ThreadPool* _this = (BR_ThreadPool*)threadPool;
+
+	Job job;
+	while (_this->GetJob(&job))
+	{
+		job.proc(job.param);
+		SetEvent(job.done);
+
+		SWS_SectionLock lock(&_this->m_mutex);
+		--_this->m_runningJobs;
+	}
+	return 0;
+}
+
+bool BR_ThreadPool::GetJob (BR_ThreadPool::Job* job)
+{
+	while (true)
+	{
+		{
+			SWS_SectionLock lock(&m_mutex);
+			if (m_quit)
+				return false;
+
+			if (!m_jobs.empty())
+			{
+				*job = m_jobs.front();
+				m_jobs.pop_front();
+				++m_runningJobs;
+				return true;
+			}
+			++m_idleThreads;
+		}
+
+		WaitForSingleObject(m_wakeEvent, WORKER_WAIT_TIMEOUT);
+
+		SWS_SectionLock lock(&m_mutex);
+		--m_idleThreads;
+	}
+}
@@ -0,0 +1,80 @@
+/******************************************************************************
+/ BR_ThreadPool.h
+/
+/ Copyright (c) 2015 Dominik Martin Drzic
+/ http://forum.cockos.com/member.php?u=27094
+/ https://code.google.com/p/sws-extension
+/
+/ Permission is hereby granted, free of charge, to any person obtaining a copy
+/ of this software and associated documentation files (the "Software"), to deal
+/ in the Software without restriction, including without limitation the rights to
+/ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+/ of the Software, and to permit persons to whom the Software is furnished to
+/ do so, subject to the following conditions:
+/
+/ The above copyright notice and this permission notice shall be included in all
+/ copies or substantial portions of the Software.
+/
+/ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+/ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+/ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+/ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+/ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+/ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+/ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+/ OTHER DEALINGS IN THE SOFTWARE.
+/
+******************************************************************************/
+#pragma once
+
+/******************************************************************************
+* Bounded pool of worker threads with a FIFO job queue. Use it instead of     *
+* starting a thread per object when many objects need processing at once      *
+* (i.e. analyzing hundreds of takes) so the machine doesn't get               *
+* oversubscribed.                                                             *
+*                                                                             *
+* Job procedure has the same signature as the one used with _beginthreadex    *
+* so existing thread procedures can be queued as they are. Queue() returns a  *
+* manual-reset event that gets signaled once the job finishes (or gets        *
+* removed from the queue) - wait on it with WaitForSingleObject() just like   *
+* with a thread handle and close it with CloseHandle() when done.             *
+* Cancellation is cooperative: the job is expected to check its own kill      *
+* flag, Dequeue() only makes sure jobs that didn't start yet never start.     *
+******************************************************************************/
+class BR_ThreadPool
+{
+public:
+	typedef unsigned (WINAPI *JobProc)(void* param);
+
+	explicit BR_ThreadPool (int maxThreads = 0); // 0 -> one thread per logical core
+	~BR_ThreadPool ();
+
+	HANDLE Queue (JobProc proc, void* param); // returns NULL if job can't be queued (pool is shut down)
+	bool Dequeue (HANDLE job);   // returns true if job was still waiting in queue (its event gets signaled)
+	void Shutdown ();            // pending jobs are dequeued, running jobs are waited on, threads exit (pool can't be used after this)
+	int CountPending ();
+	int CountRunning ();
+	int GetMaxThreads ();
+	static int GetCoreCount ();
+
+private:
+	struct Job
+	{
+		JobProc proc;
+		void* param;
+		HANDLE done;
+	};
+
+	static unsigned WINAPI WorkerThread (void* threadPool);
+	bool GetJob (Job* job);      // returns false if the thread should quit
+
+	list<Job> m_jobs;
+	vector<HANDLE> m_threads;
+	HANDLE m_wakeEvent;
+	int m_maxThreads, m_idleThreads, m_runningJobs;
+	bool m_quit;
+	SWS_Mutex m_mutex;
+
+	BR_ThreadPool (const BR_ThreadPool&);
+	void operator= (const BR_ThreadPool&);
+};
@@ -0,0 +1,290 @@
+/******************************************************************************
+/ EbuR128Bench.cpp
+/
+/ A little console application that benchmarks libebur128 kernels (K-weighting
+/ filter, frame energies, gating block sums and true peak interpolator) for
+/ common channel layouts. Every kernel set supported by the CPU
+/ (ebur128_simd.h) is compared against the scalar reference, prints processed
+/ samples per second and maximum difference from the scalar results.
+/
+/ Copyright (c) 2015 Dominik Martin Drzic
+/
+/ Permission is hereby granted, free of charge, to any person obtaining a copy
+/ of this software and associated documentation files (the "Software"), to deal
+/ in the Software without restriction, including without limitation the rights to
+/ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+/ of the Software, and to permit persons to whom the Software is furnished to
+/ do so, subject to the following conditions:
+/
+/ The above copyright notice and this permission notice shall be included in all
+/ copies or substantial portions of the Software.
+/
+/ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+/ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+/ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+/ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+/ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+/ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+/ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+/ OTHER DEALINGS IN THE SOFTWARE.
+/
+******************************************************************************/
+
+#define _USE_MATH_DEFINES
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "../libebur128/ebur128_simd.h"
+
+// 48 kHz coefficients of the BS.1770 K-weighting filter (cascaded
+// shelving and high-pass biquads, as computed by ebur128_init_filter)
+static const double g_b[5] = { 1.53512485958697, -5.76194590858032, 8.11691004925258, -5.08848181111208, 1.19839281085285 };
+static const double g_a[5] = { 1.0, -3.68070674801639, 5.08704524797113, -3.13154635144673, 0.72520888847787 };
+
+static const int    BLOCK_FRAMES   = 19200; // 400 ms at 48 kHz, same as ebur128 add_frames chunk
+static const int    SUB_BLOCK      = 4800;  // 100 ms at 48 kHz, gating blocks are made of these
+static const int    OVERSAMPLE     = 4;     // true peak interpolator at 48 kHz, same as ebur128_init_interpolator
+static const int    INTERP_TAPS    = 49;
+static const double BENCH_TIME     = 0.25;  // seconds per layout, kernel set and kernel
+
+enum Kernel
+{
+	KWEIGHT = 0,
+	ENERGY,
+	GATING,
+	TRUE_PEAK,
+	KERNEL_COUNT
+};
+
+static const char* const g_kernelNames[KERNEL_COUNT] = {"K-weight", "energy", "gating", "true peak"};
+
+struct Layout
+{
+	const char* name;
+	int channels;
+	double weights[8];
+};
+
+static const Layout g_layouts[] =
+{
+	{"mono",   1, {1.0}},
+	{"stereo", 2, {1.0, 1.0}},
+	{"5.0",    5, {1.0, 1.0, 1.0, 1.41, 1.41}},
+	{"5.1",    6, {1.0, 1.0, 1.0, 0.0, 1.41, 1.41}},
+	{"7.1",    8, {1.0, 1.0, 1.0, 0.0, 1.41, 1.41, 1.0, 1.0}},
+};
+
+struct Buffers
+{
+	size_t width;
+	size_t taps;
+	double* coeffs;       // true peak interpolator phases
+	double* src;          // interleaved input, channels per frame
+	double* x;            // padded filter buffer, (taps - 1) history frames + BLOCK_FRAMES, width per frame
+	double* input;        // deinterleaved copy of x (K-weighting filters x in place)
+	double* z;            // filter state
+	double* w;            // channel weights
+	double* e;            // frame energies
+	double* sums;         // gating sub-block sums
+	double* peak;         // true peaks
+	size_t* peakFrame;
+};
+
+static void InitBuffers (Buffers& b, const Layout& layout, const ebur128_simd_kernels* kernels, const double* coeffs, size_t taps)
+{
+	b.width     = ebur128_simd_pad(layout.channels, kernels->width);
+	b.taps      = taps;
+	b.coeffs    = (double*)coeffs;
+	b.src       = new double[BLOCK_FRAMES * layout.channels];
+	b.x         = new double[(taps - 1 + BLOCK_FRAMES) * b.width];
+	b.input     = new double[(taps - 1 + BLOCK_FRAMES) * b.width];
+	b.z         = new double[4 * b.width];
+	b.w         = new double[b.width];
+	b.e         = new double[BLOCK_FRAMES];
+	b.sums      = new double[BLOCK_FRAMES / SUB_BLOCK];
+	b.peak      = new double[b.width];
+	b.peakFrame = new size_t[b.width];
+
+	srand(1);
+	for (int i = 0; i < BLOCK_FRAMES * layout.channels; ++i)
+		b.src[i] = 2.0 * rand() / RAND_MAX - 1.0;
+	for (size_t c = 0; c < b.width; ++c)
+		b.w[c] = ((int)c < layout.channels) ? layout.weights[c] : 0.0;
+
+	// Deinterleave like EBUR128_FILTER, history is silence
+	memset(b.input, 0, (taps - 1) * b.width * sizeof(double));
+	double* x = b.input + (taps - 1) * b.width;
+	const double* src = b.src;
+	for (int i = 0; i < BLOCK_FRAMES; ++i, x += b.width, src += layout.channels)
+	{
+		int c = 0;
+		for (; c < layout.channels; ++c)
+			x[c] = src[c];
+		for (; c < (int)b.width; ++c)
+			x[c] = 0.0;
+	}
+	memcpy(b.x, b.input, (taps - 1 + BLOCK_FRAMES) * b.width * sizeof(double));
+	memset(b.z, 0, 4 * b.width * sizeof(double));
+	memset(b.peak, 0, b.width * sizeof(double));
+	memset(b.peakFrame, 0, b.width * sizeof(size_t));
+
+	// Energies and gating sums work on filtered data
+	kernels->kweight(b.x + (taps - 1) * b.width, BLOCK_FRAMES, b.width, b.z, g_b, g_a);
+	kernels->energy(b.x + (taps - 1) * b.width, BLOCK_FRAMES, b.width, b.w, b.e);
+	for (int i = 0; i < BLOCK_FRAMES / SUB_BLOCK; ++i)
+		b.sums[i] = kernels->sum(b.e + i * SUB_BLOCK, SUB_BLOCK);
+}
+
+static void FreeBuffers (Buffers& b)
+{
+	delete[] b.src;
+	delete[] b.x;
+	delete[] b.input;
+	delete[] b.z;
+	delete[] b.w;
+	delete[] b.e;
+	delete[] b.sums;
+	delete[] b.peak;
+	delete[] b.peakFrame;
+}
+
+static void RunKernel (const ebur128_simd_kernels* kernels, Kernel kernel, Buffers& b)
+{
+	double* x = b.x + (b.taps - 1) * b.width;
+	switch (kernel)
+	{
+		case KWEIGHT:
+			// Filter unfiltered input every time, otherwise repeated filtering keeps boosting high frequencies
+			memcpy(x, b.input + (b.taps - 1) * b.width, BLOCK_FRAMES * b.width * sizeof(double));
+			kernels->kweight(x, BLOCK_FRAMES, b.width, b.z, g_b, g_a);
+		break;
+
+		case ENERGY:
+			kernels->energy(x, BLOCK_FRAMES, b.width, b.w, b.e);
+		break;
+
+		case GATING:
+			for (int i = 0; i < BLOCK_FRAMES / SUB_BLOCK; ++i)
+				b.sums[i] = kernels->sum(b.e + i * SUB_BLOCK, SUB_BLOCK);
+		break;
+
+		case TRUE_PEAK:
+			kernels->interp_peak(b.input, BLOCK_FRAMES, b.width, b.coeffs, OVERSAMPLE, b.taps, b.peak, b.peakFrame, 0);
+		break;
+
+		default:
+		break;
+	}
+}
+
+// Returns processed samples per second (frames * channels)
+static double Run (const ebur128_simd_kernels* kernels, Kernel kernel, Buffers& b, int channels)
+{
+	clock_t start = clock();
+	clock_t end = start + (clock_t)(BENCH_TIME * CLOCKS_PER_SEC);
+	int blocks = 0;
+	while (clock() < end)
+	{
+		RunKernel(kernels, kernel, b);
+		++blocks;
+	}
+	double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+	return elapsed > 0 ? (double)blocks * BLOCK_FRAMES * channels / elapsed : 0;
+}
+
+static double MaxDiff (const double* reference, size_t referenceWidth, const double* values, size_t width, size_t count, size_t channels)
+{
+	double maxDiff = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		for (size_t c = 0; c < channels; ++c)
+		{
+			double diff = fabs(reference[i * referenceWidth + c] - values[i * width + c]);
+			if (diff > maxDiff)
+				maxDiff = diff;
+		}
+	}
+	return maxDiff;
+}
+
+// Results of each kernel after one block from a clean state, compared against scalar kernels
+static void CompareResults (Buffers& reference, Buffers& b, int channels, double* maxDiff)
+{
+	size_t history = reference.taps - 1;
+	maxDiff[KWEIGHT]   = MaxDiff(reference.x + history * reference.width, reference.width, b.x + history * b.width, b.width, BLOCK_FRAMES, channels);
+	maxDiff[ENERGY]    = MaxDiff(reference.e, 1, b.e, 1, BLOCK_FRAMES, 1);
+	maxDiff[GATING]    = MaxDiff(reference.sums, 1, b.sums, 1, BLOCK_FRAMES / SUB_BLOCK, 1);
+	maxDiff[TRUE_PEAK] = MaxDiff(reference.peak, reference.width, b.peak, b.width, 1, channels);
+}
+
+int main()
+{
+	const ebur128_simd_kernels* best = ebur128_simd_best();
+	int level = ebur128_simd_cpu_level();
+	printf("EbuR128Bench: %s kernels used by libebur128 on this CPU, %d channel(s) per vector\n", best->name, (int)best->width);
+	printf("Samples per second (frames * channels), speedup against scalar in parentheses\n\n");
+
+	// Hann windowed sinc split into phases, same as ebur128_init_interpolator
+	size_t taps = (INTERP_TAPS + OVERSAMPLE - 1) / OVERSAMPLE;
+	double* coeffs = new double[OVERSAMPLE * taps];
+	memset(coeffs, 0, OVERSAMPLE * taps * sizeof(double));
+	for (int j = 0; j < INTERP_TAPS; ++j)
+	{
+		double m = (double)j - (double)(INTERP_TAPS - 1) / 2.0;
+		double c = (fabs(m) > 1e-9) ? sin(m * M_PI / OVERSAMPLE) / (m * M_PI / OVERSAMPLE) : 1.0;
+		c *= 0.5 * (1.0 - cos(2.0 * M_PI * j / (INTERP_TAPS - 1)));
+		coeffs[(j % OVERSAMPLE) * taps + j / OVERSAMPLE] = c;
+	}
+
+	for (size_t l = 0; l < sizeof(g_layouts) / sizeof(g_layouts[0]); ++l)
+	{
+		const Layout& layout = g_layouts[l];
+		printf("%s (%d ch)\n", layout.name, layout.channels);
+		printf("  %-8s", "kernels");
+		for (int k = 0; k < KERNEL_COUNT; ++k)
+			printf(" %20s", g_kernelNames[k]);
+		printf(" %10s\n", "max diff");
+
+		Buffers reference;
+		InitBuffers(reference, layout, &ebur128_simd_table[0], coeffs, taps);
+		RunKernel(&ebur128_simd_table[0], TRUE_PEAK, reference);
+
+		double scalar[KERNEL_COUNT];
+		for (size_t t = 0; t < EBUR128_SIMD_TABLE_SIZE; ++t)
+		{
+			const ebur128_simd_kernels* kernels = &ebur128_simd_table[t];
+			if (kernels->level > level)
+				continue;
+
+			Buffers b;
+			InitBuffers(b, layout, kernels, coeffs, taps);
+			RunKernel(kernels, TRUE_PEAK, b);
+
+			double maxDiff[KERNEL_COUNT];
+			CompareResults(reference, b, layout.channels, maxDiff);
+			double worst = 0;
+			for (int k = 0; k < KERNEL_COUNT; ++k)
+				if (maxDiff[k] > worst)
+					worst = maxDiff[k];
+
+			printf("  %-8s", kernels->name);
+			for (int k = 0; k < KERNEL_COUNT; ++k)
+			{
+				double speed = Run(kernels, (Kernel)k, b, layout.channels);
+				if (t == 0)
+					scalar[k] = speed;
+				printf(" %11.3g (%5.2fx)", speed, scalar[k] > 0 ? speed / scalar[k] : 0);
+			}
+			printf(" %10.2g\n", worst);
+
+			FreeBuffers(b);
+		}
+		printf("\n");
+		FreeBuffers(reference);
+	}
+
+	delete[] coeffs;
+	return 0;
+}
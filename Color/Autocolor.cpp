@@ -83,7 +83,7 @@ static WDL_String g_ACIni;
 class AC_MarkerRegionListener : public SNM_MarkerRegionListener {
 public:
 	AC_MarkerRegionListener() : SNM_MarkerRegionListener() {}
-	void NotifyMarkerRegionUpdate(int _updateFlags) { AutoColorMarkerRegion(false, _updateFlags); }
+	void NotifyMarkerRegionUpdate(int _updateFlags, SNM_MarkerRegionChanges* _changes) { AutoColorMarkerRegion(false, _updateFlags); }
 };
 
 AC_MarkerRegionListener g_mkrRgnListener;
@@ -1,60 +1,7 @@
 #include "stdafx.h"
 #include "../reaper/localize.h"
 
-#include <memory>
-
 #include "RprMidiEvent.h"
-#include "RprNode.h"
-
-#include "StringUtil.h"
-
-static std::string toHex(unsigned char hex);
-
-RprMidiEvent::RprMidiEvent()
-    : mSelected(false), mMuted(false), mDelta(0), mOffset(0), mQuantizeOffset(0)
-{
-    mMidiMessage.resize(3);
-}
-
-bool RprMidiEvent::isSelected() const
-{
-    return mSelected;
-}
-
-void RprMidiEvent::setSelected(bool selected)
-{
-    mSelected = selected;
-}
-
-bool RprMidiEvent::isMuted() const
-{
-    return mMuted;
-}
-
-void RprMidiEvent::setMuted(bool muted)
-{
-    mMuted = muted;
-}
-
-int RprMidiEvent::getDelta() const
-{
-    return mDelta;
-}
-
-void RprMidiEvent::setDelta(int delta)
-{
-    mDelta = delta;
-}
-
-int RprMidiEvent::getOffset() const
-{
-    return mOffset;
-}
-
-void RprMidiEvent::setOffset(int offset)
-{
-    mOffset = offset;
-}
 
 RprMidiEvent::RprMidiException::RprMidiException(const char *message) : mMessage(message)
 {
@@ -69,67 +16,18 @@ RprMidiEvent::RprMidiException::~RprMidiException() throw()
 {
 }
 
-RprExtendedMidiEvent::RprExtendedMidiEvent() : RprMidiEvent()
+static void throwParseError()
 {
+    throw RprMidiEvent::RprMidiException(__LOCALIZE("Error parsing MIDI data","sws_mbox"));
 }
 
-void RprExtendedMidiEvent::addExtendedData(const std::string &data)
-{
-    mExtendedData.push_back(data);
-}
-
-RprMidiEvent::MessageType RprExtendedMidiEvent::getMessageType() const
+static RprMidiEvent::MessageType getMessageType(unsigned char message)
 {
-    if (mExtendedData.front().substr(0, 2) == "/w")
-        return RprMidiEvent::TextEvent;
-    else
+    if(message == 0xF0)
         return RprMidiEvent::Sysex;
-}
-
-RprNode *RprExtendedMidiEvent::toReaper()
-{
-    std::stringstream oss;
-    if(isSelected())
-        oss << "x";
-    else
-        oss << "X";
-
-    if(isMuted())
-        oss << "m";
-    oss << " ";
-    oss << getDelta() << " 0";
-    std::auto_ptr<RprNode> node(new RprParentNode(oss.str().c_str()));
-    for(std::list<std::string>::const_iterator i = mExtendedData.begin();
-        i != mExtendedData.end(); ++i)
-    {
-        std::auto_ptr<RprNode> childNode(new RprPropertyNode(*i));
-        node->addChild(childNode.release());
-    }
-    return node.release();
-}
-
-void RprMidiEvent::setMidiMessage(const std::vector<unsigned char> message)
-{
-    mMidiMessage = message;
-}
-
-const std::vector<unsigned char>& RprMidiEvent::getMidiMessage()
-{
-    return mMidiMessage;
-}
-
-unsigned char RprMidiEvent::getValue1() const
-{
-    return mMidiMessage[1];
-}
-
-void RprMidiEvent::setValue1(unsigned char value)
-{
-    mMidiMessage[1] = value;
-}
+    if(message == 0xFF)
+        return RprMidiEvent::TextEvent;
 
-static RprMidiEvent::MessageType getMessageType(unsigned char message)
-{
     message = (message & 0xF0) >> 4;
     switch(message) {
         case 8:
@@ -151,206 +49,227 @@ static RprMidiEvent::MessageType getMessageType(unsigned char message)
     }
 }
 
-RprMidiEvent::MessageType RprMidiEvent::getMessageType() const
+static bool isNote(unsigned char status)
 {
-    return ::getMessageType(mMidiMessage[0]);
+    RprMidiEvent::MessageType messageType = getMessageType(status);
+    return messageType == RprMidiEvent::NoteOn || messageType == RprMidiEvent::NoteOff;
 }
 
-void RprMidiEvent::setMessageType(RprMidiEvent::MessageType messageType)
+static const char *skipSpaces(const char *pos)
 {
-    unsigned char messageNibble = 0x0;
-    switch(messageType) {
-        case NoteOff:
-            messageNibble = 0x8;
-            break;
-        case NoteOn:
-            messageNibble = 0x9;
-            break;
-        case CC:
-            messageNibble = 0xB;
-            break;
-        case ProgramChange:
-            messageNibble = 0xC;
-            break;
-        case PitchBend:
-            messageNibble = 0xE;
-            break;
-    }
-    mMidiMessage[0] &= 0x0F;
-    mMidiMessage[0] |= (messageNibble << 4);
+    while(*pos == ' ' || *pos == '\t' || *pos == '\r')
+        pos++;
+    return pos;
 }
 
-unsigned char RprMidiEvent::getValue2() const
+static const char *nextLine(const char *pos)
 {
-    return mMidiMessage[2];
+    while(*pos && *pos != '\n')
+        pos++;
+    return *pos ? pos + 1 : pos;
 }
 
-void RprMidiEvent::setValue2(unsigned char value)
+RprMidiEventStore::RprMidiEventStore()
 {
-    mMidiMessage[2] = value;
 }
 
-int RprMidiEvent::getUnquantizedOffset() const
+int RprMidiEventStore::push(int offset, unsigned char status, unsigned char messageSize, unsigned char flags)
 {
-    return mQuantizeOffset;
-}
-
-void RprMidiEvent::setUnquantizedOffset(int offset)
-{
-    mQuantizeOffset = offset;
-}
-
-unsigned char RprMidiEvent::getChannel() const
-{ 
-    return (mMidiMessage[0] & 0x0F);
+    mOffsets.push_back(offset);
+    mUnquantizedOffsets.push_back(0);
+    mStatus.push_back(status);
+    mValue1.push_back(0);
+    mValue2.push_back(0);
+    mSizes.push_back(messageSize);
+    mFlags.push_back(flags);
+    return size() - 1;
 }
 
-void RprMidiEvent::setChannel(unsigned char channel)
+void RprMidiEventStore::read(const char *data)
 {
-    mMidiMessage[0] &= 0xF0;
-    mMidiMessage[0] |= channel;
-}
+    int offset = 0;
+    const char *pos = data;
+    while(*pos) {
+        const char *line = skipSpaces(pos);
+        pos = nextLine(line);
+        if(*line == '\n' || *line == 0)
+            continue;
 
-RprNode *RprMidiEvent::toReaper()
-{
-    std::stringstream oss;
-    if(isSelected())
-        oss << "e";
-    else
-        oss << "E";
+        bool extended = *line == '<';
+        if(extended)
+            line++;
 
-    if(isMuted())
-        oss << "m";
-    oss << " ";
-    oss << getDelta();
-    for(std::vector<unsigned char>::iterator i = mMidiMessage.begin(); i != mMidiMessage.end(); i++)
-        oss << " " << toHex(*i);
+        unsigned char flags = 0;
+        switch(line[0]) {
+            case 'e':
+            case 'x':
+                flags |= Selected;
+                break;
+            case 'E':
+            case 'X':
+                break;
+            default:
+                throwParseError();
+        }
+        line++;
+        if(*line == 'm') {
+            flags |= Muted;
+            line++;
+        }
+        if(*line != ' ')
+            throwParseError();
+
+        char *end;
+        offset += (int)strtol(line, &end, 10);
+        line = end;
+
+        if(extended) {
+            /* data lines up to the closing '>' of the event chunk */
+            ExtendedData extendedData;
+            extendedData.event = push(offset, 0xF0, 0, flags | Extended);
+            extendedData.start = (int)mExtendedData.size();
+            for(int depth = 1;;) {
+                const char *dataLine = skipSpaces(pos);
+                if(*dataLine == 0)
+                    throwParseError();
+                pos = nextLine(dataLine);
+                if(*dataLine == '<')
+                    depth++;
+                else if(*dataLine == '>' && --depth == 0)
+                    break;
+                mExtendedData.append(dataLine, pos - dataLine);
+            }
+            extendedData.length = (int)mExtendedData.size() - extendedData.start;
+            if(mExtendedData.compare(extendedData.start, 2, "/w") == 0)
+                mStatus.back() = 0xFF;
+            mExtended.push_back(extendedData);
+            continue;
+        }
 
-    if(getMessageType() == NoteOn || getMessageType() == NoteOff) {
-        if(mQuantizeOffset != 0) {
-            oss << " " << mQuantizeOffset;
+        unsigned char message[3] = {0, 0, 0};
+        int messageSize = 0;
+        int unquantizedOffset = 0;
+        for(int token = 0;; token++) {
+            line = skipSpaces(line);
+            if(*line == '\n' || *line == 0)
+                break;
+            if(token == 3 && isNote(message[0])) {
+                unquantizedOffset = (int)strtol(line, &end, 10);
+            } else {
+                unsigned long value = strtoul(line, &end, 16);
+                if(messageSize == 3)
+                    throwParseError();
+                message[messageSize++] = (unsigned char)value;
+            }
+            if(end == line)
+                throwParseError();
+            line = end;
         }
+        if(messageSize == 0)
+            throwParseError();
+
+        int event = push(offset, message[0], (unsigned char)messageSize, flags);
+        mValue1[event] = message[1];
+        mValue2[event] = message[2];
+        mUnquantizedOffsets[event] = unquantizedOffset;
     }
-    std::auto_ptr<RprNode> node(new RprPropertyNode(oss.str()));
-    return node.release();
 }
 
-static bool isExtended(const char* inStr)
+const RprMidiEventStore::ExtendedData &RprMidiEventStore::getExtendedData(int event) const
 {
-    if(inStr[0] == 0)
-        throw RprMidiEvent::RprMidiException(__LOCALIZE("Error parsing MIDI data","sws_mbox"));
-    if(inStr[0] == 'x')
-        return true;
-    if(inStr[0] == 'X')
-        return true;
-    return false;
+    int low = 0;
+    int high = (int)mExtended.size() - 1;
+    while(low < high) {
+        int mid = (low + high) / 2;
+        if(mExtended[mid].event < event)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return mExtended[low];
 }
 
-static bool isSelected(const char* inStr)
+void RprMidiEventStore::write(const std::vector<int> &order, int startOffset, std::string &data) const
 {
-    if(inStr[0] == 0)
-        throw RprMidiEvent::RprMidiException(__LOCALIZE("Error parsing MIDI data","sws_mbox"));
-    if(inStr[0] == 'E')
-        return false;
-    if(inStr[0] == 'e')
-        return true;
-    if(inStr[0] == 'x')
-        return true;
-    if(inStr[0] == 'X')
-        return false;
+    static const char hexDigits[] = "0123456789abcdef";
 
-    throw RprMidiEvent::RprMidiException(__LOCALIZE("Error parsing MIDI data","sws_mbox"));
-}
+    data.reserve(data.size() + order.size() * 20);
+    int offset = startOffset;
+    char buffer[64];
+    for(std::vector<int>::const_iterator i = order.begin(); i != order.end(); ++i) {
+        int event = *i;
+        int delta = mOffsets[event] - offset;
+        offset = mOffsets[event];
+        const char *muted = isMuted(event) ? "m" : "";
 
-static bool isMuted(const char* inStr)
-{
-    if(inStr[0] == 0 || inStr[1] == 0)
-        return false;
-    if(inStr[1] == 'm')
-        return true;
-
-    throw RprMidiEvent::RprMidiException(__LOCALIZE("Error parsing MIDI data","sws_mbox"));
-}
+        if(mFlags[event] & Extended) {
+            const ExtendedData &extendedData = getExtendedData(event);
+            data.append(buffer, sprintf(buffer, "<%c%s %d 0\n", isSelected(event) ? 'x' : 'X', muted, delta));
+            data.append(mExtendedData, extendedData.start, extendedData.length);
+            data.append(">\n");
+            continue;
+        }
 
-static unsigned char fromHex(const std::string &inStr)
-{
-    unsigned int v;
-    std::istringstream iss(inStr);
-    iss >> std::setbase(16) >> v;
-    return (unsigned char)v;
+        int length = sprintf(buffer, "%c%s %d", isSelected(event) ? 'e' : 'E', muted, delta);
+        const unsigned char message[3] = { mStatus[event], mValue1[event], mValue2[event] };
+        for(int j = 0; j < mSizes[event]; j++) {
+            buffer[length++] = ' ';
+            buffer[length++] = hexDigits[message[j] >> 4];
+            buffer[length++] = hexDigits[message[j] & 0x0F];
+        }
+        if(isNote(mStatus[event]) && mUnquantizedOffsets[event] != 0)
+            length += sprintf(buffer + length, " %d", mUnquantizedOffsets[event]);
+        buffer[length++] = '\n';
+        data.append(buffer, length);
+    }
 }
 
-static std::string toHex(unsigned char hex)
+int RprMidiEventStore::add(RprMidiEvent::MessageType messageType)
 {
-    std::ostringstream oss;
-    oss << std::setbase(16) << std::setw(2) << std::setfill('0') << (int)hex;
-    return oss.str();
+    int event = push(0, 0, 3, 0);
+    setMessageType(event, messageType);
+    return event;
 }
 
-static bool isNote(std::vector<unsigned char> &midiMessage)
+RprMidiEvent::MessageType RprMidiEventStore::getMessageType(int event) const
 {
-    if(midiMessage.empty())
-        return false;
-    if(getMessageType(midiMessage[0]) == RprMidiEvent::NoteOn)
-        return true;
-    if(getMessageType(midiMessage[0]) == RprMidiEvent::NoteOff)
-        return true;
-    return false;
+    return ::getMessageType(mStatus[event]);
 }
 
-RprMidiEventCreator::RprMidiEventCreator(RprNode *node)
+void RprMidiEventStore::setMessageType(int event, RprMidiEvent::MessageType messageType)
 {
-    StringVector tokens(node->getValue());
-
-    if(tokens.empty())
-        throw RprMidiEvent::RprMidiException(__LOCALIZE("Error parsing MIDI data","sws_mbox"));
-
-    int delta = (int)strtoul(tokens.at(1), 0, 10);
-    bool selected = isSelected(tokens.at(0));
-    bool muted = isMuted(tokens.at(0));
-
-    if(isExtended(tokens.at(0)))
-    {
-        mXEvent.reset(new RprExtendedMidiEvent());
-        mXEvent->setDelta(delta);
-
-        for(int i = 0; i < node->childCount(); ++i)
-        {
-            mXEvent->addExtendedData(node->getChild(i)->getValue());
-        }
-
-        mXEvent->setMuted(muted);
-        mXEvent->setSelected(selected);
-        return;
-    }
-    mEvent.reset(new RprMidiEvent());
-    mEvent->setSelected(selected);
-    mEvent->setMuted(muted);
-    mEvent->setDelta(delta);
-    std::vector<unsigned char> midiMessage;
-    for(unsigned int i = 2; i < tokens.size(); i++) {
-
-        if(i == 5 && isNote(midiMessage)) {
-            mEvent->setUnquantizedOffset(::atoi(tokens.at(i)));
-        } else {
-            midiMessage.push_back(fromHex(tokens.at(i)));
-        }
-
+    unsigned char messageNibble = 0x0;
+    switch(messageType) {
+        case RprMidiEvent::NoteOff:
+            messageNibble = 0x8;
+            break;
+        case RprMidiEvent::NoteOn:
+            messageNibble = 0x9;
+            break;
+        case RprMidiEvent::CC:
+            messageNibble = 0xB;
+            break;
+        case RprMidiEvent::ProgramChange:
+            messageNibble = 0xC;
+            break;
+        case RprMidiEvent::PitchBend:
+            messageNibble = 0xE;
+            break;
     }
-    mEvent->setMidiMessage(midiMessage);
+    mStatus[event] &= 0x0F;
+    mStatus[event] |= (messageNibble << 4);
 }
 
-RprMidiEvent *RprMidiEventCreator::collectEvent()
+void RprMidiEventStore::setChannel(int event, unsigned char channel)
 {
-    if (mEvent.get())
-        return mEvent.release();
-
-    if (mXEvent.get())
-        return mXEvent.release();
-
-    throw RprMidiEvent::RprMidiException(__LOCALIZE("Error parsing MIDI data","sws_mbox"));
+    mStatus[event] &= 0xF0;
+    mStatus[event] |= channel;
 }
 
-RprMidiEventCreator::~RprMidiEventCreator()
+void RprMidiEventStore::setFlag(int event, unsigned char flag, bool set)
 {
+    if(set)
+        mFlags[event] |= flag;
+    else
+        mFlags[event] &= ~flag;
 }
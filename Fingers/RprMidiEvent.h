@@ -1,51 +1,13 @@
 #ifndef __RPRMIDIEVENT_HXX
 #define __RPRMIDIEVENT_HXX
 
-#include <memory>
-
-class RprNode;
+#include <string>
+#include <vector>
 
 class RprMidiEvent {
 public:
     enum MessageType { NoteOff, NoteOn, KeyPressure, CC, ProgramChange, ChannelPressure, PitchBend,
                        Sysex, TextEvent, Unknown };
-    RprMidiEvent();
-
-    bool isSelected() const;
-    void setSelected( bool selected);
-
-    bool isMuted() const;
-    void setMuted(bool muted);
-
-    int getDelta() const;
-    void setDelta(int delta);
-
-    virtual MessageType getMessageType() const;
-    void setMessageType(MessageType messageType);
-
-    int getOffset() const;
-    void setOffset(int offset);
-
-    void setChannel(unsigned char channel);
-    unsigned char getChannel() const;
-
-    unsigned char getValue1() const;
-    void setValue1(unsigned char value);
-
-    unsigned char getValue2() const;
-    void setValue2(unsigned char value);
-
-    int getUnquantizedOffset() const;
-    void setUnquantizedOffset(int offset);
-
-    void setMidiMessage(const std::vector<unsigned char> message);
-    const std::vector<unsigned char>& getMidiMessage();
-
-    const std::string& getExtendedData() const;
-
-    virtual RprNode *toReaper();
-
-    virtual ~RprMidiEvent() {}
 
     class RprMidiException {
     public:
@@ -57,42 +19,80 @@ public:
     };
 
 private:
-
-    std::vector<unsigned char> mMidiMessage;
-    int mQuantizeOffset;
-
-    int mDelta;
-    int mOffset;
-    bool mMuted;
-    bool mSelected;
+    RprMidiEvent();
 };
 
-class RprExtendedMidiEvent : public RprMidiEvent
+/* All MIDI events of a take, one entry per event in each array. Events are
+ * referred to by index, which stays valid for the lifetime of the store.
+ * Sysex and text events keep their chunk data lines in a shared buffer. */
+class RprMidiEventStore
 {
 public:
-    RprExtendedMidiEvent();
+    RprMidiEventStore();
 
-    void addExtendedData(const std::string &data);
+    /* Parse the event lines of a MIDI source chunk, offsets are
+     * accumulated from the deltas */
+    void read(const char *data);
 
-    virtual MessageType getMessageType() const;
+    /* Append the events in order to the chunk data, deltas are
+     * relative to startOffset */
+    void write(const std::vector<int> &order, int startOffset, std::string &data) const;
 
-    virtual RprNode *toReaper();
+    int size() const { return (int)mOffsets.size(); }
 
-private:
-    std::list<std::string> mExtendedData;
-};
+    /* Add a three byte event of the given type at offset 0 */
+    int add(RprMidiEvent::MessageType messageType);
+
+    RprMidiEvent::MessageType getMessageType(int event) const;
+    void setMessageType(int event, RprMidiEvent::MessageType messageType);
+
+    int getOffset(int event) const { return mOffsets[event]; }
+    void setOffset(int event, int offset) { mOffsets[event] = offset; }
+
+    int getUnquantizedOffset(int event) const { return mUnquantizedOffsets[event]; }
+    void setUnquantizedOffset(int event, int offset) { mUnquantizedOffsets[event] = offset; }
+
+    unsigned char getChannel(int event) const { return mStatus[event] & 0x0F; }
+    void setChannel(int event, unsigned char channel);
+
+    unsigned char getValue1(int event) const { return mValue1[event]; }
+    void setValue1(int event, unsigned char value) { mValue1[event] = value; }
+
+    unsigned char getValue2(int event) const { return mValue2[event]; }
+    void setValue2(int event, unsigned char value) { mValue2[event] = value; }
+
+    bool isSelected(int event) const { return (mFlags[event] & Selected) != 0; }
+    void setSelected(int event, bool selected) { setFlag(event, Selected, selected); }
+
+    bool isMuted(int event) const { return (mFlags[event] & Muted) != 0; }
+    void setMuted(int event, bool muted) { setFlag(event, Muted, muted); }
 
-class RprMidiEventCreator
-{
-public:
-    RprMidiEventCreator(RprNode *node);
-    /* Collect midi Event. Once you have collected it you
-     * take ownership of it. */
-    RprMidiEvent *collectEvent();
-    ~RprMidiEventCreator();
 private:
-    std::auto_ptr<RprMidiEvent> mEvent;
-    std::auto_ptr<RprExtendedMidiEvent> mXEvent;
+    enum { Selected = 1, Muted = 2, Extended = 4 };
+
+    struct ExtendedData
+    {
+        int event;
+        int start;
+        int length;
+    };
+
+    int push(int offset, unsigned char status, unsigned char messageSize, unsigned char flags);
+    void setFlag(int event, unsigned char flag, bool set);
+    const ExtendedData &getExtendedData(int event) const;
+
+    std::vector<int> mOffsets;
+    std::vector<int> mUnquantizedOffsets;
+    /* status byte, 0xF0 for sysex and 0xFF for text events */
+    std::vector<unsigned char> mStatus;
+    std::vector<unsigned char> mValue1;
+    std::vector<unsigned char> mValue2;
+    /* number of bytes of the MIDI message */
+    std::vector<unsigned char> mSizes;
+    std::vector<unsigned char> mFlags;
+    /* sorted by event */
+    std::vector<ExtendedData> mExtended;
+    std::string mExtendedData;
 };
 
 #endif /*__RPRMIDIEVENT_HXX */
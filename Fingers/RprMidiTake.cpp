@@ -164,35 +164,6 @@ RprMidiNote* FNG_AddMidiNote(RprMidiTake* midiTake)
     return 0;
 }
 
-typedef std::list<RprMidiEvent *> RprMidiEvents;
-typedef std::list<RprMidiEvent *>::iterator RprMidiEventsIter;
-typedef std::list<RprMidiEvent *>::const_iterator RprMidiEventsCIter;
-
-/* Class to auto cleanup pointers to RprMidiEvent objects stored in a list */
-class RprTempMidiEvents
-{
-public:
-    RprTempMidiEvents()
-    {
-    }
-
-    RprMidiEvents &get()
-    {
-        return mEvents;
-    }
-
-    ~RprTempMidiEvents()
-    {
-        for(RprMidiEventsIter i = mEvents.begin(); i != mEvents.end(); ++i)
-        {
-            delete *i;
-        }
-    }
-
-private:
-    RprMidiEvents mEvents;
-};
-
 class RprMidiContext
 {
 public:
@@ -235,27 +206,19 @@ private:
     double mPlayRate;
 };
 
-template
-<typename T>
-static bool compareMidiPositions(T *lhs, T *rhs)
+static bool compareNotePositions(const RprMidiNote *lhs, const RprMidiNote *rhs)
 {
     return lhs->getItemPosition() < rhs->getItemPosition();
 }
 
-RprMidiNote::RprMidiNote(RprMidiContext *context)
+static bool compareCCPositions(const RprMidiCC &lhs, const RprMidiCC &rhs)
 {
-    RprMidiEvent *noteOnEvent = new RprMidiEvent();
-    noteOnEvent->setMessageType(RprMidiEvent::NoteOn);
-    mNoteOn = noteOnEvent;
-
-    RprMidiEvent *noteOffEvent = new RprMidiEvent();
-    noteOffEvent->setMessageType(RprMidiEvent::NoteOff);
-    mNoteOff = noteOffEvent;
-    mContext = context;
+    return lhs.getItemPosition() < rhs.getItemPosition();
 }
 
-RprMidiNote::RprMidiNote(RprMidiEvent *noteOn, RprMidiEvent *noteOff, RprMidiContext *context)
+RprMidiNote::RprMidiNote(RprMidiEventStore *events, int noteOn, int noteOff, RprMidiContext *context)
 {
+    mEvents = events;
     mNoteOn = noteOn;
     mNoteOff = noteOff;
     mContext = context;
@@ -281,73 +244,73 @@ static int getMidiOffsetPosition(const RprMidiContext *context, double position)
 
 double RprMidiNote::getPosition() const
 {
-    return getPositionMidiOffset(mContext, mNoteOn->getOffset());
+    return getPositionMidiOffset(mContext, mEvents->getOffset(mNoteOn));
 }
 
 void RprMidiNote::setPosition(double position)
 {
-    int unQuantizedNoteOn = mNoteOn->getOffset() + mNoteOn->getUnquantizedOffset();
-    int unQuantizedNoteOff = mNoteOff->getOffset() + mNoteOff->getUnquantizedOffset();
+    int unQuantizedNoteOn = mEvents->getOffset(mNoteOn) + mEvents->getUnquantizedOffset(mNoteOn);
+    int unQuantizedNoteOff = mEvents->getOffset(mNoteOff) + mEvents->getUnquantizedOffset(mNoteOff);
 
     int noteOnOffset = getMidiOffsetPosition(mContext, position);
-    int noteOffOffset = noteOnOffset + mNoteOff->getOffset() - mNoteOn->getOffset();
+    int noteOffOffset = noteOnOffset + mEvents->getOffset(mNoteOff) - mEvents->getOffset(mNoteOn);
 
-    mNoteOn->setOffset(noteOnOffset);
-    mNoteOff->setOffset(noteOffOffset);
+    mEvents->setOffset(mNoteOn, noteOnOffset);
+    mEvents->setOffset(mNoteOff, noteOffOffset);
 
-    mNoteOn->setUnquantizedOffset(unQuantizedNoteOn - noteOnOffset);
-    mNoteOff->setUnquantizedOffset(unQuantizedNoteOff - noteOffOffset);
+    mEvents->setUnquantizedOffset(mNoteOn, unQuantizedNoteOn - noteOnOffset);
+    mEvents->setUnquantizedOffset(mNoteOff, unQuantizedNoteOff - noteOffOffset);
 }
 
 bool RprMidiNote::isSelected() const
 {
-    return mNoteOn->isSelected();
+    return mEvents->isSelected(mNoteOn);
 }
 
 bool RprMidiNote::isMuted() const
 {
-    return mNoteOn->isMuted();
+    return mEvents->isMuted(mNoteOn);
 }
 
 void RprMidiNote::setMuted(bool muted)
 {
-    mNoteOn->setMuted(muted);
-    mNoteOff->setMuted(muted);
+    mEvents->setMuted(mNoteOn, muted);
+    mEvents->setMuted(mNoteOff, muted);
 }
 
 void RprMidiNote::setSelected(bool selected)
 {
-    mNoteOn->setSelected(selected);
-    mNoteOff->setSelected(selected);
+    mEvents->setSelected(mNoteOn, selected);
+    mEvents->setSelected(mNoteOff, selected);
 }
 
 int RprMidiNote::getItemPosition() const
 {
-    return mNoteOn->getOffset();
+    return mEvents->getOffset(mNoteOn);
 }
 
 void RprMidiNote::setItemPosition(int position)
 {
-    int noteOffPosition = mNoteOff->getOffset() - mNoteOn->getOffset() + position;
-    mNoteOn->setOffset(position);
-    mNoteOff->setOffset(noteOffPosition);
+    int noteOffPosition = mEvents->getOffset(mNoteOff) - mEvents->getOffset(mNoteOn) + position;
+    mEvents->setOffset(mNoteOn, position);
+    mEvents->setOffset(mNoteOff, noteOffPosition);
 }
 
 int RprMidiNote::getChannel() const
 {
-    return (int)(mNoteOn->getChannel() + 1);
+    return (int)(mEvents->getChannel(mNoteOn) + 1);
 }
 
 void RprMidiNote::setChannel(int channel)
 {
-    mNoteOn->setChannel(channel - 1);
-    mNoteOff->setChannel(channel - 1);
+    mEvents->setChannel(mNoteOn, channel - 1);
+    mEvents->setChannel(mNoteOff, channel - 1);
 }
 
 double RprMidiNote::getLength() const
 {
-    return getPositionMidiOffset(mContext, mNoteOff->getOffset()) -
-        getPositionMidiOffset(mContext, mNoteOn->getOffset());
+    return getPositionMidiOffset(mContext, mEvents->getOffset(mNoteOff)) -
+        getPositionMidiOffset(mContext, mEvents->getOffset(mNoteOn));
 }
 
 void RprMidiNote::setLength(double length)
@@ -361,16 +324,16 @@ void RprMidiNote::setLength(double length)
 
 int RprMidiNote::getItemLength() const
 {
-    return mNoteOff->getOffset() - mNoteOn->getOffset();
+    return mEvents->getOffset(mNoteOff) - mEvents->getOffset(mNoteOn);
 }
 
 void RprMidiNote::setItemLength(int len)
 {
-    int offset = mNoteOn->getOffset();
-    int unquantizedOffset = offset + mNoteOff->getUnquantizedOffset();
+    int offset = mEvents->getOffset(mNoteOn);
+    int unquantizedOffset = offset + mEvents->getUnquantizedOffset(mNoteOff);
     offset += len;
-    mNoteOff->setOffset(offset);
-    mNoteOff->setUnquantizedOffset(unquantizedOffset - offset);
+    mEvents->setOffset(mNoteOff, offset);
+    mEvents->setUnquantizedOffset(mNoteOff, unquantizedOffset - offset);
 }
 
 void RprMidiNote::setPitch(int pitch)
@@ -384,13 +347,13 @@ void RprMidiNote::setPitch(int pitch)
     {
         pitch = 0;
     }
-    mNoteOn->setValue1((unsigned char)pitch);
-    mNoteOff->setValue1((unsigned char)pitch);
+    mEvents->setValue1(mNoteOn, (unsigned char)pitch);
+    mEvents->setValue1(mNoteOff, (unsigned char)pitch);
 }
 
 int RprMidiNote::getPitch() const
 {
-    return (int)mNoteOn->getValue1();
+    return (int)mEvents->getValue1(mNoteOn);
 }
 
 void RprMidiNote::setVelocity(int velocity)
@@ -405,65 +368,35 @@ void RprMidiNote::setVelocity(int velocity)
         velocity = 0;
     }
 
-    mNoteOn->setValue2((unsigned char)velocity);
-    if(mNoteOff->getMessageType() == RprMidiEvent::NoteOn &&
-       mNoteOff->getValue2() == 0)
+    mEvents->setValue2(mNoteOn, (unsigned char)velocity);
+    if(mEvents->getMessageType(mNoteOff) == RprMidiEvent::NoteOn &&
+       mEvents->getValue2(mNoteOff) == 0)
     {
         return;
     }
-    mNoteOff->setValue2((unsigned char)velocity);
+    mEvents->setValue2(mNoteOff, (unsigned char)velocity);
 }
 
 int RprMidiNote::getVelocity() const
 {
-    return (int)mNoteOn->getValue2();
-}
-
-RprMidiNote::~RprMidiNote()
-{
-    delete mNoteOn;
-    delete mNoteOff;
+    return (int)mEvents->getValue2(mNoteOn);
 }
 
-RprMidiCC::RprMidiCC(RprMidiContext *context, int controller)
-{
-    mCC = new RprMidiEvent();
-    mCC->setMessageType(RprMidiEvent::CC);
-
-    // Probably should throw an exception here if
-    // controller is invalid.
-    if(controller > 127)
-    {
-        controller = 127;
-    }
-
-    if(controller < 0)
-    {
-        controller = 0;
-    }
-
-    mCC->setValue1((unsigned char)controller);
-    mContext = context;
-}
-RprMidiCC::RprMidiCC(RprMidiEvent *cc, RprMidiContext *context)
+RprMidiCC::RprMidiCC(RprMidiEventStore *events, int cc, RprMidiContext *context)
 {
+    mEvents = events;
     mCC = cc;
     mContext = context;
 }
 
 int RprMidiCC::getChannel() const
 {
-    return mCC->getChannel() + 1;
+    return mEvents->getChannel(mCC) + 1;
 }
 
 int RprMidiCC::getItemPosition() const
 {
-    return mCC->getOffset();
-}
-
-RprMidiCC::~RprMidiCC()
-{
-    delete mCC;
+    return mEvents->getOffset(mCC);
 }
 
 static int getQNValue(RprNode *midiNode)
@@ -473,251 +406,172 @@ static int getQNValue(RprNode *midiNode)
     return ::atoi(tokens.at(2));
 }
 
-static bool sortMidiBase(const RprMidiEvent *lhs, const RprMidiEvent *rhs)
+class RprSortMidiEvents
 {
-    if (rhs->getOffset() == lhs->getOffset())
-    {
-        if (lhs->getMessageType() == RprMidiEvent::NoteOn && 
-            rhs->getMessageType() == RprMidiEvent::NoteOn)
-        {
-            // Order by increasing velocity so 0 velocity notes
-            // appear first
-            return lhs->getValue2() < rhs->getValue2();
-        }
-        // Order by message type so note-offs appear first
-        return lhs->getMessageType() < rhs->getMessageType();
-    }
-    return lhs->getOffset() < rhs->getOffset();
-}
-
-static bool isMidiEvent(const std::string &eventStr) {
-
-    if(eventStr.size() <= 3)
-    {
-        return false;
-    }
-
-    switch(eventStr[0])
-    {
-        case 'e':
-        case 'x':
-        case 'X':
-        case 'E':
-            break;
-        default:
-            return false;
-    }
-
-    switch(eventStr[1])
+public:
+    RprSortMidiEvents(const RprMidiEventStore &events) : mEvents(events)
     {
-        case ' ':
-            return true;
-        case 'm':
-            break;
-        default:
-            return false;
-    }
-
-    switch(eventStr[2]) {
-        case ' ':
-            return true;
-        default:
-            return false;
     }
-    return false;
-}
 
-static int clearMidiEventsFromMidiNode(RprNode *parent)
-{
-    int i = 0;
-    for(; i < parent->childCount(); ++i)
+    bool operator()(int lhs, int rhs) const
     {
-        if(isMidiEvent(parent->getChild(i)->getValue()))
+        if (mEvents.getOffset(rhs) == mEvents.getOffset(lhs))
         {
-            break;
+            RprMidiEvent::MessageType lhsType = mEvents.getMessageType(lhs);
+            RprMidiEvent::MessageType rhsType = mEvents.getMessageType(rhs);
+            if (lhsType == RprMidiEvent::NoteOn && rhsType == RprMidiEvent::NoteOn)
+            {
+                // Order by increasing velocity so 0 velocity notes
+                // appear first
+                return mEvents.getValue2(lhs) < mEvents.getValue2(rhs);
+            }
+            // Order by message type so note-offs appear first
+            return lhsType < rhsType;
         }
+        return mEvents.getOffset(lhs) < mEvents.getOffset(rhs);
     }
-    int offset = i;
-
-    while (isMidiEvent(parent->getChild(i)->getValue()))
-    {
-        parent->removeChild(i);
-    }
-    return offset;
-}
-
-static void midiEventsToMidiNode(std::vector< RprMidiEvent *> &midiEvents, RprNode *midiNode, 
-                                 int offset)
-{
-    int index = offset;
-    for(std::vector<RprMidiEvent *>::iterator i = midiEvents.begin(); i != midiEvents.end(); i++)
-    {
-        RprMidiEvent *current = *i;
-        midiNode->addChild(current->toReaper(), index++);
-    }
-}
-
-static void getMidiEvents(RprNode *midiNode, RprMidiEvents &midiEvents)
-{
-    int offset = 0;
-    for(int i = 1; i < midiNode->childCount(); i++)
-    {
-        if(!isMidiEvent(midiNode->getChild(i)->getValue()))
-        {
-            continue;
-        }
 
-        RprMidiEventCreator creator(midiNode->getChild(i));
-        RprMidiEvent *midiEvent = creator.collectEvent();
-        offset += midiEvent->getDelta();
-        midiEvent->setOffset(offset);
-        midiEvents.push_back(midiEvent);
-    }
-}
+private:
+    const RprMidiEventStore &mEvents;
+};
 
-static bool noteEventsMatch(const RprMidiEvent *noteOn, const RprMidiEvent *noteOff)
+static bool isNoteOff(const RprMidiEventStore &events, int event)
 {
-    if(noteOn->getChannel() != noteOff->getChannel())
-    {
-        return false;
-    }
-
-    if(noteOn->getValue1() != noteOff->getValue1())
-    {
-        return false;
-    }
-
-    if(noteOn->getOffset() > noteOff->getOffset())
-    {
-        return false;
-    }
-    return true;
+    return events.getMessageType(event) == RprMidiEvent::NoteOff ||
+        (events.getMessageType(event) == RprMidiEvent::NoteOn && events.getValue2(event) == 0);
 }
 
-static bool getMidiCCs(RprMidiEvents &midiEvents,
-                       std::vector<RprMidiCC *> *midiCCs,
+static void getMidiCCs(RprMidiEventStore &events,
+                       std::vector<int> &midiEvents,
+                       std::vector<RprMidiCC> *midiCCs,
                        RprMidiContext *context)
 {
-    RprMidiEvents other;
-    for(RprMidiEventsCIter i = midiEvents.begin(); i != midiEvents.end(); ++i)
+    std::vector<int> other;
+    other.reserve(midiEvents.size());
+    for(std::vector<int>::const_iterator i = midiEvents.begin(); i != midiEvents.end(); ++i)
     {
-        RprMidiEvent *current = *i;
-
-        if(current->getMessageType() == RprMidiEvent::CC)
+        if(events.getMessageType(*i) == RprMidiEvent::CC)
         {
-            midiCCs[current->getValue1()].push_back(new RprMidiCC(current, context));
+            midiCCs[events.getValue1(*i)].push_back(RprMidiCC(&events, *i, context));
         }
         else
         {
-            other.push_back(current);
+            other.push_back(*i);
         }
     }
-    midiEvents = other;
-    return true;
+    midiEvents.swap(other);
 }
 
-static bool getMidiNotes(RprMidiEvents &midiEvents,
+/* Pair every note-on with the first unused note-off of the same channel and
+ * pitch at or after it. Note-offs are bucketed by channel/pitch, so this is
+ * linear in the number of events for well-formed data. Zero length notes
+ * are dropped. Unmatched events are left in midiEvents. */
+static void getMidiNotes(RprMidiEventStore &events,
+                         std::vector<int> &midiEvents,
+                         std::deque<RprMidiNote> &noteStore,
                          std::vector<RprMidiNote *> &midiNotes,
                          RprMidiContext *context)
 {
-    RprMidiEvents noteOns;
-    RprMidiEvents noteOffs;
-    RprMidiEvents other;
+    std::vector< std::vector<int> > noteOffs(16 * 128);
+    std::vector<int> firstUnmatched(16 * 128, 0);
+    std::vector<bool> matched(events.size(), false);
 
-    /* categorize notes into note-ons and note-offs */
-    for(RprMidiEventsCIter i = midiEvents.begin(); i != midiEvents.end(); ++i)
+    for(std::vector<int>::const_iterator i = midiEvents.begin(); i != midiEvents.end(); ++i)
     {
-        RprMidiEvent *current = *i;
-        if(current->getMessageType() == RprMidiEvent::NoteOn && current->getValue2() != 0)
+        if(isNoteOff(events, *i))
         {
-            noteOns.push_back(current);
+            noteOffs[events.getChannel(*i) * 128 + events.getValue1(*i)].push_back(*i);
         }
-        else if(current->getMessageType() == RprMidiEvent::NoteOff ||
-               (current->getMessageType() == RprMidiEvent::NoteOn &&
-                current->getValue2() == 0))
+    }
+
+    std::vector<int> other;
+    for(std::vector<int>::const_iterator i = midiEvents.begin(); i != midiEvents.end(); ++i)
+    {
+        int noteOn = *i;
+        if(events.getMessageType(noteOn) != RprMidiEvent::NoteOn || events.getValue2(noteOn) == 0)
         {
-            noteOffs.push_back(current);
+            continue;
         }
-        else
+
+        int key = events.getChannel(noteOn) * 128 + events.getValue1(noteOn);
+        std::vector<int> &candidates = noteOffs[key];
+        int &first = firstUnmatched[key];
+        while(first < (int)candidates.size() && matched[candidates[first]])
         {
-            other.push_back(current);
+            ++first;
         }
-    }
-    midiEvents.clear();
 
-    /* match note-ons and note-offs, removing zero length notes */
-    RprMidiEventsIter i = noteOns.begin();
-    while(i != noteOns.end())
-    {
-        RprMidiEventsIter j = noteOffs.begin();
-        while(j != noteOffs.end() && !noteEventsMatch(*i, *j))
+        int noteOff = -1;
+        for(int j = first; j < (int)candidates.size(); ++j)
         {
-            ++j;
+            if(!matched[candidates[j]] && events.getOffset(candidates[j]) >= events.getOffset(noteOn))
+            {
+                noteOff = candidates[j];
+                break;
+            }
         }
+
         /* no match so add noteOn to other events */
-        if(j == noteOffs.end())
+        if(noteOff < 0)
         {
-            other.push_back(*i);
-            ++i;
+            other.push_back(noteOn);
             continue;
         }
 
-        RprMidiEvent *noteOn = *i;
-        RprMidiEvent *noteOff = *j;
-        /* delete zero length notes */
-        if(noteOn->getOffset() == noteOff->getOffset())
+        matched[noteOff] = true;
+        matched[noteOn] = true;
+        /* drop zero length notes */
+        if(events.getOffset(noteOn) == events.getOffset(noteOff))
         {
-            delete noteOn;
-            delete noteOff;
-            noteOns.erase(i++);
-            noteOffs.erase(j);
             continue;
         }
 
-        RprMidiNote *newNote = new RprMidiNote(noteOn, noteOff, context);
-        midiNotes.push_back(newNote);
-        noteOffs.erase(j);
-        ++i;
+        noteStore.push_back(RprMidiNote(&events, noteOn, noteOff, context));
+        midiNotes.push_back(&noteStore.back());
     }
 
-    /* put non-note events back onto midiEvents list */
-    for(RprMidiEventsCIter j = noteOffs.begin(); j != noteOffs.end(); j++)
+    /* put non-note events back, unmatched note-offs first */
+    std::vector<int> remaining;
+    remaining.reserve(midiEvents.size() - midiNotes.size() * 2);
+    for(std::vector<int>::const_iterator i = midiEvents.begin(); i != midiEvents.end(); ++i)
     {
-        midiEvents.push_back(*j);
+        if(isNoteOff(events, *i) && !matched[*i])
+        {
+            remaining.push_back(*i);
+        }
     }
-
-    for(RprMidiEventsCIter j = other.begin(); j != other.end(); j++)
+    for(std::vector<int>::const_iterator i = midiEvents.begin(); i != midiEvents.end(); ++i)
     {
-        midiEvents.push_back(*j);
+        if(!isNoteOff(events, *i) && events.getMessageType(*i) != RprMidiEvent::NoteOn)
+        {
+            remaining.push_back(*i);
+        }
     }
-    return true;
+    remaining.insert(remaining.end(), other.begin(), other.end());
+    midiEvents.swap(remaining);
 }
 
-static void removeDuplicates(std::vector<RprMidiCC *> *midiCCs)
+static void removeDuplicates(std::vector<RprMidiCC> *midiCCs)
 {
     for(int i = 0; i < 128; i++)
     {
         for(int ccOffset = 0; (midiCCs[i].begin() + ccOffset) != midiCCs[i].end(); ++ccOffset)
         {
-            std::vector<RprMidiCC *>::iterator j = midiCCs[i].begin() + ccOffset;
-            for(std::vector<RprMidiCC *>::iterator k = j + 1; k != midiCCs[i].end(); ++k)
+            std::vector<RprMidiCC>::iterator j = midiCCs[i].begin() + ccOffset;
+            for(std::vector<RprMidiCC>::iterator k = j + 1; k != midiCCs[i].end(); )
             {
-                if( (*k)->getItemPosition() > (*j)->getItemPosition())
+                if( k->getItemPosition() > j->getItemPosition())
                 {
                     break;
                 }
 
-                if( (*k)->getItemPosition() != (*j)->getItemPosition())
+                if( k->getItemPosition() != j->getItemPosition() ||
+                    k->getChannel() != j->getChannel())
                 {
+                    ++k;
                     continue;
                 }
 
-                if( (*k)->getChannel() != (*j)->getChannel())
-                {
-                    continue;
-                }
-
-                delete *k;
                 k = midiCCs[i].erase(k);
                 j = midiCCs[i].begin() + ccOffset;
             }
@@ -753,14 +607,12 @@ static void removeDuplicates(std::vector<RprMidiNote *> &midiNotes)
             }
             if(lhs->getItemLength() > rhs->getItemLength())
             {
-                delete rhs;
                 j = midiNotes.erase(j);
                 if (noteOffset+1 >= (int)midiNotes.size())
                     break;
             }
             else
             {
-                delete lhs;
                 i = midiNotes.erase(i);
                 noteOffset--;
                 break;
@@ -795,7 +647,6 @@ static void removeOverlaps(std::vector<RprMidiNote *> &midiNotes)
                 int lhsLength = rhs->getItemPosition() - lhs->getItemPosition();
                 if(lhsLength <= 0)
                 {
-                    delete lhs;
                     i = midiNotes.erase(i);
                     noteOffset--;
                 }
@@ -816,7 +667,10 @@ RprMidiNote *RprMidiTake::getNoteAt(int index) const
 
 RprMidiNote *RprMidiTake::addNoteAt(int index)
 {
-    RprMidiNote *note = new RprMidiNote(mContext);
+    int noteOn = mEvents.add(RprMidiEvent::NoteOn);
+    int noteOff = mEvents.add(RprMidiEvent::NoteOff);
+    mNoteStore.push_back(RprMidiNote(&mEvents, noteOn, noteOff, mContext));
+    RprMidiNote *note = &mNoteStore.back();
     mNotes.insert(mNotes.begin() + index, note);
     return note;
 }
@@ -833,29 +687,26 @@ RprMidiTake::RprMidiTake(const RprTake &take, bool readOnly)
     {
         mContext = NULL;
         RprNode *sourceNode = RprMidiTemplate::getMidiSourceNode();
+        mMidiEvents = RprMidiTemplate::getMidiEvents();
+        if(mMidiEvents == NULL)
+        {
+            throw RprLibException(__LOCALIZE("Unable to parse MIDI data","sws_mbox"));
+        }
 
-        RprTempMidiEvents tempMidiEvents;
-        getMidiEvents(sourceNode, tempMidiEvents.get());
+        mEvents.read(mMidiEvents->c_str());
         mContext = RprMidiContext::createMidiContext(take.getPlayRate(),
             getParent()->getPosition() - (take.getStartOffset() / take.getPlayRate()),
             getQNValue(sourceNode));
 
-        if (!getMidiNotes(tempMidiEvents.get(), mNotes, mContext))
-        {
-            throw RprLibException(__LOCALIZE("Unable to parse MIDI data","sws_mbox"));
-        }
-
-        if(!getMidiCCs(tempMidiEvents.get(), mCCs, mContext))
+        std::vector<int> midiEvents(mEvents.size());
+        for(int i = 0; i < mEvents.size(); ++i)
         {
-            throw RprLibException(__LOCALIZE("Unable to parse MIDI data","sws_mbox"));
+            midiEvents[i] = i;
         }
 
-        mOtherEvents.reserve(tempMidiEvents.get().size());
-        std::copy(tempMidiEvents.get().begin(), tempMidiEvents.get().end(),
-            std::back_inserter(mOtherEvents));
-        tempMidiEvents.get().clear();
-        mMidiEventsOffset = clearMidiEventsFromMidiNode(sourceNode);
-
+        getMidiNotes(mEvents, midiEvents, mNoteStore, mNotes, mContext);
+        getMidiCCs(mEvents, midiEvents, mCCs, mContext);
+        mOtherEvents.swap(midiEvents);
     }
     catch (RprMidiEvent::RprMidiException &e)
     {
@@ -866,17 +717,6 @@ RprMidiTake::RprMidiTake(const RprTake &take, bool readOnly)
     }
 }
 
-template
-<typename T>
-void cleanUpPointers(std::vector<T *> &pointers)
-{
-    for(typename std::vector<T *>::iterator i = pointers.begin(); i != pointers.end(); i++)
-    {
-        delete *i;
-    }
-    pointers.clear();
-}
-
 RprMidiTake::~RprMidiTake()
 {
     if (isReadOnly())
@@ -885,41 +725,42 @@ RprMidiTake::~RprMidiTake()
         return;
     }
 
-    std::vector<RprMidiEvent *> midiEvents;
-    std::sort(mNotes.begin(), mNotes.end(), compareMidiPositions<RprMidiNote>);
+    std::vector<int> midiEvents;
+    std::sort(mNotes.begin(), mNotes.end(), compareNotePositions);
     for(int i = 0; i < 128; i++)
     {
-        std::sort(mCCs[i].begin(), mCCs[i].end(), compareMidiPositions<RprMidiCC>);
+        std::sort(mCCs[i].begin(), mCCs[i].end(), compareCCPositions);
     }
     removeDuplicates(mNotes);
     removeDuplicates(mCCs);
     removeOverlaps(mNotes);
-    midiEvents.reserve(mNotes.size() * 2 + mOtherEvents.size());
+    midiEvents.reserve(mEvents.size());
 
-    RprMidiEvent* allNotesOffEvent = NULL;
+    int allNotesOffEvent = -1;
     if (!mCCs[0x7b].empty())
     {
-        allNotesOffEvent = (*mCCs[0x7b].begin())->mCC;
+        allNotesOffEvent = mCCs[0x7b].begin()->mCC;
     }
 
     for(std::vector<RprMidiNote *>::const_iterator i = mNotes.begin();
         i != mNotes.end(); ++i)
     {
         RprMidiNote* note = *i;
-        if (allNotesOffEvent)
+        if (allNotesOffEvent >= 0)
         {
-            if (note->getItemPosition() >= allNotesOffEvent->getOffset())
+            int allNotesOffOffset = mEvents.getOffset(allNotesOffEvent);
+            if (note->getItemPosition() >= allNotesOffOffset)
             {
                 continue;
             }
 
-            if (note->getItemPosition() + note->getItemLength() > allNotesOffEvent->getOffset())
+            if (note->getItemPosition() + note->getItemLength() > allNotesOffOffset)
             {
-                note->setItemLength(allNotesOffEvent->getOffset() - note->getItemPosition()); 
+                note->setItemLength(allNotesOffOffset - note->getItemPosition());
             }
         }
-        midiEvents.push_back((*i)->mNoteOn);
-        midiEvents.push_back((*i)->mNoteOff);
+        midiEvents.push_back(note->mNoteOn);
+        midiEvents.push_back(note->mNoteOff);
     }
 
     for(int j = 0; j < 128; j++)
@@ -930,24 +771,18 @@ RprMidiTake::~RprMidiTake()
             continue;
         }
 
-        for(std::vector<RprMidiCC *>::const_iterator i = mCCs[j].begin();
+        for(std::vector<RprMidiCC>::const_iterator i = mCCs[j].begin();
             i != mCCs[j].end(); ++i)
         {
-            RprMidiCC *cc = *i;
-
-            midiEvents.push_back((*i)->mCC);
+            midiEvents.push_back(i->mCC);
         }
     }
 
-    for(std::vector<RprMidiEvent *>::const_iterator i = mOtherEvents.begin();
-        i != mOtherEvents.end(); ++i)
-    {
-        midiEvents.push_back(*i);
-    }
+    midiEvents.insert(midiEvents.end(), mOtherEvents.begin(), mOtherEvents.end());
 
-    std::sort(midiEvents.begin(), midiEvents.end(), sortMidiBase);
+    std::sort(midiEvents.begin(), midiEvents.end(), RprSortMidiEvents(mEvents));
 
-    if (allNotesOffEvent)
+    if (allNotesOffEvent >= 0)
     {
         midiEvents.push_back(allNotesOffEvent);
     }
@@ -955,7 +790,7 @@ RprMidiTake::~RprMidiTake()
     int firstEventOffset = 0;
     if (!midiEvents.empty())
     {
-        firstEventOffset = (*midiEvents.begin())->getOffset();
+        firstEventOffset = mEvents.getOffset(midiEvents.front());
     }
 
     int offset = 0;
@@ -979,16 +814,8 @@ RprMidiTake::~RprMidiTake()
         offset = firstEventOffset;
     }
 
-    for(std::vector<RprMidiEvent *>::iterator i = midiEvents.begin(); i != midiEvents.end(); ++i)
-    {
-        RprMidiEvent *current = *i;
-        int delta = current->getOffset() - offset;
-        current->setDelta(delta);
-        offset += delta;
-    }
-
-    midiEventsToMidiNode(midiEvents, RprMidiTemplate::getMidiSourceNode(),
-        mMidiEventsOffset);
+    mMidiEvents->clear();
+    mEvents.write(midiEvents, offset, *mMidiEvents);
 
     cleanup();
 }
@@ -1003,10 +830,11 @@ void RprMidiTake::cleanup()
 
     for(int j = 0; j < 128; j++)
     {
-        cleanUpPointers(mCCs[j]);
+        mCCs[j].clear();
     }
-    cleanUpPointers(mOtherEvents);
-    cleanUpPointers(mNotes);
+    mOtherEvents.clear();
+    mNotes.clear();
+    mNoteStore.clear();
 }
 
 RprMidiTakePtr RprMidiTake::createFromMidiEditor(bool readOnly)
@@ -1032,13 +860,13 @@ int RprMidiTake::countCCs(int controller) const
     return (int)mCCs[controller].size();
 }
 
-static bool hasEvent(std::vector<RprMidiEvent *> &midiEvents, RprMidiEvent::MessageType messageType)
+static bool hasEvent(const RprMidiEventStore &events, const std::vector<int> &midiEvents,
+                     RprMidiEvent::MessageType messageType)
 {
-    for(std::vector<RprMidiEvent *>::const_iterator i = midiEvents.begin();
+    for(std::vector<int>::const_iterator i = midiEvents.begin();
         i != midiEvents.end(); ++i)
     {
-        RprMidiEvent *midiEvent = *i;
-        if(midiEvent->getMessageType() == messageType)
+        if(events.getMessageType(*i) == messageType)
         {
             return true;
         }
@@ -1063,5 +891,5 @@ bool RprMidiTake::hasEventType(RprMidiEvent::MessageType messageType)
             }
         }
     }
-    return hasEvent(mOtherEvents, messageType);
+    return hasEvent(mEvents, mOtherEvents, messageType);
 }
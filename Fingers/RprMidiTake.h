@@ -1,10 +1,11 @@
 #ifndef __RPRMIDITAKE_H
 #define __RPRMIDITAKE_H
 
+#include <deque>
+
 #include "RprMidiEvent.h"
 #include "RprMidiTemplate.h"
 
-class RprMidiEvent;
 class RprMidiContext;
 class RprItem;
 class RprNode;
@@ -36,11 +37,11 @@ RprMidiNote* FNG_AddMidiNote(RprMidiTake* midiTake);
 
 typedef std::auto_ptr<RprMidiTake> RprMidiTakePtr;
 
+/* A note-on/note-off pair of events in the take's event store */
 class RprMidiNote
 {
 public:
-    RprMidiNote(RprMidiContext *context);
-    RprMidiNote(RprMidiEvent *noteOn, RprMidiEvent *noteOff, RprMidiContext *context);
+    RprMidiNote(RprMidiEventStore *events, int noteOn, int noteOff, RprMidiContext *context);
 
     double getPosition() const;
     void setPosition(double position);
@@ -69,29 +70,29 @@ public:
     int getItemLength() const;
     void setItemLength(int);
 
-    ~RprMidiNote();
 private:
     friend class RprMidiTake;
 
-    RprMidiEvent *mNoteOn;
-    RprMidiEvent *mNoteOff;
+    RprMidiEventStore *mEvents;
+    int mNoteOn;
+    int mNoteOff;
     RprMidiContext *mContext;
 };
 
+/* A CC event in the take's event store */
 class RprMidiCC
 {
 public:
-    RprMidiCC(RprMidiContext *context, int controller);
-    RprMidiCC(RprMidiEvent *cc, RprMidiContext *context);
+    RprMidiCC(RprMidiEventStore *events, int cc, RprMidiContext *context);
 
     int getChannel() const;
 
     int getItemPosition() const;
 
-    ~RprMidiCC();
 private:
     friend class RprMidiTake;
-    RprMidiEvent *mCC;
+    RprMidiEventStore *mEvents;
+    int mCC;
     RprMidiContext *mContext;
 };
 
@@ -114,11 +115,14 @@ private:
     void cleanup();
     bool apply();
 
+    RprMidiEventStore mEvents;
+    /* deque so notes handed out by pointer stay put when adding notes */
+    std::deque<RprMidiNote> mNoteStore;
     std::vector<RprMidiNote *> mNotes;
-    std::vector<RprMidiCC *> mCCs[128];
-    std::vector<RprMidiEvent *> mOtherEvents;
+    std::vector<RprMidiCC> mCCs[128];
+    std::vector<int> mOtherEvents;
     RprMidiContext *mContext;
-    int mMidiEventsOffset;
+    std::string *mMidiEvents;
 };
 
 #endif
@@ -38,6 +38,23 @@ RprMidiTemplate::RprMidiTemplate(const RprTake &take, bool readOnly)
     mMidiSourceNode = findTakeSource(mItemNode.get(), guid);
 }
 
+std::string *RprMidiTemplate::getMidiEvents()
+{
+    if(mMidiSourceNode == NULL)
+        return NULL;
+
+    for(int i = 0; i < mMidiSourceNode->childCount(); i++) {
+        std::string *data = mMidiSourceNode->getChild(i)->getRawData();
+        if(data)
+            return data;
+    }
+
+    /* no events yet, they go after HASDATA */
+    RprNode *midiEvents = new RprRawNode();
+    mMidiSourceNode->addChild(midiEvents, mMidiSourceNode->childCount() ? 1 : 0);
+    return midiEvents->getRawData();
+}
+
 RprMidiTemplate::~RprMidiTemplate()
 {
     if(mItemNode.get() == NULL || mParent.get() == NULL)
@@ -18,6 +18,8 @@ public:
     virtual ~RprMidiTemplate();
 protected:
     RprNode *getMidiSourceNode() { return mMidiSourceNode; }
+    /* MIDI event lines of the source, NULL if there is no source */
+    std::string *getMidiEvents();
     void errorOccurred() { mInErrorState = true; }
     bool isReadOnly() const { return mReadOnly; }
 
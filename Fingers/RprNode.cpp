@@ -79,6 +79,37 @@ int RprParentNode::childCount()
     return (int)mChildren.size();
 }
 
+RprRawNode::RprRawNode()
+{
+    setValue("");
+}
+
+int RprRawNode::childCount()
+{
+    return 0;
+}
+
+RprNode *RprRawNode::getChild(int index)
+{
+    return NULL;
+}
+
+void RprRawNode::addChild(RprNode *node)
+{}
+
+void RprRawNode::removeChild(int index)
+{}
+
+std::string *RprRawNode::getRawData()
+{
+    return &mData;
+}
+
+void RprRawNode::toReaper(std::ostringstream &oss, int indent)
+{
+    oss << mData;
+}
+
 void RprParentNode::removeChild(int index)
 {
     RprNode *child = mChildren.at(index);
@@ -86,17 +117,31 @@ void RprParentNode::removeChild(int index)
     delete child;
 }
 
-static std::string getTrimmedLine(std::istringstream &iss)
+/* Returns the next line of the chunk without leading spaces and line
+ * ending, and moves pos to the line after it */
+static std::string getTrimmedLine(const char *&pos)
+{
+    while(*pos == ' ') pos++;
+    const char *start = pos;
+    while(*pos && *pos != '\n') pos++;
+    const char *end = pos;
+    if(end > start && end[-1] == '\r') end--;
+    if(*pos) pos++;
+    return std::string(start, end - start);
+}
+
+/* E/e (event) or X/x (sysex/text, starts a child chunk) lines,
+ * optionally muted (m) */
+static bool isMidiEventLine(const std::string &line)
 {
-    char lineBuffer[256];
-    iss.getline(lineBuffer, 256);
-    std::string line;
-    int offset = 0;
-    if(lineBuffer[0] == '\n')
-        offset++;
-    while(lineBuffer[offset] == ' ') offset++;
-    line = std::string(lineBuffer + offset);
-    return line;
+    const char *str = line.c_str();
+    if(str[0] == '<')
+        str++;
+    if(str[0] != 'E' && str[0] != 'e' && str[0] != 'X' && str[0] != 'x')
+        return false;
+    if(str[1] == 'm')
+        str++;
+    return str[1] == ' ';
 }
 
 void RprParentNode::toReaper(std::ostringstream &oss, int indent)
@@ -148,19 +193,46 @@ RprNode *RprParentNode::createItemStateTree(const char *itemState)
     if(strncmp(itemState, "<ITEM", 5))
         return NULL;
 
-    std::istringstream iss(itemState);
-    std::string line = getTrimmedLine(iss);
+    const char *pos = itemState;
+    std::string line = getTrimmedLine(pos);
     std::auto_ptr<RprParentNode> parentNode(new RprParentNode(line.substr(1).c_str()));
 
     RprNode *currentNode = parentNode.get();
 
-    while(!iss.eof()) {
+    /* MIDI events of a source go to a single raw node (at the position of
+     * the first event), big takes would need a node per event otherwise */
+    RprNode *midiSourceNode = NULL;
+    RprRawNode *midiEvents = NULL;
+
+    while(*pos) {
 
-        line = getTrimmedLine(iss);
+        line = getTrimmedLine(pos);
         if(line.empty())
             continue;
 
-        if(line[0] == '<')
+        if(currentNode->getValue().compare(0, 11, "SOURCE MIDI") == 0 && isMidiEventLine(line)) {
+            if(midiSourceNode != currentNode) {
+                midiSourceNode = currentNode;
+                midiEvents = new RprRawNode();
+                currentNode->addChild(midiEvents);
+            }
+            std::string &data = *midiEvents->getRawData();
+            data += line;
+            data += '\n';
+            /* sysex/text data lines up to the end of the event chunk */
+            for(int depth = line[0] == '<' ? 1 : 0; depth && *pos; ) {
+                line = getTrimmedLine(pos);
+                if(line.empty())
+                    continue;
+                if(line[0] == '<')
+                    depth++;
+                else if(line[0] == '>')
+                    depth--;
+                data += line;
+                data += '\n';
+            }
+        }
+        else if(line[0] == '<')
             currentNode = addNewChildNode(currentNode, line.substr(1));
         else if(line[0] == '>')
             currentNode = currentNode->getParent();
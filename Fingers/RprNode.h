@@ -16,6 +16,7 @@ public:
     virtual void addChild(RprNode *node) = 0;
     virtual void addChild(RprNode *node, int index) {}
     virtual void removeChild(int index) = 0;
+    virtual std::string *getRawData() { return NULL; }
     virtual ~RprNode() {}
 
     void setValue(const std::string &value);
@@ -37,6 +38,23 @@ private:
     void toReaper(std::ostringstream &oss, int indent);
 };
 
+/* Run of MIDI event lines of a MIDI source, kept as one string instead of
+ * a node per event. Written back to the chunk as is. */
+class RprRawNode : public RprNode {
+public:
+    RprRawNode();
+    int childCount();
+    RprNode *getChild(int index);
+    void addChild(RprNode *node);
+    void removeChild(int index);
+    std::string *getRawData();
+    ~RprRawNode() {}
+private:
+    void toReaper(std::ostringstream &oss, int indent);
+
+    std::string mData;
+};
+
 class RprParentNode : public RprNode {
 public:
     static RprNode *createItemStateTree(const char *itemState);
@@ -74,13 +74,9 @@ ItemState::ItemState(MediaItem* mi)
 MediaItem* ItemState::FindItem(MediaTrack* tr)
 {
 	// Find the media item in the track
-	MediaItem* mi = NULL;
-	for (int i = 0; i < GetTrackNumMediaItems(tr); i++)
-	{
-		mi = GetTrackMediaItem(tr, i);
-		if (GuidsEqual(&m_guid, (GUID*)GetSetMediaItemInfo(mi, "GUID", NULL)))
-			return mi;
-	}
+	MediaItem* mi = GuidToItem(&m_guid);
+	if (mi && GetMediaItem_Track(mi) == tr)
+		return mi;
 	return NULL;
 }
 
@@ -29,31 +29,160 @@
 #include "Analysis.h"
 #include "../sws_waitdlg.h"
 #include "../reaper/localize.h"
+#include "../Breeder/BR_ThreadPool.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SWS_ANALYSIS_SSE2
+#endif
+
+#define SWS_ANALYSIS_BLOCK 16384
+
+// Samples get copied to frame-major blocks with channel count padded to even, so one SSE2 register holds two channels
+// of the same frame. Padded channels are always silent so they never affect peaks or sums.
+static int AnalysisWidth(int nch)
+{
+	return (nch + 1) & ~1;
+}
+
+// Peak (with its position), sum and sum of squares of every channel
+static void AnalyzeBlockLevels(const double* x, int frames, int width, INT64 firstSample, double* peak, INT64* peakPos, double* sum, double* sumSq)
+{
+#ifdef SWS_ANALYSIS_SSE2
+	const __m128d sign = _mm_set1_pd(-0.0);
+	for (int c = 0; c < width; c += 2)
+	{
+		__m128d pk = _mm_loadu_pd(peak + c);
+		__m128d s  = _mm_loadu_pd(sum + c);
+		__m128d sq = _mm_loadu_pd(sumSq + c);
+		const double* in = x + c;
+		for (int i = 0; i < frames; i++, in += width)
+		{
+			__m128d v = _mm_loadu_pd(in);
+			s  = _mm_add_pd(s, v);
+			sq = _mm_add_pd(sq, _mm_mul_pd(v, v));
+
+			// New peaks are rare, only then find out which channel has it
+			__m128d a = _mm_andnot_pd(sign, v);
+			if (int mask = _mm_movemask_pd(_mm_cmpgt_pd(a, pk)))
+			{
+				if (mask & 1) peakPos[c]   = firstSample + i;
+				if (mask & 2) peakPos[c+1] = firstSample + i;
+				pk = _mm_max_pd(pk, a);
+			}
+		}
+		_mm_storeu_pd(peak + c, pk);
+		_mm_storeu_pd(sum + c, s);
+		_mm_storeu_pd(sumSq + c, sq);
+	}
+#else
+	for (int c = 0; c < width; c++)
+	{
+		const double* in = x + c;
+		for (int i = 0; i < frames; i++, in += width)
+		{
+			sum[c] += *in;
+			sumSq[c] += *in * *in;
+			double a = fabs(*in);
+			if (a > peak[c])
+			{
+				peak[c] = a;
+				peakPos[c] = firstSample + i;
+			}
+		}
+	}
+#endif
+}
+
+// Running sums of squares for every RMS window. History of squares is kept in a ring buffer as long as the longest window,
+// only maximum sums get tracked (square root is taken once the whole source is analyzed)
+static void AnalyzeBlockWindows(const double* x, int frames, int width, double* ring, int ringFrames, int* ringPos, const int* windowFrames, int windows, double* runSum, double* maxSum)
+{
+	for (int i = 0; i < frames; i++, x += width)
+	{
+		double* row = ring + *ringPos * width;
+		for (int c = 0; c < width; c += 2)
+		{
+#ifdef SWS_ANALYSIS_SSE2
+			__m128d v  = _mm_loadu_pd(x + c);
+			__m128d sq = _mm_mul_pd(v, v);
+			for (int w = 0; w < windows; w++)
+			{
+				int old = *ringPos - windowFrames[w];
+				if (old < 0) old += ringFrames;
+				double* s = runSum + w*width + c;
+				double* m = maxSum + w*width + c;
+				__m128d sum = _mm_sub_pd(_mm_add_pd(_mm_loadu_pd(s), sq), _mm_loadu_pd(ring + old*width + c));
+				_mm_storeu_pd(s, sum);
+				_mm_storeu_pd(m, _mm_max_pd(_mm_loadu_pd(m), sum));
+			}
+			_mm_storeu_pd(row + c, sq);
+#else
+			for (int j = c; j < c + 2; j++)
+			{
+				double sq = x[j] * x[j];
+				for (int w = 0; w < windows; w++)
+				{
+					int old = *ringPos - windowFrames[w];
+					if (old < 0) old += ringFrames;
+					double* s = runSum + w*width + j;
+					*s += sq - ring[old*width + j];
+					if (*s > maxSum[w*width + j])
+						maxSum[w*width + j] = *s;
+				}
+				row[j] = sq;
+			}
+#endif
+		}
+		if (++*ringPos == ringFrames)
+			*ringPos = 0;
+	}
+}
 
 void AnalyzePCMSource(ANALYZE_PCM* a)
 {
 	if (!a->pcm)
 		return;
 
-	// Init local transfer block "t" and sum of squares
+	// Init local transfer block "t"
 	PCM_source_transfer_t t={0,};
 	t.samplerate = a->pcm->GetSampleRate();
 	t.nch = a->pcm->GetNumChannels();
-	t.length = a->dWindowSize == 0.0 ? 16384 : (int)(a->dWindowSize * t.samplerate);
-	t.samples = new ReaSample[t.length * t.nch];
+	t.length = SWS_ANALYSIS_BLOCK;
 	t.time_s = 0.0;
-	
-	ReaSample* prevBuf = NULL;
-	if (a->dWindowSize != 0.0)
+	WDL_TypedBuf<ReaSample> samples;
+	t.samples = samples.Resize(t.length * t.nch, false);
+
+	// Windowed RMS (if requested) is window 0, extra windows follow
+	int width = AnalysisWidth(t.nch);
+	int windows = (a->dWindowSize != 0.0 ? 1 : 0) + (a->dWindowSizes ? a->iWindows : 0);
+	WDL_TypedBuf<int> windowFrames;
+	windowFrames.Resize(windows, false);
+	int ringFrames = 1;
+	for (int i = 0; i < windows; i++)
 	{
-		prevBuf = new ReaSample[t.length * t.nch];
-		memset(prevBuf, 0, t.length * t.nch);
+		double dSize = (a->dWindowSize != 0.0) ? (i ? a->dWindowSizes[i-1] : a->dWindowSize) : a->dWindowSizes[i];
+		windowFrames.Get()[i] = max(1, (int)(dSize * t.samplerate));
+		ringFrames = max(ringFrames, windowFrames.Get()[i]);
 	}
 
-	double* dSumSquares = new double[t.nch];
-	for (int i = 0; i < t.nch; i++)
-		dSumSquares[i] = 0.0;
+	// Everything else gets allocated once and zeroed
+	WDL_TypedBuf<double> block, levels, ring, sums;
+	WDL_TypedBuf<INT64> peakPos;
+	double* x = block.Resize(t.length * width, false);
+	double* peak = levels.Resize(3 * width, false);
+	double* sum = peak + width;
+	double* sumSq = sum + width;
+	double* runSum = sums.Resize(2 * windows * width, false);
+	double* maxSum = runSum + windows * width;
+	double* history = windows ? ring.Resize(ringFrames * width, false) : NULL;
+	memset(x, 0, t.length * width * sizeof(double));
+	memset(peak, 0, 3 * width * sizeof(double));
+	memset(runSum, 0, 2 * windows * width * sizeof(double));
+	if (history)
+		memset(history, 0, ringFrames * width * sizeof(double));
+	memset(peakPos.Resize(width, false), 0, width * sizeof(INT64));
+	int ringPos = 0;
 
 	// Init output variables.  Note can have different channel count.
 	for (int i = 0; i < a->iChannels; i++)
@@ -61,9 +190,13 @@ void AnalyzePCMSource(ANALYZE_PCM* a)
 		if (a->dPeakVals) a->dPeakVals[i] = 0.0;
 		if (a->dRMSs) a->dRMSs[i] = 0.0;
 		if (a->peakSamples) a->peakSamples[i] = 0;
+		if (a->dDCOffsets) a->dDCOffsets[i] = 0.0;
 	}
+	for (int i = 0; a->dWindowRMSs && i < a->iWindows; i++)
+		a->dWindowRMSs[i] = 0.0;
 	a->dPeakVal = 0.0;
 	a->dRMS = 0.0;
+	a->dDCOffset = 0.0;
 	a->peakSample = 0;
 	a->dProgress = 0.0;
 	a->sampleCount = 0;
@@ -72,46 +205,16 @@ void AnalyzePCMSource(ANALYZE_PCM* a)
 	int iFrame = 0;
 
 	a->pcm->GetSamples(&t);
-	while (t.samples_out)
+	while (t.samples_out && !(a->bCancel && *a->bCancel))
 	{
 		for (int samp = 0; samp < t.samples_out; samp++)
-		{
 			for (int chan = 0; chan < t.nch; chan++)
-			{
-				int i = samp*t.nch + chan;
-				dSumSquares[chan] += t.samples[i] * t.samples[i];
-				double absamp = fabs(t.samples[i]);
-				if (absamp > a->dPeakVal)
-				{
-					a->dPeakVal = absamp;
-					a->peakSample = a->sampleCount;
-				}
-
-				if (a->dPeakVals && chan < a->iChannels && absamp > a->dPeakVals[chan])
-				{
-					a->dPeakVals[chan] = absamp;
-					if (a->peakSamples)
-						a->peakSamples[chan] = a->sampleCount;
-				}
-				if (a->dWindowSize != 0.0)
-				{
-					dSumSquares[chan] -= prevBuf[i] * prevBuf[i];
-					double curRMS = sqrt(dSumSquares[chan] / t.length);
-					if (curRMS > a->dRMS) // Overall
-						a->dRMS = curRMS;
-					if (a->dRMSs && curRMS > a->dRMSs[chan]) // Single channel, if enabled
-						a->dRMSs[chan] = curRMS;
-				}
-			}
-			a->sampleCount++;
-		}
-		if (a->dWindowSize != 0.0)
-		{	// Swap buffers in windowed mode for history
-			ReaSample* temp = t.samples;
-			t.samples = prevBuf;
-			prevBuf = temp;
-		}
+				x[samp*width + chan] = t.samples[samp*t.nch + chan];
 
+		AnalyzeBlockLevels(x, t.samples_out, width, a->sampleCount, peak, peakPos.Get(), sum, sumSq);
+		if (windows)
+			AnalyzeBlockWindows(x, t.samples_out, width, history, ringFrames, &ringPos, windowFrames.Get(), windows, runSum, maxSum);
+		a->sampleCount += t.samples_out;
 
 		a->dProgress = (double)a->sampleCount / totalSamples;
 		
@@ -121,24 +224,67 @@ void AnalyzePCMSource(ANALYZE_PCM* a)
 		a->pcm->GetSamples(&t);
 	}
 
-	if (a->dWindowSize == 0.0)
+	// Overall peak is the highest channel peak (the earliest one if more channels have it)
+	for (int i = 0; i < t.nch; i++)
 	{
-		// Non-windowed mode.  Calculate the RMS for the entire item
-		// First per channel
-		if (a->dRMSs && a->sampleCount)
-			for (int i = 0; i < a->iChannels && i < t.nch; i++)
-				a->dRMSs[i] = sqrt(dSumSquares[i] / a->sampleCount);
-
-		// Then for all channels combined
-		double dSS = 0.0;
+		if (peak[i] > a->dPeakVal || (peak[i] == a->dPeakVal && peak[i] != 0.0 && peakPos.Get()[i] < a->peakSample))
+		{
+			a->dPeakVal = peak[i];
+			a->peakSample = peakPos.Get()[i];
+		}
+		if (i < a->iChannels)
+		{
+			if (a->dPeakVals) a->dPeakVals[i] = peak[i];
+			if (a->dPeakVals && a->peakSamples) a->peakSamples[i] = peakPos.Get()[i];
+		}
+	}
+
+	if (a->sampleCount)
+	{
+		// DC offset
+		double dSum = 0.0;
 		for (int i = 0; i < t.nch; i++)
-			dSS += dSumSquares[i];
-		a->dRMS = sqrt(dSS / (a->sampleCount * t.nch));
+		{
+			dSum += sum[i];
+			if (a->dDCOffsets && i < a->iChannels)
+				a->dDCOffsets[i] = sum[i] / a->sampleCount;
+		}
+		a->dDCOffset = dSum / (a->sampleCount * t.nch);
+
+		if (a->dWindowSize == 0.0)
+		{
+			// Non-windowed mode.  Calculate the RMS for the entire item
+			// First per channel
+			if (a->dRMSs)
+				for (int i = 0; i < a->iChannels && i < t.nch; i++)
+					a->dRMSs[i] = sqrt(sumSq[i] / a->sampleCount);
+
+			// Then for all channels combined
+			double dSS = 0.0;
+			for (int i = 0; i < t.nch; i++)
+				dSS += sumSq[i];
+			a->dRMS = sqrt(dSS / (a->sampleCount * t.nch));
+		}
 	}
 
-	delete[] t.samples;
-	delete[] prevBuf;
-	delete[] dSumSquares;
+	// Windowed RMS is the loudest window of any channel
+	for (int w = 0; w < windows; w++)
+	{
+		double dMaxRMS = 0.0;
+		for (int i = 0; i < t.nch; i++)
+		{
+			double dRMS = sqrt(max(0.0, maxSum[w*width + i]) / windowFrames.Get()[w]);
+			if (dRMS > dMaxRMS)
+				dMaxRMS = dRMS;
+			if (a->dWindowSize != 0.0 && w == 0 && a->dRMSs && i < a->iChannels)
+				a->dRMSs[i] = dRMS;
+		}
+
+		if (a->dWindowSize != 0.0 && w == 0)
+			a->dRMS = dMaxRMS;
+		else if (a->dWindowRMSs)
+			a->dWindowRMSs[a->dWindowSize != 0.0 ? w-1 : w] = dMaxRMS;
+	}
 
 	// Ensure dProgress is exactly 1.0
 	a->dProgress = 1.0;
@@ -151,23 +297,36 @@ DWORD WINAPI AnalyzePCMThread(void* pAnalyze)
 	return 0;
 }
 
+// Returns zero-based duplicate of the item source (caller deletes it) or NULL if the item can't be analyzed
+static PCM_source* DuplicateItemSource(MediaItem* mi)
+{
+	PCM_source* pcm = (PCM_source*)mi;
+	if (!pcm || strcmp(pcm->GetType(), "MIDI") == 0 || strcmp(pcm->GetType(), "MIDIPOOL") == 0)
+		return NULL;
+
+	pcm = pcm->Duplicate();
+	if (!pcm)
+		return NULL;
+	if (!pcm->GetNumChannels())
+	{
+		delete pcm;
+		return NULL;
+	}
+
+	double dZero = 0.0;
+	GetSetMediaItemInfo((MediaItem*)pcm, "D_POSITION", &dZero);
+	return pcm;
+}
+
 // return true for successful analysis
 // wraps AnalyzePCM to check item validity and create a wait dialog
 bool AnalyzeItem(MediaItem* mi, ANALYZE_PCM* a)
 {
 	a->dProgress = 0.0;
-	a->pcm = (PCM_source*)mi;
-
-	if (!a->pcm || strcmp(a->pcm->GetType(), "MIDI") == 0 || strcmp(a->pcm->GetType(), "MIDIPOOL") == 0)
-		return false;
-
-	a->pcm = a->pcm->Duplicate();
-	if (!a->pcm || !a->pcm->GetNumChannels())
+	a->pcm = DuplicateItemSource(mi);
+	if (!a->pcm)
 		return false;
 
-	double dZero = 0.0;
-	GetSetMediaItemInfo((MediaItem*)a->pcm, "D_POSITION", &dZero);
-			
 	const char* cName = NULL;
 	MediaItem_Take* take = GetMediaItemTake(mi, -1);
 	if (take)
@@ -183,6 +342,129 @@ bool AnalyzeItem(MediaItem* mi, ANALYZE_PCM* a)
 	return true;
 }
 
+// Items analyzed with AnalyzeItems() share one wait dialog, progress is weighted by item length
+struct ANALYZE_BATCH
+{
+	ANALYZE_PCM* a;
+	double* dLengths;
+	int iItems;
+	double dProgress;
+	bool bCancel;
+};
+
+static unsigned WINAPI AnalyzePCMJob(void* pAnalyze)
+{
+	AnalyzePCMSource((ANALYZE_PCM*)pAnalyze);
+	return 0;
+}
+
+static void AnalyzeBatch(ANALYZE_BATCH* b)
+{
+	BR_ThreadPool pool;
+	WDL_TypedBuf<HANDLE> jobs;
+	jobs.Resize(b->iItems, false);
+
+	double dTotal = 0.0;
+	for (int i = 0; i < b->iItems; i++)
+	{
+		jobs.Get()[i] = b->a[i].pcm ? pool.Queue(AnalyzePCMJob, &b->a[i]) : NULL;
+		if (jobs.Get()[i])
+			dTotal += b->dLengths[i];
+	}
+
+	bool bDequeued = false;
+	while (true)
+	{
+		// Jobs waiting in the queue never start, running jobs see bCancel and stop after their current block
+		if (b->bCancel && !bDequeued)
+		{
+			for (int i = 0; i < b->iItems; i++)
+				if (jobs.Get()[i])
+					pool.Dequeue(jobs.Get()[i]);
+			bDequeued = true;
+		}
+
+		bool bDone = true;
+		double dDone = 0.0;
+		for (int i = 0; i < b->iItems; i++)
+		{
+			if (!jobs.Get()[i])
+				continue;
+			if (WaitForSingleObject(jobs.Get()[i], 0) == WAIT_OBJECT_0)
+				dDone += b->dLengths[i];
+			else
+			{
+				dDone += b->dLengths[i] * b->a[i].dProgress;
+				bDone = false;
+			}
+		}
+		if (bDone)
+			break;
+
+		// Stay below 1.0, wait dialog returns as soon as it sees it
+		b->dProgress = dTotal > 0.0 ? min(dDone / dTotal, 0.99) : 0.0;
+		Sleep(20);
+	}
+
+	for (int i = 0; i < b->iItems; i++)
+		if (jobs.Get()[i])
+			CloseHandle(jobs.Get()[i]);
+}
+
+DWORD WINAPI AnalyzeBatchThread(void* pBatch)
+{
+	AnalyzeBatch((ANALYZE_BATCH*)pBatch);
+	((ANALYZE_BATCH*)pBatch)->dProgress = 1.0;
+	return 0;
+}
+
+// Analyzes items concurrently (each on its own source duplicate) behind a single wait dialog
+// a[i] receives results of items[i] (set options and output arrays before calling), bAnalyzed[i]
+// is false for items that couldn't be analyzed.  Returns false if the user canceled the analysis.
+bool AnalyzeItems(MediaItem** items, int iItems, ANALYZE_PCM* a, bool* bAnalyzed)
+{
+	ANALYZE_BATCH b;
+	WDL_TypedBuf<double> lengths;
+	b.a = a;
+	b.dLengths = lengths.Resize(iItems, false);
+	b.iItems = iItems;
+	b.dProgress = 0.0;
+	b.bCancel = false;
+
+	bool bDidWork = false;
+	for (int i = 0; i < iItems; i++)
+	{
+		a[i].dProgress = 0.0;
+		a[i].bCancel = &b.bCancel;
+		a[i].pcm = DuplicateItemSource(items[i]);
+		b.dLengths[i] = a[i].pcm ? a[i].pcm->GetLength() : 0.0;
+		bAnalyzed[i] = a[i].pcm != NULL;
+		bDidWork |= bAnalyzed[i];
+	}
+
+	if (bDidWork)
+	{
+		HANDLE thread = CreateThread(NULL, 0, AnalyzeBatchThread, &b, 0, NULL);
+
+		WDL_String title;
+		title.AppendFormatted(100, __LOCALIZE_VERFMT("Please wait, analyzing %d item(s)...","sws_analysis"), iItems);
+		SWS_WaitDlg wait(title.Get(), &b.dProgress, NULL, &b.bCancel);
+
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+	}
+
+	for (int i = 0; i < iItems; i++)
+	{
+		delete a[i].pcm;
+		a[i].pcm = NULL;
+		a[i].bCancel = NULL;
+		if (b.bCancel)
+			bAnalyzed[i] = false;
+	}
+	return !b.bCancel;
+}
+
 void DoAnalyzeItem(COMMAND_T*)
 {
 	WDL_TypedBuf<MediaItem*> items;
@@ -258,21 +540,25 @@ void OrganizeByVol(COMMAND_T* ct)
 		{
 			double dStart = *(double*)GetSetMediaItemInfo(items.Get()[0], "D_POSITION", NULL);
 			double* pVol = new double[items.GetSize()];
-			ANALYZE_PCM a;
-			memset(&a, 0, sizeof(a));
+			WDL_TypedBuf<ANALYZE_PCM> a;
+			WDL_TypedBuf<bool> bAnalyzed;
+			memset(a.Resize(items.GetSize(), false), 0, items.GetSize() * sizeof(ANALYZE_PCM));
+			bAnalyzed.Resize(items.GetSize(), false);
 			if (ct->user == 2)
 			{	// Windowed mode, set the window size
 				char str[100];
 				GetPrivateProfileString(SWS_INI, SWS_RMS_KEY, "-20,0.1", str, 100, get_ini_file());
 				char* pWindow = strchr(str, ',');
-				a.dWindowSize = pWindow ? atof(pWindow+1) : 0.1;
+				for (int i = 0; i < items.GetSize(); i++)
+					a.Get()[i].dWindowSize = pWindow ? atof(pWindow+1) : 0.1;
 			}
-			for (int i = 0; i < items.GetSize(); i++)
+			if (!AnalyzeItems(items.Get(), items.GetSize(), a.Get(), bAnalyzed.Get()))
 			{
-				pVol[i] = -1.0;
-				if (AnalyzeItem(items.Get()[i], &a))
-					pVol[i] = ct->user ? a.dRMS : a.dPeakVal;
+				delete [] pVol;
+				return;
 			}
+			for (int i = 0; i < items.GetSize(); i++)
+				pVol[i] = bAnalyzed.Get()[i] ? (ct->user ? a.Get()[i].dRMS : a.Get()[i].dPeakVal) : -1.0;
 			// Sort and arrange items from min to max RMS
 			while (true)
 			{
@@ -302,19 +588,25 @@ void RMSNormalize(double dTargetDb, double dWindowSize)
 	WDL_TypedBuf<MediaItem*> items;
 	SWS_GetSelectedMediaItems(&items);
 	bool bDidWork = false;
-	ANALYZE_PCM a;
-	memset(&a, 0, sizeof(a));
-	a.dWindowSize = dWindowSize;
+	WDL_TypedBuf<ANALYZE_PCM> a;
+	WDL_TypedBuf<bool> bAnalyzed;
+	memset(a.Resize(items.GetSize(), false), 0, items.GetSize() * sizeof(ANALYZE_PCM));
+	bAnalyzed.Resize(items.GetSize(), false);
+	for (int i = 0; i < items.GetSize(); i++)
+		a.Get()[i].dWindowSize = dWindowSize;
+
+	if (!AnalyzeItems(items.Get(), items.GetSize(), a.Get(), bAnalyzed.Get()))
+		return;
 
 	for (int i = 0; i < items.GetSize(); i++)
 	{
 		MediaItem* mi = items.Get()[i];
 		MediaItem_Take* take = GetMediaItemTake(mi, -1);
-		if (take && AnalyzeItem(mi, &a) && a.dRMS != 0.0)
+		if (take && bAnalyzed.Get()[i] && a.Get()[i].dRMS != 0.0)
 		{
 			bDidWork = true;
 			double dVol = *(double*)GetSetMediaItemTakeInfo(take, "D_VOL", NULL);
-			dVol *= DB2VAL(dTargetDb) / a.dRMS;
+			dVol *= DB2VAL(dTargetDb) / a.Get()[i].dRMS;
 			GetSetMediaItemTakeInfo(take, "D_VOL", &dVol);
 		}
 	}
@@ -330,16 +622,22 @@ void RMSNormalizeAll(double dTargetDb, double dWindowSize)
 	WDL_TypedBuf<MediaItem*> items;
 	SWS_GetSelectedMediaItems(&items);
 	double dMaxRMS = -DBL_MAX;
-	ANALYZE_PCM a;
-	memset(&a, 0, sizeof(a));
-	a.dWindowSize = dWindowSize;
+	WDL_TypedBuf<ANALYZE_PCM> a;
+	WDL_TypedBuf<bool> bAnalyzed;
+	memset(a.Resize(items.GetSize(), false), 0, items.GetSize() * sizeof(ANALYZE_PCM));
+	bAnalyzed.Resize(items.GetSize(), false);
+	for (int i = 0; i < items.GetSize(); i++)
+		a.Get()[i].dWindowSize = dWindowSize;
+
+	if (!AnalyzeItems(items.Get(), items.GetSize(), a.Get(), bAnalyzed.Get()))
+		return;
 
 	for (int i = 0; i < items.GetSize(); i++)
 	{
 		MediaItem* mi = items.Get()[i];
 		MediaItem_Take* take = GetMediaItemTake(mi, -1);
-		if (take && AnalyzeItem(mi, &a) && a.dRMS != 0.0 && a.dRMS > dMaxRMS)
-			dMaxRMS = a.dRMS;
+		if (take && bAnalyzed.Get()[i] && a.Get()[i].dRMS != 0.0 && a.Get()[i].dRMS > dMaxRMS)
+			dMaxRMS = a.Get()[i].dRMS;
 	}
 
 	if (dMaxRMS > -DBL_MAX)
@@ -44,8 +44,15 @@ typedef struct ANALYZE_PCM
 	double dProgress;		// out Analysis progress, 0.0-1.0 for 0-100%
 	INT64 sampleCount;		// out # of samples analyzed
 	double dWindowSize;		// RMS window in seconds.  If this is != 0.0, then RMS is calculated/returned as max within window
+	double* dDCOffsets;		// i/o Array of channel DC offsets (optional)
+	double dDCOffset;		// out DC offset of all channels
+	int iWindows;			// in  Dimension of the extra RMS window arrays (zero to disable)
+	double* dWindowSizes;	// in  Array of extra RMS windows in seconds, analyzed in the same pass
+	double* dWindowRMSs;	// i/o Array of max RMS values within each extra window (over all channels)
+	bool* bCancel;			// in  Analysis stops after current block once this gets set (optional)
 } ANALYZE_PCM;
 
 int AnalysisInit();
 
 bool AnalyzeItem(MediaItem* mi, ANALYZE_PCM* a);
+bool AnalyzeItems(MediaItem** items, int iItems, ANALYZE_PCM* a, bool* bAnalyzed);
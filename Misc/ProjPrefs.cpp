@@ -176,6 +176,7 @@ static COMMAND_T g_commandTable[] =
 	{ { DEFACCEL, "SWS: Metronome disable" },										"SWS_METROOFF",			MetronomeOff,		},
 #ifdef ACTION_DEBUG
 	{ { DEFACCEL, "SWS: Write SWS actions to sws_actions.csv" },					"SWS_ACTIONS",			ActionsList,		},
+	{ { DEFACCEL, "SWS: Show toggle state poll rates" },							"SWS_ACTIONSSTATS",		ActionsStats,		},
 #endif
 	{ {}, LAST_COMMAND, }, // Denote end of table
 };
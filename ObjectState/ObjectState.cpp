@@ -38,6 +38,28 @@
 
 //#define GOS_DEBUG
 
+static double GOS_GetTime()
+{
+#ifdef _WIN32
+	LARGE_INTEGER count, freq;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&freq);
+	return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.0;
+#endif
+}
+
+#ifdef GOS_DEBUG
+static int GOS_CompareTime(const void* a, const void* b)
+{
+	double d = *(const double*)b - *(const double*)a;
+	return d > 0.0 ? 1 : d < 0.0 ? -1 : 0;
+}
+#endif
+
 ObjectStateCache::ObjectStateCache():m_iUseCount(1)
 {
 }
@@ -52,13 +74,18 @@ void ObjectStateCache::WriteCache()
 #ifdef GOS_DEBUG
 	int iCount = 0;
 #endif
-	for (int i = 0; i < m_obj.GetSize(); i++)
+	for (int i = 0; i < m_states.GetSize(); i++)
 	{
-		if (m_str.Get(i)->GetLength() && m_orig.Get(i) && strcmp(m_str.Get(i)->Get(), m_orig.Get(i)))
+		// Only written states get compared, and only the ones that really changed get applied.
+		// States that were written without being read first have nothing to compare to and are skipped
+		CachedState* s = m_states.Get(i);
+		if (s->bDirty && s->orig && strcmp(s->str.Get(), s->orig))
 		{
-			int fxstate = SNM_PreObjectState(m_str.Get(i), false);
-			GetSetObjectState(m_obj.Get(i), m_str.Get(i)->Get());
+			double dStart = GOS_GetTime();
+			int fxstate = SNM_PreObjectState(&s->str, false);
+			GetSetObjectState(s->obj, s->str.Get());
 			SNM_PostObjectState(fxstate);
+			s->dWriteTime += GOS_GetTime() - dStart;
 #ifdef GOS_DEBUG
 			iCount++;
 #endif
@@ -66,6 +93,23 @@ void ObjectStateCache::WriteCache()
 	}
 #ifdef GOS_DEBUG
 	dprintf("ObjectStateCache::WriteCache applied %d chunks.\n", iCount);
+
+	// Slowest objects first: time, then index of the state
+	WDL_TypedBuf<double> times;
+	times.Resize(m_states.GetSize() * 2, false);
+	for (int i = 0; i < m_states.GetSize(); i++)
+	{
+		times.Get()[i*2] = m_states.Get(i)->dReadTime + m_states.Get(i)->dWriteTime;
+		times.Get()[i*2+1] = (double)i;
+	}
+	qsort(times.Get(), m_states.GetSize(), sizeof(double) * 2, GOS_CompareTime);
+	for (int i = 0; i < m_states.GetSize() && i < 20; i++)
+	{
+		CachedState* s = m_states.Get((int)times.Get()[i*2+1]);
+		const char* chunk = s->orig ? s->orig : s->str.Get();
+		const char* eol = strchr(chunk, '\n');
+		dprintf("  %p read %.1f ms, write %.1f ms: %.*s\n", s->obj, s->dReadTime * 1000.0, s->dWriteTime * 1000.0, eol ? (int)(eol - chunk) : 40, chunk);
+	}
 #endif
 
 	EmptyCache();
@@ -73,39 +117,46 @@ void ObjectStateCache::WriteCache()
 
 void ObjectStateCache::EmptyCache()
 {
-	m_obj.Empty(false);
-	m_str.Empty(true);
-	m_orig.Empty(true, FreeHeapPtr);
+	for (int i = 0; i < m_states.GetSize(); i++)
+		if (m_states.Get(i)->orig)
+			FreeHeapPtr(m_states.Get(i)->orig);
+	m_states.Empty(true);
+	m_index.DeleteAll();
 }
 
 const char* ObjectStateCache::GetSetObjState(void* obj, const char* str, bool wantsMinimalState)
 {
-	int i = m_obj.Find(obj);
-	if (i < 0)
+	CachedState* s = m_states.Get(m_index.Get((INT_PTR)obj, -1));
+	if (!s)
 	{
-		i = m_obj.GetSize();
-		m_obj.Add(obj);
-		m_str.Add(new WDL_FastString);
-		if (str && str[0])
-			m_orig.Add(NULL);
-		else
+		s = new CachedState;
+		s->obj = obj;
+		s->orig = NULL;
+		s->bDirty = false;
+		s->dReadTime = 0.0;
+		s->dWriteTime = 0.0;
+		if (!str || !str[0])
 		{
+			double dStart = GOS_GetTime();
 			int fxstate = SNM_PreObjectState(NULL, wantsMinimalState);
-			char* p = GetSetObjectState(obj, NULL);
+			s->orig = GetSetObjectState(obj, NULL);
 			SNM_PostObjectState(fxstate);
-			m_orig.Add(p);
+			s->dReadTime = GOS_GetTime() - dStart;
 		}
+		m_index.Insert((INT_PTR)obj, m_states.GetSize());
+		m_states.Add(s);
 	}
 	if (str && str[0])
 	{
-		m_str.Get(i)->Set(str);
+		s->str.Set(str);
+		s->bDirty = true;
 		return NULL;
 	}
 
-	if (m_str.Get(i)->GetLength())
-		return m_str.Get(i)->Get();
+	if (s->str.GetLength())
+		return s->str.Get();
 	else
-		return m_orig.Get(i);
+		return s->orig;
 }
 
 ObjectStateCache* g_objStateCache = NULL;
@@ -38,9 +38,17 @@ public:
 	const char* GetSetObjState(void* obj, const char* str, bool wantsMinimalState = false);
 	int m_iUseCount;
 private:
-	WDL_PtrList<void> m_obj;
-	WDL_PtrList<WDL_FastString> m_str;
-	WDL_PtrList<char> m_orig;
+	struct CachedState
+	{
+		void* obj;
+		WDL_FastString str;	// state set by the caller
+		char* orig;			// state read from REAPER, NULL if the first access was a write
+		bool bDirty;		// set on write, only dirty states get written back
+		double dReadTime;	// seconds spent in GetSetObjectState, for finding objects that dominate a recall
+		double dWriteTime;
+	};
+	WDL_PtrList<CachedState> m_states;	// in order of first access
+	WDL_PtrKeyedArray<int> m_index;		// object -> m_states index
 };
 
 const char* SWS_GetSetObjectState(void* obj, WDL_FastString* str, bool wantsMinimalState = false);
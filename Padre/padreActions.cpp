@@ -170,6 +170,8 @@ WDL_DLGRET EnvelopeLfoDlgProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam
 			SetDlgItemText(hwnd, IDC_PADRELFO_STRENGTH, buffer);
 			sprintf(buffer, "%.0lf", 100.0*EnvelopeProcessor::getInstance()->_parameters.waveParams.offset);
 			SetDlgItemText(hwnd, IDC_PADRELFO_OFFSET, buffer);
+			sprintf(buffer, "%g", EnvelopeProcessor::getInstance()->_parameters.maxError);
+			SetDlgItemText(hwnd, IDC_PADRELFO_MAXERROR, buffer);
 
 			for(int i=eTAKEENV_VOLUME; i<=eTAKEENV_PITCH; i++)
 			{
@@ -231,6 +233,9 @@ WDL_DLGRET EnvelopeLfoDlgProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam
 					GetDlgItemText(hwnd,IDC_PADRELFO_OFFSET,buffer,BUFFER_SIZE);
 					EnvelopeProcessor::getInstance()->_parameters.waveParams.offset = atof(buffer)/100.0;
 
+					GetDlgItemText(hwnd,IDC_PADRELFO_MAXERROR,buffer,BUFFER_SIZE);
+					EnvelopeProcessor::getInstance()->_parameters.maxError = atof(buffer);
+
 					combo = (int)SendDlgItemMessage(hwnd,IDC_PADRELFO_TAKEENV,CB_GETCURSEL,0,0);
 					if(combo != CB_ERR)
 						EnvelopeProcessor::getInstance()->_parameters.takeEnvType = (TakeEnvType)(SendDlgItemMessage(hwnd,IDC_PADRELFO_TAKEENV,CB_GETITEMDATA,combo,0));
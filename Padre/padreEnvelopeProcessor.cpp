@@ -30,6 +30,7 @@
 #include "padreEnvelopeProcessor.h"
 #include "../reaper/localize.h"
 #include "../SnM/SnM_Item.h"
+#include "../Breeder/BR_EnvelopeUtil.h"
 
 const char* GetEnvTypeStr(EnvType type)
 {
@@ -71,7 +72,7 @@ LfoWaveParams& LfoWaveParams::operator=(const LfoWaveParams &params)
 }
 
 EnvLfoParams::EnvLfoParams()
-: waveParams(), precision(0.05), midiCc(7), takeEnvType(eTAKEENV_VOLUME), envType(eENVTYPE_TRACK), timeSegment(eTIMESEGMENT_TIMESEL), activeTakeOnly(true)
+: waveParams(), precision(0.05), maxError(0.0), midiCc(7), takeEnvType(eTAKEENV_VOLUME), envType(eENVTYPE_TRACK), timeSegment(eTIMESEGMENT_TIMESEL), activeTakeOnly(true)
 , freqModulator()
 {
 }
@@ -80,6 +81,7 @@ EnvLfoParams& EnvLfoParams::operator=(const EnvLfoParams &params)
 {
 	this->waveParams = params.waveParams;
 	this->precision = params.precision;
+	this->maxError = params.maxError;
 	this->midiCc = params.midiCc;
 	this->envType = params.envType;
 	this->takeEnvType = params.takeEnvType;
@@ -222,7 +224,7 @@ EnvelopeProcessor::ErrorCode EnvelopeProcessor::getTrackEnvelopeMinMax(TrackEnve
 	return eERRORCODE_OK;
 }
 
-void EnvelopeProcessor::writeLfoPoints(string &envState, double dStartTime, double dEndTime, double dValMin, double dValMax, LfoWaveParams &waveParams, double dPrecision, LfoWaveParams* freqModulator)
+void EnvelopeProcessor::writeLfoPoints(string &envState, double dStartTime, double dEndTime, double dValMin, double dValMax, LfoWaveParams &waveParams, double dPrecision, double dMaxError, LfoWaveParams* freqModulator)
 {
 	double dFreq, dDelay;
 	getFreqDelay(waveParams, dFreq, dDelay);
@@ -233,6 +235,7 @@ void EnvelopeProcessor::writeLfoPoints(string &envState, double dStartTime, doub
 	double dSamplerate;
 	double dValue = 0.0;
 	char buffer[BUFFER_SIZE];
+	vector<BR_EnvPoint> points;
 
 	EnvShape tEnvShape = eENVSHAPE_LINEAR;
 	switch(waveParams.shape)
@@ -327,8 +330,7 @@ void EnvelopeProcessor::writeLfoPoints(string &envState, double dStartTime, doub
 	double dValueEnd = waveParams.offset + dMagnitude*dCarrierEnd;
 	dValueEnd = dScale*dValueEnd + dOff;
 
-	sprintf(buffer, "PT %lf %lf %d\n", dStartTime, dValueStart, tEnvShape);
-	envState.append(buffer);
+	points.push_back(BR_EnvPoint(dStartTime, dValueStart, tEnvShape, 0, 0, 0, 0.0));
 
 //double dFreqMod = dFreq;
 //freqModulator = new LfoWaveParams();
@@ -355,8 +357,7 @@ void EnvelopeProcessor::writeLfoPoints(string &envState, double dStartTime, doub
 					dValue = waveParams.offset + dMagnitude*WaveformGeneratorSin(t, dFreq, dDelaySec);
 //dValue = waveParams.offset + dMagnitude*WaveformGeneratorSin(t, dFreqMod, dDelaySec);
 					dValue = dScale*dValue + dOff;
-					sprintf(buffer, "PT %lf %lf %d\n", t+dStartTime, dValue, tEnvShape);
-					envState.append(buffer);
+					points.push_back(BR_EnvPoint(t+dStartTime, dValue, tEnvShape, 0, 0, 0, 0.0));
 				}
 			}
 		}
@@ -375,8 +376,7 @@ void EnvelopeProcessor::writeLfoPoints(string &envState, double dStartTime, doub
 				{
 					dValue = waveParams.offset + dMagnitude*dFlipFlop;
 					dValue = dScale*dValue + dOff;
-					sprintf(buffer, "PT %lf %lf %d\n", t+dStartTime, dValue, tEnvShape);
-					envState.append(buffer);
+					points.push_back(BR_EnvPoint(t+dStartTime, dValue, tEnvShape, 0, 0, 0, 0.0));
 					dFlipFlop = -dFlipFlop;
 				}
 			}
@@ -396,8 +396,7 @@ void EnvelopeProcessor::writeLfoPoints(string &envState, double dStartTime, doub
 					{
 						dValue = waveParams.offset + dMagnitude*dFlipFlop;
 						dValue = dScale*dValue + dOff;
-						sprintf(buffer, "PT %lf %lf %d\n", t+dStartTime, dValue, tEnvShape);
-						envState.append(buffer);
+						points.push_back(BR_EnvPoint(t+dStartTime, dValue, tEnvShape, 0, 0, 0, 0.0));
 						dFlipFlop = -dFlipFlop;
 					}
 				}
@@ -420,8 +419,7 @@ void EnvelopeProcessor::writeLfoPoints(string &envState, double dStartTime, doub
 				{
 					dValue = waveParams.offset + dMagnitude*WaveformGeneratorRandom(t, dFreq, dDelaySec);
 					dValue = dScale*dValue + dOff;
-					sprintf(buffer, "PT %lf %lf %d\n", t+dStartTime, dValue, tEnvShape);
-					envState.append(buffer);
+					points.push_back(BR_EnvPoint(t+dStartTime, dValue, tEnvShape, 0, 0, 0, 0.0));
 				}
 			}
 		}
@@ -431,8 +429,18 @@ void EnvelopeProcessor::writeLfoPoints(string &envState, double dStartTime, doub
 		break;
 	}
 
-	sprintf(buffer, "PT %lf %lf %d\n", dEndTime, dValueEnd, tEnvShape);
-	envState.append(buffer);
+	points.push_back(BR_EnvPoint(dEndTime, dValueEnd, tEnvShape, 0, 0, 0, 0.0));
+
+	// Drop points the envelope doesn't need to stay within dMaxError of the waveform
+	if(dMaxError > 0.0)
+		SimplifyEnvPoints(points, dMaxError, dValMin, dValMax, 0, -1, (tEnvShape == eENVSHAPE_BEZIER));
+
+	envState.reserve(envState.size() + 32*points.size());
+	for(vector<BR_EnvPoint>::const_iterator it = points.begin(); it != points.end(); ++it)
+	{
+		sprintf(buffer, "PT %lf %lf %d\n", it->position, it->value, it->shape);
+		envState.append(buffer);
+	}
 }
 
 EnvelopeProcessor::ErrorCode EnvelopeProcessor::processPoints(char* envState, string &newState, double dStartPos, double dEndPos, double dValMin, double dValMax, EnvModType envModType, double dStrength, double dOffset)
@@ -556,7 +564,7 @@ EnvelopeProcessor::ErrorCode EnvelopeProcessor::processPoints(char* envState, st
 	return eERRORCODE_OK;
 }
 
-EnvelopeProcessor::ErrorCode EnvelopeProcessor::generateTrackLfo(TrackEnvelope* envelope, double dStartPos, double dEndPos, LfoWaveParams &waveParams, double dPrecision)
+EnvelopeProcessor::ErrorCode EnvelopeProcessor::generateTrackLfo(TrackEnvelope* envelope, double dStartPos, double dEndPos, LfoWaveParams &waveParams, double dPrecision, double dMaxError)
 {
 	if(!envelope)
 		return eERRORCODE_NOENVELOPE;
@@ -611,7 +619,7 @@ EnvelopeProcessor::ErrorCode EnvelopeProcessor::generateTrackLfo(TrackEnvelope*
 		token = strtok(NULL, "\n");
 	}
 
-	writeLfoPoints(newState, dStartPos, dEndPos, dValMin, dValMax, waveParams, dPrecision);
+	writeLfoPoints(newState, dStartPos, dEndPos, dValMin, dValMax, waveParams, dPrecision, dMaxError);
 
 	newState.append(token);
 	newState.append("\n");
@@ -666,14 +674,14 @@ EnvelopeProcessor::ErrorCode EnvelopeProcessor::generateSelectedTrackEnvLfo()
 	//Main_OnCommandEx(ID_MOVE_TIMESEL_NUDGE_RIGHTEDGE_LEFT, 0, 0);
 	//Main_OnCommandEx(ID_ENVELOPE_DELETE_ALL_POINTS_TIMESEL, 0, 0);
 
-	ErrorCode res = generateTrackLfo(envelope, dStartPos, dEndPos, _parameters.waveParams, _parameters.precision);
+	ErrorCode res = generateTrackLfo(envelope, dStartPos, dEndPos, _parameters.waveParams, _parameters.precision, _parameters.maxError);
 //UpdateTimeline();
 
 	Undo_EndBlock2(NULL, __LOCALIZE("Track envelope LFO","sws_undo"), UNDO_STATE_TRACKCFG);
 	return res;
 }
 
-EnvelopeProcessor::ErrorCode EnvelopeProcessor::generateTakeLfo(MediaItem_Take* take, double dStartPos, double dEndPos, TakeEnvType tTakeEnvType, LfoWaveParams &waveParams, double dPrecision)
+EnvelopeProcessor::ErrorCode EnvelopeProcessor::generateTakeLfo(MediaItem_Take* take, double dStartPos, double dEndPos, TakeEnvType tTakeEnvType, LfoWaveParams &waveParams, double dPrecision, double dMaxError)
 {
 	double dValMin = 0.0;
 	double dValMax = 1.0;
@@ -739,7 +747,7 @@ EnvelopeProcessor::ErrorCode EnvelopeProcessor::generateTakeLfo(MediaItem_Take*
 		token = strtok(NULL, "\n");
 	}
 
-	writeLfoPoints(newState, dStartPos, dEndPos, dValMin, dValMax, waveParams, dPrecision);
+	writeLfoPoints(newState, dStartPos, dEndPos, dValMin, dValMax, waveParams, dPrecision, dMaxError);
 
 	newState.append(token);
 	newState.append("\n");
@@ -816,7 +824,7 @@ EnvelopeProcessor::ErrorCode EnvelopeProcessor::generateTakeLfo(MediaItem_Take*
 	dStartPos -= dItemStartPos;
 	dEndPos -= dItemStartPos;
 
-	return generateTakeLfo(take, dStartPos, dEndPos, _parameters.takeEnvType, _parameters.waveParams, _parameters.precision);
+	return generateTakeLfo(take, dStartPos, dEndPos, _parameters.takeEnvType, _parameters.waveParams, _parameters.precision, _parameters.maxError);
 }
 
 EnvelopeProcessor::ErrorCode EnvelopeProcessor::generateSelectedTakesLfo()
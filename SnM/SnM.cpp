@@ -1315,5 +1315,6 @@ void SNM_Exit()
 	RegionPlaylistExit();
 	CyclactionExit();
 	SNM_UIExit();
+	OscCSurfExit();
 	IniFileExit();
 }
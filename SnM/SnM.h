@@ -172,7 +172,8 @@
 #define SNM_SCHEDJOB_LIVECFG_PRELOAD		SNM_SCHEDJOB_LIVECFG_APPLY + SNM_LIVECFG_NB_CONFIGS
 #define SNM_SCHEDJOB_LIVECFG_UPDATE			SNM_SCHEDJOB_LIVECFG_PRELOAD + SNM_LIVECFG_NB_CONFIGS
 #define SNM_SCHEDJOB_LIVECFG_FADE_UPDATE	SNM_SCHEDJOB_LIVECFG_UPDATE + 1
-#define SNM_SCHEDJOB_UNDO					SNM_SCHEDJOB_LIVECFG_FADE_UPDATE + 1
+#define SNM_SCHEDJOB_LIVECFG_FILES_UPDATE	SNM_SCHEDJOB_LIVECFG_FADE_UPDATE + 1
+#define SNM_SCHEDJOB_UNDO					SNM_SCHEDJOB_LIVECFG_FILES_UPDATE + 1
 #define SNM_SCHEDJOB_NOTES_UPDATE			SNM_SCHEDJOB_UNDO + 1
 #define SNM_SCHEDJOB_SEL_PRJ				SNM_SCHEDJOB_NOTES_UPDATE + 1
 #define SNM_SCHEDJOB_TRIG_PRESET			SNM_SCHEDJOB_SEL_PRJ + 1
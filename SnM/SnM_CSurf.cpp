@@ -28,6 +28,7 @@
 #include "stdafx.h" 
 #include "SnM.h"
 #include "SnM_CSurf.h"
+#include "SnM_Find.h"
 #include "SnM_LiveConfigs.h"
 #include "SnM_Misc.h"
 #include "SnM_Notes.h"
@@ -58,6 +59,8 @@ void SNM_CSurfRun()
 	ScheduledJob::Run();
 	StopTrackPreviewsRun();
 	UpdateMarkerRegionRun();
+	ResourcesScanRun();
+	FindIndexRun();
 	AutoRefreshToolbarRun();
 
 	sRecurseCheck = false;
@@ -66,6 +69,7 @@ void SNM_CSurfRun()
 void SNM_CSurfSetTrackTitle() {
 	NotesSetTrackTitle();
 	LiveConfigsSetTrackTitle();
+	FindSetTrackTitle();
 }
 
 void SNM_CSurfSetTrackListChange()
@@ -74,6 +78,7 @@ void SNM_CSurfSetTrackListChange()
 	LiveConfigsTrackListChange();
 	RegionPlaylistSetTrackListChange();
 	ResourcesTrackListChange();
+	FindSetTrackListChange();
 }
 
 bool g_lastPlayState=false, g_lastPauseState=false, g_lastRecState=false;
@@ -111,71 +116,214 @@ int SNM_CSurfExtended(int _call, void* _parm1, void* _parm2, void* _parm3)
 
 ///////////////////////////////////////////////////////////////////////////////
 // OSC feedtack
+// One SNM_OscSender per output destination (ip, port, etc..), shared by all 
+// SNM_OscCSurf's targeting it, with a persistent socket and its own thread.
+// The main thread only queues bundles (pairs of osc address + string arg): 
+// a queued bundle that has not been sent yet is updated in place when a new 
+// one with the same addresses is queued (i.e. only the latest feedback is
+// sent for a given address). Sent bundles are recycled, buffers are reused.
 ///////////////////////////////////////////////////////////////////////////////
 
-bool SNM_OscCSurf::SendStr(const char* _msg, const char* _oscArg, int _msgArg)
+class SNM_OscSender
 {
-	if (_msg && *_msg && _oscArg)
+public:
+	SNM_OscSender(const char* _ip, int _port, int _maxOut, int _waitOut)
+		: m_ip(_ip), m_port(_port), m_maxOut(_maxOut), m_waitOut(_waitOut), m_sock(NULL), m_quit(false)
 	{
-		oscpkt::UdpSocket sock;
-		sock.connectTo(m_ipOut.Get(), m_portOut);
-		if (sock.isOk())
-		{
-			WDL_FastString msg(_msg);
-			if (_msgArg>=0)
-				msg.SetFormatted(SNM_MAX_OSC_MSG_LEN, _msg, _msgArg);
+		m_wakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+		m_thread = (HANDLE)_beginthreadex(NULL, 0, SNM_OscSender::SenderThread, (void*)this, 0, NULL);
+	}
 
-			oscpkt::Message oscMsg(msg.Get());
-			oscMsg.pushStr(_oscArg);
-			oscpkt::PacketWriter pw;
-			pw.startBundle();
-			pw.addMessage(oscMsg);
-			pw.endBundle();
-			if ((int)pw.packetSize() < m_maxOut) // C4018
-				return sock.sendPacket(pw.packetData(), pw.packetSize());
+	// unsent bundles are lost
+	~SNM_OscSender()
+	{
+		m_quit = true;
+		SetEvent(m_wakeEvent);
+		if (m_thread) {
+			WaitForSingleObject(m_thread, INFINITE);
+			CloseHandle(m_thread);
 		}
+		CloseHandle(m_wakeEvent);
+		delete m_sock;
+		m_queue.Empty(true);
+		m_free.Empty(true);
 	}
-	return false;
-}
 
-bool SNM_OscCSurf::SendStrBundle(WDL_PtrList<WDL_FastString> * _strs)
-{
-	if (_strs && _strs->GetSize())
+	bool Matches(SNM_OscCSurf* _osc) {
+		return m_port==_osc->m_portOut && m_maxOut==_osc->m_maxOut && m_waitOut==_osc->m_waitOut && !strcmp(m_ip.Get(), _osc->m_ipOut.Get());
+	}
+
+	// _strs: osc address, string arg, osc address, string arg, etc..
+	bool Queue(WDL_PtrList<WDL_FastString>* _strs)
+	{
+		if (!m_thread || !_strs || !_strs->GetSize() || (_strs->GetSize()%2))
+			return false;
+		for (int i=0; i<_strs->GetSize(); i++)
+			if (!_strs->Get(i))
+				return false;
+
+		SWS_SectionLock lock(&m_mutex);
+
+		Bundle* b = NULL;
+		for (int i=0; !b && i<m_queue.GetSize(); i++)
+			if (m_queue.Get(i)->HasAddresses(_strs))
+				b = m_queue.Get(i); // coalesce
+		if (!b)
+		{
+			if (int sz = m_free.GetSize()) {
+				b = m_free.Get(sz-1);
+				m_free.Delete(sz-1, false);
+			}
+			else
+				b = new Bundle;
+			m_queue.Add(b);
+		}
+		b->Set(_strs);
+
+		SetEvent(m_wakeEvent);
+		return true;
+	}
+
+private:
+	struct Bundle
+	{
+		WDL_PtrList_DeleteOnDestroy<WDL_FastString> m_strs; // buffers are reused
+		int m_sz;
+		Bundle() : m_sz(0) {}
+		bool HasAddresses(WDL_PtrList<WDL_FastString>* _strs) {
+			if (_strs->GetSize() != m_sz) return false;
+			for (int i=0; i<m_sz; i+=2)
+				if (strcmp(m_strs.Get(i)->Get(), _strs->Get(i)->Get()))
+					return false;
+			return true;
+		}
+		void Set(WDL_PtrList<WDL_FastString>* _strs) {
+			m_sz = _strs->GetSize();
+			while (m_strs.GetSize() < m_sz)
+				m_strs.Add(new WDL_FastString);
+			for (int i=0; i<m_sz; i++)
+				m_strs.Get(i)->Set(_strs->Get(i));
+		}
+	};
+
+	static unsigned WINAPI SenderThread(void* _sender)
 	{
-		oscpkt::UdpSocket sock;
-		sock.connectTo(m_ipOut.Get(), m_portOut);
-		if (sock.isOk())
+		SNM_OscSender* s = (SNM_OscSender*)_sender;
+		while (!s->m_quit)
 		{
-			// build osc messages
-			WDL_PtrList_DeleteOnDestroy<oscpkt::Message> msgs; // for "auto-deletion"
-			for (int i=0; i<_strs->GetSize(); i+=2)
+			WaitForSingleObject(s->m_wakeEvent, INFINITE);
+			while (!s->m_quit)
 			{
-				if (WDL_FastString* msg = _strs->Get(i))
+				Bundle* b;
 				{
-					oscpkt::Message* oscMsg = msgs.Add(new oscpkt::Message(msg->Get()));
-					if (WDL_FastString* oscArg = _strs->Get(i+1))
-						oscMsg->pushStr(oscArg->Get());
-					else
-						return false;
+					SWS_SectionLock lock(&s->m_mutex);
+					if (!(b = s->m_queue.Get(0)))
+						break;
+					s->m_queue.Delete(0, false);
+				}
+
+				s->Send(b);
+
+				{
+					SWS_SectionLock lock(&s->m_mutex);
+					s->m_free.Add(b);
 				}
+				if (s->m_waitOut>0) // device's "wait between packets" setting
+					Sleep(s->m_waitOut);
 			}
+		}
+		return 0;
+	}
 
-			// bundle & send osc messages
-			if (msgs.GetSize())
-			{
-				oscpkt::PacketWriter pw;
-				pw.startBundle();
-				for (int i=0; i<msgs.GetSize(); i++)
-					pw.addMessage(*msgs.Get(i));
-				pw.endBundle();
-				if ((int)pw.packetSize() < m_maxOut) // C4018
-					return sock.sendPacket(pw.packetData(), pw.packetSize());
+	// sender thread only
+	bool Send(Bundle* _b)
+	{
+		if (!m_sock)
+		{
+			m_sock = new oscpkt::UdpSocket();
+			m_sock->connectTo(m_ip.Get(), m_port);
+		}
+		if (m_sock->isOk())
+		{
+			m_pw.init();
+			m_pw.startBundle();
+			for (int i=0; i<_b->m_sz; i+=2) {
+				m_msg.init(_b->m_strs.Get(i)->Get());
+				m_msg.pushStr(_b->m_strs.Get(i+1)->Get());
+				m_pw.addMessage(m_msg);
 			}
+			m_pw.endBundle();
+			if ((int)m_pw.packetSize() < m_maxOut) // C4018
+				if (m_sock->sendPacket(m_pw.packetData(), m_pw.packetSize()))
+					return true;
+		}
+		if (!m_sock->isOk()) // reconnect on next send
+			DELETE_NULL(m_sock);
+		return false;
+	}
+
+	WDL_FastString m_ip;
+	int m_port, m_maxOut, m_waitOut;
+	WDL_PtrList<Bundle> m_queue, m_free; // m_free: sent bundles, to be recycled
+	SWS_Mutex m_mutex;
+	HANDLE m_thread, m_wakeEvent;
+	volatile bool m_quit;
+	// sender thread only
+	oscpkt::UdpSocket* m_sock;
+	oscpkt::PacketWriter m_pw;
+	oscpkt::Message m_msg;
+};
+
+WDL_PtrList_DeleteOnDestroy<SNM_OscSender> g_oscSenders;
+bool g_oscSendersExited = false;
+
+SNM_OscSender* SNM_OscCSurf::GetSender()
+{
+	if (g_oscSendersExited)
+		return NULL;
+	if (!m_sender)
+	{
+		for (int i=0; !m_sender && i<g_oscSenders.GetSize(); i++)
+			if (g_oscSenders.Get(i)->Matches(this))
+				m_sender = g_oscSenders.Get(i);
+		if (!m_sender)
+			m_sender = g_oscSenders.Add(new SNM_OscSender(m_ipOut.Get(), m_portOut, m_maxOut, m_waitOut));
+	}
+	return m_sender;
+}
+
+// returns true if the message has been queued (sent asynchronously)
+bool SNM_OscCSurf::SendStr(const char* _msg, const char* _oscArg, int _msgArg)
+{
+	if (_msg && *_msg && _oscArg)
+	{
+		if (SNM_OscSender* sender = GetSender())
+		{
+			WDL_FastString msg(_msg), arg(_oscArg);
+			if (_msgArg>=0)
+				msg.SetFormatted(SNM_MAX_OSC_MSG_LEN, _msg, _msgArg);
+
+			WDL_PtrList<WDL_FastString> strs;
+			strs.Add(&msg);
+			strs.Add(&arg);
+			bool queued = sender->Queue(&strs);
+			strs.Empty(false);
+			return queued;
 		}
 	}
 	return false;
 }
 
+// _strs: osc address, string arg, osc address, string arg, etc..
+// returns true if the bundle has been queued (sent asynchronously)
+bool SNM_OscCSurf::SendStrBundle(WDL_PtrList<WDL_FastString> * _strs)
+{
+	if (_strs && _strs->GetSize())
+		if (SNM_OscSender* sender = GetSender())
+			return sender->Queue(_strs);
+	return false;
+}
+
 bool SNM_OscCSurf::Equals(SNM_OscCSurf* _osc)
 {
 	return _osc &&
@@ -237,6 +385,13 @@ SNM_OscCSurf* LoadOscCSurfs(WDL_PtrList<SNM_OscCSurf>* _out, const char* _name)
 	return NULL;
 }
 
+// stops the sender threads, SNM_OscCSurf's cannot send anything afterwards
+void OscCSurfExit()
+{
+	g_oscSendersExited = true;
+	g_oscSenders.Empty(true);
+}
+
 // just to factorize osc cursf menu creations
 void AddOscCSurfMenu(HMENU _menu, SNM_OscCSurf* _activeOsc, int _startMsg, int _endMsg)
 {
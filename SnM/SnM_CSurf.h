@@ -40,14 +40,16 @@ int SNM_CSurfExtended(int _call, void* _parm1, void* _parm2, void* _parm3);
 
 
 // osc csurf feedback
+// note: messages are sent asynchronously, see SNM_OscSender
+class SNM_OscSender;
 class SNM_OscCSurf {
 public:
 	SNM_OscCSurf(const char* _name, int _flags, int _portIn, const char* _ipOut, int _portOut, int _maxOut, int _waitOut, const char* _layout)
 		: m_name(_name), m_flags(_flags), m_portIn(_portIn), 
-		m_ipOut(_ipOut), m_portOut(_portOut), m_maxOut(_maxOut), m_waitOut(_waitOut), m_layout(_layout) {}
+		m_ipOut(_ipOut), m_portOut(_portOut), m_maxOut(_maxOut), m_waitOut(_waitOut), m_layout(_layout), m_sender(NULL) {}
 	SNM_OscCSurf(SNM_OscCSurf* _osc)
 		: m_name(&_osc->m_name), m_flags(_osc->m_flags), m_portIn(_osc->m_portIn), 
-		m_ipOut(&_osc->m_ipOut), m_portOut(_osc->m_portOut), m_maxOut(_osc->m_maxOut), m_waitOut(_osc->m_waitOut), m_layout(&_osc->m_layout) {}
+		m_ipOut(&_osc->m_ipOut), m_portOut(_osc->m_portOut), m_maxOut(_osc->m_maxOut), m_waitOut(_osc->m_waitOut), m_layout(&_osc->m_layout), m_sender(NULL) {}
 	~SNM_OscCSurf() {}
 	bool SendStr(const char* _msg, const char* _oscArg, int _msgArg = -1);
 	bool SendStrBundle(WDL_PtrList<WDL_FastString> * _strs);
@@ -59,10 +61,14 @@ public:
 	WDL_FastString m_ipOut;
 	int m_portOut, m_maxOut, m_waitOut;
 	WDL_FastString m_layout;
+protected:
+	SNM_OscSender* GetSender();
+	SNM_OscSender* m_sender; // shared, owned by the sender pool
 };
 
 SNM_OscCSurf* LoadOscCSurfs(WDL_PtrList<SNM_OscCSurf>* _out, const char* _name = NULL);
 void AddOscCSurfMenu(HMENU _menu, SNM_OscCSurf* _activeOsc, int _startMsg, int _endMsg);
+void OscCSurfExit();
 
 
 // fake/local osc csurf (local input)
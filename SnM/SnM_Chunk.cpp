@@ -934,3 +934,170 @@ bool SNM_TakeEnvParserPatcher::SetVal(const char* _envKeyWord, int _val) {
 	return (ParsePatch(-1, 1, _envKeyWord) > 0);
 }
 
+
+///////////////////////////////////////////////////////////////////////////////
+// SNM_ChunkTransaction
+///////////////////////////////////////////////////////////////////////////////
+
+enum {
+	SNM_EDIT_TOKEN = 0,
+	SNM_EDIT_LINE,
+	SNM_EDIT_SUBCHUNK
+};
+
+// edited lines always have a parent, i.e. depth 0 edits would never match
+bool SNM_ChunkTransaction::AddTokenEdit(const char* _parent, const char* _keyword, int _depth, int _occurence, int _tokenPos, const char* _value)
+{
+	assert(_depth >= 1);
+	if (!_parent || !_keyword || !_value || _depth < 1 || _tokenPos < 0)
+		return false;
+	m_edits.Add(new SNM_ChunkEdit(SNM_EDIT_TOKEN, _parent, _keyword, _depth, _occurence, _tokenPos, _value));
+	return true;
+}
+
+bool SNM_ChunkTransaction::AddLineEdit(const char* _parent, const char* _keyword, int _depth, int _occurence, const char* _newLines)
+{
+	assert(_depth >= 1);
+	if (!_parent || !_keyword || _depth < 1)
+		return false;
+	m_edits.Add(new SNM_ChunkEdit(SNM_EDIT_LINE, _parent, _keyword, _depth, _occurence, 0, _newLines ? _newLines : ""));
+	return true;
+}
+
+void SNM_ChunkTransaction::AddSubChunkEdit(const char* _keyword, int _depth, int _occurence, const char* _newSubChunk)
+{
+	if (_keyword && _depth > 0) // min _depth==1, i.e. "<keyword .."
+	{
+		WDL_FastString startToken;
+		startToken.SetFormatted((int)strlen(_keyword)+2, "<%s", _keyword);
+		m_edits.Add(new SNM_ChunkEdit(SNM_EDIT_SUBCHUNK, _keyword, startToken.Get(), _depth, _occurence, 0, _newSubChunk ? _newSubChunk : ""));
+	}
+}
+
+// applies all pending edits to the cached chunk in one go
+// returns the number of updates
+int SNM_ChunkTransaction::Apply()
+{
+	int updates = 0;
+	if (m_edits.GetSize())
+	{
+		m_removedParent = NULL;
+		updates = ParsePatch(-1);
+		m_edits.Empty(true);
+	}
+	return updates;
+}
+
+bool SNM_ChunkTransaction::Commit(bool _force)
+{
+	Apply();
+	if (SNM_ChunkParserPatcher::Commit(_force))
+	{
+		if (m_target)
+			m_target->IncUpdates();
+		return true;
+	}
+	return false;
+}
+
+bool SNM_ChunkTransaction::NotifyStartElement(int _mode, 
+	LineParser* _lp, const char* _parsedLine, int _linePos,
+	WDL_PtrList<WDL_FastString>* _parsedParents, 
+	WDL_FastString* _newChunk, int _updates)
+{
+	return (_mode == -1 && m_removedParent); // do not recopy removed sub-chunks
+}
+
+bool SNM_ChunkTransaction::NotifyEndElement(int _mode, 
+	LineParser* _lp, const char* _parsedLine, int _linePos,
+	WDL_PtrList<WDL_FastString>* _parsedParents, 
+	WDL_FastString* _newChunk, int _updates)
+{
+	if (_mode == -1 && m_removedParent)
+	{
+		if (_parsedParents->Get(_parsedParents->GetSize()-1) == m_removedParent)
+			m_removedParent = NULL; // end of removed sub-chunk (its '>' is not recopied either)
+		return true;
+	}
+	return false;
+}
+
+bool SNM_ChunkTransaction::NotifySkippedSubChunk(int _mode, 
+	const char* _subChunk, int _subChunkLength, int _subChunkPos,
+	WDL_PtrList<WDL_FastString>* _parsedParents, 
+	WDL_FastString* _newChunk, int _updates)
+{
+	return (_mode == -1 && m_removedParent);
+}
+
+bool SNM_ChunkTransaction::NotifyChunkLine(int _mode, 
+	LineParser* _lp, const char* _parsedLine, int _linePos,
+	int _parsedOccurence, WDL_PtrList<WDL_FastString>* _parsedParents, 
+	WDL_FastString* _newChunk, int _updates)
+{
+	if (_mode != -1)
+		return false;
+
+	const char* keyword = _lp->gettoken_str(0);
+	const char* parent = GetParent(_parsedParents);
+	int depth = _parsedParents->GetSize();
+	bool removed = (m_removedParent != NULL);
+
+	// occurrences are counted for all edits, even in removed sub-chunks
+	SNM_ChunkEdit* replace = NULL;
+	WDL_PtrList<SNM_ChunkEdit> tokenEdits;
+	bool pending = false;
+	for (int i=0; i < m_edits.GetSize(); i++)
+	{
+		SNM_ChunkEdit* e = m_edits.Get(i);
+		if (e->m_depth == depth && !strcmp(e->m_keyword.Get(), keyword) && !strcmp(e->m_parent.Get(), parent))
+		{
+			if (e->m_occurence == -1 || e->m_occurence == e->m_parsed)
+			{
+				if (e->m_type == SNM_EDIT_TOKEN) tokenEdits.Add(e);
+				else if (!replace) replace = e;
+			}
+			e->m_parsed++;
+		}
+		pending |= (e->m_occurence == -1 || e->m_parsed <= e->m_occurence);
+	}
+
+	bool update = removed;
+	if (!removed && replace)
+	{
+		_newChunk->Append(replace->m_value.Get());
+		if (replace->m_type == SNM_EDIT_SUBCHUNK)
+			m_removedParent = _parsedParents->Get(depth-1);
+		update = true;
+	}
+	else if (!removed && tokenEdits.GetSize())
+	{
+		// all token edits of this line at once
+		int numtokens = _lp->getnumtokens();
+		WDL_PtrList<const char> tokens;
+		for (int i=0; i < numtokens; i++)
+			tokens.Add(_lp->gettoken_str(i));
+		for (int i=0; i < tokenEdits.GetSize(); i++)
+		{
+			SNM_ChunkEdit* e = tokenEdits.Get(i);
+			if (e->m_tokenPos < numtokens && strcmp(tokens.Get(e->m_tokenPos), e->m_value.Get()))
+			{
+				tokens.Delete(e->m_tokenPos);
+				tokens.Insert(e->m_tokenPos, e->m_value.Get());
+				update = true;
+			}
+		}
+		if (update)
+			for (int i=0; i < numtokens; i++)
+			{
+				_newChunk->Append(tokens.Get(i));
+				_newChunk->Append(i == (numtokens-1) ? "\n" : " ");
+			}
+	}
+
+	// all done? bulk recopy of the remaining lines
+	if (!pending && !m_removedParent)
+		m_breakParsePatch = true;
+
+	return update;
+}
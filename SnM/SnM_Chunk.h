@@ -383,4 +383,71 @@ private:
 	int m_val;
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// SNM_ChunkTransaction
+// Collects several edits (tokens, lines, sub-chunks) and applies them all in 
+// a single ParsePatch() pass, instead of one pass + chunk re-copy per edit.
+// Attached to a reaThing* (one state get/set for all edits) or to another
+// SNM_ChunkParserPatcher (edits its cached chunk, which is committed as usual)
+// Notes: 
+// - edits match lines like ParsePatch() does (depth, parent, keyword), 
+//   occurrences are 0-based (-1: all) and refer to the chunk as it was 
+//   before the transaction
+// - a line replaced/removed by an edit ignores token edits
+// - when attached to a SNM_ChunkParserPatcher, keep the transaction short-
+//   lived: it must be committed before that patcher parses/patches again
+///////////////////////////////////////////////////////////////////////////////
+
+class SNM_ChunkEdit {
+public:
+	SNM_ChunkEdit(int _type, const char* _parent, const char* _keyword, int _depth, int _occurence, int _tokenPos, const char* _value)
+		: m_type(_type),m_parent(_parent),m_keyword(_keyword),m_depth(_depth),m_occurence(_occurence),m_tokenPos(_tokenPos),m_value(_value),m_parsed(0) {}
+	int m_type, m_depth, m_occurence, m_tokenPos, m_parsed;
+	WDL_FastString m_parent, m_keyword, m_value;
+};
+
+class SNM_ChunkTransaction : public SNM_ChunkParserPatcher
+{
+public:
+	SNM_ChunkTransaction(void* _reaObject, bool _autoCommit = true)
+		: SNM_ChunkParserPatcher(_reaObject, _autoCommit) {m_target = NULL; m_removedParent = NULL;}
+	SNM_ChunkTransaction(SNM_ChunkParserPatcher* _target, bool _autoCommit = true)
+		: SNM_ChunkParserPatcher(_target->GetChunk(), _autoCommit) {m_target = _target; m_removedParent = NULL;}
+	// see SNM_TakeParserPatcher: the destructor has to call its own Commit()
+	~SNM_ChunkTransaction() {
+		if (m_autoCommit)
+			Commit();
+	}
+	// same as ParsePatch(SNM_SET_CHUNK_CHAR, ...), returns false if rejected (min _depth==1)
+	bool AddTokenEdit(const char* _parent, const char* _keyword, int _depth, int _occurence, int _tokenPos, const char* _value);
+	// same as ReplaceLine()/RemoveLine() ("" removes lines), returns false if rejected (min _depth==1)
+	bool AddLineEdit(const char* _parent, const char* _keyword, int _depth, int _occurence, const char* _newLines = "");
+	// same as ReplaceSubChunk()/RemoveSubChunk() ("" removes sub-chunks)
+	void AddSubChunkEdit(const char* _keyword, int _depth, int _occurence, const char* _newSubChunk = "");
+	int CountEdits() { return m_edits.GetSize(); }
+	int Apply();
+	bool Commit(bool _force = false);
+protected:
+	bool NotifyStartElement(int _mode, 
+		LineParser* _lp, const char* _parsedLine, int _linePos,
+		WDL_PtrList<WDL_FastString>* _parsedParents, 
+		WDL_FastString* _newChunk, int _updates);
+	bool NotifyEndElement(int _mode, 
+		LineParser* _lp, const char* _parsedLine, int _linePos,
+		WDL_PtrList<WDL_FastString>* _parsedParents, 
+		WDL_FastString* _newChunk, int _updates);
+	bool NotifyChunkLine(int _mode, 
+		LineParser* _lp, const char* _parsedLine, int _linePos,
+		int _parsedOccurence, WDL_PtrList<WDL_FastString>* _parsedParents,
+		WDL_FastString* _newChunk, int _updates);
+	bool NotifySkippedSubChunk(int _mode, 
+		const char* _subChunk, int _subChunkLength, int _subChunkPos,
+		WDL_PtrList<WDL_FastString>* _parsedParents, 
+		WDL_FastString* _newChunk, int _updates);
+private:
+	SNM_ChunkParserPatcher* m_target;
+	WDL_PtrList_DeleteOnDestroy<SNM_ChunkEdit> m_edits;
+	WDL_FastString* m_removedParent; // sub-chunk being replaced/removed
+};
+
 #endif
\ No newline at end of file
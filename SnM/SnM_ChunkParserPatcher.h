@@ -1,5 +1,5 @@
 /******************************************************************************
-/ SnM_ChunkParserPatcher.h - v1.34
+/ SnM_ChunkParserPatcher.h - v1.35
 / Copyright (c) 2008-2013 Jeffos
 /
 / Permission is hereby granted, free of charge, to any person obtaining a copy
@@ -42,6 +42,9 @@
 // Important: 
 // - Chunks can be HUGE! e.g. 4Mb+ is an usual case
 // - The code assumes RPP chunks are consistent, left trimmed, with Unix EOL
+// - Read-only queries (see ParseIndexed()) are answered from a structural
+//   index of the cached chunk, built on the 2nd query against the same chunk
+//   and kept until the chunk changes
 // - A v2.0 with major refactoring is on the way..
 
 
@@ -137,6 +140,8 @@ SNM_ChunkParserPatcher(void* _reaObject, bool _autoCommit=true,
 	m_processInProjectMIDI = _processInProjectMIDI;
 	m_processFreeze = _processFreeze;
 	m_minimalState = false;
+	m_useIndex = true;
+	InvalidateIndex();
 }
 
 // when attached to a WDL_FastString* (simple text chunk parser/patcher)
@@ -157,6 +162,8 @@ SNM_ChunkParserPatcher(WDL_FastString* _chunk, bool _autoCommit=true,
 	m_processInProjectMIDI = _processInProjectMIDI;
 	m_processFreeze = _processFreeze;
 	m_minimalState = false;
+	m_useIndex = true;
+	InvalidateIndex();
 }
 
 virtual ~SNM_ChunkParserPatcher() 
@@ -232,6 +239,7 @@ virtual WDL_FastString* GetChunk()
 void SetChunk(const char* _newChunk, int _updates=1) {
 	m_updates = _updates;
 	GetChunk()->Set(_newChunk ? _newChunk : "");
+	InvalidateIndex();
 }
 
 int GetUpdates() {
@@ -240,11 +248,13 @@ int GetUpdates() {
 
 int IncUpdates() {
 	m_updates++;
+	InvalidateIndex();
 	return m_updates; // for facility
 }
 
 int SetUpdates(int _updates) {
 	m_updates = _updates;
+	InvalidateIndex();
 	return m_updates; // for facility
 }
 
@@ -272,7 +282,7 @@ virtual bool Commit(bool _force = false)
 }
 
 const char* GetInfo() {
-	return "SNM_ChunkParserPatcher - v1.34";
+	return "SNM_ChunkParserPatcher - v1.35";
 }
 
 void SetProcessBase64(bool _enable) {
@@ -356,6 +366,7 @@ bool ReplaceLine(int _pos, const char* _str = NULL)
 			if (_str && *_str)
 				m_chunk->Insert(_str, _pos);
 			m_updates++;
+			InvalidateIndex();
 			return true;
 		}
 	}
@@ -398,6 +409,7 @@ bool InsertAfterBefore(int _dir, const char* _str, const char* _parent, const ch
 		if (pos >= 0) {
 			m_chunk->Insert(_str, pos);
 			m_updates++;
+			InvalidateIndex();
 			return true;
 		}
 	}
@@ -467,6 +479,18 @@ protected:
 	// can be enabled to break parsing (+ bulk recopy when patching)
 	bool m_breakParsePatch;
 
+	// read-only queries with standard modes are answered from the structural
+	// index: Notify*Element() and NotifyChunkLine() are not triggered for them
+	// => inherited parsers that need those callbacks for standard modes must
+	//    disable this (none does ATM: they all use custom modes, i.e. <0)
+	bool m_useIndex;
+
+// to be called when altering the cached chunk directly without updating m_updates
+void InvalidateIndex() {
+	m_indexChunk = NULL;
+	m_indexBuilt = false;
+}
+
 
 const char* SNM_GetSetObjectState(void* _obj, WDL_FastString* _str)
 {
@@ -561,6 +585,294 @@ virtual bool NotifySkippedSubChunk(int _mode,
 ///////////////////////////////////////////////////////////////////////////////
 private:
 
+///////////////////////////////////////////////////////////////////////////////
+// Structural index of the cached chunk
+// One entry per parsed line (zapped lines excluded) or skipped sub-chunk, in
+// chunk order. Depth and parent are the ones ParsePatchCore() matches lines
+// against, i.e. a "<KEYWORD" line is its own parent and a ">" line belongs
+// to its grand-parent. Entries sharing a keyword hash are chained so that
+// queries only visit lines starting with the searched keyword.
+///////////////////////////////////////////////////////////////////////////////
+
+struct IndexEntry {
+	int pos, len;     // line (without '\n') or skipped sub-chunk in m_chunk
+	int depth;        // parents count
+	int parent;       // entry of the parent "<KEYWORD" line, -1 if none
+	int close;        // for "<KEYWORD" lines: entry of the matching ">", -1 if none
+	int keyword;      // offset in m_indexKeywords, -1 for skipped sub-chunks
+	int next;         // next entry with the same keyword hash, -1 if none
+};
+
+WDL_TypedBuf<IndexEntry> m_index;
+WDL_TypedBuf<char> m_indexKeywords;
+WDL_IntKeyedArray<int> m_indexFirst; // keyword hash -> 1st entry
+const WDL_FastString* m_indexChunk;
+const char* m_indexBuf;
+int m_indexLen, m_indexUpdates;
+bool m_indexBase64, m_indexInProjectMIDI, m_indexFreeze;
+bool m_indexBuilt; // false: the chunk has been queried once, not indexed yet
+
+static int HashKeyword(const char* _keyword) {
+	unsigned int h = 2166136261u; // FNV-1a
+	while (*_keyword) { h ^= (unsigned char)*_keyword++; h *= 16777619u; }
+	return (int)h;
+}
+
+const char* GetIndexKeyword(int _entry) {
+	return m_indexKeywords.Get() + m_index.Get()[_entry].keyword;
+}
+
+bool IsIndexValid() {
+	return m_indexChunk == m_chunk && m_indexBuf == m_chunk->Get() && 
+		m_indexLen == m_chunk->GetLength() && m_indexUpdates == m_updates &&
+		m_indexBase64 == m_processBase64 && m_indexInProjectMIDI == m_processInProjectMIDI && m_indexFreeze == m_processFreeze;
+}
+
+// remembers the chunk IsIndexValid() checks against
+void StampIndex(bool _built)
+{
+	m_indexChunk = m_chunk;
+	m_indexBuf = m_chunk->Get();
+	m_indexLen = m_chunk->GetLength();
+	m_indexUpdates = m_updates;
+	m_indexBase64 = m_processBase64;
+	m_indexInProjectMIDI = m_processInProjectMIDI;
+	m_indexFreeze = m_processFreeze;
+	m_indexBuilt = _built;
+}
+
+int AddIndexEntry(int _pos, int _len, int _depth, int _parent, const char* _keyword, WDL_IntKeyedArray<int>* _last)
+{
+	int i = m_index.GetSize();
+	IndexEntry* e = m_index.Resize(i+1) + i;
+	e->pos = _pos;
+	e->len = _len;
+	e->depth = _depth;
+	e->parent = _parent;
+	e->close = -1;
+	e->keyword = -1;
+	e->next = -1;
+	if (_keyword)
+	{
+		int kwLen = (int)strlen(_keyword)+1, kwPos = m_indexKeywords.GetSize();
+		memcpy(m_indexKeywords.Resize(kwPos+kwLen)+kwPos, _keyword, kwLen);
+		m_index.Get()[i].keyword = kwPos;
+
+		int h = HashKeyword(_keyword), last = _last->Get(h, -1);
+		if (last >= 0) m_index.Get()[last].next = i;
+		else m_indexFirst.Insert(h, i);
+		_last->Insert(h, i);
+	}
+	return i;
+}
+
+// same walk (skipped data, zapped lines, depth) as ParsePatchCore(), nothing copied but keywords
+void BuildIndex()
+{
+	m_index.Resize(0, false);
+	m_indexKeywords.Resize(0, false);
+	m_indexFirst.DeleteAll();
+
+	const char* cData = m_chunk->Get();
+	LineParser lp(false);
+	char curLine[SNM_MAX_CHUNK_LINE_LENGTH] = "";
+	WDL_TypedBuf<int> parents;
+	WDL_IntKeyedArray<int> last;
+	const char* pEOL = cData-1, *keyword, *pLine, *pEOSkippedChunk;
+	int curLineLen, depth;
+	bool parsingSource = false;
+	for(;;)
+	{
+		pLine = pEOL+1;
+		pEOL = strchr(pLine, '\n');
+		if (!pEOL)
+			break;
+		curLineLen = (int)(pEOL-pLine);
+		depth = parents.GetSize();
+
+		pEOSkippedChunk = NULL;
+		if (!m_processBase64 &&
+			curLineLen>2 && *(pEOL-1)=='=' && *(pEOL-2)=='=')
+		{
+			pEOSkippedChunk = strstr(pLine, ">\n");
+		}
+		else if (!m_processInProjectMIDI && parsingSource && (
+			(curLineLen>2 && !_strnicmp(pLine, "E ", 2)) ||
+			(curLineLen>3 && !_strnicmp(pLine, "Em ", 3))))
+		{
+			pEOSkippedChunk = strstr(pLine, "GUID {");
+		}
+		else if (!m_processFreeze && depth==1 && 
+			curLineLen>8 && !strncmp(pLine, "<FREEZE ", 8))
+		{
+			int skippedLen = FindEndOfSubChunk(pLine, 0);
+			while (skippedLen >= 0)
+			{
+				pEOSkippedChunk = (char*)(pLine+skippedLen);
+				if (!strncmp(pEOSkippedChunk, "<FREEZE ", 8))
+					skippedLen = FindEndOfSubChunk(pLine, skippedLen);
+				else
+					skippedLen = -1;
+			}
+		}
+
+		if (pEOSkippedChunk) 
+		{
+			AddIndexEntry((int)(pLine-cData), (int)(pEOSkippedChunk-pLine), depth, depth ? parents.Get()[depth-1] : -1, NULL, &last);
+			pLine = pEOSkippedChunk;
+			pEOL = strchr(pEOSkippedChunk, '\n');
+			curLineLen = (int)(pEOL-pLine);
+		}
+
+		memcpy(curLine, pLine, curLineLen >= SNM_MAX_CHUNK_LINE_LENGTH ? SNM_MAX_CHUNK_LINE_LENGTH-1 : curLineLen);
+		curLine[curLineLen >= SNM_MAX_CHUNK_LINE_LENGTH ? SNM_MAX_CHUNK_LINE_LENGTH-1 : curLineLen] = '\0';
+		if (lp.parse(curLine) || !lp.getnumtokens())
+			continue;
+		keyword = lp.gettoken_str(0);
+		if (!*keyword)
+			continue;
+
+		if (*keyword == '<')
+		{
+			parsingSource |= (lp.getnumtokens()==2 && curLineLen>9 && !strcmp(keyword+1, "SOURCE"));
+			int i = m_index.GetSize();
+			parents.Resize(depth+1);
+			parents.Get()[depth] = i;
+			AddIndexEntry((int)(pLine-cData), curLineLen, depth+1, i, keyword, &last);
+		}
+		else if (*keyword == '>' && depth)
+		{
+			int closed = parents.Get()[depth-1];
+			if (parsingSource) 
+				parsingSource = !!strcmp(GetIndexKeyword(closed)+1, "SOURCE");
+			parents.Resize(depth-1);
+			int close = AddIndexEntry((int)(pLine-cData), curLineLen, depth-1, depth>1 ? parents.Get()[depth-2] : -1, keyword, &last);
+			m_index.Get()[closed].close = close;
+		}
+		else
+			AddIndexEntry((int)(pLine-cData), curLineLen, depth, depth ? parents.Get()[depth-1] : -1, keyword, &last);
+	}
+
+	StampIndex(true);
+}
+
+// a line as ParsePatchCore() sees it (trimmed if too long)
+void AppendIndexEntry(WDL_FastString* _str, int _entry)
+{
+	const IndexEntry* e = m_index.Get()+_entry;
+	if (e->keyword < 0) // skipped sub-chunk, recopied as it is
+		_str->Insert(m_chunk->Get()+e->pos, _str->GetLength(), e->len);
+	else {
+		_str->Insert(m_chunk->Get()+e->pos, _str->GetLength(), e->len >= SNM_MAX_CHUNK_LINE_LENGTH ? SNM_MAX_CHUNK_LINE_LENGTH-1 : e->len);
+		_str->Append("\n");
+	}
+}
+
+bool IsIndexedStrictMatch(int _entry, int _depth, const char* _expectedParent, const char* _keyWord)
+{
+	const IndexEntry* e = m_index.Get()+_entry;
+	return (e->depth == _depth && e->parent >= 0 &&
+		!strcmp(GetIndexKeyword(e->parent)+1, _expectedParent) && !strcmp(GetIndexKeyword(_entry), _keyWord));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ParseIndexed()
+// Same results as ParsePatchCore() for read-only SNM_GET_CHUNK_CHAR, 
+// SNM_GET_SUBCHUNK_OR_LINE(_EOL) and SNM_COUNT_KEYWORD queries with depth,
+// parent and keyword provided. Only lines starting with the searched keyword
+// (and the break keyword) are visited, and the chunk is not copied.
+// Only called for chunks that have already been queried (see ParsePatchCore())
+///////////////////////////////////////////////////////////////////////////////
+
+int ParseIndexed(int _mode, int _depth, const char* _expectedParent, const char* _keyWord, 
+	int _occurence, int _tokenPos, void* _value, const char* _breakKeyword)
+{
+	if (!m_indexBuilt)
+		BuildIndex();
+
+	NotifyStartChunk(_mode);
+
+	// the 1st breaking keyword that isn't a match (lines with no parent are not checked)
+	int breakAt = m_index.GetSize();
+	if (_breakKeyword)
+		for (int i=m_indexFirst.Get(HashKeyword(_breakKeyword), -1); i >= 0; i=m_index.Get()[i].next)
+			if (m_index.Get()[i].depth && !strcmp(GetIndexKeyword(i), _breakKeyword) && !IsIndexedStrictMatch(i, _depth, _expectedParent, _keyWord)) {
+				breakAt = i;
+				break;
+			}
+
+	int found = -1, occurence = 0;
+	for (int i=m_indexFirst.Get(HashKeyword(_keyWord), -1); i >= 0 && i < breakAt; i=m_index.Get()[i].next)
+	{
+		if (IsIndexedStrictMatch(i, _depth, _expectedParent, _keyWord))
+		{
+			if (_mode != SNM_COUNT_KEYWORD && (_occurence == occurence || _occurence == -1)) {
+				found = i;
+				break;
+			}
+			occurence++;
+		}
+	}
+
+	if (found >= 0)
+	{
+		const char* cData = m_chunk->Get();
+		const IndexEntry* e = m_index.Get()+found;
+		switch (_mode)
+		{
+			case SNM_GET_CHUNK_CHAR:
+			{
+				if (_value)
+				{
+					char curLine[SNM_MAX_CHUNK_LINE_LENGTH] = "";
+					LineParser lp(false);
+					lstrcpyn(curLine, cData+e->pos, e->len >= SNM_MAX_CHUNK_LINE_LENGTH ? SNM_MAX_CHUNK_LINE_LENGTH : e->len+1);
+					lp.parse(curLine);
+					strcpy((char*)_value, lp.gettoken_str(_tokenPos));
+				}
+				const char* p = strstr(cData+e->pos, _keyWord);
+				return (p ? ((int)(p-cData+1)) : -1); 
+			}
+			case SNM_GET_SUBCHUNK_OR_LINE:
+			case SNM_GET_SUBCHUNK_OR_LINE_EOL:
+			{
+				if (_value)
+					AppendIndexEntry((WDL_FastString*)_value, found);
+				const char* pSub = strstr(cData+e->pos, _keyWord);
+				int posStartOfSubchunk = (pSub ? ((int)(pSub-cData+1)) : -1);
+				if (*_keyWord != '<' || (_mode == SNM_GET_SUBCHUNK_OR_LINE && !_value))
+					return (_mode == SNM_GET_SUBCHUNK_OR_LINE ? posStartOfSubchunk : e->pos+e->len+1);
+
+				// whole sub-chunk (or up to the end of the chunk if not closed, i.e. not found)
+				int end = e->close >= 0 ? e->close : m_index.GetSize();
+				if (_value)
+					for (int i=found+1; i < end; i++)
+						AppendIndexEntry((WDL_FastString*)_value, i);
+				if (e->close >= 0)
+				{
+					if (_value) 
+						((WDL_FastString*)_value)->Append(">\n",2);
+					const IndexEntry* eoc = m_index.Get()+e->close;
+					return (_mode == SNM_GET_SUBCHUNK_OR_LINE ? posStartOfSubchunk : eoc->pos+eoc->len+1);
+				}
+			}
+			break;
+		}
+	}
+
+	NotifyEndChunk(_mode);
+	return (_mode == SNM_COUNT_KEYWORD ? occurence : 0);
+}
+
+// recopies unaltered data of the original chunk (from *_copyFrom up to _end) 
+// at _newPos in the chunk being built, i.e. before what has been added since
+void SpliceUnaltered(WDL_FastString* _newChunk, const char* _cData, int* _copyFrom, int _end, int _newPos)
+{
+	if (_end > *_copyFrom)
+		_newChunk->Insert(_cData+*_copyFrom, _newPos, _end-*_copyFrom);
+	*_copyFrom = _end;
+}
+
 // just to avoid duplicate strcmp() calls in ParsePatchCore()
 void IsMatchingParsedLine(bool* _tolerantMatch, bool* _strictMatch, 
 		int _expectedDepth, int _parsedDepth,
@@ -638,12 +950,25 @@ int ParsePatchCore(
 	if (!cData)
 		return -1;
 
+	// read-only lookups: the 1st one against a chunk is a plain parse (which can
+	// stop early), the structural index is only worth building when the same
+	// chunk gets queried again
+	if (!_write && m_useIndex && !m_breakParsePatch && _depth > 0 && _expectedParent && _keyWord &&
+		(_mode == SNM_GET_CHUNK_CHAR || _mode == SNM_GET_SUBCHUNK_OR_LINE || _mode == SNM_GET_SUBCHUNK_OR_LINE_EOL || _mode == SNM_COUNT_KEYWORD))
+	{
+		if (IsIndexValid())
+			return ParseIndexed(_mode, _depth, _expectedParent, _keyWord, _occurence, _tokenPos, _value, _breakKeyword);
+		StampIndex(false);
+	}
+
 	NotifyStartChunk(_mode);
 
+	// when patching, unaltered lines are not recopied one by one: they are 
+	// spliced in bulk (from copyFrom) when an altered line is encountered
 	LineParser lp(false);
 	WDL_FastString* newChunk = _write ? new WDL_FastString(SNM_HEAPBUF_GRANUL) : NULL; 
 	char curLine[SNM_MAX_CHUNK_LINE_LENGTH] = "";
-	int updates = 0, occurence = 0, posStartOfSubchunk = -1, linePos, curLineLen;
+	int updates = 0, occurence = 0, posStartOfSubchunk = -1, linePos, curLineLen, newLen = 0, copyFrom = 0, copyTo = 0;
 	WDL_FastString* subChunkKeyword = NULL;
 	WDL_PtrList_DeleteOnDestroy<WDL_FastString> parents;
 	const char* pEOL = cData-1, *keyword, *pLine, *pEOSkippedChunk;
@@ -655,14 +980,14 @@ int ParsePatchCore(
 		pLine = pEOL+1;
 		pEOL = strchr(pLine, '\n');
 
-		// break conditions
+		// break conditions (note: trailing data with no EOL is not recopied)
+		copyTo = (int)(pLine-cData);
 		if (!pEOL)
 			break;
 
 		if (m_breakParsePatch)
 		{
-			if (_write)
-				newChunk->Append(pLine);
+			copyTo += (int)strlen(pLine);
 			break;
 		}
 
@@ -703,10 +1028,14 @@ int ParsePatchCore(
 		
 		if (pEOSkippedChunk) 
 		{
+			if (_write) newLen = newChunk->GetLength();
 			bool alter = NotifySkippedSubChunk(_mode, pLine, (int)(pEOSkippedChunk-pLine), (int)(pLine-cData), &parents, newChunk, updates);
 			alter |= (subChunkKeyword && _mode == SNM_REPLACE_SUBCHUNK_OR_LINE);
-			if (_write && !alter)
-				newChunk->Insert(pLine, newChunk->GetLength(), (int)(pEOSkippedChunk-pLine));
+			if (_write && (alter || newChunk->GetLength() != newLen))
+			{
+				SpliceUnaltered(newChunk, cData, &copyFrom, (int)(pLine-cData), newLen);
+				if (alter) copyFrom = (int)(pEOSkippedChunk-cData);
+			}
 			if ((_mode == SNM_GET_SUBCHUNK_OR_LINE || _mode == SNM_GET_SUBCHUNK_OR_LINE_EOL) && subChunkKeyword && _value)
 				((WDL_FastString*)_value)->Insert(pLine, ((WDL_FastString*)_value)->GetLength(), (int)(pEOSkippedChunk-pLine));
 
@@ -721,15 +1050,18 @@ int ParsePatchCore(
 		memcpy(curLine, pLine, curLineLen >= SNM_MAX_CHUNK_LINE_LENGTH ? SNM_MAX_CHUNK_LINE_LENGTH-1 : curLineLen);
 		curLine[curLineLen >= SNM_MAX_CHUNK_LINE_LENGTH ? SNM_MAX_CHUNK_LINE_LENGTH-1 : curLineLen] = '\0';
 		linePos = (int)(pLine-cData);
+		if (_write) newLen = newChunk->GetLength();
 
-		// zap this line?
-		if (lp.parse(curLine) || !lp.getnumtokens())
+		// zap this line? (not recopied)
+		if (lp.parse(curLine) || !lp.getnumtokens() || !*lp.gettoken_str(0))
+		{
+			if (_write) {
+				SpliceUnaltered(newChunk, cData, &copyFrom, linePos, newLen);
+				copyFrom = (int)(pEOL-cData+1);
+			}
 			continue;
-
-		// zap this line?
+		}
 		keyword = lp.gettoken_str(0);
-		if (!*keyword)
-			continue;
 
 		// sub chunk?
 		if (*keyword == '<')
@@ -930,16 +1262,19 @@ int ParsePatchCore(
 		}
 		updates += (_write && alter);
 
-		// copy current line only in RW mode & if it wasn't altered above
-		if (_write && !alter) {
-			newChunk->Append(curLine);
-			newChunk->Append("\n");
+		// current line is recopied later (in bulk) if it wasn't altered above,
+		// but what precedes it must be recopied now if something was added
+		if (_write && (alter || newChunk->GetLength() != newLen))
+		{
+			SpliceUnaltered(newChunk, cData, &copyFrom, linePos, newLen);
+			if (alter) copyFrom = (int)(pEOL-cData+1);
 		}
 	}
 
 	// update cache if needed
 	if (_write && newChunk)
 	{
+		SpliceUnaltered(newChunk, cData, &copyFrom, copyTo, newChunk->GetLength());
 		if (updates && newChunk->GetLength())
 		{
 			m_updates += updates;
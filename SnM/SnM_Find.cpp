@@ -70,59 +70,374 @@ bool g_notFound=false;
 
 
 ///////////////////////////////////////////////////////////////////////////////
+// FindIndexField
+///////////////////////////////////////////////////////////////////////////////
+
+// lower case ascii only, see stristr()
+static int Trigram(const char* _s) {
+	return (tolower((unsigned char)_s[0])<<16) | (tolower((unsigned char)_s[1])<<8) | tolower((unsigned char)_s[2]);
+}
 
-bool TakeNameMatch(MediaItem_Take* _tk, const char* _searchStr)
+void FindIndexField::Set(const void* _obj, const char* _str, int _gen)
 {
-	char* takeName = _tk ? (char*)GetSetMediaItemTakeInfo(_tk, "P_NAME", NULL) : NULL;
-	return (takeName && stristr(takeName, _searchStr));
+	if (!_str) _str = "";
+	int id = m_objs.Get((INT_PTR)_obj, -1);
+	if (Entry* e = m_entries.Get(id))
+	{
+		e->m_gen = _gen;
+		if (!strcmp(e->m_str.Get(), _str))
+			return; // unchanged
+		Kill(id);
+	}
+	if (!*_str)
+		return; // nothing to find
+
+	Entry* e = new Entry;
+	e->m_obj = _obj;
+	e->m_str.Set(_str);
+	e->m_gen = _gen;
+	m_entries.Add(e);
+	m_objs.Insert((INT_PTR)_obj, m_entries.GetSize()-1);
+	AddPostings(m_entries.GetSize()-1);
+	m_live++;
+	m_resultsOk = false;
+
+	// postings of removed entries are only cleared from time to time
+	if (m_entries.GetSize() > 2*m_live+1024)
+		Compact();
+}
+
+void FindIndexField::Remove(const void* _obj) {
+	Kill(m_objs.Get((INT_PTR)_obj, -1));
 }
 
-bool TakeFilenameMatch(MediaItem_Take* _tk, const char* _searchStr)
+// removes objects that were not updated during the generation _gen
+void FindIndexField::Purge(int _gen)
 {
-	bool match = false;
-	PCM_source* src = _tk ? (PCM_source*)GetSetMediaItemTakeInfo(_tk, "P_SOURCE", NULL) : NULL;
-	if (src) 
+	for (int i=0; i<m_entries.GetSize(); i++)
+		if (Entry* e = m_entries.Get(i))
+			if (e->m_gen != _gen)
+				Kill(i);
+}
+
+void FindIndexField::Empty()
+{
+	m_entries.Empty(true);
+	m_objs.DeleteAll();
+	m_postings.DeleteAll();
+	m_results.DeleteAll();
+	m_live = 0;
+	m_resultsOk = false;
+}
+
+void FindIndexField::AddPostings(int _id)
+{
+	Entry* e = m_entries.Get(_id);
+	const char* s = e ? e->m_str.Get() : "";
+	for (int i=0; s[i] && s[i+1] && s[i+2]; i++)
 	{
-		const char* takeFilename = src->GetFileName();
-		match = (takeFilename && strstr(takeFilename, _searchStr)); // no stristr: osx + utf-8
+		int tri = Trigram(s+i);
+		WDL_TypedBuf<int>* p = m_postings.Get(tri, NULL);
+		if (!p) {
+			p = new WDL_TypedBuf<int>;
+			m_postings.Insert(tri, p);
+		}
+		int sz = p->GetSize();
+		if (!sz || p->Get()[sz-1] != _id) // same trigram twice in s?
+			if (int* ids = p->ResizeOK(sz+1))
+				ids[sz] = _id;
 	}
-	return match;
 }
 
-bool ItemNotesMatch(MediaItem* _item, const char* _searchStr)
+void FindIndexField::Kill(int _id)
 {
-	bool match = false;
-	if (_item)
+	if (Entry* e = m_entries.Get(_id))
 	{
-		SNM_ChunkParserPatcher p(_item);
-		WDL_FastString notes;
-		if (p.GetSubChunk("NOTES", 2, 0, &notes, "VOLPAN") >= 0) // rmk: we use VOLPAN as it also exists for empty items
-			//JFB TODO? we compare a formated string with a normal one here, oh well..
-			match = (stristr(notes.Get(), _searchStr) != NULL);
+		m_objs.Delete((INT_PTR)e->m_obj);
+		m_entries.Set(_id, NULL);
+		delete e;
+		m_live--;
+		m_resultsOk = false;
 	}
-	return match;
 }
 
-bool TrackNameMatch(MediaTrack* _tr, const char* _searchStr) {
-	char* name = _tr ? (char*)GetSetMediaTrackInfo(_tr, "P_NAME", NULL) : NULL;
-	return (name && stristr(name, _searchStr));
+// renumbers live entries and rebuilds postings
+void FindIndexField::Compact()
+{
+	WDL_PtrList<Entry> entries;
+	for (int i=0; i<m_entries.GetSize(); i++)
+		if (Entry* e = m_entries.Get(i))
+			entries.Add(e);
+	m_entries.Empty(false);
+	m_objs.DeleteAll();
+	m_postings.DeleteAll();
+	for (int i=0; i<entries.GetSize(); i++)
+	{
+		m_entries.Add(entries.Get(i));
+		m_objs.Insert((INT_PTR)entries.Get(i)->m_obj, i);
+		AddPostings(i);
+	}
+	m_resultsOk = false;
 }
 
-bool TrackNotesMatch(MediaTrack* _tr, const char* _searchStr) 
+// returns the number of matching objects
+// candidates come from the shortest posting list of the search string's trigrams,
+// they are then checked like before indexing (strstr or stristr)
+int FindIndexField::Search(const char* _searchStr)
 {
-	bool match = false;
-	if (_tr)
+	if (!_searchStr) _searchStr = "";
+	if (m_resultsOk && !strcmp(m_lastSearch.Get(), _searchStr))
+		return m_results.GetSize();
+
+	m_results.DeleteAll();
+	m_lastSearch.Set(_searchStr);
+	m_resultsOk = true;
+	if (!*_searchStr)
+		return 0;
+
+	WDL_TypedBuf<int>* candidates = NULL;
+	for (int i=0; _searchStr[i] && _searchStr[i+1] && _searchStr[i+2]; i++)
 	{
-		for (int i=0; i < g_SNM_TrackNotes.Get()->GetSize(); i++)
+		WDL_TypedBuf<int>* p = m_postings.Get(Trigram(_searchStr+i), NULL);
+		if (!p)
+			return 0;
+		if (!candidates || p->GetSize() < candidates->GetSize())
+			candidates = p;
+	}
+
+	// search strings < 3 chars: check all entries (no API call, at least)
+	int nb = candidates ? candidates->GetSize() : m_entries.GetSize();
+	for (int i=0; i<nb; i++)
+		if (Entry* e = m_entries.Get(candidates ? candidates->Get()[i] : i))
+			if (m_caseSensitive ? strstr(e->m_str.Get(), _searchStr) != NULL : stristr(e->m_str.Get(), _searchStr) != NULL)
+				m_results.Insert((INT_PTR)e->m_obj, true);
+	return m_results.GetSize();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Search index
+// only the current search type is indexed, while the window is opened.
+// it is synced incrementally in the main thread, see FindIndexRun(): API 
+// calls are not thread-safe, but only strings of changed objects are 
+// re-indexed. Notifications (track list changes, track names, markers) 
+// and project changes (see GetProjectStateChangeCount(), undo points with 
+// older REAPER versions) flag the index as dirty: it is then synced in the 
+// background, as you type searches only sync one more step (results are 
+// refreshed once synced) but find actions perform a full sync first. 
+// There are no periodic resyncs: a synced index is only resynced once 
+// flagged as dirty.
+// Markers/regions are keyed by enum index (marker numbers can be shared), 
+// any marker/region update flags the index as dirty
+///////////////////////////////////////////////////////////////////////////////
+
+#define FIND_IDX_MAX_PER_RUN	1000	// max. number of objects synced per FindIndexRun() call
+
+FindIndexField g_findIdx;
+FindMarkerRegionListener g_findMkrRgnListener;
+int g_findIdxType = -1; // indexed search type
+int g_findIdxGen = 0;
+int g_findIdxPos = 0; // sync position (track, item, notes or marker index)
+int g_findIdxSubPos = 0; // item index on track g_findIdxPos
+bool g_findIdxOk = false; // full sync done since the last notification?
+bool g_findIdxSyncing = false;
+bool g_findIdxPartial = false; // as you type result shown from a partially synced index?
+int g_findIdxChangeCount = -1; // last project state change count seen
+WDL_FastString g_findIdxUndo; // last undo point seen (older REAPER versions)
+
+void FindIndexInvalidate()
+{
+	g_findIdxOk = false;
+	g_findIdxSyncing = false; // restart
+}
+
+void FindIndexSetType(int _type)
+{
+	if (_type == g_findIdxType)
+		return;
+	g_findIdx.Empty();
+	g_findIdx.SetCaseSensitive(_type==TYPE_ITEM_FILENAME || _type==TYPE_ITEM_FILENAME_ALL_TAKES); // no stristr: osx + utf-8
+	g_findIdxType = _type;
+	FindIndexInvalidate();
+
+	if (_type == TYPE_MARKER_REGION) RegisterToMarkerRegionUpdates(&g_findMkrRgnListener);
+	else UnregisterToMarkerRegionUpdates(&g_findMkrRgnListener);
+}
+
+// take names/filenames are joined with \n, never part of a search string
+void GetItemSearchString(MediaItem* _item, int _type, WDL_FastString* _str)
+{
+	_str->Set("");
+	if (_type == TYPE_ITEM_NOTES)
+	{
+		if (const char* notes = (const char*)GetSetMediaItemInfo(_item, "P_NOTES", NULL)) 
+			_str->Set(notes);
+		return;
+	}
+
+	bool allTakes = (_type==TYPE_ITEM_NAME_ALL_TAKES || _type==TYPE_ITEM_FILENAME_ALL_TAKES);
+	bool names = (_type==TYPE_ITEM_NAME || _type==TYPE_ITEM_NAME_ALL_TAKES);
+	MediaItem_Take* activeTk = GetActiveTake(_item);
+	int nbTakes = GetMediaItemNumTakes(_item);
+	for (int k=0; k < nbTakes; k++)
+	{
+		MediaItem_Take* tk = GetMediaItemTake(_item, k);
+		if (tk && (allTakes || tk == activeTk))
 		{
-			if (g_SNM_TrackNotes.Get()->Get(i)->GetTrack() == _tr)
+			const char* str = NULL;
+			if (names)
+				str = (const char*)GetSetMediaItemTakeInfo(tk, "P_NAME", NULL);
+			else if (PCM_source* src = (PCM_source*)GetSetMediaItemTakeInfo(tk, "P_SOURCE", NULL))
+				str = src->GetFileName();
+			if (str && *str) {
+				if (_str->GetLength()) _str->Append("\n");
+				_str->Append(str);
+			}
+		}
+	}
+}
+
+// syncs at most _max objects, returns true when a full sync pass is done
+bool FindIndexSync(int _max)
+{
+	if (!g_findIdxSyncing)
+	{
+		g_findIdxSyncing = true;
+		g_findIdxPos = g_findIdxSubPos = 0;
+		g_findIdxGen++;
+	}
+
+	WDL_FastString str;
+	int nb = 0;
+	bool done = false;
+	switch (g_findIdxType)
+	{
+		case TYPE_ITEM_NAME:
+		case TYPE_ITEM_NAME_ALL_TAKES:
+		case TYPE_ITEM_FILENAME:
+		case TYPE_ITEM_FILENAME_ALL_TAKES:
+		case TYPE_ITEM_NOTES:
+			while (nb < _max && g_findIdxPos < CountTracks(NULL))
 			{
-				match = (stristr(g_SNM_TrackNotes.Get()->Get(i)->m_notes.Get(), _searchStr) != NULL);
-				break;
+				MediaTrack* tr = GetTrack(NULL, g_findIdxPos);
+				int nbItems = tr ? GetTrackNumMediaItems(tr) : 0;
+				for (; nb < _max && g_findIdxSubPos < nbItems; g_findIdxSubPos++, nb++)
+					if (MediaItem* item = GetTrackMediaItem(tr, g_findIdxSubPos)) {
+						GetItemSearchString(item, g_findIdxType, &str);
+						g_findIdx.Set(item, str.Get(), g_findIdxGen);
+					}
+				if (g_findIdxSubPos >= nbItems) {
+					g_findIdxPos++;
+					g_findIdxSubPos = 0;
+				}
 			}
+			done = (g_findIdxPos >= CountTracks(NULL));
+			break;
+		case TYPE_TRACK_NAME:
+			for (; nb < _max && g_findIdxPos <= CountTracks(NULL); g_findIdxPos++, nb++)
+				if (MediaTrack* tr = CSurf_TrackFromID(g_findIdxPos, false))
+					g_findIdx.Set(tr, (const char*)GetSetMediaTrackInfo(tr, "P_NAME", NULL), g_findIdxGen);
+			done = (g_findIdxPos > CountTracks(NULL));
+			break;
+		case TYPE_TRACK_NOTES:
+			for (; nb < _max && g_findIdxPos < g_SNM_TrackNotes.Get()->GetSize(); g_findIdxPos++, nb++)
+				if (SNM_TrackNotes* notes = g_SNM_TrackNotes.Get()->Get(g_findIdxPos))
+					if (MediaTrack* tr = notes->GetTrack())
+						g_findIdx.Set(tr, notes->m_notes.Get(), g_findIdxGen);
+			done = (g_findIdxPos >= g_SNM_TrackNotes.Get()->GetSize());
+			break;
+		case TYPE_MARKER_REGION:
+		{
+			const char* name;
+			for (; nb < _max; g_findIdxPos++, nb++)
+			{
+				if (!EnumProjectMarkers2(NULL, g_findIdxPos, NULL, NULL, NULL, &name, NULL)) {
+					done = true;
+					break;
+				}
+				g_findIdx.Set((const void*)(INT_PTR)g_findIdxPos, name, g_findIdxGen);
+			}
+			break;
 		}
+		default:
+			done = true;
+			break;
 	}
-	return match;
+
+	if (done)
+	{
+		g_findIdx.Purge(g_findIdxGen); // deleted objects
+		g_findIdxSyncing = false;
+		g_findIdxOk = true;
+	}
+	return done;
+}
+
+// returns the number of objects matching the search string
+// _fullSync: full sync if needed, otherwise (as you type) one more sync step only
+int FindIndexSearch(int _type, const char* _searchStr, bool _fullSync)
+{
+	FindIndexSetType(_type);
+	if (!g_findIdxOk)
+	{
+		if (_fullSync) while (!FindIndexSync(FIND_IDX_MAX_PER_RUN)) {}
+		else FindIndexSync(FIND_IDX_MAX_PER_RUN);
+	}
+	g_findIdxPartial = !g_findIdxOk;
+	return g_findIdx.Search(_searchStr);
+}
+
+// called from the main thread via SNM_CSurfRun()
+void FindIndexRun()
+{
+	FindWnd* w = g_findWndMgr.Get();
+	if (!w || !w->IsValidWindow() || g_findIdxType<0)
+		return;
+
+	if (GetProjectStateChangeCount)
+	{
+		int cnt = GetProjectStateChangeCount(NULL);
+		if (cnt != g_findIdxChangeCount)
+		{
+			g_findIdxChangeCount = cnt;
+			FindIndexInvalidate();
+		}
+	}
+	else
+	{
+		// most edits create undo points (consecutive edits with the same name are missed)
+		const char* undo = Undo_CanUndo2(NULL);
+		if (strcmp(undo ? undo : "", g_findIdxUndo.Get()))
+		{
+			g_findIdxUndo.Set(undo ? undo : "");
+			FindIndexInvalidate();
+		}
+	}
+
+	if (g_findIdxSyncing || !g_findIdxOk)
+		if (FindIndexSync(FIND_IDX_MAX_PER_RUN) && g_findIdxPartial)
+		{
+			// refresh the as you type result now that the index is synced
+			g_findIdxPartial = false;
+			w->UpdateNotFoundMsg(!*g_searchStr || g_findIdx.Search(g_searchStr) > 0);
+		}
+}
+
+void FindSetTrackListChange() {
+	FindIndexInvalidate(); // incl. project switches
+}
+
+void FindSetTrackTitle() {
+	if (g_findIdxType == TYPE_TRACK_NAME)
+		FindIndexInvalidate();
+}
+
+// incremental update of marker/region names
+void FindMarkerRegionListener::NotifyMarkerRegionUpdate(int _updateFlags, SNM_MarkerRegionChanges* _changes)
+{
+	if (g_findIdxType != TYPE_MARKER_REGION)
+		return;
+	FindIndexInvalidate(); // enum indexes may have changed
 }
 
 
@@ -213,6 +528,7 @@ void FindWnd::OnDestroy()
 
 	m_cbType.Empty();
 	g_notFound = false;
+	FindIndexSetType(-1); // frees the index
 //	*g_searchStr = 0;
 }
 
@@ -223,7 +539,7 @@ void FindWnd::OnCommand(WPARAM wParam, LPARAM lParam)
 		case IDC_EDIT:
 			if (HIWORD(wParam)==EN_CHANGE) {
 				GetDlgItemText(m_hwnd, IDC_EDIT, g_searchStr, MAX_SEARCH_STR_LEN);
-				UpdateNotFoundMsg(true);
+				UpdateNotFoundMsg(!*g_searchStr || FindIndexSearch(m_type, g_searchStr, false) > 0); // as you type
 			}
 			break;
 		case BTNID_ZOOM_SCROLL_EN:
@@ -242,7 +558,7 @@ void FindWnd::OnCommand(WPARAM wParam, LPARAM lParam)
 		case CMBID_TYPE:
 			if (HIWORD(wParam)==CBN_SELCHANGE) {
 				m_type = m_cbType.GetCurSel();
-				UpdateNotFoundMsg(true); // + redraw
+				UpdateNotFoundMsg(!*g_searchStr || FindIndexSearch(m_type, g_searchStr, false) > 0); // + redraw
 				SetFocus(GetDlgItem(m_hwnd, IDC_EDIT));
 			}
 			break;
@@ -355,25 +671,15 @@ bool FindWnd::Find(int _mode)
 	switch(m_type)
 	{
 		case TYPE_ITEM_NAME:
-			update = FindMediaItem(_mode, false, TakeNameMatch);
-		break;
 		case TYPE_ITEM_NAME_ALL_TAKES:
-			update = FindMediaItem(_mode, true, TakeNameMatch);
-		break;
 		case TYPE_ITEM_FILENAME:
-			update = FindMediaItem(_mode, false, TakeFilenameMatch);
-		break;
 		case TYPE_ITEM_FILENAME_ALL_TAKES:
-			update = FindMediaItem(_mode, true, TakeFilenameMatch);
-		break;
 		case TYPE_ITEM_NOTES:
-			update = FindMediaItem(_mode, false, NULL, ItemNotesMatch);
+			update = FindMediaItem(_mode);
 		break;
 		case TYPE_TRACK_NAME:
-			update = FindTrack(_mode, TrackNameMatch);
-		break;
 		case TYPE_TRACK_NOTES:
-			update = FindTrack(_mode, TrackNotesMatch);
+			update = FindTrack(_mode);
 		break;
 		case TYPE_MARKER_REGION:
 			update = FindMarkerRegion(_mode);
@@ -414,12 +720,15 @@ MediaItem* FindWnd::FindPrevNextItem(int _dir, MediaItem* _item)
 	return previous;
 }
 
-// param _allTakes only makes sense if jobTake() is used
-bool FindWnd::FindMediaItem(int _dir, bool _allTakes, bool (*jobTake)(MediaItem_Take*,const char*), bool (*jobItem)(MediaItem*,const char*))
+// the search index provides matching items, walking tracks/items is only 
+// needed to get them in project order
+bool FindWnd::FindMediaItem(int _dir)
 {
 	bool update = false, found = false, sel = true;
 	if (g_searchStr && *g_searchStr)
 	{
+		bool anyMatch = (FindIndexSearch(m_type, g_searchStr, true) > 0);
+
 		MediaItem* startItem = NULL;
 		bool clearCurrentSelection = false;
 		if (_dir)
@@ -450,7 +759,7 @@ bool FindWnd::FindMediaItem(int _dir, bool _allTakes, bool (*jobTake)(MediaItem_
 		MediaItem* item = NULL;
 		MediaTrack* startTr = startItem ? GetMediaItem_Track(startItem) : NULL;
 		int startTrIdx = startTr ? CSurf_TrackToID(startTr, false) : -1;
-		if (startTr && startItem && startTrIdx>=0)
+		if (anyMatch && startTr && startItem && startTrIdx>=0)
 		{
 			// find startItem idx
 			int startItemIdx=-1;
@@ -469,38 +778,12 @@ bool FindWnd::FindMediaItem(int _dir, bool _allTakes, bool (*jobTake)(MediaItem_
 					item = GetTrackMediaItem(tr,j);
 					firstItem = false;
 
-					// search at item level 
-					if (jobItem)
+					if (item && g_findIdx.Match(item, g_searchStr))
 					{
-						if (jobItem(item, g_searchStr))
-						{
-							if (!update) Undo_BeginBlock2(NULL);
-							update = found = true;
-							GetSetMediaItemInfo(item, "B_UISEL", &sel);
-							if (_dir) breakSelection = true;
-						}
-					}
-					// search at take level 
-					else if (jobTake)
-					{
-						int nbTakes = GetMediaItemNumTakes(item);
-						for (int k=0; item && k < nbTakes; k++)
-						{
-							MediaItem_Take* tk = GetMediaItemTake(item, k);
-							if (tk && (_allTakes || (!_allTakes && tk == GetActiveTake(item))))
-							{
-								if (jobTake(tk, g_searchStr))
-								{
-									if (!update) Undo_BeginBlock2(NULL);
-									update = found = true;
-									GetSetMediaItemInfo(item, "B_UISEL", &sel);
-									if (_dir) {
-										breakSelection = true;
-										break;
-									}
-								}
-							}
-						}
+						if (!update) Undo_BeginBlock2(NULL);
+						update = found = true;
+						GetSetMediaItemInfo(item, "B_UISEL", &sel);
+						if (_dir) breakSelection = true;
 					}
 				}
 			}
@@ -519,11 +802,13 @@ bool FindWnd::FindMediaItem(int _dir, bool _allTakes, bool (*jobTake)(MediaItem_
 	return update;
 }
 
-bool FindWnd::FindTrack(int _dir, bool (*job)(MediaTrack*,const char*))
+bool FindWnd::FindTrack(int _dir)
 {
 	bool update = false, found = false;
 	if (g_searchStr && *g_searchStr)
 	{
+		bool anyMatch = (FindIndexSearch(m_type, g_searchStr, true) > 0);
+
 		int startTrIdx = -1;
 		bool clearCurrentSelection = false;
 		if (_dir)
@@ -556,12 +841,12 @@ bool FindWnd::FindTrack(int _dir, bool (*job)(MediaTrack*,const char*))
 			update = true;
 		}
 
-		if (startTrIdx >= 0)
+		if (anyMatch && startTrIdx >= 0)
 		{
 			for (int i = startTrIdx; i <= CountTracks(NULL) && i>=0; i += (!_dir ? 1 : _dir))
 			{
 				MediaTrack* tr = CSurf_TrackFromID(i, false); 
-				if (tr && job(tr, g_searchStr))
+				if (tr && g_findIdx.Match(tr, g_searchStr))
 				{
 					if (!update)
 						Undo_BeginBlock2(NULL);
@@ -593,21 +878,21 @@ bool FindWnd::FindMarkerRegion(int _dir)
 	bool update = false, found = false;
 	if (g_searchStr && *g_searchStr)
 	{
+		FindIndexSearch(m_type, g_searchStr, true);
+
 		double startPos = GetCursorPositionEx(NULL);
-		int id, x = 0;
-		bool bR;
-		double dPos, dRend, dMinMaxPos = _dir < 0 ? -DBL_MAX : DBL_MAX;
-		const char *cName;
-		while ((x=EnumProjectMarkers2(NULL, x, &bR, &dPos, &dRend, &cName, &id)))
+		int idx = 0, x;
+		double dPos, dMinMaxPos = _dir < 0 ? -DBL_MAX : DBL_MAX;
+		for (; (x=EnumProjectMarkers2(NULL, idx, NULL, &dPos, NULL, NULL, NULL)); idx=x) // index keys, see FindIndexSync()
 		{
 			if (_dir == 1 && dPos > startPos) {
-				if (stristr(cName, g_searchStr)) {
+				if (g_findIdx.Match((const void*)(INT_PTR)idx, g_searchStr)) {
 					found = true;
 					dMinMaxPos = min(dPos, dMinMaxPos);
 				}
 			}
 			else if (_dir == -1 && dPos < startPos) {
-				if (stristr(cName, g_searchStr)) {
+				if (g_findIdx.Match((const void*)(INT_PTR)idx, g_searchStr)) {
 					found = true;
 					dMinMaxPos = max(dPos, dMinMaxPos);
 				}
@@ -30,9 +30,48 @@
 #ifndef _SNM_FIND_H_
 #define _SNM_FIND_H_
 
+#include "SnM_Marker.h"
 #include "SnM_VWnd.h"
 
 
+// searchable strings (one per object: item, track, marker id..) indexed by 
+// trigrams: searches only check the candidates that contain all trigrams of 
+// the search string, and the results of the last search are cached
+class FindIndexField
+{
+public:
+	FindIndexField() : m_live(0), m_postings(DeletePostings), m_resultsOk(false), m_caseSensitive(false) {}
+	~FindIndexField() { Empty(); }
+	void SetCaseSensitive(bool _caseSensitive) { m_caseSensitive = _caseSensitive; m_resultsOk = false; }
+	void Set(const void* _obj, const char* _str, int _gen);
+	void Remove(const void* _obj);
+	void Purge(int _gen);
+	void Empty();
+	int Search(const char* _searchStr);
+	bool Match(const void* _obj, const char* _searchStr) { Search(_searchStr); return m_results.Get((INT_PTR)_obj, false); }
+	int GetSize() { return m_live; }
+private:
+	struct Entry { const void* m_obj; WDL_FastString m_str; int m_gen; };
+	static void DeletePostings(WDL_TypedBuf<int>* _p) { delete _p; }
+	void AddPostings(int _id);
+	void Kill(int _id);
+	void Compact();
+
+	WDL_PtrList<Entry> m_entries; // entry id -> entry, NULL when removed
+	WDL_PtrKeyedArray<int> m_objs; // object -> entry id
+	int m_live;
+	WDL_IntKeyedArray<WDL_TypedBuf<int>*> m_postings; // trigram -> entry ids (ascending)
+	WDL_PtrKeyedArray<bool> m_results; // objects matching m_lastSearch
+	WDL_FastString m_lastSearch;
+	bool m_resultsOk, m_caseSensitive;
+};
+
+class FindMarkerRegionListener : public SNM_MarkerRegionListener {
+public:
+	FindMarkerRegionListener() : SNM_MarkerRegionListener() {}
+	void NotifyMarkerRegionUpdate(int _updateFlags, SNM_MarkerRegionChanges* _changes);
+};
+
 class FindWnd : public SWS_DockWnd
 {
 public:
@@ -41,8 +80,8 @@ public:
 	void GetMinSize(int* _w, int* _h) { *_w=297; *_h=100; }
 	bool Find(int _mode);
 	MediaItem* FindPrevNextItem(int _dir, MediaItem* _item);
-	bool FindMediaItem(int _dir, bool _allTakes, bool (*jobTake)(MediaItem_Take*,const char*), bool (*jobItem)(MediaItem*,const char*) = NULL);
-	bool FindTrack(int _dir, bool (*job)(MediaTrack*,const char*));
+	bool FindMediaItem(int _dir);
+	bool FindTrack(int _dir);
 	bool FindMarkerRegion(int _dir);
 	void UpdateNotFoundMsg(bool _found);
 protected:
@@ -62,6 +101,9 @@ protected:
 
 int FindInit();
 void FindExit();
+void FindSetTrackListChange();
+void FindSetTrackTitle();
+void FindIndexRun();
 void OpenFind(COMMAND_T*);
 int IsFindDisplayed(COMMAND_T*);
 void FindNextPrev(COMMAND_T*);
@@ -141,6 +141,7 @@ SNM_MultiWindowManager<LiveConfigMonitorWnd> g_monWndsMgr(LIVECFG_MON_WND_ID);
 
 SWSProjConfig<WDL_PtrList_DeleteOnDestroy<LiveConfig> > g_liveConfigs;
 WDL_PtrList<LiveConfigItem> g_clipboardConfigs; // for cut/copy/paste
+WDL_PtrList<LiveConfigFile> g_lcFiles; // see GetLiveConfigFile()
 int g_configId = 0; // the current *displayed/edited* config id
 
 // prefs
@@ -294,6 +295,64 @@ bool TriggerFXPresets(MediaTrack* _tr, WDL_FastString* _presetConf)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+// LiveConfigFile
+///////////////////////////////////////////////////////////////////////////////
+
+// (re)loads the file if it has changed on disk since the last call
+// track templates are stored as single track template chunks, i.e. ready to
+// be applied, so that config switches do not have to touch the disk at all
+bool LiveConfigFile::Update()
+{
+	struct stat s;
+#ifdef _WIN32
+	if (statUTF8(m_fn.Get(), &s))
+#else
+	if (stat(m_fn.Get(), &s))
+#endif
+	{
+		m_chunk.Set("");
+		m_mtime = 0;
+		m_size = -1;
+		return false;
+	}
+
+	if (s.st_mtime!=m_mtime || (WDL_INT64)s.st_size!=m_size)
+	{
+		WDL_FastString chunk;
+		m_chunk.Set("");
+		if (LoadChunk(m_fn.Get(), &chunk) && chunk.GetLength())
+		{
+			if (m_trTemplate)
+				MakeSingleTrackTemplateChunk(&chunk, &m_chunk, true, true, false);
+			else
+				m_chunk.Set(&chunk);
+		}
+		m_mtime = s.st_mtime;
+		m_size = (WDL_INT64)s.st_size;
+	}
+	return (m_chunk.GetLength()>0);
+}
+
+// returns the in-memory copy of a track template/fx chain (loaded if needed), NULL on error
+// _resFn: resource file name, as stored in live configs
+LiveConfigFile* GetLiveConfigFile(const char* _resFn, bool _trTemplate)
+{
+	char fn[SNM_MAX_PATH]="";
+	GetFullResourcePath(_trTemplate ? "TrackTemplates" : "FXChains", _resFn, fn, sizeof(fn));
+
+	LiveConfigFile* f = NULL;
+	for (int i=0; !f && i<g_lcFiles.GetSize(); i++)
+		if (g_lcFiles.Get(i)->m_trTemplate==_trTemplate && !strcmp(g_lcFiles.Get(i)->m_fn.Get(), fn))
+			f = g_lcFiles.Get(i);
+	if (!f)
+		f = g_lcFiles.Add(new LiveConfigFile(fn, _trTemplate));
+
+	f->m_used = true;
+	return f->Update() ? f : NULL;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // LiveConfigItem
 ///////////////////////////////////////////////////////////////////////////////
@@ -422,6 +481,7 @@ LiveConfig::LiveConfig()
 	m_ignoreEmpty = m_muteOthers = m_offlineOthers = 0;
 	memcpy(&m_inputTr, &GUID_NULL, sizeof(GUID));
 	m_activeMidiVal = m_preloadMidiVal = m_curMidiVal = m_curPreloadMidiVal = -1;
+	m_lastSwitchMs = m_maxSwitchMs = 0;
 	m_osc = NULL;
 	for (int j=0; j<SNM_LIVECFG_NB_ROWS; j++)
 		m_ccConfs.Add(new LiveConfigItem(j, "", NULL, "", "", "", "", ""));
@@ -1050,6 +1110,7 @@ void LiveConfigsWnd::OnCommand(WPARAM wParam, LPARAM lParam)
 			if (updt) {
 				Update();
 				Undo_OnStateChangeEx2(NULL, UNDO_STR, UNDO_STATE_MISCCFG, -1);
+				ScheduledJob::Schedule(new LiveConfigsUpdateFilesJob());
 			}
 			break;
 		}
@@ -1087,6 +1148,7 @@ void LiveConfigsWnd::OnCommand(WPARAM wParam, LPARAM lParam)
 			if (updt) {
 				Update();
 				Undo_OnStateChangeEx2(NULL, UNDO_STR, UNDO_STATE_MISCCFG, -1);
+				ScheduledJob::Schedule(new LiveConfigsUpdateFilesJob());
 			}
 			break;
 		}
@@ -1678,7 +1740,14 @@ bool LiveConfigsWnd::GetToolTipString(int _xpos, int _ypos, char* _bufOut, int _
 		{
 			case BTNID_ENABLE:
 				if (LiveConfig* lc = g_liveConfigs.Get()->Get(g_configId))
+				{
 					_snprintfSafe(_bufOut, _bufOutSz, __LOCALIZE_VERFMT("Live Config #%d: %s","sws_DLG_155"), g_configId+1, lc->m_enable?__LOCALIZE("on","sws_DLG_155"):__LOCALIZE("off","sws_DLG_155"));
+					if (lc->m_maxSwitchMs)
+					{
+						int len = strlen(_bufOut);
+						_snprintfSafe(_bufOut+len, _bufOutSz-len, __LOCALIZE_VERFMT("\nLast switch: %d ms (max: %d ms)","sws_DLG_155"), lc->m_lastSwitchMs, lc->m_maxSwitchMs);
+					}
+				}
 				return true;
 			case TXTID_INPUT_TRACK:
 			case CMBID_INPUT_TRACK:
@@ -1755,6 +1824,32 @@ void LiveConfigsUpdateEditorJob::Perform() {
 		w->Update();
 }
 
+// (re)loads the track templates and fx chains of enabled live configs,
+// drops the ones that are not used anymore
+void LiveConfigsUpdateFilesJob::Perform()
+{
+	for (int i=0; i<g_lcFiles.GetSize(); i++)
+		g_lcFiles.Get(i)->m_used = false;
+
+	for (int i=0; i<g_liveConfigs.Get()->GetSize(); i++)
+		if (LiveConfig* lc = g_liveConfigs.Get()->Get(i))
+			if (lc->m_enable)
+				for (int j=0; j<lc->m_ccConfs.GetSize(); j++)
+					if (LiveConfigItem* item = lc->m_ccConfs.Get(j))
+						if (item->m_track)
+						{
+							// same priority as ApplyPreloadLiveConfig()
+							if (item->m_trTemplate.GetLength())
+								GetLiveConfigFile(item->m_trTemplate.Get(), true);
+							else if (item->m_fxChain.GetLength())
+								GetLiveConfigFile(item->m_fxChain.Get(), false);
+						}
+
+	for (int i=g_lcFiles.GetSize()-1; i>=0; i--)
+		if (!g_lcFiles.Get(i)->m_used)
+			g_lcFiles.Delete(i, true);
+}
+
 // moderate things a bit
 void LiveConfigsUpdateFadeJob::Perform()
 {
@@ -1858,6 +1953,8 @@ static bool ProcessExtensionLine(const char *line, ProjectStateContext *ctx, boo
 				configId,
 				APPLY_MASK|PRELOAD_MASK,
 				APPLY_MASK|PRELOAD_MASK);
+
+			ScheduledJob::Schedule(new LiveConfigsUpdateFilesJob());
 		}
 
 		// refresh editor
@@ -2015,6 +2112,7 @@ void LiveConfigExit()
 
 	g_lcWndMgr.Delete();
 	g_monWndsMgr.DeleteAll();
+	g_lcFiles.Empty(true);
 }
 
 void OpenLiveConfig(COMMAND_T*)
@@ -2152,6 +2250,7 @@ void ApplyPreloadLiveConfig(bool _apply, int _cfgId, int _val, LiveConfigItem* _
 	if (cfg->m_track)
 	{
 		MediaTrack* inputTr = lc->GetInputTrack();
+		DWORD startTime = GetTickCount();
 
 		// --------------------------------------------------------------------
 		// 1) mute things a) to trigger tiny fades b) according to options
@@ -2256,25 +2355,26 @@ void ApplyPreloadLiveConfig(bool _apply, int _cfgId, int _val, LiveConfigItem* _
 			// if the altered track has sends, it'll be glitch free too as me mute this source track
 			if (cfg->m_trTemplate.GetLength()) 
 			{
-				WDL_FastString tmplt; char fn[SNM_MAX_PATH] = "";
-				GetFullResourcePath("TrackTemplates", cfg->m_trTemplate.Get(), fn, sizeof(fn));
-				if (LoadChunk(fn, &tmplt) && tmplt.GetLength())
+				if (LiveConfigFile* tmplt = GetLiveConfigFile(cfg->m_trTemplate.Get(), true)) // single track template, ready to use
 				{
 					SNM_SendPatcher p(cfg->m_track); // auto-commit on destroy
 					
-					WDL_FastString chunk; MakeSingleTrackTemplateChunk(&tmplt, &chunk, true, true, false);
-					if (ApplyTrackTemplate(cfg->m_track, &chunk, false, false, &p))
+					if (ApplyTrackTemplate(cfg->m_track, &tmplt->m_chunk, false, false, &p))
 					{
-						// make sure the track will be restored with its current name 
-						WDL_FastString trNameEsc("");
-						if (char* name = (char*)GetSetMediaTrackInfo(cfg->m_track, "P_NAME", NULL))
-							if (*name)
-								makeEscapedConfigString(name, &trNameEsc);
-						p.ParsePatch(SNM_SET_CHUNK_CHAR,1,"TRACK","NAME",0,1,(void*)trNameEsc.Get());
-
-						// make sure the track will be restored with proper mute state
-						char onoff[2]; strcpy(onoff, *(bool*)GetSetMediaTrackInfo(cfg->m_track, "B_MUTE", NULL) ? "1" : "0");
-						p.ParsePatch(SNM_SET_CHUNK_CHAR,1,"TRACK","MUTESOLO",0,1,onoff);
+						{
+							SNM_ChunkTransaction t(&p); // both patches in one pass, committed to p on destroy
+
+							// make sure the track will be restored with its current name 
+							WDL_FastString trNameEsc("");
+							if (char* name = (char*)GetSetMediaTrackInfo(cfg->m_track, "P_NAME", NULL))
+								if (*name)
+									makeEscapedConfigString(name, &trNameEsc);
+							t.AddTokenEdit("TRACK","NAME",1,0,1,trNameEsc.Get());
+
+							// make sure the track will be restored with proper mute state
+							char onoff[2]; strcpy(onoff, *(bool*)GetSetMediaTrackInfo(cfg->m_track, "B_MUTE", NULL) ? "1" : "0");
+							t.AddTokenEdit("TRACK","MUTESOLO",1,0,1,onoff);
+						}
 
 						WaitForMuteAndSendCC123(lc, cfg, &muteTime, &muteTracks, &cc123Tracks);
 					}
@@ -2283,12 +2383,10 @@ void ApplyPreloadLiveConfig(bool _apply, int _cfgId, int _val, LiveConfigItem* _
 			// fx chain reconfiguration via state chunk update
 			else if (cfg->m_fxChain.GetLength())
 			{
-				char fn[SNM_MAX_PATH]=""; WDL_FastString chunk;
-				GetFullResourcePath("FXChains", cfg->m_fxChain.Get(), fn, sizeof(fn));
-				if (LoadChunk(fn, &chunk) && chunk.GetLength())
+				if (LiveConfigFile* fxChain = GetLiveConfigFile(cfg->m_fxChain.Get(), false))
 				{
 					SNM_FXChainTrackPatcher p(cfg->m_track); // auto-commit on destroy
-					if (p.SetFXChain(&chunk))
+					if (p.SetFXChain(&fxChain->m_chunk))
 						WaitForMuteAndSendCC123(lc, cfg, &muteTime, &muteTracks, &cc123Tracks);
 				}
 			} // auto-commit
@@ -2410,6 +2508,16 @@ void ApplyPreloadLiveConfig(bool _apply, int _cfgId, int _val, LiveConfigItem* _
 			// unmute the config track, whatever is lc->m_muteOthers
 			if (*(bool*)GetSetMediaTrackInfo(cfg->m_track, "B_MUTE", NULL))
 				GetSetMediaTrackInfo(cfg->m_track, "B_MUTE", &g_bFalse);
+
+			// switch time, i.e. the mute gap (tracks are muted at the very start)
+			lc->m_lastSwitchMs = (int)(GetTickCount()-startTime);
+			if (lc->m_lastSwitchMs > lc->m_maxSwitchMs)
+				lc->m_maxSwitchMs = lc->m_lastSwitchMs;
+#ifdef _SNM_DEBUG
+			char dbg[256] = "";
+			_snprintfSafe(dbg, sizeof(dbg), "ApplyPreloadLiveConfig() - Switch time: %d ms\n", lc->m_lastSwitchMs);
+			OutputDebugString(dbg);
+#endif
 		}
 
 	} // if (cfg->m_track)
@@ -2986,6 +3094,7 @@ void UpdateEnableLiveConfig(int _cfgId, int _val)
 		if (!lc->m_enable)
 			lc->m_curMidiVal = lc->m_activeMidiVal = lc->m_curPreloadMidiVal = lc->m_preloadMidiVal = -1;
 		Undo_OnStateChangeEx2(NULL, UNDO_STR, UNDO_STATE_MISCCFG, -1);
+		ScheduledJob::Schedule(new LiveConfigsUpdateFilesJob());
 
 		if (g_configId == _cfgId)
 			if (LiveConfigsWnd* w = g_lcWndMgr.Get())
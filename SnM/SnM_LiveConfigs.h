@@ -76,6 +76,7 @@ public:
 	WDL_PtrList<LiveConfigItem> m_ccConfs;
 	int m_version, m_ccDelay, m_fade, m_enable, m_muteOthers, m_selScroll, m_offlineOthers, m_cc123, m_ignoreEmpty, m_autoSends;
 	int m_activeMidiVal, m_curMidiVal, m_preloadMidiVal, m_curPreloadMidiVal;
+	int m_lastSwitchMs, m_maxSwitchMs; // not persisted
 	SNM_OscCSurf* m_osc;
 
 private:
@@ -83,6 +84,19 @@ private:
 };
 
 
+// in-memory (and pre-processed) track template or fx chain used by a live config
+class LiveConfigFile {
+public:
+	LiveConfigFile(const char* _fn, bool _trTemplate) : m_fn(_fn), m_trTemplate(_trTemplate), m_used(true), m_mtime(0), m_size(-1) {}
+	bool Update();
+	WDL_FastString m_fn, m_chunk;
+	bool m_trTemplate, m_used;
+private:
+	time_t m_mtime;
+	WDL_INT64 m_size;
+};
+
+
 class LiveConfigView : public SWS_ListView {
 public:
 	LiveConfigView(HWND hwndList, HWND hwndEdit);
@@ -187,6 +201,14 @@ protected:
 	void Perform();
 };
 
+class LiveConfigsUpdateFilesJob : public ScheduledJob {
+public:
+	LiveConfigsUpdateFilesJob() 
+		: ScheduledJob(SNM_SCHEDJOB_LIVECFG_FILES_UPDATE, SNM_SCHEDJOB_DEFAULT_DELAY) {}
+protected:
+	void Perform();
+};
+
 class LiveConfigsUpdateFadeJob : public ScheduledJob {
 public:
 	LiveConfigsUpdateFadeJob(int _value) 
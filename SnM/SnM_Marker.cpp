@@ -41,6 +41,8 @@ SWS_Mutex g_mkrRgnListenersMutex;
 #endif
 WDL_PtrList<MarkerRegion> g_mkrRgnCache;
 WDL_PtrList<SNM_MarkerRegionListener> g_mkrRgnListeners;
+int g_mkrRgnPendingFlags = 0; // updates detected by lookups, not notified yet
+SNM_MarkerRegionChanges g_mkrRgnChanges; // not notified yet either
 
 void RegisterToMarkerRegionUpdates(SNM_MarkerRegionListener* _listener)
 {
@@ -61,38 +63,283 @@ void UnregisterToMarkerRegionUpdates(SNM_MarkerRegionListener* _listener)
 		g_mkrRgnListeners.Delete(idx, false);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Marker and region index
+// g_mkrRgnCache mirrors the current project's markers & regions in 
+// EnumProjectMarkers3() order, i.e. sorted by position, so that cache indexes
+// are also marker/region indexes. On top of it:
+// - g_mkrRgnIds: open addressing hash table, marker/region id -> index
+// - g_mkrIdx/g_rgnIdx: indexes of markers/regions, sorted by position
+// - g_rgnEnds: max tree over region ends (leaves in g_rgnIdx order), to find
+//   the last region starting before and ending after a given position
+// The cache is refreshed before lookups when the project has changed (see
+// GetProjectStateChangeCount()) or the number of markers/regions differs.
+// Lookups also validate their result against EnumProjectMarkers3(), misses 
+// refresh the cache once (unless it was just refreshed) and lookups that 
+// still fail fall back to linear scans, see GetMarkerRegionCache()
+///////////////////////////////////////////////////////////////////////////////
+
+DWORD g_mkrRgnCacheTime = 0;
+int g_mkrRgnCacheGen = 0; // incremented by each refresh
+int g_mkrRgnCacheChangeCount = -1; // project state change count at the last refresh
+WDL_TypedBuf<int> g_mkrRgnIds, g_mkrIdx, g_rgnIdx;
+WDL_TypedBuf<double> g_rgnEnds;
+int g_mkrRgnIdsBits = 0;
+int g_rgnEndsSz = 0; // number of leaves
+
+static int HashMarkerRegionId(int _id) {
+	return (int)(((unsigned int)_id * 2654435761u) >> (32-g_mkrRgnIdsBits));
+}
+
+// returns the index of _id in _entries (as indexed by g_mkrRgnIds), -1 if not found
+static int LookupMarkerRegionId(int _id, MarkerRegion** _entries)
+{
+	int idx = -1;
+	if (g_mkrRgnIdsBits)
+	{
+		int mask = (1<<g_mkrRgnIdsBits)-1, h = HashMarkerRegionId(_id);
+		while ((idx = g_mkrRgnIds.Get()[h]) >= 0 && _entries[idx]->GetId() != _id)
+			h = (h+1)&mask;
+	}
+	return idx;
+}
+
+static void BuildMarkerRegionIndex()
+{
+	int sz = g_mkrRgnCache.GetSize(), nbMkr=0, nbRgn=0;
+
+	// id hash table, load factor <= 0.5
+	g_mkrRgnIdsBits = 4;
+	while ((1<<g_mkrRgnIdsBits) < 2*sz) g_mkrRgnIdsBits++;
+	int* ids = g_mkrRgnIds.Resize(1<<g_mkrRgnIdsBits, false);
+	int mask = (1<<g_mkrRgnIdsBits)-1;
+	for (int i=0; i<=mask; i++) ids[i] = -1;
+
+	int* mkrs = g_mkrIdx.Resize(sz, false);
+	int* rgns = g_rgnIdx.Resize(sz, false);
+	for (int i=0; i<sz; i++)
+	{
+		MarkerRegion* m = g_mkrRgnCache.Get(i);
+		int h = HashMarkerRegionId(m->GetId());
+		while (ids[h]>=0 && g_mkrRgnCache.Get(ids[h])->GetId()!=m->GetId()) h = (h+1)&mask;
+		if (ids[h]<0) ids[h] = i; // 1st one wins if duplicate ids, like linear scans
+		if (m->IsRegion()) rgns[nbRgn++] = i;
+		else mkrs[nbMkr++] = i;
+	}
+	g_mkrIdx.Resize(nbMkr, false);
+	g_rgnIdx.Resize(nbRgn, false);
+
+	// region ends max tree: node n has children 2n and 2n+1, leaves at g_rgnEndsSz+i
+	g_rgnEndsSz = 1;
+	while (g_rgnEndsSz < nbRgn) g_rgnEndsSz *= 2;
+	double* ends = g_rgnEnds.Resize(2*g_rgnEndsSz, false);
+	for (int i=0; i<g_rgnEndsSz; i++)
+		ends[g_rgnEndsSz+i] = i<nbRgn ? g_mkrRgnCache.Get(rgns[i])->GetRegEnd() : -1.0e300;
+	for (int i=g_rgnEndsSz-1; i>0; i--)
+		ends[i] = max(ends[2*i], ends[2*i+1]);
+}
+
+// returns the last region (in g_rgnIdx) amongst the _k 1st ones ending at/after _pos, -1 if none
+static int FindRegionEndingAfter(int _node, int _lo, int _hi, int _k, double _pos)
+{
+	if (_lo >= _k || g_rgnEnds.Get()[_node] < _pos)
+		return -1;
+	if (_hi-_lo == 1)
+		return _lo;
+	int mid = (_lo+_hi)/2;
+	int i = FindRegionEndingAfter(2*_node+1, mid, _hi, _k, _pos);
+	return i>=0 ? i : FindRegionEndingAfter(2*_node, _lo, mid, _k, _pos);
+}
+
+// returns the number of markers or regions of _idx starting at/before _pos
+static int CountMarkerRegionBefore(WDL_TypedBuf<int>* _idx, double _pos)
+{
+	int lo=0, hi=_idx->GetSize();
+	while (lo < hi) {
+		int mid = (lo+hi)/2;
+		if (g_mkrRgnCache.Get(_idx->Get()[mid])->GetPos() <= _pos) lo = mid+1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+int UpdateMarkerRegionCache();
+
+static void RefreshMarkerRegionCache() {
+	g_mkrRgnPendingFlags |= UpdateMarkerRegionCache();
+}
+
+// returns true if the index can be used for _proj (refreshed if needed)
+// note: without GetProjectStateChangeCount() (older REAPER versions), edits
+// that keep the number of markers/regions are only caught by the periodic 
+// refresh or by lookups' checks, see below
+static bool GetMarkerRegionCache(ReaProject* _proj)
+{
+	if (_proj && _proj != EnumProjects(-1, NULL, 0))
+		return false;
+	if ((GetTickCount()-g_mkrRgnCacheTime) > SNM_MKR_RGN_UPDATE_FREQ ||
+		(GetProjectStateChangeCount && GetProjectStateChangeCount(NULL) != g_mkrRgnCacheChangeCount) ||
+		CountProjectMarkers(NULL, NULL, NULL) != g_mkrRgnCache.GetSize())
+	{
+		RefreshMarkerRegionCache();
+	}
+	return true;
+}
+
+// true if the REAPER marker/region at index _idx matches the cached one (or if both do not exist)
+static bool CheckMarkerRegionCache(int _idx)
+{
+	bool isrgn; double pos, end; int num;
+	MarkerRegion* m = g_mkrRgnCache.Get(_idx);
+	if (!EnumProjectMarkers3(NULL, _idx, &isrgn, &pos, &end, NULL, &num, NULL))
+		return !m;
+	return m && isrgn==m->IsRegion() && num==m->GetNum() && pos==m->GetPos() && (!isrgn || end==m->GetRegEnd());
+}
+
+// returns the index of the marker/region _id, -1 if not found
+// the cache is refreshed if the REAPER marker/region at this index does not
+// match, or if _id is unknown but markers/regions were added/removed
+// _gen: g_mkrRgnCacheGen before GetMarkerRegionCache() was called, i.e. a miss
+// is trusted if the cache has been refreshed since, it is refreshed otherwise
+static int FindMarkerRegionId(int _id, bool* _isrgn, double* _pos, double* _end, const char** _name, int* _num, int* _color, int _gen)
+{
+	const char* name; double pos, end; int num, col; bool isrgn;
+	for (int pass=0; pass<2; pass++)
+	{
+		if (pass)
+		{
+			if (_gen != g_mkrRgnCacheGen)
+				break; // just refreshed but REAPER does not match, see linear scan below
+			RefreshMarkerRegionCache();
+		}
+
+		int idx = LookupMarkerRegionId(_id, g_mkrRgnCache.GetList());
+		if (idx < 0)
+		{
+			if (_gen != g_mkrRgnCacheGen)
+				return -1; // up to date cache
+		}
+		else if (EnumProjectMarkers3(NULL, idx, &isrgn, &pos, &end, &name, &num, &col) && MakeMarkerRegionId(num, isrgn) == _id)
+		{
+			if (_isrgn)	*_isrgn = isrgn;
+			if (_pos)	*_pos = pos;
+			if (_end)	*_end = end;
+			if (_name)	*_name = name;
+			if (_num)	*_num = num;
+			if (_color)	*_color = col;
+			return idx;
+		}
+	}
+
+	int x=0, lastx=0;
+	while (x = EnumProjectMarkers3(NULL, x, &isrgn, &pos, &end, &name, &num, &col))
+	{
+		if (MakeMarkerRegionId(num, isrgn) == _id)
+		{
+			if (_isrgn)	*_isrgn = isrgn;
+			if (_pos)	*_pos = pos;
+			if (_end)	*_end = end;
+			if (_name)	*_name = name;
+			if (_num)	*_num = num;
+			if (_color)	*_color = col;
+			return lastx;
+		}
+		lastx=x;
+	}
+	return -1;
+}
+
+// diffs the cache with the project's markers & regions
+// changed markers/regions are matched by id and updated in place, added ones
+// are the only allocations. Changes are accumulated into g_mkrRgnChanges.
 // return a bitmask: &SNM_MARKER_MASK: marker update, &SNM_REGION_MASK: region update
 int UpdateMarkerRegionCache()
 {
 	int updateFlags=0;
 	int i=0, x=0, num, col; double pos, rgnend; const char* name; bool isRgn;
 
-	// added/updated markers/regions?
+	// skip unchanged markers/regions
 	while (x = EnumProjectMarkers3(NULL, x, &isRgn, &pos, &rgnend, &name, &num, &col))
 	{
 		MarkerRegion* m = g_mkrRgnCache.Get(i);
-		if (!m || (m && !m->Compare(isRgn, pos, rgnend, name, num, col)))
-		{
-			if (m) g_mkrRgnCache.Delete(i, true);
-			g_mkrRgnCache.Insert(i, new MarkerRegion(isRgn, pos, rgnend, name, num, col));
-			updateFlags |= (isRgn ? SNM_REGION_MASK : SNM_MARKER_MASK);
-		}
+		if (!m || !m->Compare(isRgn, pos, rgnend, name, num, col))
+			break;
 		i++;
 	}
-	// removed markers/regions?
-	for (int j=g_mkrRgnCache.GetSize()-1; j>=i; j--) {
-		if (MarkerRegion* m = g_mkrRgnCache.Get(j))
-			updateFlags |= (m->IsRegion() ? SNM_REGION_MASK : SNM_MARKER_MASK);
-		g_mkrRgnCache.Delete(j, true);
+
+	int oldSz = g_mkrRgnCache.GetSize();
+	if (x || i<oldSz)
+	{
+		// detach the remaining entries, they are re-attached when matched by id
+		WDL_TypedBuf<MarkerRegion*> olds; WDL_TypedBuf<char> matched;
+		if (oldSz) {
+			memcpy(olds.Resize(oldSz, false), g_mkrRgnCache.GetList(), oldSz*sizeof(MarkerRegion*));
+			memset(matched.Resize(oldSz, false), 0, oldSz);
+		}
+		while (g_mkrRgnCache.GetSize() > i)
+			g_mkrRgnCache.Delete(g_mkrRgnCache.GetSize()-1, false);
+
+		// added/updated markers/regions?
+		for (; x; x = EnumProjectMarkers3(NULL, x, &isRgn, &pos, &rgnend, &name, &num, &col))
+		{
+			MarkerRegion* m = NULL;
+			int id = MakeMarkerRegionId(num, isRgn), changes = 0;
+			int j = LookupMarkerRegionId(id, olds.Get());
+			if (j>=i && !matched.Get()[j])
+			{
+				m = olds.Get()[j];
+				matched.Get()[j] = 1;
+				if (m->GetPos()!=pos || m->GetRegEnd()!=rgnend) {
+					m->SetPos(pos);
+					m->SetRegEnd(rgnend);
+					changes |= SNM_MKRRGN_POS;
+				}
+				if (strcmp(m->GetName(), name ? name : "")) {
+					m->SetName(name);
+					changes |= SNM_MKRRGN_NAME;
+				}
+				if (m->GetColor()!=col) {
+					m->SetColor(col);
+					changes |= SNM_MKRRGN_COLOR;
+				}
+			}
+			else
+			{
+				m = new MarkerRegion(isRgn, pos, rgnend, name, num, col);
+				changes = SNM_MKRRGN_ADDED;
+			}
+			if (changes) {
+				g_mkrRgnChanges.Add(id, changes);
+				updateFlags |= (isRgn ? SNM_REGION_MASK : SNM_MARKER_MASK);
+			}
+			g_mkrRgnCache.Add(m);
+		}
+
+		// removed markers/regions?
+		for (int j=i; j<oldSz; j++)
+			if (!matched.Get()[j])
+			{
+				MarkerRegion* m = olds.Get()[j];
+				g_mkrRgnChanges.Add(m->GetId(), SNM_MKRRGN_REMOVED);
+				updateFlags |= (m->IsRegion() ? SNM_REGION_MASK : SNM_MARKER_MASK);
+				delete m;
+			}
+
+		BuildMarkerRegionIndex();
 	}
+	g_mkrRgnCacheTime = GetTickCount();
+	g_mkrRgnCacheGen++;
+	if (GetProjectStateChangeCount)
+		g_mkrRgnCacheChangeCount = GetProjectStateChangeCount(NULL);
+
 	// project time mode update?
 	static int sPrevTimemode = *(int*)GetConfigVar("projtimemode");
-	if (updateFlags != (SNM_MARKER_MASK|SNM_REGION_MASK))
-		if (int* timemode = (int*)GetConfigVar("projtimemode"))
-			if (*timemode != sPrevTimemode) {
-				sPrevTimemode = *timemode;
-				return SNM_MARKER_MASK|SNM_REGION_MASK;
-			}
+	if (int* timemode = (int*)GetConfigVar("projtimemode"))
+		if (*timemode != sPrevTimemode) {
+			sPrevTimemode = *timemode;
+			g_mkrRgnChanges.SetAll();
+			return SNM_MARKER_MASK|SNM_REGION_MASK;
+		}
 	return updateFlags;
 }
 
@@ -108,9 +355,22 @@ void UpdateMarkerRegionRun()
 		SWS_SectionLock lock(&g_mkrRgnListenersMutex);
 #endif
 		if (int sz=g_mkrRgnListeners.GetSize())
-			if (int updateFlags = UpdateMarkerRegionCache())
+		{
+			// pending changes are taken before notifying: listeners' lookups can 
+			// refresh the cache, changes found meanwhile are kept for the next run
+			int updateFlags = UpdateMarkerRegionCache() | g_mkrRgnPendingFlags;
+			SNM_MarkerRegionChanges changes;
+			g_mkrRgnChanges.MoveTo(&changes);
+			g_mkrRgnPendingFlags = 0;
+			if (updateFlags)
 				for (int i=sz-1; i>=0; i--)
-					g_mkrRgnListeners.Get(i)->NotifyMarkerRegionUpdate(updateFlags);
+					g_mkrRgnListeners.Get(i)->NotifyMarkerRegionUpdate(updateFlags, &changes);
+		}
+		else
+		{
+			g_mkrRgnPendingFlags = 0;
+			g_mkrRgnChanges.Clear();
+		}
 	}
 }
 
@@ -151,6 +411,17 @@ bool SNM_GetProjectMarkerName(ReaProject* _proj, int _num, bool _isrgn, WDL_Fast
 {
 	if (_name)
 	{
+		int gen = g_mkrRgnCacheGen;
+		if (GetMarkerRegionCache(_proj))
+		{
+			const char* name;
+			if (FindMarkerRegionId(MakeMarkerRegionId(_num, _isrgn), NULL, NULL, NULL, &name, NULL, NULL, gen) >= 0) {
+				_name->Set(name);
+				return true;
+			}
+			return false;
+		}
+
 		int x=0, num; const char* name; bool isrgn;
 		while (x = EnumProjectMarkers3(_proj, x, &isrgn, NULL, NULL, &name, &num, NULL))
 			if (num==_num && isrgn==_isrgn) {
@@ -166,6 +437,47 @@ bool SNM_GetProjectMarkerName(ReaProject* _proj, int _num, bool _isrgn, WDL_Fast
 // _flags: &SNM_MARKER_MASK=marker, &SNM_REGION_MASK=region
 int FindMarkerRegion(ReaProject* _proj, double _pos, int _flags, int* _idOut)
 {
+	int gen = g_mkrRgnCacheGen;
+	if (GetMarkerRegionCache(_proj))
+	{
+		for (int pass=0; pass<2; pass++)
+		{
+			if (pass)
+			{
+				if (gen != g_mkrRgnCacheGen)
+					break; // just refreshed but REAPER does not match, see linear scan below
+				RefreshMarkerRegionCache();
+			}
+
+			// last marker starting before _pos, last region containing _pos
+			int foundx = -1;
+			if (_flags&SNM_MARKER_MASK)
+				if (int k = CountMarkerRegionBefore(&g_mkrIdx, _pos))
+					foundx = g_mkrIdx.Get()[k-1];
+			if (_flags&SNM_REGION_MASK)
+				if (int k = CountMarkerRegionBefore(&g_rgnIdx, _pos)) {
+					int i = FindRegionEndingAfter(1, 0, g_rgnEndsSz, k, _pos);
+					if (i>=0 && g_rgnIdx.Get()[i] > foundx)
+						foundx = g_rgnIdx.Get()[i];
+				}
+
+			// the next marker/region is checked too (inserted after the found one?)
+			MarkerRegion* m = foundx>=0 ? g_mkrRgnCache.Get(foundx) : NULL;
+			if (!m)
+			{
+				if (gen != g_mkrRgnCacheGen) { // up to date cache
+					if (_idOut) *_idOut = -1;
+					return -1;
+				}
+			}
+			else if (CheckMarkerRegionCache(foundx) && CheckMarkerRegionCache(foundx+1))
+			{
+				if (_idOut) *_idOut = m->GetId();
+				return foundx;
+			}
+		}
+	}
+
 	bool isrgn;
 	double dPos, dEnd;
 	int x=0, lastx=0, num, foundId=-1, foundx=-1;
@@ -216,6 +528,10 @@ int GetMarkerRegionIndexFromId(ReaProject* _proj, int _id)
 {
 	if (_id > 0)
 	{
+		int gen = g_mkrRgnCacheGen;
+		if (GetMarkerRegionCache(_proj))
+			return FindMarkerRegionId(_id, NULL, NULL, NULL, NULL, NULL, NULL, gen);
+
 		int x=0, lastx=0, num=(_id&0x3FFFFFFF), num2; 
 		bool isrgn = IsRegion(_id), isrgn2;
 		while (x = EnumProjectMarkers3(_proj, x, &isrgn2, NULL, NULL, NULL, &num2, NULL)) {
@@ -239,6 +555,10 @@ int EnumMarkerRegionById(ReaProject* _proj, int _id, bool* _isrgn, double* _pos,
 {
 	if (_id > 0)
 	{
+		int gen = g_mkrRgnCacheGen;
+		if (GetMarkerRegionCache(_proj))
+			return FindMarkerRegionId(_id, _isrgn, _pos, _end, _name, _num, _color, gen);
+
 		const char* name2;
 		double pos2, end2;
 		bool isrgn = IsRegion(_id), isrgn2;
@@ -33,13 +33,59 @@
 #include "../MarkerList/MarkerListClass.h"
 
 
+// marker/region change flags, see SNM_MarkerRegionChanges
+#define SNM_MKRRGN_ADDED	1
+#define SNM_MKRRGN_REMOVED	2
+#define SNM_MKRRGN_POS		4 // position or region end
+#define SNM_MKRRGN_NAME		8
+#define SNM_MKRRGN_COLOR	16
+#define SNM_MKRRGN_ALL		(SNM_MKRRGN_ADDED|SNM_MKRRGN_REMOVED|SNM_MKRRGN_POS|SNM_MKRRGN_NAME|SNM_MKRRGN_COLOR)
+
+// ids of the markers/regions that changed since the last notification
+// when IsAll() is true (e.g. project time mode update), everything has to be 
+// refreshed and Get() returns SNM_MKRRGN_ALL for any id
+class SNM_MarkerRegionChanges {
+public:
+	SNM_MarkerRegionChanges() : m_all(false) {}
+	void Add(int _id, int _flags) { m_changes.Insert(_id, m_changes.Get(_id, 0) | _flags); }
+	void SetAll() { m_all = true; }
+	void Clear() { m_changes.DeleteAll(); m_all = false; }
+	// moves all changes to _dest (cleared first)
+	void MoveTo(SNM_MarkerRegionChanges* _dest) {
+		_dest->Clear();
+		for (int i=0, id; i<m_changes.GetSize(); i++) {
+			int flags = m_changes.Enumerate(i, &id, 0);
+			_dest->m_changes.Insert(id, flags);
+		}
+		_dest->m_all = m_all;
+		Clear();
+	}
+	bool IsAll() { return m_all; }
+	bool IsEmpty() { return !m_all && !m_changes.GetSize(); }
+	int GetSize() { return m_changes.GetSize(); }
+	int Enum(int _i, int* _id) { return m_changes.Enumerate(_i, _id, 0); } // returns change flags
+	int Get(int _id) { return m_all ? SNM_MKRRGN_ALL : m_changes.Get(_id, 0); }
+	// true if only names/colors changed (optionally excluding _id)
+	bool IsNameColorOnly(int _exceptId = -1) {
+		if (m_all) return false;
+		for (int i=0, id; i<m_changes.GetSize(); i++)
+			if ((m_changes.Enumerate(i, &id, 0) & ~(SNM_MKRRGN_NAME|SNM_MKRRGN_COLOR)) || id==_exceptId)
+				return false;
+		return true;
+	}
+protected:
+	WDL_IntKeyedArray<int> m_changes; // id -> change flags
+	bool m_all;
+};
+
 // register/unregister to marker/region changes
 class SNM_MarkerRegionListener {
 public:
 	SNM_MarkerRegionListener() {}
 	virtual ~SNM_MarkerRegionListener() {}
 	// _updateFlags: &1 marker update, &2 region update
-	virtual void NotifyMarkerRegionUpdate(int _updateFlags) {}
+	// _changes: what changed exactly, so that listeners can update incrementally
+	virtual void NotifyMarkerRegionUpdate(int _updateFlags, SNM_MarkerRegionChanges* _changes) {}
 };
 
 void RegisterToMarkerRegionUpdates(SNM_MarkerRegionListener* _sub);
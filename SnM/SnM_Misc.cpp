@@ -67,6 +67,8 @@ MediaItem_Take* SNM_GetMediaItemTakeByGUID(ReaProject* _project, const char* _gu
 	{
 		GUID g;
 		stringToGuid(_guid, &g);
+		if (!_project || _project == EnumProjects(-1, NULL, 0))
+			return GuidToTake(&g); // indexed, active project only
 		return GetMediaItemTakeByGUID(_project, &g);
 	}
 	return NULL;
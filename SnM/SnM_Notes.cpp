@@ -1091,8 +1091,13 @@ void NotesUpdateJob::Perform() {
 ///////////////////////////////////////////////////////////////////////////////
 
 // ScheduledJob because of multi-notifs during project switches (vs CSurfSetTrackListChange)
-void NotesMarkerRegionListener::NotifyMarkerRegionUpdate(int _updateFlags)
+void NotesMarkerRegionListener::NotifyMarkerRegionUpdate(int _updateFlags, SNM_MarkerRegionChanges* _changes)
 {
+	// other markers/regions renamed or recolored: the displayed one is still valid
+	// (moves, additions and removals may change the one at edit/play cursor)
+	if (_changes->IsNameColorOnly(g_lastMarkerRegionId))
+		return;
+
 	if (g_notesType>=SNM_NOTES_MKR_SUB && g_notesType<=SNM_NOTES_MKRRGN_SUB)
 	{
 		ScheduledJob::Schedule(new NotesUpdateJob(SNM_SCHEDJOB_ASYNC_DELAY_OPT));
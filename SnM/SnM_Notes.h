@@ -90,7 +90,7 @@ protected:
 class NotesMarkerRegionListener : public SNM_MarkerRegionListener {
 public:
 	NotesMarkerRegionListener() : SNM_MarkerRegionListener() {}
-	void NotifyMarkerRegionUpdate(int _updateFlags);
+	void NotifyMarkerRegionUpdate(int _updateFlags, SNM_MarkerRegionChanges* _changes);
 };
 
 class NotesWnd : public SWS_DockWnd
@@ -111,11 +111,32 @@ bool g_unsync = false;			// true when switching to a position that is not part o
 int g_playCur = -1;				// index of the item being played, -1 means "not playing yet"
 int g_playNext = -1;			// index of the next item to be played, -1 means "the end"
 int g_rgnLoop = 0;				// region loop count: 0 not looping, <0 infinite loop, n>0 looping n times
-bool g_plLoop = false;			// other (corner case) loops in the playlist?
-double g_lastRunPos = -1.0;
 double g_nextRgnPos, g_nextRgnEnd;
 double g_curRgnPos = 0.0, g_curRgnEnd = -1.0; // to detect unsync, end<pos means non relevant
 
+// flattened schedule of the playing playlist, see BuildPlaylistSchedule()
+struct RgnPlaylistStep {
+	double m_pos, m_end;	// region bounds
+	int m_next;				// next item to be played, -1 means "the end"
+	int m_loop;				// initial g_rgnLoop value when playing this item (see SeekItem())
+	bool m_valid;
+};
+WDL_TypedBuf<RgnPlaylistStep> g_playSteps; // indexed like the playlist items
+
+// shared with the audio thread, see PlaylistOnAudioBuffer()
+volatile bool g_armValid = false;
+volatile int g_armSeq = 0, g_enteredSeq = 0;
+volatile double g_armPos = 0.0, g_armEnd = 0.0, g_enteredPos = 0.0;
+volatile double g_audioBlockLen = 0.0;
+double g_audioLastPos = -1.0;	// audio thread only
+
+// region switch statistics, reset on play
+struct RgnPlaylistStats {
+	int m_switches, m_late;
+	double m_jitterMin, m_jitterMax, m_jitterSum; // audio pos when entering a region - region start
+	double m_leadMin;	// min. time between an armed seek and the end of the current region, <0 if unknown
+} g_playStats = { 0, 0, 0.0, 0.0, 0.0, -1.0 };
+
 int g_oldSeekPref = -1;
 int g_oldStopprojlenPref = -1;
 int g_oldRepeatState = -1;
@@ -127,6 +148,17 @@ RegionPlaylist* GetPlaylist(int _plId = -1) {
 	return g_pls.Get()->Get(_plId);
 }
 
+// true if the region _rgnId is used in any playlist of the current project
+bool IsRegionInPlaylists(int _rgnId)
+{
+	for (int i=0; i<g_pls.Get()->GetSize(); i++)
+		if (RegionPlaylist* pl = g_pls.Get()->Get(i))
+			for (int j=0; j<pl->GetSize(); j++)
+				if (pl->Get(j) && pl->Get(j)->m_rgnId == _rgnId)
+					return true;
+	return false;
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // RegionPlaylist
@@ -1253,7 +1285,16 @@ bool RegionPlaylistWnd::GetToolTipString(int _xpos, int _ypos, char* _bufOut, in
 				lstrcpyn(_bufOut, __LOCALIZE("Crop, paste or append playlist","sws_DLG_165"), _bufOutSz);
 				return true;
 			case TXTID_MONITOR_PL:
-				if (g_playPlaylist>=0) _snprintfSafe(_bufOut, _bufOutSz, __LOCALIZE_VERFMT("Playing playlist: #%d \"%s\"","sws_DLG_165"), g_playPlaylist+1, GetPlaylist(g_playPlaylist)->m_name.Get());
+				if (g_playPlaylist>=0)
+				{
+					_snprintfSafe(_bufOut, _bufOutSz, __LOCALIZE_VERFMT("Playing playlist: #%d \"%s\"","sws_DLG_165"), g_playPlaylist+1, GetPlaylist(g_playPlaylist)->m_name.Get());
+					if (int n = g_playStats.m_switches)
+					{
+						int len = strlen(_bufOut);
+						_snprintfSafe(_bufOut+len, _bufOutSz-len, __LOCALIZE_VERFMT("\nRegion switches: %d, late: %d\nJitter (ms): min %.2f, avg %.2f, max %.2f\nMin. seek lead time (ms): %.1f","sws_DLG_165"),
+							n, g_playStats.m_late, 1000.0*g_playStats.m_jitterMin, 1000.0*g_playStats.m_jitterSum/n, 1000.0*g_playStats.m_jitterMax, g_playStats.m_leadMin>=0.0 ? 1000.0*g_playStats.m_leadMin : 0.0);
+					}
+				}
 				return (g_playPlaylist>=0);
 		}
 	}
@@ -1337,53 +1378,159 @@ int GetPrevValidItem(int _plId, int _itemId, bool _startWith, bool _repeat)
 	return -1;
 }
 
+// builds the flattened schedule of the playlist _plId: one step per item,
+// invalid items are skipped and the repeat state is resolved once for all
+// so that PlaylistRun() just has to follow steps (loops are handled with
+// g_rgnLoop, like before)
+bool BuildPlaylistSchedule(int _plId)
+{
+	RegionPlaylist* pl = _plId>=0 ? g_pls.Get()->Get(_plId) : NULL;
+	int sz = pl ? pl->GetSize() : 0;
+	RgnPlaylistStep* steps = g_playSteps.ResizeOK(sz, false);
+	if (!steps) {
+		g_playSteps.Resize(0, false);
+		return false;
+	}
+
+	int first=-1, last=-1;
+	for (int i=0; i<sz; i++)
+	{
+		steps[i].m_next = -1;
+		steps[i].m_loop = 0;
+		steps[i].m_valid = false;
+		if (pl->IsValidIem(i))
+			if (RgnPlaylistItem* item = pl->Get(i))
+				if (EnumMarkerRegionById(NULL, item->m_rgnId, NULL, &steps[i].m_pos, &steps[i].m_end, NULL, NULL, NULL)>=0)
+				{
+					steps[i].m_valid = true;
+					steps[i].m_loop = item->m_cnt<0 ? -1 : item->m_cnt>1 ? item->m_cnt : 0;
+					if (last>=0) steps[last].m_next = i;
+					else first = i;
+					last = i;
+				}
+	}
+	if (g_repeatPlaylist && last>=0)
+		steps[last].m_next = first; // note: first==last when there is one valid item only
+	return (first>=0);
+}
+
+RgnPlaylistStep* GetPlaylistStep(int _itemId) {
+	return (_itemId>=0 && _itemId<g_playSteps.GetSize() && g_playSteps.Get()[_itemId].m_valid) ? g_playSteps.Get()+_itemId : NULL;
+}
+
+// arms the smooth seek to the step _itemId (-1: end of playlist) and tells
+// the audio hook which region start it has to watch for
+void ArmPlaylistStep(int _itemId)
+{
+	g_armValid = false; // no region switch detection while updating the armed range
+
+	RgnPlaylistStep* step = GetPlaylistStep(_itemId);
+	if (!step)
+	{
+		// trick to stop the playlist in sync: smooth seek to the end of the project (!)
+		// temp override of the "stop play at project end" option
+		if (int* opt = (int*)GetConfigVar("stopprojlen")) {
+			if (g_oldStopprojlenPref<0) g_oldStopprojlenPref = *opt;
+			*opt = 1;
+		}
+		g_playNext = -1;
+		g_rgnLoop = 0;
+		g_nextRgnPos = SNM_GetProjectLength()+1.0;
+		g_nextRgnEnd = g_nextRgnPos+1.0;
+	}
+	else
+	{
+		// moving to another item, or to the current one again once its loops are done
+		// (e.g. repeated single item playlist): reload its loop count, otherwise keep counting down
+		if (_itemId!=g_playCur || !g_rgnLoop)
+			g_rgnLoop = step->m_loop;
+		g_playNext = _itemId;
+		g_nextRgnPos = step->m_pos;
+		g_nextRgnEnd = step->m_end;
+	}
+
+	g_armPos = g_nextRgnPos;
+	g_armEnd = g_nextRgnEnd;
+	g_armSeq++;
+	g_armValid = true;
+	SeekPlay(g_nextRgnPos);
+}
+
 bool SeekItem(int _plId, int _nextItemId, int _curItemId)
 {
 #ifdef _SNM_MUTEX
 	SWS_SectionLock lock(&g_plsMutex);
 #endif
-	if (RegionPlaylist* pl = g_pls.Get()->Get(_plId))
+	if (g_pls.Get()->Get(_plId))
 	{
-		// trick to stop the playlist in sync: smooth seek to the end of the project (!)
+		BuildPlaylistSchedule(_plId);
+
 		if (_nextItemId<0)
 		{
-			// temp override of the "stop play at project end" option
-			if (int* opt = (int*)GetConfigVar("stopprojlen")) {
-				g_oldStopprojlenPref = *opt;
-				*opt = 1;
-			}
-			g_playNext = -1;
-			g_rgnLoop = 0;
-			g_nextRgnPos = SNM_GetProjectLength()+1.0;
-			g_nextRgnEnd = g_nextRgnPos+1.0;
-			SeekPlay(g_nextRgnPos);
+			ArmPlaylistStep(-1);
 			return true;
 		}
-		else if (RgnPlaylistItem* next = pl->Get(_nextItemId))
+		else if (RgnPlaylistStep* next = GetPlaylistStep(_nextItemId))
 		{
-			double a, b;
-			if (EnumMarkerRegionById(NULL, next->m_rgnId, NULL, &a, &b, NULL, NULL, NULL)>=0)
-			{
-				g_playNext = _nextItemId;
-				g_playCur = _plId==g_playPlaylist ? g_playCur : _curItemId;
-				g_rgnLoop = next->m_cnt<0 ? -1 : next->m_cnt>1 ? next->m_cnt : 0;
-				g_nextRgnPos = a;
-				g_nextRgnEnd = b;
-				if (_curItemId<0) {
-					g_curRgnPos = 0.0;
-					g_curRgnEnd = -1.0;
-				}
-				SeekPlay(g_nextRgnPos);
-				return true;
+			g_playCur = _plId==g_playPlaylist ? g_playCur : _curItemId;
+			g_rgnLoop = next->m_loop;
+			if (_curItemId<0) {
+				g_curRgnPos = 0.0;
+				g_curRgnEnd = -1.0;
 			}
+			ArmPlaylistStep(_nextItemId);
+			return true;
 		}
 	}
 	return false;
 }
 
+// audio thread: watches the play position block by block and latches the
+// exact block where the armed region starts, i.e. where REAPER performed the
+// smooth seek (or reached the region when it directly follows the current one)
+// only volatile vars are shared with the main thread, see ArmPlaylistStep()
+void PlaylistOnAudioBuffer(bool _isPost, int _len, double _srate, audio_hook_register_t* _reg)
+{
+	if (_isPost || _srate<=0.0)
+		return;
+
+	if (g_playPlaylist<0 || !g_armValid || (GetPlayStateEx(NULL)&1)!=1) {
+		g_audioLastPos = -1.0;
+		return;
+	}
+
+	double pos = GetPlayPosition2Ex(NULL); // position of the block being processed
+	double halfSample = 0.5/_srate;
+	g_audioBlockLen = Master_GetPlayRate(NULL)*_len/_srate;
+
+	int seq = g_armSeq;
+	double a = g_armPos, b = g_armEnd;
+	if (g_armValid && seq==g_armSeq && seq!=g_enteredSeq && (pos+halfSample)>=a && pos<b)
+	{
+		// entering the armed range, or jumping back into it (region loop)
+		if ((g_audioLastPos+halfSample)<a || g_audioLastPos>=b || pos<g_audioLastPos)
+		{
+			g_enteredPos = pos;
+			g_enteredSeq = seq; // last!
+		}
+	}
+	g_audioLastPos = pos;
+}
+
+audio_hook_register_t g_audioHook = { PlaylistOnAudioBuffer, NULL, NULL, 0, 0, NULL };
+
+void ResetPlaylistStats()
+{
+	g_playStats.m_switches = g_playStats.m_late = 0;
+	g_playStats.m_jitterMin = g_playStats.m_jitterMax = g_playStats.m_jitterSum = 0.0;
+	g_playStats.m_leadMin = -1.0;
+}
+
 // the meat!
-// polls the playing position and smooth seeks if needed
-// remember we always lookup one region ahead!
+// region switches are detected by the audio hook (sample block accurate),
+// this func just arms the next seek as soon as the previous one is done:
+// the next region is known well ahead of time (i.e. during the whole current
+// region) so that timer cadence is not relevant anymore
 // made as idle as possible, polled via SNM_CSurfRun()
 void PlaylistRun()
 {
@@ -1399,80 +1546,67 @@ void PlaylistRun()
 		bool updated = false;
 		double pos = GetPlayPosition2Ex(NULL);
 
-		if ((pos+0.01) >= g_nextRgnPos && pos <= g_nextRgnEnd)	//JFB!! +0.01 because 'pos' can be a bit ahead of time
-																// +1 sample block would be better, but no API..
-																// note: sync loss detection could deal with this in the worst case
+		if (g_armValid && g_enteredSeq==g_armSeq)
 		{
-			// a bunch of calls end here when looping!!
+			double jitter = g_enteredPos-g_nextRgnPos;
+			if (!g_playStats.m_switches || jitter<g_playStats.m_jitterMin) g_playStats.m_jitterMin = jitter;
+			if (!g_playStats.m_switches || jitter>g_playStats.m_jitterMax) g_playStats.m_jitterMax = jitter;
+			g_playStats.m_jitterSum += jitter;
+			g_playStats.m_switches++;
 
-			if (!g_plLoop || (g_plLoop && (g_unsync || pos<g_lastRunPos)))
-			{
-				g_plLoop = false;
-
-				bool first = false;
-				if (g_playCur != g_playNext 
-/*JFB those vars are only altered here
-					|| g_curRgnPos != g_nextRgnPos || g_curRgnEnd != g_nextRgnEnd
-*/
-					)
-				{
 #ifdef _SNM_RGNPL_DEBUG1
-					 OutputDebugString("\n");
-					_snprintfSafe(dbg, sizeof(dbg), "NEXT DETECTED - pos = %f\n", pos); OutputDebugString(dbg);
-					_snprintfSafe(dbg, sizeof(dbg), "                g_curRgnPos = %f, g_curRgnEnd = %f\n", g_curRgnPos, g_curRgnEnd); OutputDebugString(dbg);
-					_snprintfSafe(dbg, sizeof(dbg), "                g_nextRgnPos = %f, g_nextRgnEnd = %f\n", g_nextRgnPos, g_nextRgnEnd); OutputDebugString(dbg);
-					_snprintfSafe(dbg, sizeof(dbg), "                g_playCur = %d, g_playNext = %d\n", g_playCur, g_playNext); OutputDebugString(dbg);
-					_snprintfSafe(dbg, sizeof(dbg), "                g_unsync = %d, g_lastRunPos = %f\n", g_unsync, g_lastRunPos); OutputDebugString(dbg);
+			OutputDebugString("\n");
+			_snprintfSafe(dbg, sizeof(dbg), "NEXT DETECTED - pos = %f, audio pos = %f (jitter: %f)\n", pos, g_enteredPos, jitter); OutputDebugString(dbg);
+			_snprintfSafe(dbg, sizeof(dbg), "                g_curRgnPos = %f, g_curRgnEnd = %f\n", g_curRgnPos, g_curRgnEnd); OutputDebugString(dbg);
+			_snprintfSafe(dbg, sizeof(dbg), "                g_nextRgnPos = %f, g_nextRgnEnd = %f\n", g_nextRgnPos, g_nextRgnEnd); OutputDebugString(dbg);
+			_snprintfSafe(dbg, sizeof(dbg), "                g_playCur = %d, g_playNext = %d, g_rgnLoop = %d\n", g_playCur, g_playNext, g_rgnLoop); OutputDebugString(dbg);
 #endif
-					first = updated = true;
-					g_playCur = g_playNext;
-					g_curRgnPos = g_nextRgnPos;
-					g_curRgnEnd = g_nextRgnEnd;
-				}
+			updated = true;
+			g_unsync = false;
 
-				// region loop?
-				if (g_rgnLoop && (first || g_unsync || pos<g_lastRunPos))
-				{
-					updated = true;
-					if (g_rgnLoop>0)
-						g_rgnLoop--;
-					if (g_rgnLoop)
-						SeekPlay(g_nextRgnPos); // then exit
-				}
+			if (g_playNext<0) // end of playlist, play will stop
+			{
+				g_armValid = false;
+			}
+			else
+			{
+				g_playCur = g_playNext;
+				g_curRgnPos = g_nextRgnPos;
+				g_curRgnEnd = g_nextRgnEnd;
 
-				if (!g_rgnLoop) // if, not else if!
-				{
-					int nextId = GetNextValidItem(g_playPlaylist, g_playCur, false, g_repeatPlaylist);
+				// region loop?
+				if (g_rgnLoop>0)
+					g_rgnLoop--;
 
-					// loop corner cases
-					// ex: 1 item in the playlist + repeat on, or repeat on + last region == first region,
-					//     or playlist = region3, then unknown region (e.g. deleted) and region3 again, or etc..
-					if (nextId>=0)
-						if (RegionPlaylist* pl = GetPlaylist(g_playPlaylist))
-							if (RgnPlaylistItem* next = pl->Get(nextId)) 
-								if (RgnPlaylistItem* cur = pl->Get(g_playCur)) 
-									g_plLoop = (cur->m_rgnId==next->m_rgnId); // valid regions at this point
+				// lead time, i.e. how long before the region end the next seek is armed
+				double lead = g_curRgnEnd-pos;
+				if (g_playStats.m_leadMin<0.0 || lead<g_playStats.m_leadMin) g_playStats.m_leadMin = lead>0.0 ? lead : 0.0;
+				if (lead<=0.0) g_playStats.m_late++;
 
+				int nextId = g_playCur;
+				if (!g_rgnLoop)
+					if (RgnPlaylistStep* cur = GetPlaylistStep(g_playCur))
+						nextId = cur->m_next;
 #ifdef _SNM_RGNPL_DEBUG1
-					_snprintfSafe(dbg, sizeof(dbg), "SEEK - Current = %d, Next = %d\n", g_playCur, nextId); OutputDebugString(dbg);
+				_snprintfSafe(dbg, sizeof(dbg), "SEEK - Current = %d, Next = %d, lead = %f\n", g_playCur, nextId, lead); OutputDebugString(dbg);
 #endif
-					if (!SeekItem(g_playPlaylist, nextId, g_playCur))
-						SeekItem(g_playPlaylist, -1, g_playCur); // end of playlist..
-					updated = true;
-				}
+				ArmPlaylistStep(nextId); // -1 (end of playlist) if the step has been removed meanwhile
 			}
-			g_unsync = false;
 		}
 		else if (g_curRgnPos<g_curRgnEnd) // relevant vars?
 		{
+			// one audio block of tolerance: 'pos' can be a bit ahead of time
+			double tol = g_audioBlockLen>0.0 ? g_audioBlockLen : 0.01;
+
 			// seek play requested, waiting for region switch..
-			if ((pos+0.01) >= g_curRgnPos && pos <= g_curRgnEnd) //JFB!! +0.01 because 'pos' can be a bit ahead of time
-																 // +1 sample block would be better, but no API..
+			if (((pos+tol) >= g_curRgnPos && pos <= g_curRgnEnd) || ((pos+tol) >= g_nextRgnPos && pos <= g_nextRgnEnd))
 			{
 				// a bunch of calls end here!
+				if (g_unsync)
+					updated = true;
 				g_unsync = false;
 			}
-			// playlist no more in sync?
+			// playlist no more in sync, e.g. the user seeked somewhere else
 			else if (!g_unsync)
 			{
 #ifdef _SNM_RGNPL_DEBUG2
@@ -1499,7 +1633,6 @@ void PlaylistRun()
 			}
 		}
 
-		g_lastRunPos = pos;
 		if (updated && (g_osc || g_rgnplWndMgr.Get()))
 		{
 			// one call to GetMonitoringInfo() for both the wnd & osc
@@ -1597,9 +1730,8 @@ void PlaylistPlay(int _plId, int _itemId)
 				GetSetRepeat(0);
 			}
 
-			g_plLoop = false;
 			g_unsync = false;
-			g_lastRunPos = SNM_GetProjectLength()+1.0;
+			ResetPlaylistStats();
 			if (SeekItem(_plId, _itemId, g_playPlaylist==_plId ? g_playCur : -1))
 			{
 				g_playPlaylist = _plId; // enables PlaylistRun()
@@ -1666,6 +1798,7 @@ void PlaylistStopped(bool _pause)
 	if (g_playPlaylist>=0 && !_pause)
 	{
 		g_playPlaylist = -1;
+		g_armValid = false;
 
 		// restore options
 		if (g_oldSeekPref >= 0)
@@ -1999,7 +2132,19 @@ void PlaylistUpdateJob::Perform() {
 ///////////////////////////////////////////////////////////////////////////////
 
 // ScheduledJob used because of multi-notifs
-void PlaylistMarkerRegionListener::NotifyMarkerRegionUpdate(int _updateFlags) {
+void PlaylistMarkerRegionListener::NotifyMarkerRegionUpdate(int _updateFlags, SNM_MarkerRegionChanges* _changes)
+{
+	// renamed/recolored markers/regions: playback is not affected, the
+	// view only needs an update if those are regions used in playlists
+	if (_changes->IsNameColorOnly())
+	{
+		for (int i=0, id; i<_changes->GetSize(); i++)
+			if (_changes->Enum(i, &id) && IsRegion(id) && IsRegionInPlaylists(id)) {
+				ScheduledJob::Schedule(new PlaylistUpdateJob(SNM_SCHEDJOB_ASYNC_DELAY_OPT));
+				break;
+			}
+		return;
+	}
 	PlaylistResync();
 	ScheduledJob::Schedule(new PlaylistUpdateJob(SNM_SCHEDJOB_ASYNC_DELAY_OPT));
 }
@@ -2120,6 +2265,9 @@ int RegionPlaylistInit()
 	if (!plugin_register("projectconfig", &s_projectconfig))
 		return 0;
 
+	// region switch detection, see PlaylistOnAudioBuffer()
+	Audio_RegHardwareHook(true, &g_audioHook);
+
 	return 1;
 }
 
@@ -2141,6 +2289,8 @@ void RegionPlaylistExit()
 	else
 		WritePrivateProfileString("RegionPlaylist", "OscFeedback", NULL, g_SNM_IniFn.Get());
 
+	Audio_RegHardwareHook(false, &g_audioHook);
+
 	DELETE_NULL(g_osc);
 	g_rgnplWndMgr.Delete();
 }
@@ -37,7 +37,7 @@
 class PlaylistMarkerRegionListener : public SNM_MarkerRegionListener {
 public:
 	PlaylistMarkerRegionListener() : SNM_MarkerRegionListener() {}
-	void NotifyMarkerRegionUpdate(int _updateFlags);
+	void NotifyMarkerRegionUpdate(int _updateFlags, SNM_MarkerRegionChanges* _changes);
 };
 
 // no other attributes (like a comment) because of the "auto-compacting" feature..
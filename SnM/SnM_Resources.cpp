@@ -208,6 +208,7 @@ enum {
 SNM_WindowManager<ResourcesWnd> g_resWndMgr(RES_WND_ID);
 WDL_PtrList<ResourceItem> g_dragResourceItems; 
 WDL_PtrList<ResourceList> g_SNM_ResSlots;
+ResourceScanner* g_resScanner = NULL; // background auto-fill, one at a time
 
 // prefs
 int g_resType = -1; // current type (user selection)
@@ -390,7 +391,7 @@ void UntieAllResFileFromProject(ReaProject* _prj, const char* _prjPath, int _typ
 ///////////////////////////////////////////////////////////////////////////////
 
 ResourceList::ResourceList(const char* _resDir, const char* _name, const char* _ext, int _flags)
-	: m_name(_name), m_ext(_ext), m_flags(_flags), WDL_PtrList<ResourceItem>()
+	: m_name(_name), m_ext(_ext), m_flags(_flags), m_pathIdxCnt(0), m_pathIdxOk(false), WDL_PtrList<ResourceItem>()
 {
 	char tmp[512]="";
 
@@ -440,7 +441,10 @@ ResourceItem* ResourceList::AddSlot(const char* _path, const char* _desc)
 {
 	char shortPath[SNM_MAX_PATH] = "";
 	GetShortResourcePath(m_resDir.Get(), _path, shortPath, sizeof(shortPath));
-	return Add(new ResourceItem(shortPath, _desc));
+	ResourceItem* item = Add(new ResourceItem(shortPath, _desc));
+	if (m_pathIdxOk)
+		IndexSlot(GetSize()-1);
+	return item;
 }
 
 // _path: short resource path or full path
@@ -450,23 +454,105 @@ ResourceItem* ResourceList::InsertSlot(int _slot, const char* _path, const char*
 	char shortPath[SNM_MAX_PATH] = "";
 	GetShortResourcePath(m_resDir.Get(), _path, shortPath, sizeof(shortPath));
 	if (_slot >=0 && _slot < GetSize())
+	{
 		item = Insert(_slot, new ResourceItem(shortPath, _desc));
+		InvalidatePathIndex(); // slots have moved
+	}
 	else
+	{
 		item = Add(new ResourceItem(shortPath, _desc));
+		if (m_pathIdxOk)
+			IndexSlot(GetSize()-1);
+	}
 	return item;
 }
 
+// case insensitive, see _stricmp() in FindByPath()
+static unsigned int HashPath(const char* _path)
+{
+	unsigned int h = 2166136261U; // FNV-1a
+	while (*_path)
+	{
+		h ^= (unsigned char)tolower((unsigned char)*_path++);
+		h *= 16777619U;
+	}
+	return h;
+}
+
+// returns the 1st slot whose full path is _fullPath, -1 if not found
+// the path index is built on demand, then maintained by AddSlot() 
+// so that auto-fill does not have to scan all slots for each file
 int ResourceList::FindByPath(const char* _fullPath)
 {
+	if (!_fullPath)
+		return -1;
+
 	char fullpath[SNM_MAX_PATH];
-	if (_fullPath)
-		for (int i=0; i<GetSize(); i++)
-			if (GetFullPath(i, fullpath, sizeof(fullpath)))
-				if (!_stricmp(_fullPath, fullpath))
-					return i;
+	if (!m_pathIdxOk)
+		BuildPathIndex();
+
+	if (m_pathIdxOk)
+	{
+		unsigned int h = HashPath(_fullPath);
+		int mask = m_pathIdx.GetSize()-1;
+		PathIndexEntry* idx = m_pathIdx.Get();
+		for (int i=h&mask; idx[i].m_slot>=0; i=(i+1)&mask)
+			if (idx[i].m_hash==h && GetFullPath(idx[i].m_slot, fullpath, sizeof(fullpath)) && !_stricmp(_fullPath, fullpath))
+				return idx[i].m_slot;
+		return -1;
+	}
+
+	// no index (alloc error)
+	for (int i=0; i<GetSize(); i++)
+		if (GetFullPath(i, fullpath, sizeof(fullpath)))
+			if (!_stricmp(_fullPath, fullpath))
+				return i;
 	return -1;
 }
 
+void ResourceList::BuildPathIndex()
+{
+	int sz=1;
+	while (sz < 2*GetSize()+16) sz<<=1; // load factor <= 50%
+
+	m_pathIdxOk = false;
+	m_pathIdxCnt = 0;
+	if (PathIndexEntry* idx = m_pathIdx.ResizeOK(sz, false))
+	{
+		for (int i=0; i<sz; i++)
+			idx[i].m_slot = -1;
+		m_pathIdxOk = true;
+		for (int i=0; i<GetSize(); i++)
+			IndexSlot(i);
+	}
+	else
+		m_pathIdx.Resize(0, false);
+}
+
+// duplicate paths are indexed once, with their 1st slot
+void ResourceList::IndexSlot(int _slot)
+{
+	if (2*(m_pathIdxCnt+1) > m_pathIdx.GetSize()) {
+		BuildPathIndex(); // grow, indexes _slot too
+		return;
+	}
+
+	char fullpath[SNM_MAX_PATH], fullpath2[SNM_MAX_PATH];
+	if (!GetFullPath(_slot, fullpath, sizeof(fullpath)))
+		return;
+
+	unsigned int h = HashPath(fullpath);
+	int mask = m_pathIdx.GetSize()-1, i = h&mask;
+	PathIndexEntry* idx = m_pathIdx.Get();
+	for (; idx[i].m_slot>=0; i=(i+1)&mask)
+		if (idx[i].m_hash==h && GetFullPath(idx[i].m_slot, fullpath2, sizeof(fullpath2)) && !_stricmp(fullpath, fullpath2))
+			return;
+
+	idx[i].m_hash = h;
+	idx[i].m_slot = _slot;
+	m_pathIdxCnt++;
+}
+
 bool ResourceList::GetFullPath(int _slot, char* _fullFn, int _fullFnSz)
 {
 	if (ResourceItem* item = Get(_slot)) {
@@ -483,6 +569,7 @@ bool ResourceList::SetFromFullPath(int _slot, const char* _fullPath)
 		char shortPath[SNM_MAX_PATH] = "";
 		GetShortResourcePath(m_resDir.Get(), _fullPath, shortPath, sizeof(shortPath));
 		item->m_shortPath.Set(shortPath);
+		InvalidatePathIndex();
 		return true;
 	}
 	return false;
@@ -589,6 +676,7 @@ bool ResourceList::ClearSlot(int _slot)
 {
 	if (_slot>=0 && _slot<GetSize()) {
 		Get(_slot)->Clear();
+		InvalidatePathIndex();
 		return true;
 	}
 	return false;
@@ -1331,7 +1419,8 @@ void ResourcesWnd::OnCommand(WPARAM wParam, LPARAM lParam)
 		// auto-fill
 		case BTNID_AUTOFILL:
 		case AUTOFILL_MSG:
-			AutoFill(g_resType);
+			if (IsAutoFilling(g_resType)) CancelAutoFill();
+			else AutoFill(g_resType);
 			break;
 		case AUTOFILL_DIR_MSG:
 		{
@@ -2058,6 +2147,7 @@ void ResourcesWnd::OnDroppedFiles(HDROP _h)
 		dropSlot = fl->GetSize();
 		for (int i=0; i < iValidFiles; i++)
 			fl->Add(new ResourceItem());
+		fl->InvalidatePathIndex();
 	}
 	// drop on a slot => insert slots at drop point
 	else 
@@ -2083,6 +2173,7 @@ void ResourcesWnd::OnDroppedFiles(HDROP _h)
 			if (ResourceItem* item = fl->Get(slot))
 			{
 				item->m_shortPath.Set(g_dragResourceItems.Get(i)->m_shortPath.Get());
+				fl->InvalidatePathIndex();
 				item->m_comment.Set(g_dragResourceItems.Get(i)->m_comment.Get());
 				dropped++;
 				pItem = fl->Get(slot+1); 
@@ -2110,6 +2201,7 @@ void ResourcesWnd::OnDroppedFiles(HDROP _h)
 					if (j < dropSlot)
 						dropSlot--;
 					fl->Delete(j, false);
+					fl->InvalidatePathIndex();
 				}
 
 		Update();
@@ -2138,7 +2230,14 @@ void ResourcesWnd::DrawControls(LICE_IBitmap* _bm, const RECT* _r, int* _tooltip
 	IconTheme* it = SNM_GetIconTheme();
 
 	// "auto-fill" button
-	SNM_SkinButton(&m_btnAutoFill, it ? &(it->toolbar_open) : NULL, __LOCALIZE("Auto-fill","sws_DLG_150"));
+	if (IsAutoFilling(g_resType))
+	{
+		char label[64] = "";
+		_snprintfSafe(label, sizeof(label), __LOCALIZE_VERFMT("Cancel (%d)","sws_DLG_150"), g_resScanner->GetNumFound());
+		SNM_SkinButton(&m_btnAutoFill, it ? &(it->toolbar_open) : NULL, label);
+	}
+	else
+		SNM_SkinButton(&m_btnAutoFill, it ? &(it->toolbar_open) : NULL, __LOCALIZE("Auto-fill","sws_DLG_150"));
 	if (SNM_AutoVWndPosition(DT_LEFT, &m_btnAutoFill, NULL, _r, &x0, _r->top, h, 0))
 	{
 		// "auto-save" button
@@ -2220,6 +2319,10 @@ bool ResourcesWnd::GetToolTipString(int _xpos, int _ypos, char* _bufOut, int _bu
 		switch (v->GetID())
 		{
 			case BTNID_AUTOFILL:
+				if (IsAutoFilling(g_resType))
+					return (_snprintfStrict(_bufOut, _bufOutSz, 
+						__LOCALIZE_VERFMT("Scanning %s (click to cancel)\n%d files found, %d slots added","sws_DLG_150"), 
+						GetAutoFillDir(), g_resScanner->GetNumFound(), g_resScanner->m_added) > 0);
 				return (_snprintfStrict(_bufOut, _bufOutSz, 
 					__LOCALIZE_VERFMT("Auto-fill %s slots (right-click for options)\nfrom %s","sws_DLG_150"), 
 					g_SNM_ResSlots.Get(typeForUser)->GetName(), 
@@ -2335,6 +2438,7 @@ void ResourcesWnd::AddSlot()
 	{
 		int idx = fl->GetSize();
 		if (fl->Add(new ResourceItem())) {
+			fl->InvalidatePathIndex();
 			Update();
 			SelectBySlot(idx);
 		}
@@ -2420,6 +2524,7 @@ bool AutoSaveSlot(int _type, const char* _dirPath,
 					char shortPath[SNM_MAX_PATH] = "";
 					GetShortResourcePath(g_SNM_ResSlots.Get(_type)->GetResourceDir(), fn, shortPath, sizeof(shortPath));
 					_owSlots->Get(*_owIdx)->m_shortPath.Set(shortPath);
+					g_SNM_ResSlots.Get(_type)->InvalidatePathIndex();
 				}
 			}
 			saved = (SaveSlot ? SaveSlot(_obj, fn) : SNM_CopyFile(fn, _name));
@@ -2444,6 +2549,7 @@ bool AutoSaveSlot(int _type, const char* _dirPath,
 				char shortPath[SNM_MAX_PATH] = "";
 				GetShortResourcePath(g_SNM_ResSlots.Get(_type)->GetResourceDir(), fn, shortPath, sizeof(shortPath));
 				_owSlots->Get(*_owIdx-1)->m_shortPath.Set(shortPath);
+				g_SNM_ResSlots.Get(_type)->InvalidatePathIndex();
 			}
 		}
 	}
@@ -2555,7 +2661,121 @@ void AutoSave(int _type, bool _ow, int _flags)
 	}
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// ResourceScanner
+///////////////////////////////////////////////////////////////////////////////
+
+#define SNM_RES_SCAN_BATCH		256		// files passed to the main thread in one go
+#define SNM_RES_SCAN_MAX_ADD	1000	// max. number of files processed per ResourcesScanRun() call
+#define SNM_RES_SCAN_UPDATE_MS	500		// GUI refresh rate while scanning
+
+ResourceScanner::ResourceScanner(int _type, ResourceList* _list, const char* _dir, const char* _fileFilter)
+	: m_startSlot(_list ? _list->GetSize() : 0), m_added(0), m_type(_type), m_list(_list), m_dir(_dir), m_filter(_fileFilter), 
+	m_filesPos(0), m_cancel(false), m_done(false), m_found(0)
+{
+	m_thread = (HANDLE)_beginthreadex(NULL, 0, ScanThread, (void*)this, 0, NULL);
+	if (!m_thread)
+		m_done = true;
+}
+
+ResourceScanner::~ResourceScanner()
+{
+	m_cancel = true;
+	if (m_thread)
+	{
+		WaitForSingleObject(m_thread, INFINITE);
+		CloseHandle(m_thread);
+	}
+	for (int i=m_filesPos; i<m_files.GetSize(); i++)
+		delete m_files.Get(i);
+	m_files.Empty(false);
+}
+
+unsigned WINAPI ResourceScanner::ScanThread(void* _scanner)
+{
+	ResourceScanner* scanner = (ResourceScanner*)_scanner;
+	WDL_PtrList<WDL_FastString> batch;
+	scanner->Scan(scanner->m_dir.Get(), &batch);
+	scanner->Flush(&batch);
+	scanner->m_done = true; // last! files are all flushed at this point
+	return 0;
+}
+
+// same filtering as ScanFiles(), but cancelable and results are streamed
+void ResourceScanner::Scan(const char* _dir, WDL_PtrList<WDL_FastString>* _batch)
+{
+	WDL_DirScan ds;
+	if (!_dir || m_cancel || ds.First(_dir))
+		return;
+
+	WDL_String fn, ext;
+	do 
+	{
+		const char* curFn = ds.GetCurrentFN();
+		if (!strcmp(curFn, ".") || !strcmp(curFn, "..")) 
+			continue;
+
+		if (ds.GetCurrentIsDirectory())
+		{
+			ds.GetCurrentFullFN(&fn);
+			Scan(fn.Get(), _batch);
+		}
+		else
+		{
+			bool match = !strcmp("*", m_filter.Get());
+			if (!match)
+			{
+				const char* curfnExt = GetFileExtension(curFn);
+				if (*curfnExt)
+				{
+					ext.SetFormatted(32, "*.%s", curfnExt);
+					match = (stristr(m_filter.Get(), ext.Get()) != NULL);
+				}
+			}
+			if (match)
+			{
+				ds.GetCurrentFullFN(&fn);
+				_batch->Add(new WDL_FastString(fn.Get()));
+				if (_batch->GetSize() >= SNM_RES_SCAN_BATCH)
+					Flush(_batch);
+			}
+		}
+	}
+	while (!m_cancel && !ds.Next());
+}
+
+void ResourceScanner::Flush(WDL_PtrList<WDL_FastString>* _batch)
+{
+	if (int sz = _batch->GetSize())
+	{
+		SWS_SectionLock lock(&m_mutex);
+		for (int i=0; i<sz; i++)
+			m_files.Add(_batch->Get(i));
+		m_found += sz;
+		_batch->Empty(false);
+	}
+}
+
+// moves (at most _max) found files to _files, returns the number of moved files
+int ResourceScanner::GetFiles(WDL_PtrList<WDL_FastString>* _files, int _max)
+{
+	SWS_SectionLock lock(&m_mutex);
+	int sz = min(_max, m_files.GetSize()-m_filesPos);
+	for (int i=0; i<sz; i++)
+		_files->Add(m_files.Get(m_filesPos++));
+	if (m_filesPos >= m_files.GetSize()) { // all consumed
+		m_files.Empty(false);
+		m_filesPos = 0;
+	}
+	return sz;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
 // recursive from auto-fill path
+// the directory tree is scanned in background, see ResourcesScanRun()
+// this is incremental: files that are already present are skipped
 void AutoFill(int _type)
 {
 	ResourceList* fl = g_SNM_ResSlots.Get(_type);
@@ -2565,35 +2785,89 @@ void AutoFill(int _type)
 	if (!CheckSetAutoDirectory(__LOCALIZE("Auto-fill","sws_DLG_150"), _type, false))
 		return;
 
-	int startSlot = g_SNM_ResSlots.Get(_type)->GetSize();
+	CancelAutoFill(); // one scan at a time
 
 	char fileFilter[2048] = ""; // filters need some room!
 	fl->GetFileFilter(fileFilter, sizeof(fileFilter), false);
+	g_resScanner = new ResourceScanner(_type, fl, GetAutoFillDir(_type), fileFilter);
 
-	WDL_PtrList_DeleteOnDestroy<WDL_String> files; 
-	ScanFiles(&files, GetAutoFillDir(_type), fileFilter, true);
-	if (int sz = files.GetSize())
-		for (int i=0; i<sz; i++)
-			if (fl->FindByPath(files.Get(i)->Get()) < 0) { // skip if already present
-				TieResFileToProject(files.Get(i)->Get(), _type);
-				fl->AddSlot(files.Get(i)->Get());
-			}
+	if (ResourcesWnd* w = g_resWndMgr.Get())
+		w->Update(); // auto-fill button
+}
 
-	if (startSlot != fl->GetSize())
+bool IsAutoFilling(int _type) {
+	return (g_resScanner && g_resScanner->GetType()==_type);
+}
+
+// slots already added are kept
+void CancelAutoFill()
+{
+	if (g_resScanner)
 	{
-		if (g_resType==_type)
-			if (ResourcesWnd* w = g_resWndMgr.Get()) {
+		DELETE_NULL(g_resScanner);
+		if (ResourcesWnd* w = g_resWndMgr.Get())
+			w->Update();
+	}
+}
+
+// polled from the main thread via SNM_CSurfRun()
+// adds files found by the background auto-fill to slots, by batches
+void ResourcesScanRun()
+{
+	if (!g_resScanner)
+		return;
+
+	int type = g_resScanner->GetType();
+	ResourceList* fl = g_SNM_ResSlots.Get(type);
+	if (!fl || fl != g_resScanner->GetList()) { // slot type removed meanwhile
+		CancelAutoFill();
+		return;
+	}
+
+	bool done = g_resScanner->IsDone(); // before GetFiles(), see ScanThread()
+	WDL_PtrList_DeleteOnDestroy<WDL_FastString> files;
+	int added=0, nb=g_resScanner->GetFiles(&files, SNM_RES_SCAN_MAX_ADD);
+	for (int i=0; i<nb; i++)
+		if (fl->FindByPath(files.Get(i)->Get()) < 0) // skip if already present
+		{
+			TieResFileToProject(files.Get(i)->Get(), type);
+			fl->AddSlot(files.Get(i)->Get());
+			added++;
+		}
+	g_resScanner->m_added += added;
+
+	ResourcesWnd* w = (g_resType==type ? g_resWndMgr.Get() : NULL);
+	if (done && nb<SNM_RES_SCAN_MAX_ADD)
+	{
+		int startSlot = g_resScanner->m_startSlot, totAdded = g_resScanner->m_added;
+		DELETE_NULL(g_resScanner);
+
+		if (totAdded)
+		{
+			if (w) {
 				w->Update();
-				w->SelectBySlot(startSlot, g_SNM_ResSlots.Get(_type)->GetSize());
+				w->SelectBySlot(startSlot, fl->GetSize());
 			}
+		}
+		else
+		{
+			if (w) w->Update(); // auto-fill button
+
+			const char* path = GetAutoFillDir(type);
+			char msg[SNM_MAX_PATH]="";
+			if (path && *path) _snprintfSafe(msg, sizeof(msg), __LOCALIZE_VERFMT("No slot added from: %s\n%s","sws_DLG_150"), path, AUTOFILL_ERR_STR);
+			else _snprintfSafe(msg, sizeof(msg), __LOCALIZE_VERFMT("No slot added!\n%s","sws_DLG_150"), AUTOFILL_ERR_STR);
+			MessageBox(g_resWndMgr.GetMsgHWND(), msg, __LOCALIZE("S&M - Warning","sws_DLG_150"), MB_OK);
+		}
 	}
-	else
+	else if (w)
 	{
-		const char* path = GetAutoFillDir(_type);
-		char msg[SNM_MAX_PATH]="";
-		if (path && *path) _snprintfSafe(msg, sizeof(msg), __LOCALIZE_VERFMT("No slot added from: %s\n%s","sws_DLG_150"), path, AUTOFILL_ERR_STR);
-		else _snprintfSafe(msg, sizeof(msg), __LOCALIZE_VERFMT("No slot added!\n%s","sws_DLG_150"), AUTOFILL_ERR_STR);
-		MessageBox(g_resWndMgr.GetMsgHWND(), msg, __LOCALIZE("S&M - Warning","sws_DLG_150"), MB_OK);
+		// moderate GUI updates (progress + slots streamed so far)
+		static DWORD sLastUpdate = 0;
+		if (int(GetTickCount()-sLastUpdate) >= SNM_RES_SCAN_UPDATE_MS) {
+			sLastUpdate = GetTickCount();
+			w->Update();
+		}
 	}
 }
 
@@ -2684,6 +2958,7 @@ WDL_FastString* GetOrPromptOrBrowseSlot(int _type, int* _slot)
 	bool uiUpdate = (*_slot >= fl->GetSize());
 	while (*_slot >= fl->GetSize())
 		fl->Add(new ResourceItem());
+	fl->InvalidatePathIndex();
 
 	// get filename or browse if the slot is empty (macro friendly)
 	char fn[SNM_MAX_PATH]="";
@@ -2768,6 +3043,7 @@ void ClearDeleteSlotsFiles(int _type, int _mode, int _slot)
 				{
 					slots.Delete(slot, false); // keep the sel list "in sync"
 					fl->Delete(slot, false); // remove slot, pointer not deleted yet
+					fl->InvalidatePathIndex();
 					delItems.Add(item); // for later pointer deletion..
 				}
 				else if (_mode&2)
@@ -3074,6 +3350,8 @@ void DeleteBookmark(int _bookmarkType)
 			g_autoFillDirs.Delete(oldType, true);
 			g_tiedProjects.Delete(oldType, true);
 			g_syncAutoDirPrefs[oldType] = true;
+			if (g_resScanner && g_resScanner->GetType()>=oldType)
+				CancelAutoFill(); // slot types have moved
 			g_SNM_ResSlots.Delete(oldType, true);
 
 			if (ResourcesWnd* w = g_resWndMgr.Get()) {
@@ -3299,6 +3577,7 @@ int ResourcesInit()
 				ReadSlotIniFile(iniSec, j, path, sizeof(path), desc, sizeof(desc));
 				list->Add(new ResourceItem(path, desc));
 			}
+			list->InvalidatePathIndex();
 		}
 	}
 
@@ -3313,6 +3592,8 @@ int ResourcesInit()
 
 void ResourcesExit()
 {
+	DELETE_NULL(g_resScanner); // waits for the scan thread
+
 	WDL_FastString iniStr, escapedStr;
 	WDL_PtrList_DeleteOnDestroy<WDL_FastString> iniSections;
 	GetIniSectionNames(&iniSections);
@@ -80,6 +80,7 @@ class ResourceList : public WDL_PtrList<ResourceItem>
 	ResourceItem* AddSlot(const char* _path="", const char* _desc="");
 	ResourceItem* InsertSlot(int _slot, const char* _path="", const char* _desc="");
 	int FindByPath(const char* _fullPath);
+	void InvalidatePathIndex() { m_pathIdxOk = false; } // must be called when slots are altered directly
 	bool GetFullPath(int _slot, char* _fullFn, int _fullFnSz);
 	bool SetFromFullPath(int _slot, const char* _fullPath);
 	bool ClearSlot(int _slot);
@@ -101,7 +102,50 @@ protected:
 	WDL_FastString m_ext;				// file extensions w/o '.' (ex: "rfxchain"), "" means all supported media file extensions
 	int m_flags;						// see bitmask definition above
 private:
+	void BuildPathIndex();
+	void IndexSlot(int _slot);
+
+	struct PathIndexEntry {
+		unsigned int m_hash;
+		int m_slot;						// <0 means "free entry"
+	};
+
 	WDL_PtrList<WDL_FastString> m_exts;	// split file extensions
+	WDL_TypedBuf<PathIndexEntry> m_pathIdx; // open addressing: full path -> 1st slot, see FindByPath()
+	int m_pathIdxCnt;
+	bool m_pathIdxOk;
+};
+
+
+// scans a directory tree in a worker thread, found files are added 
+// to slots by batches from the main thread, see ResourcesScanRun()
+class ResourceScanner
+{
+public:
+	ResourceScanner(int _type, ResourceList* _list, const char* _dir, const char* _fileFilter);
+	~ResourceScanner();
+	void Cancel() { m_cancel = true; }
+	bool IsCancelled() { return m_cancel; }
+	bool IsDone() { return m_done; }
+	int GetNumFound() { return m_found; }
+	int GetFiles(WDL_PtrList<WDL_FastString>* _files, int _max);
+	int GetType() { return m_type; }
+	ResourceList* GetList() { return m_list; }
+	int m_startSlot, m_added;
+private:
+	static unsigned WINAPI ScanThread(void* _scanner);
+	void Scan(const char* _dir, WDL_PtrList<WDL_FastString>* _batch);
+	void Flush(WDL_PtrList<WDL_FastString>* _batch);
+
+	int m_type;
+	ResourceList* m_list;
+	WDL_FastString m_dir, m_filter;
+	WDL_PtrList<WDL_FastString> m_files; // found files, not processed yet from m_filesPos
+	int m_filesPos;
+	SWS_Mutex m_mutex;
+	HANDLE m_thread;
+	volatile bool m_cancel, m_done;
+	volatile int m_found;
 };
 
 
@@ -184,6 +228,9 @@ bool AutoSaveSlot(int _slotType, const char* _dirPath,
 				bool (*SaveSlot)(const void*, const char*)=NULL, const void* _obj=NULL);
 void AutoSave(int _type, bool _ow, int _flags = 0);
 void AutoFill(int _type);
+bool IsAutoFilling(int _type);
+void CancelAutoFill();
+void ResourcesScanRun();
 
 bool BrowseSlot(int _type, int _slot, bool _tieUntiePrj, char* _fn = NULL, int _fnSz = 0, bool* _updatedList = NULL);
 WDL_FastString* GetOrPromptOrBrowseSlot(int _type, int* _slot);
@@ -862,10 +862,12 @@ bool ApplyTrackTemplate(MediaTrack* _tr, WDL_FastString* _tmplt, bool _itemsFrom
 			WDL_PtrList<SNM_ChunkParserPatcher> ps; ps.Add(p);
 			PasteSendsReceives(&trs, &snds, &rcvs, &ps);
 
+			// both lines in one pass
+			SNM_ChunkTransaction t(p); // auto-commit on destroy
 			if (busLine.GetLength())
-				p->ReplaceLine("TRACK", "ISBUS", 1, 0, busLine.Get(), "BUSCOMP");
+				t.AddLineEdit("TRACK", "ISBUS", 1, 0, busLine.Get());
 			if (compbusLine.GetLength())
-				p->ReplaceLine("TRACK", "BUSCOMP", 1, 0, compbusLine.Get(), "SHOWINMIX");
+				t.AddLineEdit("TRACK", "BUSCOMP", 1, 0, compbusLine.Get());
 		}
 
 /*JFB!! works with SNM_ChunkParserPatcher v2 + "SNM_SendPatcher" to remove
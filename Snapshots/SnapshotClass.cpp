@@ -30,9 +30,91 @@
 #include "../../WDL/projectcontext.h"
 #include "../reaper/localize.h"
 #include "../Utility/Base64.h"
+#include "../Breeder/BR_ThreadPool.h"
 #include "SnapshotClass.h"
 #include "Snapshots.h"
 
+// Uncomment to print the time spent per mask category on every recall
+//#define SS_DEBUG
+
+#define SS_DIFF_MIN_BATCH	8 // tracks per compare job, fewer are compared inline (cheaper than waking a thread)
+
+// "Std" envelopes stored in a track snapshot
+// JFB note: localized env names are retrieved in GetSetEnvelope()
+static const char* cSSEnvNames[SS_NUM_ENVS] = { "Volume (Pre-FX)", "Volume", "Pan (Pre-FX)", "Pan", "Width (Pre-FX)", "Width", "Mute" };
+static const int cSSEnvMasks[SS_NUM_ENVS] = { VOL_MASK, VOL_MASK, PAN_MASK, PAN_MASK, PAN_MASK, PAN_MASK, MUTE_MASK };
+static WDL_FastString TrackSnapshot::* const cSSEnvs[SS_NUM_ENVS] = { &TrackSnapshot::m_sVolEnv, &TrackSnapshot::m_sVolEnv2, &TrackSnapshot::m_sPanEnv,
+	&TrackSnapshot::m_sPanEnv2, &TrackSnapshot::m_sWidthEnv, &TrackSnapshot::m_sWidthEnv2, &TrackSnapshot::m_sMuteEnv };
+
+static BR_ThreadPool* g_diffPool = NULL; // created on first large recall
+
+#ifdef SS_DEBUG
+enum { SS_TIME_GATHER, SS_TIME_COMPARE, SS_TIME_VOL, SS_TIME_PAN, SS_TIME_MUTE, SS_TIME_SOLO, SS_TIME_VIS, SS_TIME_SEL,
+	SS_TIME_FXATM, SS_TIME_FXCHAIN, SS_TIME_SENDS, SS_TIME_OBJSTATE, SS_NUM_TIMES };
+static const char* cSSTimeNames[SS_NUM_TIMES] = { "read live", "compare", "volume", "pan", "mute", "solo", "visibility", "selection",
+	"fx (old)", "fx chain", "sends", "write chunks" };
+static double g_dRecallTime[SS_NUM_TIMES];
+
+static double SS_GetTime()
+{
+#ifdef _WIN32
+	LARGE_INTEGER count, freq;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&freq);
+	return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.0;
+#endif
+}
+
+// Adds the time spent in its scope to a recall category
+class SS_RecallTimer
+{
+public:
+	SS_RecallTimer(int iCat):m_iCat(iCat),m_dStart(SS_GetTime()) {}
+	~SS_RecallTimer() { g_dRecallTime[m_iCat] += SS_GetTime() - m_dStart; }
+private:
+	int m_iCat;
+	double m_dStart;
+};
+#define SS_RECALL_TIMER(cat) SS_RecallTimer ssTimer(cat)
+#else
+#define SS_RECALL_TIMER(cat)
+#endif
+
+// Recall only writes values that differ from the live ones: every write marks
+// the project dirty, notifies control surfaces and can trigger redraws
+static void SS_SetTrackInfo(MediaTrack* tr, const char* parm, double val)
+{
+	double* cur = (double*)GetSetMediaTrackInfo(tr, parm, NULL);
+	if (!cur || *cur != val)
+		GetSetMediaTrackInfo(tr, parm, &val);
+}
+
+static void SS_SetTrackInfo(MediaTrack* tr, const char* parm, int val)
+{
+	int* cur = (int*)GetSetMediaTrackInfo(tr, parm, NULL);
+	if (!cur || *cur != val)
+		GetSetMediaTrackInfo(tr, parm, &val);
+}
+
+static void SS_SetTrackInfo(MediaTrack* tr, const char* parm, bool val)
+{
+	bool* cur = (bool*)GetSetMediaTrackInfo(tr, parm, NULL);
+	if (!cur || *cur != val)
+		GetSetMediaTrackInfo(tr, parm, &val);
+}
+
+// Sets the envelopes of a mask category that differ from the live ones (all of them without a diff)
+static void SS_SetEnvelopes(TrackSnapshot* ts, MediaTrack* tr, int mask, TrackSnapshotDiff* diff)
+{
+	for (int i = 0; i < SS_NUM_ENVS; i++)
+		if ((mask & cSSEnvMasks[i]) && (!diff || diff->EnvChanged(i)))
+			TrackSnapshot::GetSetEnvelope(tr, &(ts->*cSSEnvs[i]), cSSEnvNames[i], true);
+}
+
 FXSnapshot::FXSnapshot(MediaTrack* tr, int fx)
 {
 	m_iCurParam = 0;
@@ -121,23 +203,23 @@ void FXSnapshot::RestoreParams(const char* str)
 		m_dParams[m_iCurParam++] = newDoubles[i];
 }
 
-int FXSnapshot::UpdateReaper(MediaTrack* tr, bool* bMatched, int num)
+int FXSnapshot::UpdateReaper(MediaTrack* tr, FXSnapshotLive* live, int num)
 {
 	// Match the name and count of the FX
 	int fx;
-	char name[256];
 	for (fx = 0; fx < num; fx++)
-	{
-		TrackFX_GetFXName(tr, fx, name, 256);
-		if (!bMatched[fx] && strcmp(m_cName, name) == 0 && m_iNumParams == TrackFX_GetNumParams(tr, fx))
+		if (!live[fx].bMatched && m_iNumParams == live[fx].iNumParams && strcmp(m_cName, live[fx].cName) == 0)
 			break;
-	}
 
 	if (fx >= num)
 		return -1;
+	live[fx].bMatched = true;
 
+	// Setting a param goes through the plugin, reading it back is much cheaper
+	double d1, d2;
 	for (int i = 0; i < m_iNumParams; i++)
-		TrackFX_SetParam(tr, fx, i, m_dParams[i]);
+		if (TrackFX_GetParam(tr, fx, i, &d1, &d2) != m_dParams[i])
+			TrackFX_SetParam(tr, fx, i, m_dParams[i]);
 
 	return fx;
 }
@@ -276,7 +358,7 @@ TrackSnapshot::~TrackSnapshot()
 }
 
 // Returns true if cannot find the track to update!
-bool TrackSnapshot::UpdateReaper(int mask, bool bSelOnly, int* fxErr, WDL_PtrList<TrackSendFix>* pFix)
+bool TrackSnapshot::UpdateReaper(int mask, bool bSelOnly, int* fxErr, WDL_PtrList<TrackSendFix>* pFix, TrackSnapshotDiff* diff)
 {
 	MediaTrack* tr = GuidToTrack(&m_guid);
 	if (!tr)
@@ -288,64 +370,79 @@ bool TrackSnapshot::UpdateReaper(int mask, bool bSelOnly, int* fxErr, WDL_PtrLis
 
 	if (mask & VOL_MASK)
 	{
-		GetSetMediaTrackInfo(tr, "D_VOL", &m_dVol);
-		GetSetEnvelope(tr, &m_sVolEnv, "Volume (Pre-FX)", true);
-		GetSetEnvelope(tr, &m_sVolEnv2, "Volume", true);
+		SS_RECALL_TIMER(SS_TIME_VOL);
+		SS_SetTrackInfo(tr, "D_VOL", m_dVol);
+		SS_SetEnvelopes(this, tr, VOL_MASK, diff);
 	}
 	if (mask & PAN_MASK)
 	{
-		GetSetMediaTrackInfo(tr, "D_PAN", &m_dPan);
-		GetSetMediaTrackInfo(tr, "I_PANMODE", &m_iPanMode);
-		GetSetMediaTrackInfo(tr, "D_WIDTH", &m_dPanWidth);
-		GetSetMediaTrackInfo(tr, "D_DUALPANL", &m_dPanL);
-		GetSetMediaTrackInfo(tr, "D_DUALPANR", &m_dPanR);
+		SS_RECALL_TIMER(SS_TIME_PAN);
+		SS_SetTrackInfo(tr, "D_PAN", m_dPan);
+		SS_SetTrackInfo(tr, "I_PANMODE", m_iPanMode);
+		SS_SetTrackInfo(tr, "D_WIDTH", m_dPanWidth);
+		SS_SetTrackInfo(tr, "D_DUALPANL", m_dPanL);
+		SS_SetTrackInfo(tr, "D_DUALPANR", m_dPanR);
 		if (m_dPanLaw != -100.0)
-			GetSetMediaTrackInfo(tr, "D_PANLAW", &m_dPanLaw);
-		GetSetEnvelope(tr, &m_sPanEnv, "Pan (Pre-FX)", true);
-		GetSetEnvelope(tr, &m_sPanEnv2, "Pan", true);
-		GetSetEnvelope(tr, &m_sWidthEnv, "Width (Pre-FX)", true);
-		GetSetEnvelope(tr, &m_sWidthEnv2, "Width", true);
+			SS_SetTrackInfo(tr, "D_PANLAW", m_dPanLaw);
+		SS_SetEnvelopes(this, tr, PAN_MASK, diff);
 	}
 	if (mask & MUTE_MASK)
 	{
-		GetSetMediaTrackInfo(tr, "B_MUTE", &m_bMute);
-		GetSetEnvelope(tr, &m_sMuteEnv, "Mute", true);
+		SS_RECALL_TIMER(SS_TIME_MUTE);
+		SS_SetTrackInfo(tr, "B_MUTE", m_bMute);
+		SS_SetEnvelopes(this, tr, MUTE_MASK, diff);
 	}
 	if (mask & SOLO_MASK)
-		GetSetMediaTrackInfo(tr, "I_SOLO", &m_iSolo);
+	{
+		SS_RECALL_TIMER(SS_TIME_SOLO);
+		SS_SetTrackInfo(tr, "I_SOLO", m_iSolo);
+	}
 	if (mask & VIS_MASK)
-		SetTrackVis(tr, m_iVis); // ignores master
+	{
+		SS_RECALL_TIMER(SS_TIME_VIS);
+		if (GetTrackVis(tr) != m_iVis)
+			SetTrackVis(tr, m_iVis); // ignores master
+	}
 	if (mask & SEL_MASK)
-		GetSetMediaTrackInfo(tr, "I_SELECTED", &m_iSel);
+	{
+		SS_RECALL_TIMER(SS_TIME_SEL);
+		if (iSel != m_iSel)
+			GetSetMediaTrackInfo(tr, "I_SELECTED", &m_iSel);
+	}
 	if (mask & FXATM_MASK) // DEPRECATED, keep for previously saved snapshots
 	{
-		GetSetMediaTrackInfo(tr, "I_FXEN", &m_iFXEn);
+		SS_RECALL_TIMER(SS_TIME_FXATM);
+		SS_SetTrackInfo(tr, "I_FXEN", m_iFXEn);
 		int numFX = TrackFX_GetCount(tr);
 		if (numFX)
 		{
-			bool* bMatched = new bool[numFX];
-			memset(bMatched, 0, sizeof(bool) * numFX);
-			for (int i = 0; i < m_fx.GetSize(); i++)
+			FXSnapshotLive* live = new FXSnapshotLive[numFX];
+			for (int fx = 0; fx < numFX; fx++)
 			{
-				int match = m_fx.Get(i)->UpdateReaper(tr, bMatched, numFX);
-				if (match >= 0)
-					bMatched[match] = true;
-				else
-					(*fxErr)++;
+				TrackFX_GetFXName(tr, fx, live[fx].cName, 256);
+				live[fx].iNumParams = TrackFX_GetNumParams(tr, fx);
+				live[fx].bMatched = false;
 			}
-			delete [] bMatched;
+			for (int i = 0; i < m_fx.GetSize(); i++)
+				if (m_fx.Get(i)->UpdateReaper(tr, live, numFX) < 0)
+					(*fxErr)++;
+			delete [] live;
 		}
 		else
 			*fxErr += m_fx.GetSize();
 	}
 	if (mask & FXCHAIN_MASK)
 	{
-		GetSetMediaTrackInfo(tr, "I_FXEN", &m_iFXEn);
-		SetFXChain(tr, m_sFXChain.Get());
+		SS_RECALL_TIMER(SS_TIME_FXCHAIN);
+		SS_SetTrackInfo(tr, "I_FXEN", m_iFXEn);
+		if (!diff || diff->m_bFXChainDiff)
+			SetFXChain(tr, m_sFXChain.Get());
 	}
 	if (mask & SENDS_MASK)
 	{
-		m_sends.UpdateReaper(tr, pFix);
+		SS_RECALL_TIMER(SS_TIME_SENDS);
+		if (!diff || diff->m_bSendsDiff)
+			m_sends.UpdateReaper(tr, pFix);
 	}
 	
 	return false;
@@ -657,6 +754,110 @@ bool TrackSnapshot::ProcessEnv(const char* chunk, char* line, int iLineMax, int*
 	return false;
 }
 
+TrackSnapshotDiff::TrackSnapshotDiff(TrackSnapshot* ts, MediaTrack* tr, int mask)
+:m_ts(ts), m_iMask(mask), m_iEnvDiff(0), m_bFXChainDiff(false), m_bSendsDiff(false)
+{
+	// Empty snapshot envelopes are never set, no need to read the live ones
+	for (int i = 0; i < SS_NUM_ENVS; i++)
+		if ((mask & cSSEnvMasks[i]) && (ts->*cSSEnvs[i]).GetLength())
+			TrackSnapshot::GetSetEnvelope(tr, &m_sEnvs[i], cSSEnvNames[i], false);
+	if (mask & FXCHAIN_MASK)
+		GetFXChain(tr, &m_sFXChain);
+	if (mask & SENDS_MASK)
+		m_sends.Build(tr);
+}
+
+// No REAPER API calls in here, called from worker threads
+void TrackSnapshotDiff::Compare()
+{
+	for (int i = 0; i < SS_NUM_ENVS; i++)
+	{
+		WDL_FastString* env = &(m_ts->*cSSEnvs[i]);
+		if ((m_iMask & cSSEnvMasks[i]) && env->GetLength() && strcmp(env->Get(), m_sEnvs[i].Get()))
+			m_iEnvDiff |= 1 << i;
+	}
+	if (m_iMask & FXCHAIN_MASK)
+	{
+		const char* ss = m_ts->m_sFXChain.GetSize() ? m_ts->m_sFXChain.Get() : "";
+		const char* live = m_sFXChain.GetSize() ? m_sFXChain.Get() : "";
+		m_bFXChainDiff = strcmp(ss, live) != 0;
+	}
+	if (m_iMask & SENDS_MASK)
+	{
+		WDL_FastString ss, live;
+		m_ts->m_sends.GetChunk(&ss);
+		m_sends.GetChunk(&live);
+		m_bSendsDiff = strcmp(ss.Get(), live.Get()) != 0;
+	}
+}
+
+struct SS_DiffBatch
+{
+	WDL_PtrList<TrackSnapshotDiff>* diffs;
+	int iStart;
+	int iEnd;
+};
+
+static unsigned WINAPI CompareDiffBatch(void* pBatch)
+{
+	SS_DiffBatch* b = (SS_DiffBatch*)pBatch;
+	for (int i = b->iStart; i < b->iEnd; i++)
+		if (TrackSnapshotDiff* diff = b->diffs->Get(i))
+			diff->Compare();
+	return 0;
+}
+
+// Splits the diffs into one batch per core, the last batch runs on the calling thread
+static void CompareDiffs(WDL_PtrList<TrackSnapshotDiff>* diffs)
+{
+	int nbBatches = diffs->GetSize() / SS_DIFF_MIN_BATCH;
+	if (nbBatches > BR_ThreadPool::GetCoreCount())
+		nbBatches = BR_ThreadPool::GetCoreCount();
+	if (nbBatches <= 1)
+	{
+		SS_DiffBatch b = { diffs, 0, diffs->GetSize() };
+		CompareDiffBatch(&b);
+		return;
+	}
+
+	if (!g_diffPool)
+		g_diffPool = new BR_ThreadPool();
+
+	WDL_TypedBuf<SS_DiffBatch> batches;
+	WDL_TypedBuf<HANDLE> jobs;
+	batches.Resize(nbBatches, false);
+	jobs.Resize(nbBatches, false);
+	for (int i = 0; i < nbBatches; i++)
+	{
+		SS_DiffBatch* b = &batches.Get()[i];
+		b->diffs = diffs;
+		b->iStart = diffs->GetSize() * i / nbBatches;
+		b->iEnd = diffs->GetSize() * (i+1) / nbBatches;
+		jobs.Get()[i] = i < nbBatches-1 ? g_diffPool->Queue(CompareDiffBatch, b) : NULL;
+	}
+	CompareDiffBatch(&batches.Get()[nbBatches-1]);
+
+	for (int i = 0; i < nbBatches-1; i++)
+	{
+		if (jobs.Get()[i])
+		{
+			WaitForSingleObject(jobs.Get()[i], INFINITE);
+			CloseHandle(jobs.Get()[i]);
+		}
+		else
+			CompareDiffBatch(&batches.Get()[i]);
+	}
+}
+
+void SnapshotRecallExit()
+{
+	if (g_diffPool)
+	{
+		g_diffPool->Shutdown();
+		DELETE_NULL(g_diffPool);
+	}
+}
+
 Snapshot::Snapshot(int slot, int mask, bool bSelOnly, const char* name, const char* notes)
 {
 	m_iSlot = slot;
@@ -815,19 +1016,49 @@ bool Snapshot::UpdateReaper(int mask, bool bSelOnly, bool bHideNewVis)
 	//Undo_BeginBlock();
 	int trackErr = 0, fxErr = 0;
 	WDL_PtrList<TrackSendFix> sendFixes;
+	WDL_PtrList<TrackSnapshotDiff> diffs; // same indexes as m_tracks, NULL for tracks not recalled
+	mask &= m_iMask;
+#ifdef SS_DEBUG
+	memset(g_dRecallTime, 0, sizeof(g_dRecallTime));
+	double dStart = SS_GetTime();
+#endif
 
-	// Do "non-chunk" stuff first
-	for (int i = 0; i < m_tracks.GetSize(); i++)
-		m_tracks.Get(i)->UpdateReaper(mask & m_iMask & ~CHUNK_MASK, bSelOnly, &fxErr, &sendFixes);
-	
-	// Then cache all ObjectState changes for the chunk updating
+	// Cache all ObjectState reads and changes, read the live state of the tracks first...
 	SWS_CacheObjectState(true);
+	{
+		SS_RECALL_TIMER(SS_TIME_GATHER);
+		for (int i = 0; i < m_tracks.GetSize(); i++)
+		{
+			TrackSnapshot* ts = m_tracks.Get(i);
+			MediaTrack* tr = GuidToTrack(&ts->m_guid);
+			if (tr && (!bSelOnly || *(int*)GetSetMediaTrackInfo(tr, "I_SELECTED", NULL)))
+				diffs.Add(new TrackSnapshotDiff(ts, tr, mask));
+			else
+				diffs.Add(NULL);
+		}
+	}
+
+	// ...compare it against the snapshot on worker threads...
+	{
+		SS_RECALL_TIMER(SS_TIME_COMPARE);
+		CompareDiffs(&diffs);
+	}
+
+	// ...then do the chunk updating, straight from the cache filled above
 	for (int i = 0; i < m_tracks.GetSize(); i++)
-		if (m_tracks.Get(i)->UpdateReaper(mask & m_iMask & CHUNK_MASK, bSelOnly, &fxErr, &sendFixes))
+		if (m_tracks.Get(i)->UpdateReaper(mask & CHUNK_MASK, bSelOnly, &fxErr, &sendFixes, diffs.Get(i)))
 			trackErr++;
-	SWS_CacheObjectState(false);
+	{
+		SS_RECALL_TIMER(SS_TIME_OBJSTATE);
+		SWS_CacheObjectState(false);
+	}
+
+	// Do "non-chunk" stuff last, cached chunks would be stale otherwise
+	for (int i = 0; i < m_tracks.GetSize(); i++)
+		m_tracks.Get(i)->UpdateReaper(mask & ~CHUNK_MASK, bSelOnly, &fxErr, &sendFixes, diffs.Get(i));
+	diffs.Empty(true);
 
-	if (mask & m_iMask & VIS_MASK)
+	if (mask & VIS_MASK)
 	{
 		if (!bSelOnly && bHideNewVis && GetNumTracks() > 1)
 		{
@@ -843,8 +1074,9 @@ bool Snapshot::UpdateReaper(int mask, bool bSelOnly, bool bHideNewVis)
 			}
 			for (int i = 0; i < GetNumTracks(); i++)
 			{
-				if (!bInSnapshot[i])
-					SetTrackVis(CSurf_TrackFromID(i+1, false), 0);
+				MediaTrack* tr = CSurf_TrackFromID(i+1, false);
+				if (!bInSnapshot[i] && GetTrackVis(tr))
+					SetTrackVis(tr, 0);
 			}
 			delete [] bInSnapshot;
 		}
@@ -856,6 +1088,13 @@ bool Snapshot::UpdateReaper(int mask, bool bSelOnly, bool bHideNewVis)
 	sprintf(str, __LOCALIZE_VERFMT("Load snapshot %s","sws_undo"), m_cName);
 	Undo_OnStateChangeEx(str, UNDO_STATE_ALL, -1);
 
+#ifdef SS_DEBUG
+	dprintf("Snapshot::UpdateReaper \"%s\", %d track(s): %.3f ms\n", m_cName, m_tracks.GetSize(), (SS_GetTime() - dStart) * 1000.0);
+	for (int i = 0; i < SS_NUM_TIMES; i++)
+		if (g_dRecallTime[i] > 0.0)
+			dprintf("  %-12s %.3f ms\n", cSSTimeNames[i], g_dRecallTime[i] * 1000.0);
+#endif
+
 	if (trackErr || fxErr)
 	{
 		char errString[512];
@@ -28,6 +28,18 @@
 #pragma once
 
 #define DOUBLES_PER_LINE 8
+#define SS_NUM_ENVS 7
+
+// Name and param count of a live FX, read once per recall so matching
+// snapshot FX doesn't query REAPER again for every candidate
+struct FXSnapshotLive
+{
+	char cName[256];
+	int iNumParams;
+	bool bMatched;
+};
+
+class TrackSnapshotDiff;
 
 class FXSnapshot
 {
@@ -39,7 +51,7 @@ public:
 
 	void GetChunk(WDL_FastString* chunk);
     void RestoreParams(const char* str);
-    int UpdateReaper(MediaTrack* tr, bool* bMatched, int num);
+    int UpdateReaper(MediaTrack* tr, FXSnapshotLive* live, int num);
 	bool Exists(MediaTrack* tr);
 
     double* m_dParams;
@@ -57,7 +69,7 @@ public:
     TrackSnapshot(LineParser* lp);
     ~TrackSnapshot();
 
-	bool UpdateReaper(int mask, bool bSelOnly, int* fxErr, WDL_PtrList<TrackSendFix>* pFix);
+	bool UpdateReaper(int mask, bool bSelOnly, int* fxErr, WDL_PtrList<TrackSendFix>* pFix, TrackSnapshotDiff* diff);
 	bool Cleanup();
 	void GetChunk(WDL_FastString* chunk);
 	void GetDetails(WDL_FastString* details, int iMask);
@@ -96,6 +108,27 @@ public:
 	WDL_FastString m_sMuteEnv;
 };
 
+// Live envelopes, FX chain and sends of a track, read on the main thread when
+// recalling. Serializing and comparing them against the snapshot doesn't need
+// the REAPER API so Compare() runs on worker threads, recall then only applies
+// the parts that differ. NULL diff means "apply everything".
+class TrackSnapshotDiff
+{
+public:
+	TrackSnapshotDiff(TrackSnapshot* ts, MediaTrack* tr, int mask);
+	void Compare();
+	bool EnvChanged(int i) { return (m_iEnvDiff & (1 << i)) != 0; }
+
+	TrackSnapshot* m_ts;
+	int m_iMask;
+	int m_iEnvDiff;
+	bool m_bFXChainDiff;
+	bool m_bSendsDiff;
+	WDL_FastString m_sEnvs[SS_NUM_ENVS];
+	WDL_TypedBuf<char> m_sFXChain;
+	TrackSends m_sends;
+};
+
 // Mask:
 #define VOL_MASK        0x001
 #define PAN_MASK        0x002
@@ -144,4 +177,6 @@ public:
 	int m_time;
     
     WDL_PtrList<TrackSnapshot> m_tracks;
-};
\ No newline at end of file
+};
+
+void SnapshotRecallExit();
\ No newline at end of file
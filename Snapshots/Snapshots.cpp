@@ -1247,5 +1247,6 @@ void SnapshotsExit()
 	sprintf(buf, "%d", g_nbRecallPref);
 	WritePrivateProfileString(SWS_INI, "DefaultNbSnapsRecall", buf, get_ini_file());
 
+	SnapshotRecallExit();
 	delete g_pSSWnd;
 }
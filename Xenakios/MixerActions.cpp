@@ -788,16 +788,7 @@ void DoRenderReceivesAsStems(COMMAND_T*)
 			Main_OnCommand(40297,0); // unselect all tracks
 			int meh=1;
 			j=0;
-			SourceTrack=0;
-			for (j=0;j<GetNumTracks();j++)
-			{
-				CurTrack=CSurf_TrackFromID(j+1,false);
-				if (CurTrack && TrackMatchesGuid(CurTrack,&orselTrackGUID))
-				{
-					SourceTrack=CurTrack;
-					break;
-				}
-			}
+			SourceTrack=GuidToTrack(&orselTrackGUID);
 			GetSetMediaTrackInfo(SourceTrack,"B_MUTE",&blah); // render stems action mutes original track, so counteract here
 			GetSetMediaTrackInfo(SourceTrack,"I_SELECTED",&meh);
 			
@@ -836,23 +827,14 @@ void DoRenderReceivesAsStems(COMMAND_T*)
 					// stem render messes up selected track etc, so need to do this crap
 					
 					Main_OnCommand(40297,0); // unselect all tracks
-					int l;
-					for (l=0;l<GetNumTracks();l++)
+					CurTrack=GuidToTrack(&orselTrackGUID);
+					if (CurTrack)
 					{
-						CurTrack=CSurf_TrackFromID(l+1,false);
-						if (CurTrack)
-						{
-							GUID compaGUID=*(GUID*)GetSetMediaTrackInfo(CurTrack,"GUID",0);
-							if (GuidsEqual(&compaGUID,&orselTrackGUID))
-							{
-								meh=1;
-								blah=false;
-								GetSetMediaTrackInfo(CurTrack,"I_SELECTED",&meh);
-								GetSetMediaTrackInfo(CurTrack,"B_MUTE",&blah);
-								SourceTrack=CurTrack;
-								break;
-							}
-						}
+						meh=1;
+						blah=false;
+						GetSetMediaTrackInfo(CurTrack,"I_SELECTED",&meh);
+						GetSetMediaTrackInfo(CurTrack,"B_MUTE",&blah);
+						SourceTrack=CurTrack;
 					}
 				}
 			}
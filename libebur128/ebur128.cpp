@@ -1,6 +1,7 @@
 /* BR: This is modified libebur128 v1.0.1. for usage in SWS. Modifications are   *
-*  related to the usage of REAPER resampler (instead of speex resampler) and     *
-*  position of true/sample peak                                                  *
+*  related to position of true/sample peak, polyphase true peak interpolator     *
+*  (instead of speex resampler), vectorized filtering (see ebur128_simd.h) and   *
+*  gating blocks calculated from running sums of 100ms sub-blocks                *
 *                                                                                *
 *                                                                                *
 *  Original license follows:                                                     *
@@ -27,10 +28,10 @@
 
 #include "stdafx.h"
 #include "ebur128.h"
+#include "ebur128_simd.h"
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include "queue/sys/queue.h"
-#include "../reaper/localize.h"
 
 
 #define CHECK_ERROR(condition, errorcode, goto_point)                          \
@@ -46,11 +47,13 @@ struct ebur128_dq_entry {
 };
 
 struct ebur128_state_internal {
-  /** Filtered audio data (used as ring buffer). */
-  double* audio_data;
-  /** Size of audio_data array. */
+  /** Channel weighted energy of each filtered frame (used as ring buffer). */
+  double* frame_energy;
+  /** Summed frame_energy of each 100ms sub-block of the ring buffer. */
+  double* block_energy;
+  /** Size of frame_energy array. */
   size_t audio_data_frames;
-  /** Current index for audio_data. */
+  /** Current frame index for frame_energy. */
   size_t audio_data_index;
   /** How many frames are needed for a gating block. Will correspond to 400ms
    *  of audio at initialization, and 100ms after the first block (75% overlap
@@ -64,12 +67,24 @@ struct ebur128_state_internal {
   double b[5];
   /** BS.1770 filter coefficients (denominator). */
   double a[5];
-  /** BS.1770 filter state. */
-  double v[5][5];
+  /** BS.1770 filter state, 4 * filter_width (see ebur128_kweight). */
+  double* filter_state;
+  /** Deinterleaved audio, history_frames followed by 400ms of frames with
+   *  filter_width samples each. */
+  double* filter_buffer;
+  /** Unfiltered frames kept from the previous call (true peak interpolator
+   *  needs them). */
+  size_t history_frames;
+  /** Channels padded to SIMD width. */
+  size_t filter_width;
+  /** Weight of each channel when summing energy (0 for unused channels). */
+  double* channel_weight;
   /** Linked list of block energies. */
   struct ebur128_double_queue block_list;
   /** Linked list of 3s-block energies, used to calculate LRA. */
   struct ebur128_double_queue short_term_block_list;
+  /** Heap allocations done while adding frames. */
+  size_t heap_allocations;
   int use_histogram;
   unsigned long *block_energy_histogram;
   unsigned long *short_term_block_energy_histogram;
@@ -79,16 +94,18 @@ struct ebur128_state_internal {
   double* sample_peak;
   size_t* sample_peak_frame;
   size_t  sample_peak_frame_count;
-  /** Maximum true peak, one per channel */
+  /** Maximum true peak, one per channel (padded to filter_width) */
   double* true_peak;
   size_t* true_peak_frame;
   size_t  true_peak_frame_count;
-
-  REAPER_Resample_Interface* resampler;
+  /** True peak oversampling factor, 1 if not oversampling. */
   size_t oversample_factor;
-  ReaSample* resampler_buffer_input;
-  ReaSample* resampler_buffer_output;
-  size_t     resampler_buffer_output_frames;
+  /** Polyphase interpolator coefficients, oversample_factor phases with
+   *  interp_taps coefficients each. */
+  double* interp_coeffs;
+  size_t  interp_taps;
+  /** Interpolator delay in oversampled frames. */
+  size_t  interp_delay;
 };
 
 static double relative_gate = -10.0;
@@ -100,7 +117,7 @@ static double histogram_energies[1000];
 static double histogram_energy_boundaries[1001];
 
 static void ebur128_init_filter(ebur128_state* st) {
-  int i, j;
+  size_t i;
 
   double f0 = 1681.974450955533;
   double G  =    3.999843853973347;
@@ -146,11 +163,110 @@ static void ebur128_init_filter(ebur128_state* st) {
   st->d->a[3] = pa[1] * ra[2] + pa[2] * ra[1];
   st->d->a[4] = pa[2] * ra[2];
 
-  for (i = 0; i < 5; ++i) {
-    for (j = 0; j < 5; ++j) {
-      st->d->v[i][j] = 0.0;
+  for (i = 0; i < 4 * st->d->filter_width; ++i) {
+    st->d->filter_state[i] = 0.0;
+  }
+}
+
+static void ebur128_init_channel_weights(ebur128_state* st) {
+  size_t c;
+  for (c = 0; c < st->d->filter_width; ++c) {
+    if (c >= st->channels || st->d->channel_map[c] == EBUR128_UNUSED) {
+      st->d->channel_weight[c] = 0.0;
+    } else if (st->d->channel_map[c] == EBUR128_LEFT_SURROUND ||
+               st->d->channel_map[c] == EBUR128_RIGHT_SURROUND) {
+      st->d->channel_weight[c] = 1.41;
+    } else if (st->d->channel_map[c] == EBUR128_DUAL_MONO) {
+      st->d->channel_weight[c] = 2.0;
+    } else {
+      st->d->channel_weight[c] = 1.0;
+    }
+  }
+}
+
+static int ebur128_use_true_peak(ebur128_state* st) {
+  return ((st->mode & EBUR128_MODE_TRUE_PEAK) == EBUR128_MODE_TRUE_PEAK);
+}
+
+/* BS.1770-4 Annex 2: oversample 4x below 96 kHz, 2x below 192 kHz. The
+ * interpolation filter is a Hann windowed sinc split into oversample_factor
+ * phases, so only input samples get multiplied (no zero stuffing). */
+static int ebur128_init_interpolator(ebur128_state* st) {
+  size_t taps = 49;
+  size_t j;
+
+  st->d->interp_coeffs = NULL;
+  st->d->interp_taps   = 0;
+  st->d->interp_delay  = 0;
+  if (!ebur128_use_true_peak(st) || st->samplerate >= 192000) {
+    st->d->oversample_factor = 1;
+    return EBUR128_SUCCESS;
+  }
+  st->d->oversample_factor = st->samplerate < 96000 ? 4 : 2;
+  st->d->interp_taps  = (taps + st->d->oversample_factor - 1) /
+                        st->d->oversample_factor;
+  st->d->interp_delay = (taps - 1) / 2;
+  st->d->interp_coeffs = (double*) calloc(st->d->oversample_factor *
+                                          st->d->interp_taps,
+                                          sizeof(double));
+  if (!st->d->interp_coeffs) return EBUR128_ERROR_NOMEM;
+
+  for (j = 0; j < taps; ++j) {
+    double m = (double) j - (double) (taps - 1) / 2.0;
+    double c = 1.0;
+    if (fabs(m) > 1e-9) {
+      c = sin(m * M_PI / st->d->oversample_factor) /
+          (m * M_PI / st->d->oversample_factor);
     }
+    c *= 0.5 * (1.0 - cos(2.0 * M_PI * j / (taps - 1)));
+    st->d->interp_coeffs[(j % st->d->oversample_factor) * st->d->interp_taps +
+                         j / st->d->oversample_factor] = c;
+  }
+  return EBUR128_SUCCESS;
+}
+
+static void ebur128_destroy_buffers(ebur128_state* st) {
+  free(st->d->interp_coeffs);  st->d->interp_coeffs = NULL;
+  free(st->d->frame_energy);   st->d->frame_energy = NULL;
+  free(st->d->block_energy);   st->d->block_energy = NULL;
+  free(st->d->filter_state);   st->d->filter_state = NULL;
+  free(st->d->filter_buffer);  st->d->filter_buffer = NULL;
+  free(st->d->channel_weight); st->d->channel_weight = NULL;
+}
+
+static int ebur128_init_buffers(ebur128_state* st) {
+  size_t blocks;
+  if ((st->mode & EBUR128_MODE_S) == EBUR128_MODE_S) {
+    blocks = 30;
+  } else if ((st->mode & EBUR128_MODE_M) == EBUR128_MODE_M) {
+    blocks = 4;
+  } else {
+    return EBUR128_ERROR_INVALID_MODE;
+  }
+  st->d->audio_data_frames = st->d->samples_in_100ms * blocks;
+  st->d->filter_width = ebur128_simd_width(st->channels);
+  if (ebur128_init_interpolator(st)) {
+    return EBUR128_ERROR_NOMEM;
   }
+  st->d->history_frames = st->d->interp_taps ? st->d->interp_taps - 1 : 0;
+
+  st->d->frame_energy   = (double*) calloc(st->d->audio_data_frames,
+                                           sizeof(double));
+  st->d->block_energy   = (double*) calloc(blocks, sizeof(double));
+  st->d->filter_state   = (double*) calloc(4 * st->d->filter_width,
+                                           sizeof(double));
+  st->d->filter_buffer  = (double*) calloc((st->d->history_frames +
+                                            st->d->samples_in_100ms * 4) *
+                                           st->d->filter_width,
+                                           sizeof(double));
+  st->d->channel_weight = (double*) calloc(st->d->filter_width,
+                                           sizeof(double));
+  if (!st->d->frame_energy || !st->d->block_energy || !st->d->filter_state ||
+      !st->d->filter_buffer || !st->d->channel_weight) {
+    ebur128_destroy_buffers(st);
+    return EBUR128_ERROR_NOMEM;
+  }
+  return EBUR128_SUCCESS;
 }
 
 static int ebur128_init_channel_map(ebur128_state* st) {
@@ -184,73 +300,6 @@ static int ebur128_init_channel_map(ebur128_state* st) {
   return EBUR128_SUCCESS;
 }
 
-static int ebur128_init_resampler(ebur128_state* st) {
-  int errcode = EBUR128_SUCCESS;
-
-  if (st->samplerate < 96000) {
-    st->d->oversample_factor = 4;
-  } else if (st->samplerate < 192000) {
-    st->d->oversample_factor = 2;
-  } else {
-    st->d->oversample_factor = 1;
-    st->d->resampler_buffer_input = NULL;
-    st->d->resampler_buffer_output = NULL;
-    st->d->resampler = NULL;
-  }
-
-  size_t resampler_buffer_input_frames  = st->d->samples_in_100ms * 4;
-  st->d->resampler_buffer_output_frames = resampler_buffer_input_frames * st->d->oversample_factor;
-  st->d->resampler_buffer_output        = (ReaSample*)calloc(st->d->resampler_buffer_output_frames *
-                                                              st->channels,
-                                                              sizeof(ReaSample));
-  st->d->resampler = Resampler_Create();
-  CHECK_ERROR(!st->d->resampler, EBUR128_ERROR_NOMEM, free_output)
-
-  static int  resamplerMode = 0;
-  static bool foundResamplerMode = false;
-  if (!foundResamplerMode)
-  {
-    while (true)
-    {
-      const char* targetMode = __localizeFunc("Good (64pt Sinc)", "resample", 0);
-      const char* currentMode = Resample_EnumModes(resamplerMode);
-
-      if (!targetMode || !currentMode)
-      {
-        resamplerMode = -1; // default to project default in case our mode hasn't been found
-        foundResamplerMode = true;
-        break;
-      }
-      else if (!strcmp(targetMode, currentMode))
-      {
-        foundResamplerMode = true;
-        break;
-      }
-      ++resamplerMode;
-    }
-  }
-
-  st->d->resampler->Extended(RESAMPLE_EXT_SETFEEDMODE,(void*)(INT_PTR)1,0,0);
-  st->d->resampler->Extended(RESAMPLE_EXT_SETRSMODE,(void*)(INT_PTR)resamplerMode,0,0);
-  st->d->resampler->SetRates((double)st->samplerate, (double)(st->samplerate * st->d->oversample_factor));
-
-  return errcode;
-
-free_output:
-  free(st->d->resampler_buffer_output);
-  st->d->resampler_buffer_output = NULL;
-  return errcode;
-}
-
-static void ebur128_destroy_resampler(ebur128_state* st) {
-
-  delete st->d->resampler;
-  free(st->d->resampler_buffer_output);
-  st->d->resampler = NULL;
-  st->d->resampler_buffer_input  = NULL;
-  st->d->resampler_buffer_output = NULL;
-}
-
 void ebur128_get_version(int* major, int* minor, int* patch) {
   *major = EBUR128_VERSION_MAJOR;
   *minor = EBUR128_VERSION_MINOR;
@@ -276,13 +325,15 @@ ebur128_state* ebur128_init(unsigned int channels,
 
   st->d->sample_peak = (double*) malloc(channels * sizeof(double));
   CHECK_ERROR(!st->d->sample_peak, 0, free_channel_map)
-  st->d->true_peak = (double*) malloc(channels * sizeof(double));
+  st->d->true_peak = (double*) calloc(ebur128_simd_width(channels),
+                                      sizeof(double));
   CHECK_ERROR(!st->d->true_peak, 0, free_sample_peak)
   st->d->sample_peak_frame_count = 0;
 
   st->d->sample_peak_frame = (size_t*) malloc(channels * sizeof(size_t));
   CHECK_ERROR(!st->d->sample_peak_frame, 0, free_true_peak)
-  st->d->true_peak_frame = (size_t*) malloc(channels * sizeof(size_t));
+  st->d->true_peak_frame = (size_t*) calloc(ebur128_simd_width(channels),
+                                            sizeof(size_t));
   CHECK_ERROR(!st->d->true_peak_frame, 0, free_sample_peak_frame)
   st->d->true_peak_frame_count = 0;
 
@@ -300,22 +351,14 @@ ebur128_state* ebur128_init(unsigned int channels,
   st->samplerate = samplerate;
   st->d->samples_in_100ms = (st->samplerate + 5) / 10;
   st->mode = mode;
-  if ((mode & EBUR128_MODE_S) == EBUR128_MODE_S) {
-    st->d->audio_data_frames = st->d->samples_in_100ms * 30;
-  } else if ((mode & EBUR128_MODE_M) == EBUR128_MODE_M) {
-    st->d->audio_data_frames = st->d->samples_in_100ms * 4;
-  } else {
-    goto free_sample_peak_frame;
-  }
-  st->d->audio_data = (double*) malloc(st->d->audio_data_frames *
-                                       st->channels *
-                                       sizeof(double));
-  CHECK_ERROR(!st->d->audio_data, 0, free_true_peak_frame)
+  result = ebur128_init_buffers(st);
+  CHECK_ERROR(result, 0, free_true_peak_frame)
   ebur128_init_filter(st);
+  ebur128_init_channel_weights(st);
 
   if (st->d->use_histogram) {
     st->d->block_energy_histogram = (unsigned long*)malloc(1000 * sizeof(unsigned long));
-    CHECK_ERROR(!st->d->block_energy_histogram, 0, free_audio_data)
+    CHECK_ERROR(!st->d->block_energy_histogram, 0, free_buffers)
     for (i = 0; i < 1000; ++i) {
       st->d->block_energy_histogram[i] = 0;
     }
@@ -333,11 +376,9 @@ ebur128_state* ebur128_init(unsigned int channels,
   }
   SLIST_INIT(&st->d->block_list);
   SLIST_INIT(&st->d->short_term_block_list);
+  st->d->heap_allocations = 0;
   st->d->short_term_frame_counter = 0;
 
-  result = ebur128_init_resampler(st);
-  CHECK_ERROR(result, 0, free_short_term_block_energy_histogram)
-
   /* the first block needs 400ms of audio data */
   st->d->needed_frames = st->d->samples_in_100ms * 4;
   /* start at the beginning of the buffer */
@@ -358,12 +399,10 @@ ebur128_state* ebur128_init(unsigned int channels,
 
   return st;
 
-free_short_term_block_energy_histogram:
-  free(st->d->short_term_block_energy_histogram);
 free_block_energy_histogram:
   free(st->d->block_energy_histogram);
-free_audio_data:
-  free(st->d->audio_data);
+free_buffers:
+  ebur128_destroy_buffers(st);
 free_true_peak_frame:
   free(st->d->true_peak_frame);
 free_sample_peak_frame:
@@ -386,7 +425,7 @@ void ebur128_destroy(ebur128_state** st) {
   struct ebur128_dq_entry* entry;
   free((*st)->d->block_energy_histogram);
   free((*st)->d->short_term_block_energy_histogram);
-  free((*st)->d->audio_data);
+  ebur128_destroy_buffers(*st);
   free((*st)->d->channel_map);
   free((*st)->d->sample_peak);
   free((*st)->d->sample_peak_frame);
@@ -403,42 +442,11 @@ void ebur128_destroy(ebur128_state** st) {
     free(entry);
   }
 
-  ebur128_destroy_resampler(*st);
-
   free((*st)->d);
   free(*st);
   *st = NULL;
 }
 
-static int ebur128_use_resampler(ebur128_state* st) {
-  return ((st->mode & EBUR128_MODE_TRUE_PEAK) == EBUR128_MODE_TRUE_PEAK);
-}
-
-static void ebur128_check_true_peak(ebur128_state* st, size_t frames) {
-
-  size_t out_len = st->d->resampler->ResampleOut(st->d->resampler_buffer_output,
-                                                 frames,
-                                                 st->d->resampler_buffer_output_frames,
-                                                 st->channels);
-  for (size_t c = 0; c < st->channels; ++c) {
-    for (size_t i = 0; i < out_len; ++i) {
-      if (st->d->resampler_buffer_output[i * st->channels + c] >
-                                                         st->d->true_peak[c]) {
-        st->d->true_peak[c] =
-            st->d->resampler_buffer_output[i * st->channels + c];
-        st->d->true_peak_frame[c] = st->d->true_peak_frame_count + i;
-      } else if (-st->d->resampler_buffer_output[i * st->channels + c] >
-                                                         st->d->true_peak[c]) {
-        st->d->true_peak[c] =
-           -st->d->resampler_buffer_output[i * st->channels + c];
-        st->d->true_peak_frame[c] = st->d->true_peak_frame_count + i;
-      }
-
-    }
-  }
-  st->d->true_peak_frame_count += out_len;
-}
-
 #ifdef __SSE2_MATH__
 #include <xmmintrin.h>
 #define TURN_ON_FTZ \
@@ -451,79 +459,91 @@ static void ebur128_check_true_peak(ebur128_state* st, size_t frames) {
 #define TURN_ON_FTZ
 #define TURN_OFF_FTZ
 #define FLUSH_MANUALLY \
-    st->d->v[ci][4] = fabs(st->d->v[ci][4]) < DBL_MIN ? 0.0 : st->d->v[ci][4]; \
-    st->d->v[ci][3] = fabs(st->d->v[ci][3]) < DBL_MIN ? 0.0 : st->d->v[ci][3]; \
-    st->d->v[ci][2] = fabs(st->d->v[ci][2]) < DBL_MIN ? 0.0 : st->d->v[ci][2]; \
-    st->d->v[ci][1] = fabs(st->d->v[ci][1]) < DBL_MIN ? 0.0 : st->d->v[ci][1];
+    for (i = 0; i < 4 * st->d->filter_width; ++i) { \
+      if (fabs(st->d->filter_state[i]) < DBL_MIN) { \
+        st->d->filter_state[i] = 0.0; \
+      } \
+    }
 #endif
 
+/* Filters frames already deinterleaved into filter_buffer and stores their
+ * energy at audio_data_index (see EBUR128_FILTER) */
+static void ebur128_filter(ebur128_state* st, size_t frames) {
+  double* x = st->d->filter_buffer +
+              st->d->history_frames * st->d->filter_width;
+  double* frame_energy = st->d->frame_energy + st->d->audio_data_index;
+  size_t width = st->d->filter_width;
+  size_t i, c;
+
+  TURN_ON_FTZ
+
+  if ((st->mode & EBUR128_MODE_SAMPLE_PEAK) == EBUR128_MODE_SAMPLE_PEAK) {
+    for (i = 0; i < frames; ++i) {
+      for (c = 0; c < st->channels; ++c) {
+        double value = x[i * width + c];
+        if (value < 0.0) value = -value;
+        if (value > st->d->sample_peak[c]) {
+          st->d->sample_peak[c] = value;
+          st->d->sample_peak_frame[c] = st->d->sample_peak_frame_count + i;
+        }
+      }
+    }
+  }
+  st->d->sample_peak_frame_count += frames;
+  if (ebur128_use_true_peak(st) && st->d->oversample_factor > 1) {
+    ebur128_interp_peak(st->d->filter_buffer, frames, width,
+                        st->d->interp_coeffs, st->d->oversample_factor,
+                        st->d->interp_taps, st->d->true_peak,
+                        st->d->true_peak_frame, st->d->true_peak_frame_count);
+    st->d->true_peak_frame_count += frames * st->d->oversample_factor;
+    /* keep unfiltered tail for the next call (filter works in place) */
+    memmove(st->d->filter_buffer, st->d->filter_buffer + frames * width,
+            st->d->history_frames * width * sizeof(double));
+  }
+
+  ebur128_kweight(x, frames, width, st->d->filter_state, st->d->b, st->d->a);
+  FLUSH_MANUALLY
+  ebur128_energy(x, frames, width, st->d->channel_weight, frame_energy);
+
+  /* keep running sums of 100ms sub-blocks so gating blocks don't have to
+   * rescan the whole ring buffer */
+  i = 0;
+  while (i < frames) {
+    size_t index  = st->d->audio_data_index + i;
+    size_t offset = index % st->d->samples_in_100ms;
+    size_t count  = st->d->samples_in_100ms - offset;
+    double sum;
+    if (count > frames - i) count = frames - i;
+    sum = ebur128_sum(frame_energy + i, count);
+    if (offset == 0) {
+      st->d->block_energy[index / st->d->samples_in_100ms] = sum;
+    } else {
+      st->d->block_energy[index / st->d->samples_in_100ms] += sum;
+    }
+    i += count;
+  }
+
+  TURN_OFF_FTZ
+}
+
 #define EBUR128_FILTER(type, min_scale, max_scale)                             \
 static void ebur128_filter_##type(ebur128_state* st, const type* src,          \
                                   size_t frames) {                             \
   static double scaling_factor = -((double) min_scale) > (double) max_scale ?  \
                                  -((double) min_scale) : (double) max_scale;   \
-  double* audio_data = st->d->audio_data + st->d->audio_data_index;            \
+  size_t width = st->d->filter_width;                                          \
+  double* x = st->d->filter_buffer + st->d->history_frames * width;            \
   size_t i, c;                                                                 \
                                                                                \
-  TURN_ON_FTZ                                                                  \
-                                                                               \
-  if ((st->mode & EBUR128_MODE_SAMPLE_PEAK) == EBUR128_MODE_SAMPLE_PEAK) {     \
+  for (i = 0; i < frames; ++i, x += width, src += st->channels) {              \
     for (c = 0; c < st->channels; ++c) {                                       \
-      double max = 0.0;                                                        \
-      size_t max_frame = 0;                                                    \
-      for (i = 0; i < frames; ++i) {                                           \
-        if (src[i * st->channels + c] > max) {                                 \
-          max       = src[i * st->channels + c];                               \
-          max_frame = st->d->sample_peak_frame_count + i;                      \
-        } else if (-src[i * st->channels + c] > max) {                         \
-          max       = -1.0 * src[i * st->channels + c];                        \
-          max_frame = st->d->sample_peak_frame_count + i;                      \
-        }                                                                      \
-      }                                                                        \
-      max /= scaling_factor;                                                   \
-      if (max > st->d->sample_peak[c]) {                                       \
-        st->d->sample_peak[c] = max;                                           \
-        st->d->sample_peak_frame[c] = max_frame;                               \
-      }                                                                        \
-    }                                                                          \
-  }                                                                            \
-  st->d->sample_peak_frame_count += frames;                                    \
-  if (ebur128_use_resampler(st)) {                                             \
-    st->d->resampler->ResamplePrepare(frames,                                  \
-                                      st->channels,                            \
-                                      &st->d->resampler_buffer_input);         \
-    for (c = 0; c < st->channels; ++c) {                                       \
-      for (i = 0; i < frames; ++i) {                                           \
-        st->d->resampler_buffer_input[i * st->channels + c] =                  \
-                      (ReaSample) (src[i * st->channels + c] / scaling_factor);\
-      }                                                                        \
+      x[c] = (double) src[c] / scaling_factor;                                 \
     }                                                                          \
-    ebur128_check_true_peak(st, frames);                                       \
-  }                                                                            \
-  for (c = 0; c < st->channels; ++c) {                                         \
-    int ci = st->d->channel_map[c] - 1;                                        \
-    if (ci < 0) continue;                                                      \
-    else if (ci > 4) ci = 0; /* dual mono */                                   \
-    for (i = 0; i < frames; ++i) {                                             \
-      st->d->v[ci][0] = (double) (src[i * st->channels + c] / scaling_factor)  \
-                   - st->d->a[1] * st->d->v[ci][1]                             \
-                   - st->d->a[2] * st->d->v[ci][2]                             \
-                   - st->d->a[3] * st->d->v[ci][3]                             \
-                   - st->d->a[4] * st->d->v[ci][4];                            \
-      audio_data[i * st->channels + c] =                                       \
-                     st->d->b[0] * st->d->v[ci][0]                             \
-                   + st->d->b[1] * st->d->v[ci][1]                             \
-                   + st->d->b[2] * st->d->v[ci][2]                             \
-                   + st->d->b[3] * st->d->v[ci][3]                             \
-                   + st->d->b[4] * st->d->v[ci][4];                            \
-      st->d->v[ci][4] = st->d->v[ci][3];                                       \
-      st->d->v[ci][3] = st->d->v[ci][2];                                       \
-      st->d->v[ci][2] = st->d->v[ci][1];                                       \
-      st->d->v[ci][1] = st->d->v[ci][0];                                       \
+    for (; c < width; ++c) {                                                   \
+      x[c] = 0.0;                                                              \
     }                                                                          \
-    FLUSH_MANUALLY                                                             \
   }                                                                            \
-  TURN_OFF_FTZ                                                                 \
+  ebur128_filter(st, frames);                                                  \
 }
 EBUR128_FILTER(short, SHRT_MIN, SHRT_MAX)
 EBUR128_FILTER(int, INT_MIN, INT_MAX)
@@ -553,39 +573,25 @@ static size_t find_histogram_index(double energy) {
 
 static int ebur128_calc_gating_block(ebur128_state* st, size_t frames_per_block,
                                      double* optional_output) {
-  size_t i, c;
+  size_t index = st->d->audio_data_index;
+  size_t frames = frames_per_block;
   double sum = 0.0;
-  double channel_sum;
-  for (c = 0; c < st->channels; ++c) {
-    if (st->d->channel_map[c] == EBUR128_UNUSED) continue;
-    channel_sum = 0.0;
-    if (st->d->audio_data_index < frames_per_block * st->channels) {
-      for (i = 0; i < st->d->audio_data_index / st->channels; ++i) {
-        channel_sum += st->d->audio_data[i * st->channels + c] *
-                       st->d->audio_data[i * st->channels + c];
-      }
-      for (i = st->d->audio_data_frames -
-              (frames_per_block -
-               st->d->audio_data_index / st->channels);
-           i < st->d->audio_data_frames; ++i) {
-        channel_sum += st->d->audio_data[i * st->channels + c] *
-                       st->d->audio_data[i * st->channels + c];
-      }
+  /* walk backwards from the current position: whole 100ms sub-blocks come
+   * from their running sums and only partial ones from frame energies */
+  while (frames > 0) {
+    size_t count, i;
+    if (index == 0) index = st->d->audio_data_frames;
+    count = (index - 1) % st->d->samples_in_100ms + 1;
+    if (count > frames) count = frames;
+    if (count == st->d->samples_in_100ms) {
+      sum += st->d->block_energy[index / st->d->samples_in_100ms - 1];
     } else {
-      for (i = st->d->audio_data_index / st->channels - frames_per_block;
-           i < st->d->audio_data_index / st->channels;
-           ++i) {
-        channel_sum += st->d->audio_data[i * st->channels + c] *
-                       st->d->audio_data[i * st->channels + c];
+      for (i = index - count; i < index; ++i) {
+        sum += st->d->frame_energy[i];
       }
     }
-    if (st->d->channel_map[c] == EBUR128_LEFT_SURROUND ||
-        st->d->channel_map[c] == EBUR128_RIGHT_SURROUND) {
-      channel_sum *= 1.41;
-    } else if (st->d->channel_map[c] == EBUR128_DUAL_MONO) {
-      channel_sum *= 2.0;
-    }
-    sum += channel_sum;
+    index  -= count;
+    frames -= count;
   }
   sum /= (double) frames_per_block;
   if (optional_output) {
@@ -598,6 +604,7 @@ static int ebur128_calc_gating_block(ebur128_state* st, size_t frames_per_block,
       struct ebur128_dq_entry* block;
       block = (struct ebur128_dq_entry*) malloc(sizeof(struct ebur128_dq_entry));
       if (!block) return EBUR128_ERROR_NOMEM;
+      ++st->d->heap_allocations;
       block->z = sum;
       SLIST_INSERT_HEAD(&st->d->block_list, block, entries);
     }
@@ -619,6 +626,7 @@ int ebur128_set_channel(ebur128_state* st,
     return 1;
   }
   st->d->channel_map[channel_number] = value;
+  ebur128_init_channel_weights(st);
   return 0;
 }
 
@@ -630,8 +638,7 @@ int ebur128_change_parameters(ebur128_state* st,
       samplerate == st->samplerate) {
     return 2;
   }
-  free(st->d->audio_data);
-  st->d->audio_data = NULL;
+  ebur128_destroy_buffers(st);
 
   if (channels != st->channels) {
     unsigned int i;
@@ -643,9 +650,6 @@ int ebur128_change_parameters(ebur128_state* st,
     free(st->d->true_peak_frame);   st->d->true_peak_frame = NULL;
     st->channels = channels;
 
-    ebur128_destroy_resampler(st);
-    ebur128_init_resampler(st);
-
     errcode = ebur128_init_channel_map(st);
     CHECK_ERROR(errcode, EBUR128_ERROR_NOMEM, exit)
 
@@ -655,9 +659,11 @@ int ebur128_change_parameters(ebur128_state* st,
     CHECK_ERROR(!st->d->sample_peak_frame, EBUR128_ERROR_NOMEM, exit)
     st->d->sample_peak_frame_count = 0;
 
-    st->d->true_peak = (double*) malloc(channels * sizeof(double));
+    st->d->true_peak = (double*) calloc(ebur128_simd_width(channels),
+                                        sizeof(double));
     CHECK_ERROR(!st->d->true_peak, EBUR128_ERROR_NOMEM, exit)
-    st->d->true_peak_frame = (size_t*) malloc(channels * sizeof(size_t));
+    st->d->true_peak_frame = (size_t*) calloc(ebur128_simd_width(channels),
+                                              sizeof(size_t));
     CHECK_ERROR(!st->d->true_peak_frame, EBUR128_ERROR_NOMEM, exit)
     st->d->true_peak_frame_count = 0;
 
@@ -670,19 +676,12 @@ int ebur128_change_parameters(ebur128_state* st,
   }
   if (samplerate != st->samplerate) {
     st->samplerate = samplerate;
-    ebur128_init_filter(st);
-  }
-  if ((st->mode & EBUR128_MODE_S) == EBUR128_MODE_S) {
-    st->d->audio_data_frames = st->d->samples_in_100ms * 30;
-  } else if ((st->mode & EBUR128_MODE_M) == EBUR128_MODE_M) {
-    st->d->audio_data_frames = st->d->samples_in_100ms * 4;
-  } else {
-    return 1;
+    st->d->samples_in_100ms = (st->samplerate + 5) / 10;
   }
-  st->d->audio_data = (double*) malloc(st->d->audio_data_frames *
-                                       st->channels *
-                                       sizeof(double));
-  CHECK_ERROR(!st->d->audio_data, EBUR128_ERROR_NOMEM, exit)
+  errcode = ebur128_init_buffers(st);
+  CHECK_ERROR(errcode, errcode, exit)
+  ebur128_init_filter(st);
+  ebur128_init_channel_weights(st);
 
   /* the first block needs 400ms of audio data */
   st->d->needed_frames = st->d->samples_in_100ms * 4;
@@ -697,6 +696,9 @@ exit:
   return 1;
 }
 
+size_t ebur128_heap_allocations(ebur128_state* st) {
+  return st->d->heap_allocations;
+}
 
 static int ebur128_energy_shortterm(ebur128_state* st, double* out);
 #define EBUR128_ADD_FRAMES(type)                                               \
@@ -708,7 +710,7 @@ int ebur128_add_frames_##type(ebur128_state* st,                               \
       ebur128_filter_##type(st, src + src_index, st->d->needed_frames);        \
       src_index += st->d->needed_frames * st->channels;                        \
       frames -= st->d->needed_frames;                                          \
-      st->d->audio_data_index += st->d->needed_frames * st->channels;          \
+      st->d->audio_data_index += st->d->needed_frames;                         \
       /* calculate the new gating block */                                     \
       if ((st->mode & EBUR128_MODE_I) == EBUR128_MODE_I) {                     \
         if (ebur128_calc_gating_block(st, st->d->samples_in_100ms * 4, NULL)) {\
@@ -729,6 +731,7 @@ int ebur128_add_frames_##type(ebur128_state* st,                               \
               block = (struct ebur128_dq_entry*)                               \
                       malloc(sizeof(struct ebur128_dq_entry));                 \
               if (!block) return EBUR128_ERROR_NOMEM;                          \
+              ++st->d->heap_allocations;                                       \
               block->z = st_energy;                                            \
               SLIST_INSERT_HEAD(&st->d->short_term_block_list, block, entries);\
             }                                                                  \
@@ -739,12 +742,12 @@ int ebur128_add_frames_##type(ebur128_state* st,                               \
       /* 100ms are needed for all blocks besides the first one */              \
       st->d->needed_frames = st->d->samples_in_100ms;                          \
       /* reset audio_data_index when buffer full */                            \
-      if (st->d->audio_data_index == st->d->audio_data_frames * st->channels) {\
+      if (st->d->audio_data_index == st->d->audio_data_frames) {               \
         st->d->audio_data_index = 0;                                           \
       }                                                                        \
     } else {                                                                   \
       ebur128_filter_##type(st, src + src_index, frames);                      \
-      st->d->audio_data_index += frames * st->channels;                        \
+      st->d->audio_data_index += frames;                                       \
       if ((st->mode & EBUR128_MODE_LRA) == EBUR128_MODE_LRA) {                 \
         st->d->short_term_frame_counter += frames;                             \
       }                                                                        \
@@ -1050,9 +1053,128 @@ int ebur128_true_peak(ebur128_state* st,
        ? st->d->true_peak[channel_number]
        : st->d->sample_peak[channel_number];
 
+  /* interpolator output is late for interp_delay oversampled frames */
   *pos = st->d->true_peak[channel_number] > st->d->sample_peak[channel_number]
-       ? (double)st->d->true_peak_frame[channel_number] / (double)(st->samplerate * st->d->oversample_factor)
+       ? (st->d->true_peak_frame[channel_number] > st->d->interp_delay
+         ? (double)(st->d->true_peak_frame[channel_number] - st->d->interp_delay)
+         : 0.0) / (double)(st->samplerate * st->d->oversample_factor)
        : (double)st->d->sample_peak_frame[channel_number] / (double)st->samplerate;
 
   return EBUR128_SUCCESS;
-}
\ No newline at end of file
+}
+
+int ebur128_energy_window(ebur128_state* st, size_t frames, double* out) {
+  return ebur128_energy_in_interval(st, frames, out);
+}
+
+void ebur128_reset_peaks(ebur128_state* st) {
+  size_t i;
+  for (i = 0; i < st->channels; ++i) {
+    st->d->sample_peak[i] = 0.0;
+  }
+  for (i = 0; i < st->d->filter_width; ++i) {
+    st->d->true_peak[i] = 0.0;
+  }
+}
+
+/* mean energy of count consecutive 100ms blocks ending with block end */
+static double ebur128_blocks_mean(const double* energies, size_t end,
+                                  size_t count) {
+  double sum = 0.0;
+  size_t i;
+  for (i = end + 1 - count; i <= end; ++i) {
+    sum += energies[i];
+  }
+  return sum / (double) count;
+}
+
+int ebur128_loudness_global_blocks(const double* energies, size_t count,
+                                   double* out) {
+  double absolute_threshold = pow(10.0, (-70.0 + 0.691) / 10.0);
+  double relative_threshold = 0.0;
+  double gated_loudness = 0.0;
+  size_t above_thresh_counter = 0;
+  size_t i;
+
+  /* gating blocks are 400ms long and overlap by 75% */
+  for (i = 3; i < count; ++i) {
+    double z = ebur128_blocks_mean(energies, i, 4);
+    if (z >= absolute_threshold) {
+      relative_threshold += z;
+      ++above_thresh_counter;
+    }
+  }
+  if (!above_thresh_counter) {
+    *out = -HUGE_VAL;
+    return EBUR128_SUCCESS;
+  }
+  relative_threshold /= (double) above_thresh_counter;
+  relative_threshold *= pow(10.0, relative_gate / 10.0);
+  if (relative_threshold < absolute_threshold) {
+    relative_threshold = absolute_threshold;
+  }
+  above_thresh_counter = 0;
+  for (i = 3; i < count; ++i) {
+    double z = ebur128_blocks_mean(energies, i, 4);
+    if (z >= relative_threshold) {
+      gated_loudness += z;
+      ++above_thresh_counter;
+    }
+  }
+  if (!above_thresh_counter) {
+    *out = -HUGE_VAL;
+    return EBUR128_SUCCESS;
+  }
+  gated_loudness /= (double) above_thresh_counter;
+  *out = ebur128_energy_to_loudness(gated_loudness);
+  return EBUR128_SUCCESS;
+}
+
+int ebur128_loudness_range_blocks(const double* energies, size_t count,
+                                  double* out) {
+  double absolute_threshold = pow(10.0, (-70.0 + 0.691) / 10.0);
+  double* stl_vector;
+  size_t stl_size = 0;
+  double* stl_relgated;
+  size_t stl_relgated_size;
+  double stl_power = 0.0, stl_integrated;
+  double h_en, l_en;
+  size_t i;
+
+  /* 3s short term blocks, one every second */
+  stl_vector = (double*) malloc((count / 10 + 1) * sizeof(double));
+  if (!stl_vector)
+    return EBUR128_ERROR_NOMEM;
+  for (i = 29; i < count; i += 10) {
+    double z = ebur128_blocks_mean(energies, i, 30);
+    if (z >= absolute_threshold) {
+      stl_vector[stl_size++] = z;
+      stl_power += z;
+    }
+  }
+  if (!stl_size) {
+    free(stl_vector);
+    *out = 0.0;
+    return EBUR128_SUCCESS;
+  }
+  qsort(stl_vector, stl_size, sizeof(double), ebur128_double_cmp);
+  stl_power /= (double) stl_size;
+  stl_integrated = pow(10.0, -20.0 / 10.0) * stl_power;
+
+  stl_relgated = stl_vector;
+  stl_relgated_size = stl_size;
+  while (stl_relgated_size > 0 && *stl_relgated < stl_integrated) {
+    ++stl_relgated;
+    --stl_relgated_size;
+  }
+
+  if (stl_relgated_size) {
+    h_en = stl_relgated[(size_t) ((stl_relgated_size - 1) * 0.95 + 0.5)];
+    l_en = stl_relgated[(size_t) ((stl_relgated_size - 1) * 0.1 + 0.5)];
+    *out = ebur128_energy_to_loudness(h_en) - ebur128_energy_to_loudness(l_en);
+  } else {
+    *out = 0.0;
+  }
+  free(stl_vector);
+  return EBUR128_SUCCESS;
+}
@@ -1,6 +1,6 @@
 /* BR: This is modified libebur128 v1.0.1. for usage in SWS. Modifications are   *
-*  related to the usage of REAPER resampler (instead of speex resampler) and     *
-*  position of true/sample peak                                                  *
+*  related to the polyphase true peak interpolator (instead of speex resampler)  *
+*  and position of true/sample peak                                              *
 *                                                                                *
 *                                                                                *
 *  Original license follows:                                                     *
@@ -188,6 +188,17 @@ int ebur128_add_frames_double(ebur128_state* st,
                              const double* src,
                              size_t frames);
 
+/** \brief Get number of heap allocations done while adding frames.
+ *
+ *  Only gating blocks (\ref EBUR128_MODE_I and \ref EBUR128_MODE_LRA in
+ *  non-histogram mode) get allocated while adding frames, so this stays at 0
+ *  in other modes.
+ *
+ *  @param st library state.
+ *  @return number of heap allocations.
+ */
+size_t ebur128_heap_allocations(ebur128_state* st);
+
 /** \brief Get global integrated loudness in LUFS.
  *
  *  @param st library state.
@@ -286,9 +297,10 @@ int ebur128_sample_peak(ebur128_state* st,
  *  try to compare resulting values across different versions of the library,
  *  as the algorithm may change.
  *
- *  The current implementation uses the Speex resampler with quality level 8 to
- *  calculate true peak. Will oversample 4x for sample rates < 96000 Hz, 2x for
- *  sample rates < 192000 Hz and leave the signal unchanged for 192000 Hz.
+ *  The current implementation uses a 49 tap Hann windowed sinc polyphase
+ *  interpolator to calculate true peak. Will oversample 4x for sample rates
+ *  < 96000 Hz, 2x for sample rates < 192000 Hz and leave the signal unchanged
+ *  for 192000 Hz.
  *
  *  @param st library state
  *  @param channel_number channel to analyse
@@ -304,4 +316,60 @@ int ebur128_true_peak(ebur128_state* st,
                       unsigned int channel_number,
                       double* out, double* pos);
 
+/** \brief Get mean channel weighted energy of the last frames.
+ *
+ *  Frames are K-weighted, same as for momentary and short-term loudness, so
+ *  energies of consecutive 100ms windows can be cached and passed to
+ *  \ref ebur128_loudness_global_blocks and \ref ebur128_loudness_range_blocks
+ *  later.
+ *
+ *  @param st library state.
+ *  @param frames window length, can't be longer than the internal buffer
+ *                (400ms, or 3s with "EBUR128_MODE_S").
+ *  @param out mean energy of the window.
+ *  @return
+ *    - EBUR128_SUCCESS on success.
+ *    - EBUR128_ERROR_INVALID_MODE if window is too long.
+ */
+int ebur128_energy_window(ebur128_state* st, size_t frames, double* out);
+
+/** \brief Reset maximum sample and true peak of all channels.
+ *
+ *  Peak positions keep counting from initialization so peaks can be
+ *  collected per block of frames.
+ *
+ *  @param st library state.
+ */
+void ebur128_reset_peaks(ebur128_state* st);
+
+/** \brief Get integrated loudness from energies of consecutive 100ms blocks.
+ *
+ *  Uses the same gating as \ref ebur128_loudness_global without keeping any
+ *  library state, so loudness can be recalculated after only some of the
+ *  blocks changed.
+ *
+ *  @param energies block energies (see \ref ebur128_energy_window).
+ *  @param count number of blocks.
+ *  @param out integrated loudness in LUFS. -HUGE_VAL if result is negative
+ *             infinity.
+ *  @return
+ *    - EBUR128_SUCCESS on success.
+ */
+int ebur128_loudness_global_blocks(const double* energies, size_t count,
+                                   double* out);
+
+/** \brief Get loudness range from energies of consecutive 100ms blocks.
+ *
+ *  See \ref ebur128_loudness_global_blocks and \ref ebur128_loudness_range.
+ *
+ *  @param energies block energies (see \ref ebur128_energy_window).
+ *  @param count number of blocks.
+ *  @param out loudness range (LRA) in LU.
+ *  @return
+ *    - EBUR128_SUCCESS on success.
+ *    - EBUR128_ERROR_NOMEM in case of memory allocation error.
+ */
+int ebur128_loudness_range_blocks(const double* energies, size_t count,
+                                  double* out);
+
 #endif  /* EBUR128_H_ */
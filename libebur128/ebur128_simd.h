@@ -0,0 +1,611 @@
+/* BR: Vectorized kernels used by modified libebur128 in SWS. Kept free of     *
+*  SWS/REAPER includes so they can be benchmarked standalone (see             *
+*  BuildUtils/EbuR128Bench.cpp)                                               *
+*                                                                             *
+*  Audio is processed frame-major with channels padded to the vector width    *
+*  of the selected kernels, so one vector register holds the same sample      *
+*  position of several channels and all channels are filtered (and            *
+*  oversampled for true peak) in parallel.                                    *
+*                                                                             *
+*  AVX and AVX2 kernels don't depend on compiler flags (release builds only   *
+*  target SSE2), they are compiled with per-function target attributes and    *
+*  picked at runtime with CPUID, see ebur128_simd_best()                      */
+
+#ifndef EBUR128_SIMD_H_
+#define EBUR128_SIMD_H_
+
+#include <stddef.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+  #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define EBUR128_SIMD_SSE2
+  #endif
+#endif
+
+#if defined(EBUR128_SIMD_SSE2)
+  #if defined(_MSC_VER) && _MSC_VER >= 1700
+    #define EBUR128_SIMD_AVX
+    #define EBUR128_TARGET_AVX
+    #define EBUR128_TARGET_AVX2
+  #elif defined(__clang__) && defined(__has_attribute)
+    #if __has_attribute(target)
+      #define EBUR128_SIMD_AVX
+    #endif
+  #elif defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+    #define EBUR128_SIMD_AVX
+  #endif
+  #if defined(EBUR128_SIMD_AVX) && !defined(_MSC_VER)
+    #define EBUR128_TARGET_AVX  __attribute__((target("avx")))
+    #define EBUR128_TARGET_AVX2 __attribute__((target("avx2,fma")))
+  #endif
+#endif
+
+#if defined(EBUR128_SIMD_AVX)
+  #include <immintrin.h>
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+  #else
+    #include <cpuid.h>
+  #endif
+#elif defined(EBUR128_SIMD_SSE2)
+  #include <emmintrin.h>
+#endif
+
+/** Kernel sets, in order of preference. */
+enum {
+  EBUR128_SIMD_SCALAR = 0,
+  EBUR128_SIMD_LEVEL_SSE2,
+  EBUR128_SIMD_LEVEL_AVX,
+  EBUR128_SIMD_LEVEL_AVX2
+};
+
+/** Number of doubles per frame in a filter buffer processed by kernels
+ *  handling vector_width channels at once. */
+static inline size_t ebur128_simd_pad(size_t channels, size_t vector_width) {
+  return (channels + vector_width - 1) / vector_width * vector_width;
+}
+
+/** Scalar K-weighting filter. Used directly when no SIMD is available and
+ *  as a reference for the vectorized versions.
+ *
+ *  @param x      frames * width samples, filtered in place.
+ *  @param z      filter state, 4 * width doubles (v1 for all channels, then
+ *                v2 and so on).
+ *  @param b, a   5 filter coefficients each (a[0] is ignored). */
+static inline void ebur128_kweight_scalar(double* x, size_t frames, size_t width,
+                                          double* z, const double* b,
+                                          const double* a) {
+  size_t i, c;
+  for (c = 0; c < width; ++c) {
+    double v0;
+    double v1 = z[c];
+    double v2 = z[width + c];
+    double v3 = z[2 * width + c];
+    double v4 = z[3 * width + c];
+    double* in = x + c;
+    for (i = 0; i < frames; ++i, in += width) {
+      v0 = *in - a[1] * v1 - a[2] * v2 - a[3] * v3 - a[4] * v4;
+      *in = b[0] * v0 + b[1] * v1 + b[2] * v2 + b[3] * v3 + b[4] * v4;
+      v4 = v3;
+      v3 = v2;
+      v2 = v1;
+      v1 = v0;
+    }
+    z[c]             = v1;
+    z[width + c]     = v2;
+    z[2 * width + c] = v3;
+    z[3 * width + c] = v4;
+  }
+}
+
+/** Channel weighted energy of each frame: e[i] = sum(w[c] * x[c]^2). */
+static inline void ebur128_energy_scalar(const double* x, size_t frames,
+                                         size_t width, const double* w, double* e) {
+  size_t i, c;
+  for (i = 0; i < frames; ++i, x += width) {
+    double sum = 0.0;
+    for (c = 0; c < width; ++c) {
+      sum += w[c] * x[c] * x[c];
+    }
+    e[i] = sum;
+  }
+}
+
+/** Sum of n consecutive frame energies (running sums of 100ms sub-blocks
+ *  used for gating, momentary and short-term blocks). */
+static inline double ebur128_sum_scalar(const double* e, size_t n) {
+  double sum = 0.0;
+  size_t i;
+  for (i = 0; i < n; ++i) {
+    sum += e[i];
+  }
+  return sum;
+}
+
+/** Scalar true peak interpolator. For every input frame computes
+ *  oversampled values of all phases and updates maximum absolute value.
+ *
+ *  @param x           (taps - 1) history frames followed by frames to process,
+ *                     width samples each.
+ *  @param coeffs      factor phases of taps coefficients each.
+ *  @param peak        current true peak of each channel (width elements).
+ *  @param peak_frame  oversampled frame of each peak (width elements).
+ *  @param frame_offset oversampled frame of the first processed frame. */
+static inline void ebur128_interp_peak_scalar(const double* x, size_t frames,
+                                              size_t width,
+                                              const double* coeffs,
+                                              size_t factor, size_t taps,
+                                              double* peak, size_t* peak_frame,
+                                              size_t frame_offset) {
+  size_t i, c, p, k;
+  for (c = 0; c < width; ++c) {
+    const double* in = x + (taps - 1) * width + c;
+    for (i = 0; i < frames; ++i, in += width) {
+      for (p = 0; p < factor; ++p) {
+        const double* h = coeffs + p * taps;
+        double y = 0.0;
+        for (k = 0; k < taps; ++k) {
+          y += h[k] * in[-(ptrdiff_t) (k * width)];
+        }
+        if (y < 0.0) y = -y;
+        if (y > peak[c]) {
+          peak[c] = y;
+          peak_frame[c] = frame_offset + i * factor + p;
+        }
+      }
+    }
+  }
+}
+
+#if defined(EBUR128_SIMD_SSE2)
+
+static inline void ebur128_kweight_sse2(double* x, size_t frames, size_t width,
+                                        double* z, const double* b,
+                                        const double* a) {
+  size_t i, c;
+  __m128d b0 = _mm_set1_pd(b[0]), b1 = _mm_set1_pd(b[1]),
+          b2 = _mm_set1_pd(b[2]), b3 = _mm_set1_pd(b[3]),
+          b4 = _mm_set1_pd(b[4]);
+  __m128d a1 = _mm_set1_pd(a[1]), a2 = _mm_set1_pd(a[2]),
+          a3 = _mm_set1_pd(a[3]), a4 = _mm_set1_pd(a[4]);
+  for (c = 0; c < width; c += 2) {
+    __m128d v0;
+    __m128d v1 = _mm_loadu_pd(z + c);
+    __m128d v2 = _mm_loadu_pd(z + width + c);
+    __m128d v3 = _mm_loadu_pd(z + 2 * width + c);
+    __m128d v4 = _mm_loadu_pd(z + 3 * width + c);
+    double* in = x + c;
+    for (i = 0; i < frames; ++i, in += width) {
+      v0 = _mm_sub_pd(_mm_sub_pd(_mm_loadu_pd(in),
+                                 _mm_add_pd(_mm_mul_pd(a1, v1),
+                                            _mm_mul_pd(a2, v2))),
+                      _mm_add_pd(_mm_mul_pd(a3, v3), _mm_mul_pd(a4, v4)));
+      _mm_storeu_pd(in, _mm_add_pd(
+                    _mm_add_pd(_mm_mul_pd(b0, v0),
+                               _mm_add_pd(_mm_mul_pd(b1, v1),
+                                          _mm_mul_pd(b2, v2))),
+                    _mm_add_pd(_mm_mul_pd(b3, v3), _mm_mul_pd(b4, v4))));
+      v4 = v3;
+      v3 = v2;
+      v2 = v1;
+      v1 = v0;
+    }
+    _mm_storeu_pd(z + c,             v1);
+    _mm_storeu_pd(z + width + c,     v2);
+    _mm_storeu_pd(z + 2 * width + c, v3);
+    _mm_storeu_pd(z + 3 * width + c, v4);
+  }
+}
+
+static inline void ebur128_energy_sse2(const double* x, size_t frames,
+                                       size_t width, const double* w, double* e) {
+  size_t i, c;
+  for (i = 0; i < frames; ++i, x += width) {
+    __m128d sum = _mm_setzero_pd();
+    for (c = 0; c < width; c += 2) {
+      __m128d v = _mm_loadu_pd(x + c);
+      sum = _mm_add_pd(sum, _mm_mul_pd(_mm_loadu_pd(w + c), _mm_mul_pd(v, v)));
+    }
+    _mm_store_sd(e + i, _mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+  }
+}
+
+static inline double ebur128_sum_sse2(const double* e, size_t n) {
+  __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+  double sum;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    s0 = _mm_add_pd(s0, _mm_loadu_pd(e + i));
+    s1 = _mm_add_pd(s1, _mm_loadu_pd(e + i + 2));
+  }
+  s0 = _mm_add_pd(s0, s1);
+  _mm_store_sd(&sum, _mm_add_sd(s0, _mm_unpackhi_pd(s0, s0)));
+  for (; i < n; ++i) {
+    sum += e[i];
+  }
+  return sum;
+}
+
+static inline void ebur128_interp_peak_sse2(const double* x, size_t frames,
+                                            size_t width, const double* coeffs,
+                                            size_t factor, size_t taps,
+                                            double* peak, size_t* peak_frame,
+                                            size_t frame_offset) {
+  size_t i, c, p, k, l;
+  const __m128d sign = _mm_set1_pd(-0.0);
+  for (c = 0; c < width; c += 2) {
+    __m128d max = _mm_loadu_pd(peak + c);
+    const double* in = x + (taps - 1) * width + c;
+    for (i = 0; i < frames; ++i, in += width) {
+      for (p = 0; p < factor; ++p) {
+        const double* h = coeffs + p * taps;
+        __m128d y = _mm_setzero_pd();
+        int mask;
+        for (k = 0; k < taps; ++k) {
+          y = _mm_add_pd(y, _mm_mul_pd(_mm_set1_pd(h[k]),
+                                       _mm_loadu_pd(in - (ptrdiff_t) (k * width))));
+        }
+        y = _mm_andnot_pd(sign, y);
+        /* new maximums are rare, only then find out which channels have it */
+        mask = _mm_movemask_pd(_mm_cmpgt_pd(y, max));
+        if (mask) {
+          double v[2];
+          _mm_storeu_pd(v, y);
+          for (l = 0; l < 2; ++l) {
+            if (mask & (1 << l)) {
+              peak[c + l] = v[l];
+              peak_frame[c + l] = frame_offset + i * factor + p;
+            }
+          }
+          max = _mm_max_pd(max, y);
+        }
+      }
+    }
+  }
+}
+
+#endif /* EBUR128_SIMD_SSE2 */
+
+#if defined(EBUR128_SIMD_AVX)
+
+/* Kernels are called through ebur128_simd_kernels so compiler never has to
+ * inline AVX code into functions compiled for SSE2. Upper register halves
+ * are cleared before returning to avoid AVX/SSE transition penalties. */
+
+static EBUR128_TARGET_AVX void ebur128_kweight_avx(double* x, size_t frames,
+                                                   size_t width, double* z,
+                                                   const double* b,
+                                                   const double* a) {
+  size_t i, c;
+  __m256d b0 = _mm256_set1_pd(b[0]), b1 = _mm256_set1_pd(b[1]),
+          b2 = _mm256_set1_pd(b[2]), b3 = _mm256_set1_pd(b[3]),
+          b4 = _mm256_set1_pd(b[4]);
+  __m256d a1 = _mm256_set1_pd(a[1]), a2 = _mm256_set1_pd(a[2]),
+          a3 = _mm256_set1_pd(a[3]), a4 = _mm256_set1_pd(a[4]);
+  for (c = 0; c < width; c += 4) {
+    __m256d v0;
+    __m256d v1 = _mm256_loadu_pd(z + c);
+    __m256d v2 = _mm256_loadu_pd(z + width + c);
+    __m256d v3 = _mm256_loadu_pd(z + 2 * width + c);
+    __m256d v4 = _mm256_loadu_pd(z + 3 * width + c);
+    double* in = x + c;
+    for (i = 0; i < frames; ++i, in += width) {
+      v0 = _mm256_sub_pd(_mm256_sub_pd(_mm256_loadu_pd(in),
+                                       _mm256_add_pd(_mm256_mul_pd(a1, v1),
+                                                     _mm256_mul_pd(a2, v2))),
+                         _mm256_add_pd(_mm256_mul_pd(a3, v3),
+                                       _mm256_mul_pd(a4, v4)));
+      _mm256_storeu_pd(in, _mm256_add_pd(
+                       _mm256_add_pd(_mm256_mul_pd(b0, v0),
+                                     _mm256_add_pd(_mm256_mul_pd(b1, v1),
+                                                   _mm256_mul_pd(b2, v2))),
+                       _mm256_add_pd(_mm256_mul_pd(b3, v3),
+                                     _mm256_mul_pd(b4, v4))));
+      v4 = v3;
+      v3 = v2;
+      v2 = v1;
+      v1 = v0;
+    }
+    _mm256_storeu_pd(z + c,             v1);
+    _mm256_storeu_pd(z + width + c,     v2);
+    _mm256_storeu_pd(z + 2 * width + c, v3);
+    _mm256_storeu_pd(z + 3 * width + c, v4);
+  }
+  _mm256_zeroupper();
+}
+
+static EBUR128_TARGET_AVX void ebur128_energy_avx(const double* x, size_t frames,
+                                                  size_t width, const double* w,
+                                                  double* e) {
+  size_t i, c;
+  for (i = 0; i < frames; ++i, x += width) {
+    __m256d sum = _mm256_setzero_pd();
+    __m128d half;
+    for (c = 0; c < width; c += 4) {
+      __m256d v = _mm256_loadu_pd(x + c);
+      sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_loadu_pd(w + c),
+                                             _mm256_mul_pd(v, v)));
+    }
+    half = _mm_add_pd(_mm256_castpd256_pd128(sum),
+                      _mm256_extractf128_pd(sum, 1));
+    _mm_store_sd(e + i, _mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+  }
+  _mm256_zeroupper();
+}
+
+static EBUR128_TARGET_AVX double ebur128_sum_avx(const double* e, size_t n) {
+  __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+  __m128d half;
+  double sum;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    s0 = _mm256_add_pd(s0, _mm256_loadu_pd(e + i));
+    s1 = _mm256_add_pd(s1, _mm256_loadu_pd(e + i + 4));
+  }
+  s0 = _mm256_add_pd(s0, s1);
+  half = _mm_add_pd(_mm256_castpd256_pd128(s0), _mm256_extractf128_pd(s0, 1));
+  _mm_store_sd(&sum, _mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+  _mm256_zeroupper();
+  for (; i < n; ++i) {
+    sum += e[i];
+  }
+  return sum;
+}
+
+static EBUR128_TARGET_AVX void ebur128_interp_peak_avx(const double* x,
+                                                       size_t frames,
+                                                       size_t width,
+                                                       const double* coeffs,
+                                                       size_t factor,
+                                                       size_t taps,
+                                                       double* peak,
+                                                       size_t* peak_frame,
+                                                       size_t frame_offset) {
+  size_t i, c, p, k, l;
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  for (c = 0; c < width; c += 4) {
+    __m256d max = _mm256_loadu_pd(peak + c);
+    const double* in = x + (taps - 1) * width + c;
+    for (i = 0; i < frames; ++i, in += width) {
+      for (p = 0; p < factor; ++p) {
+        const double* h = coeffs + p * taps;
+        __m256d y = _mm256_setzero_pd();
+        int mask;
+        for (k = 0; k < taps; ++k) {
+          y = _mm256_add_pd(y, _mm256_mul_pd(_mm256_broadcast_sd(h + k),
+                                   _mm256_loadu_pd(in - (ptrdiff_t) (k * width))));
+        }
+        y = _mm256_andnot_pd(sign, y);
+        /* new maximums are rare, only then find out which channels have it */
+        mask = _mm256_movemask_pd(_mm256_cmp_pd(y, max, _CMP_GT_OQ));
+        if (mask) {
+          double v[4];
+          _mm256_storeu_pd(v, y);
+          for (l = 0; l < 4; ++l) {
+            if (mask & (1 << l)) {
+              peak[c + l] = v[l];
+              peak_frame[c + l] = frame_offset + i * factor + p;
+            }
+          }
+          max = _mm256_max_pd(max, y);
+        }
+      }
+    }
+  }
+  _mm256_zeroupper();
+}
+
+/* AVX2 kernels differ from AVX ones by using FMA. In the K-weighting filter
+ * the newest state (v1) is applied last, so the recursion only waits for a
+ * single fused multiply-add per frame */
+
+static EBUR128_TARGET_AVX2 void ebur128_kweight_avx2(double* x, size_t frames,
+                                                     size_t width, double* z,
+                                                     const double* b,
+                                                     const double* a) {
+  size_t i, c;
+  __m256d b0 = _mm256_set1_pd(b[0]), b1 = _mm256_set1_pd(b[1]),
+          b2 = _mm256_set1_pd(b[2]), b3 = _mm256_set1_pd(b[3]),
+          b4 = _mm256_set1_pd(b[4]);
+  __m256d a1 = _mm256_set1_pd(a[1]), a2 = _mm256_set1_pd(a[2]),
+          a3 = _mm256_set1_pd(a[3]), a4 = _mm256_set1_pd(a[4]);
+  for (c = 0; c < width; c += 4) {
+    __m256d v0;
+    __m256d v1 = _mm256_loadu_pd(z + c);
+    __m256d v2 = _mm256_loadu_pd(z + width + c);
+    __m256d v3 = _mm256_loadu_pd(z + 2 * width + c);
+    __m256d v4 = _mm256_loadu_pd(z + 3 * width + c);
+    double* in = x + c;
+    for (i = 0; i < frames; ++i, in += width) {
+      v0 = _mm256_fnmadd_pd(a4, v4, _mm256_loadu_pd(in));
+      v0 = _mm256_fnmadd_pd(a3, v3, v0);
+      v0 = _mm256_fnmadd_pd(a2, v2, v0);
+      v0 = _mm256_fnmadd_pd(a1, v1, v0);
+      _mm256_storeu_pd(in, _mm256_fmadd_pd(b0, v0,
+                           _mm256_fmadd_pd(b1, v1,
+                           _mm256_fmadd_pd(b2, v2,
+                           _mm256_fmadd_pd(b3, v3, _mm256_mul_pd(b4, v4))))));
+      v4 = v3;
+      v3 = v2;
+      v2 = v1;
+      v1 = v0;
+    }
+    _mm256_storeu_pd(z + c,             v1);
+    _mm256_storeu_pd(z + width + c,     v2);
+    _mm256_storeu_pd(z + 2 * width + c, v3);
+    _mm256_storeu_pd(z + 3 * width + c, v4);
+  }
+  _mm256_zeroupper();
+}
+
+static EBUR128_TARGET_AVX2 void ebur128_energy_avx2(const double* x,
+                                                    size_t frames, size_t width,
+                                                    const double* w, double* e) {
+  size_t i, c;
+  for (i = 0; i < frames; ++i, x += width) {
+    __m256d sum = _mm256_setzero_pd();
+    __m128d half;
+    for (c = 0; c < width; c += 4) {
+      __m256d v = _mm256_loadu_pd(x + c);
+      sum = _mm256_fmadd_pd(_mm256_mul_pd(_mm256_loadu_pd(w + c), v), v, sum);
+    }
+    half = _mm_add_pd(_mm256_castpd256_pd128(sum),
+                      _mm256_extractf128_pd(sum, 1));
+    _mm_store_sd(e + i, _mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+  }
+  _mm256_zeroupper();
+}
+
+static EBUR128_TARGET_AVX2 void ebur128_interp_peak_avx2(const double* x,
+                                                         size_t frames,
+                                                         size_t width,
+                                                         const double* coeffs,
+                                                         size_t factor,
+                                                         size_t taps,
+                                                         double* peak,
+                                                         size_t* peak_frame,
+                                                         size_t frame_offset) {
+  size_t i, c, p, k, l;
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  for (c = 0; c < width; c += 4) {
+    __m256d max = _mm256_loadu_pd(peak + c);
+    const double* in = x + (taps - 1) * width + c;
+    for (i = 0; i < frames; ++i, in += width) {
+      for (p = 0; p < factor; ++p) {
+        const double* h = coeffs + p * taps;
+        __m256d y = _mm256_setzero_pd();
+        int mask;
+        for (k = 0; k < taps; ++k) {
+          y = _mm256_fmadd_pd(_mm256_broadcast_sd(h + k),
+                              _mm256_loadu_pd(in - (ptrdiff_t) (k * width)), y);
+        }
+        y = _mm256_andnot_pd(sign, y);
+        /* new maximums are rare, only then find out which channels have it */
+        mask = _mm256_movemask_pd(_mm256_cmp_pd(y, max, _CMP_GT_OQ));
+        if (mask) {
+          double v[4];
+          _mm256_storeu_pd(v, y);
+          for (l = 0; l < 4; ++l) {
+            if (mask & (1 << l)) {
+              peak[c + l] = v[l];
+              peak_frame[c + l] = frame_offset + i * factor + p;
+            }
+          }
+          max = _mm256_max_pd(max, y);
+        }
+      }
+    }
+  }
+  _mm256_zeroupper();
+}
+
+static inline void ebur128_cpuid(unsigned int leaf, unsigned int* r) {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuidex(info, (int) leaf, 0);
+  r[0] = (unsigned int) info[0]; r[1] = (unsigned int) info[1];
+  r[2] = (unsigned int) info[2]; r[3] = (unsigned int) info[3];
+#else
+  __cpuid_count(leaf, 0, r[0], r[1], r[2], r[3]);
+#endif
+}
+
+static inline unsigned int ebur128_xgetbv0(void) {
+#if defined(_MSC_VER)
+  return (unsigned int) _xgetbv(0);
+#else
+  unsigned int eax, edx;
+  __asm__ __volatile__(".byte 0x0f, 0x01, 0xd0" /* xgetbv */
+                       : "=a" (eax), "=d" (edx) : "c" (0));
+  return eax;
+#endif
+}
+
+#endif /* EBUR128_SIMD_AVX */
+
+/** Best kernel set supported by both the build and the CPU. */
+static inline int ebur128_simd_cpu_level(void) {
+#if defined(EBUR128_SIMD_AVX)
+  int level = EBUR128_SIMD_LEVEL_SSE2;
+  unsigned int r[4];
+  ebur128_cpuid(0, r);
+  if (r[0] >= 1) {
+    unsigned int max_leaf = r[0];
+    ebur128_cpuid(1, r);
+    /* AVX needs OS support for saving YMM registers too (OSXSAVE + XCR0) */
+    if ((r[2] & (1u << 27)) && (r[2] & (1u << 28)) &&
+        (ebur128_xgetbv0() & 6) == 6) {
+      int fma = (r[2] & (1u << 12)) != 0;
+      level = EBUR128_SIMD_LEVEL_AVX;
+      if (fma && max_leaf >= 7) {
+        ebur128_cpuid(7, r);
+        if (r[1] & (1u << 5)) level = EBUR128_SIMD_LEVEL_AVX2;
+      }
+    }
+  }
+  return level;
+#elif defined(EBUR128_SIMD_SSE2)
+  return EBUR128_SIMD_LEVEL_SSE2;
+#else
+  return EBUR128_SIMD_SCALAR;
+#endif
+}
+
+typedef struct {
+  int level;
+  const char* name;
+  size_t width; /* channels per vector, filter buffers are padded to it */
+  void (*kweight)(double* x, size_t frames, size_t width, double* z,
+                  const double* b, const double* a);
+  void (*energy)(const double* x, size_t frames, size_t width,
+                 const double* w, double* e);
+  double (*sum)(const double* e, size_t n);
+  void (*interp_peak)(const double* x, size_t frames, size_t width,
+                      const double* coeffs, size_t factor, size_t taps,
+                      double* peak, size_t* peak_frame, size_t frame_offset);
+} ebur128_simd_kernels;
+
+/** All kernel sets compiled in this build, scalar first. Use
+ *  ebur128_simd_cpu_level() to see which ones can run. */
+static const ebur128_simd_kernels ebur128_simd_table[] = {
+  {EBUR128_SIMD_SCALAR, "scalar", 1, ebur128_kweight_scalar,
+   ebur128_energy_scalar, ebur128_sum_scalar, ebur128_interp_peak_scalar},
+#if defined(EBUR128_SIMD_SSE2)
+  {EBUR128_SIMD_LEVEL_SSE2, "SSE2", 2, ebur128_kweight_sse2,
+   ebur128_energy_sse2, ebur128_sum_sse2, ebur128_interp_peak_sse2},
+#endif
+#if defined(EBUR128_SIMD_AVX)
+  {EBUR128_SIMD_LEVEL_AVX, "AVX", 4, ebur128_kweight_avx,
+   ebur128_energy_avx, ebur128_sum_avx, ebur128_interp_peak_avx},
+  {EBUR128_SIMD_LEVEL_AVX2, "AVX2", 4, ebur128_kweight_avx2,
+   ebur128_energy_avx2, ebur128_sum_avx, ebur128_interp_peak_avx2},
+#endif
+};
+
+#define EBUR128_SIMD_TABLE_SIZE \
+  (sizeof(ebur128_simd_table) / sizeof(ebur128_simd_table[0]))
+
+/** Kernels used by libebur128. Detected on first call, concurrent first
+ *  calls simply detect the same thing. */
+static inline const ebur128_simd_kernels* ebur128_simd_best(void) {
+  static const ebur128_simd_kernels* best = NULL;
+  if (!best) {
+    int level = ebur128_simd_cpu_level();
+    size_t i = EBUR128_SIMD_TABLE_SIZE;
+    while (i > 1 && ebur128_simd_table[i - 1].level > level) --i;
+    best = &ebur128_simd_table[i - 1];
+  }
+  return best;
+}
+
+/** Number of doubles per frame in the padded filter buffer. */
+static inline size_t ebur128_simd_width(size_t channels) {
+  return ebur128_simd_pad(channels, ebur128_simd_best()->width);
+}
+
+#define ebur128_kweight     (ebur128_simd_best()->kweight)
+#define ebur128_energy      (ebur128_simd_best()->energy)
+#define ebur128_sum         (ebur128_simd_best()->sum)
+#define ebur128_interp_peak (ebur128_simd_best()->interp_peak)
+
+#endif /* EBUR128_SIMD_H_ */
@@ -255,6 +255,7 @@
 #define IDC_PADRELFO_TIMESEGMENT        1157
 #define IDC_PADRELFO_TARGET             1158
 #define IDC_PADRELFO_ACTIVETAKES        1159
+#define IDC_PADRELFO_MAXERROR           1358
 #define IDC_PADREENVPROC_TYPE           1160
 #define IDC_PADREENVPROC_OFFSET         1161
 #define IDC_PADREENVPROC_STRENGTH       1162
@@ -457,7 +458,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        184
 #define _APS_NEXT_COMMAND_VALUE         40000
-#define _APS_NEXT_CONTROL_VALUE         1358
+#define _APS_NEXT_CONTROL_VALUE         1359
 #define _APS_NEXT_SYMED_VALUE           100
 #endif
 #endif
@@ -49,6 +49,7 @@
 #include <ctype.h>
 #include <time.h>
 #include <float.h>
+#include <assert.h>
 #include <sys/stat.h>
 
 // stl
@@ -74,10 +74,137 @@ static WDL_IntKeyedArray<COMMAND_T*> g_commands; // no valdispose (cmds can be a
 int g_iFirstCommand = 0;
 int g_iLastCommand = 0;
 
+// dense command table (cmd id - g_cmdTableBase -> command), O(1) lookups for
+// the hooks below which are called very often (toolbars, menus). It also 
+// caches toggle states and flags re-entrant calls
+#define SWS_REENTRANT_CMD		1
+#define SWS_REENTRANT_CMD2		2
+#define SWS_REENTRANT_TOGGLE	4
+#define SWS_TOGGLE_CACHE_MS		250 // max. age of cached toggle states (states that change w/o notification)
+
+struct SWSCommandEntry
+{
+	COMMAND_T* cmd;
+	int toggleState;
+	unsigned int toggleGen; // toggleState is valid if == g_toggleGen..
+	DWORD toggleTime; // ..and if not too old
+	char reentrant; // SWS_REENTRANT_* flags
+};
+
+static WDL_TypedBuf<SWSCommandEntry> g_cmdTable;
+static int g_cmdTableBase = 0;
+static unsigned int g_toggleGen = 1;
+
+// reverse lookup, doCommand -> commands (sorted by cmd id), see SWSGetCommandID()
+static void freeCmdListValue(WDL_PtrList<COMMAND_T>* p) {delete p;}
+static WDL_PtrKeyedArray<WDL_PtrList<COMMAND_T>*> g_cmdsByFunc(freeCmdListValue);
+
+// poll counters, see ActionsStats()
+static unsigned int g_toggleStatsPolls = 0;
+static unsigned int g_toggleStatsEvals = 0;
+static unsigned int g_toggleStatsMenuItems = 0;
+static DWORD g_toggleStatsTime = 0;
+
+static void (*g_RefreshToolbar)(int) = NULL;
+
+static SWSCommandEntry* GetCommandEntry(int cmdId)
+{
+	int i = cmdId - g_cmdTableBase;
+	if (i >= 0 && i < g_cmdTable.GetSize())
+		return g_cmdTable.Get() + i;
+	return NULL;
+}
+
+static void SetCommandEntry(int cmdId, COMMAND_T* ct)
+{
+	int sz = g_cmdTable.GetSize();
+	if (!sz)
+		g_cmdTableBase = cmdId;
+
+	if (cmdId < g_cmdTableBase) // grow at the beginning
+	{
+		int shift = g_cmdTableBase - cmdId;
+		if (!g_cmdTable.ResizeOK(sz + shift))
+			return;
+		memmove(g_cmdTable.Get() + shift, g_cmdTable.Get(), sz * sizeof(SWSCommandEntry));
+		memset(g_cmdTable.Get(), 0, shift * sizeof(SWSCommandEntry));
+		g_cmdTableBase = cmdId;
+	}
+	else if (cmdId - g_cmdTableBase >= sz) // grow at the end
+	{
+		int newSz = cmdId - g_cmdTableBase + 1;
+		if (!g_cmdTable.ResizeOK(newSz))
+			return;
+		memset(g_cmdTable.Get() + sz, 0, (newSz - sz) * sizeof(SWSCommandEntry));
+	}
+
+	if (SWSCommandEntry* e = GetCommandEntry(cmdId))
+	{
+		memset(e, 0, sizeof(SWSCommandEntry));
+		e->cmd = ct;
+	}
+}
+
+// all toggle states (cmdId==0) or the one of cmdId
+void InvalidateToggleStates(int cmdId)
+{
+	if (!cmdId) g_toggleGen++;
+	else if (SWSCommandEntry* e = GetCommandEntry(cmdId)) e->toggleGen = 0;
+}
+
+// toggle states may have changed when toolbars are refreshed
+static void SWSRefreshToolbar(int cmdId)
+{
+	InvalidateToggleStates(cmdId);
+	if (g_RefreshToolbar)
+		g_RefreshToolbar(cmdId);
+}
+
+// returns -1 on re-entrant call
+static int GetToggleState(int cmdId)
+{
+	SWSCommandEntry* e = GetCommandEntry(cmdId);
+	if (!e || !e->cmd || !e->cmd->getEnabled)
+		return -1;
+
+	DWORD now = GetTickCount();
+	if (e->toggleGen == g_toggleGen && (now - e->toggleTime) < SWS_TOGGLE_CACHE_MS)
+		return e->toggleState;
+
+	if (e->reentrant & SWS_REENTRANT_TOGGLE)
+	{
+#ifdef ACTION_DEBUG
+		OutputDebugString("toggleActionHook - recursive action: ");
+		OutputDebugString(e->cmd->id);
+		OutputDebugString("\n");
+#endif
+		return -1;
+	}
+
+	COMMAND_T* cmd = e->cmd;
+	unsigned int gen = g_toggleGen;
+	e->reentrant |= SWS_REENTRANT_TOGGLE;
+	int state = cmd->getEnabled(cmd);
+	g_toggleStatsEvals++;
+
+	// getEnabled() might have (un)registered commands
+	if ((e = GetCommandEntry(cmdId)) && e->cmd == cmd)
+	{
+		e->reentrant &= ~SWS_REENTRANT_TOGGLE;
+		if (gen == g_toggleGen) { // not invalidated meanwhile
+			e->toggleState = state;
+			e->toggleGen = gen;
+			e->toggleTime = now;
+		}
+	}
+	return state;
+}
+
 
 bool hookCommandProc(int iCmd, int flag)
 {
-	static WDL_PtrList<const char> sReentrantCmds;
+	// any action can change toggle states
+	InvalidateToggleStates();
 
 	// for Xen extensions
 	g_KeyUpUndoHandler=0;
@@ -98,18 +225,21 @@ bool hookCommandProc(int iCmd, int flag)
 	// Ignore commands that don't have anything to do with us from this point forward
 	if (COMMAND_T* cmd = SWSGetCommandByID(iCmd))
 	{
+		SWSCommandEntry* e = GetCommandEntry(iCmd);
 		if (!cmd->uniqueSectionId && cmd->accel.accel.cmd==iCmd && cmd->doCommand)
 		{
-			if (sReentrantCmds.Find(cmd->id)<0)
+			if (!(e->reentrant & SWS_REENTRANT_CMD))
 			{
-				sReentrantCmds.Add(cmd->id);
+				e->reentrant |= SWS_REENTRANT_CMD;
 				cmd->fakeToggle = !cmd->fakeToggle;
 #ifndef BR_DEBUG_PERFORMANCE_ACTIONS
 				cmd->doCommand(cmd);
 #else
 				CommandTimer(cmd);
 #endif
-				sReentrantCmds.Delete(sReentrantCmds.Find(cmd->id));
+				if ((e = GetCommandEntry(iCmd))) // table may have been resized
+					e->reentrant &= ~SWS_REENTRANT_CMD;
+				InvalidateToggleStates();
 				return true;
 			}
 #ifdef ACTION_DEBUG
@@ -127,8 +257,6 @@ bool hookCommandProc(int iCmd, int flag)
 
 bool hookCommandProc2(KbdSectionInfo* sec, int cmdId, int val, int valhw, int relmode, HWND hwnd)
 {
-	static WDL_PtrList<const char> sReentrantCmds;
-
 	// Ignore commands that don't have anything to do with us from this point forward
 	if (COMMAND_T* cmd = SWSGetCommandByID(cmdId))
 	{
@@ -139,12 +267,14 @@ bool hookCommandProc2(KbdSectionInfo* sec, int cmdId, int val, int valhw, int re
 			if (cmd->doCommand)
 				return false;
 
+			SWSCommandEntry* e = GetCommandEntry(cmdId);
 			if (cmd->onAction)
 			{
-				if (sReentrantCmds.Find(cmd->id)<0)
+				if (!(e->reentrant & SWS_REENTRANT_CMD2))
 				{
-					sReentrantCmds.Add(cmd->id);
+					e->reentrant |= SWS_REENTRANT_CMD2;
 					cmd->fakeToggle = !cmd->fakeToggle;
+					InvalidateToggleStates();
 
 					if (!BR_SetGetCommandHook2Reentrancy(false, false)) // needed for refreshing MIDI toolbar (make sure it's called after changing toggle state)
 					{
@@ -154,7 +284,9 @@ bool hookCommandProc2(KbdSectionInfo* sec, int cmdId, int val, int valhw, int re
 						CommandTimer(cmd, val, valhw, relmode, hwnd, true);
 #endif
 					}
-					sReentrantCmds.Delete(sReentrantCmds.Find(cmd->id));
+					if ((e = GetCommandEntry(cmdId))) // table may have been resized
+						e->reentrant &= ~SWS_REENTRANT_CMD2;
+					InvalidateToggleStates();
 					return true;
 				}
 #ifdef ACTION_DEBUG
@@ -183,30 +315,14 @@ void hookPostCommandProc(int iCmd, int flag)
 // -1 = action does not belong to this extension, or does not toggle
 //  0 = action belongs to this extension and is currently set to "off"
 //  1 = action belongs to this extension and is currently set to "on"
+// Polled by REAPER for all visible toolbar buttons/menu items, states are cached
+// (invalidated by actions, control surface notifications, RefreshToolbar(), or when too old)
 int toggleActionHook(int iCmd)
 {
-	static WDL_PtrList<const char> sReentrantCmds;
+	g_toggleStatsPolls++;
 	if (COMMAND_T* cmd = SWSGetCommandByID(iCmd))
-	{
 		if (cmd->accel.accel.cmd==iCmd && cmd->getEnabled)
-		{
-			if (sReentrantCmds.Find(cmd->id) == -1)
-			{
-				sReentrantCmds.Add(cmd->id);
-				int state = cmd->getEnabled(cmd);
-				sReentrantCmds.Delete(sReentrantCmds.Find(cmd->id));
-				return state;
-			}
-#ifdef ACTION_DEBUG
-			else
-			{
-				OutputDebugString("toggleActionHook - recursive action: ");
-				OutputDebugString(cmd->id);
-				OutputDebugString("\n");
-			}
-#endif
-		}
-	}
+			return GetToggleState(iCmd);
 	return -1;
 }
 
@@ -251,6 +367,18 @@ int SWSRegisterCmd(COMMAND_T* pCommand, const char* cFile, int cmdId, bool local
 	if (cmdId > g_iLastCommand) g_iLastCommand = cmdId;
 
 	g_commands.Insert(cmdId, pCommand);
+	SetCommandEntry(cmdId, pCommand);
+	if (pCommand->doCommand)
+	{
+		WDL_PtrList<COMMAND_T>* cmds = g_cmdsByFunc.Get((INT_PTR)pCommand->doCommand, NULL);
+		if (!cmds) {
+			cmds = new WDL_PtrList<COMMAND_T>;
+			g_cmdsByFunc.Insert((INT_PTR)pCommand->doCommand, cmds);
+		}
+		int i = 0;
+		while (i < cmds->GetSize() && cmds->Get(i)->accel.accel.cmd < cmdId) i++;
+		cmds->Insert(i, pCommand);
+	}
 #ifdef ACTION_DEBUG
 	g_cmdFiles.Insert(cmdId, new WDL_String(cFile));
 #endif
@@ -313,6 +441,13 @@ COMMAND_T* SWSUnregisterCmd(int id)
 			plugin_register("-custom_action", (void*)&s);
 		}
 		g_commands.Delete(id);
+		SetCommandEntry(id, NULL);
+		if (WDL_PtrList<COMMAND_T>* cmds = ct->doCommand ? g_cmdsByFunc.Get((INT_PTR)ct->doCommand, NULL) : NULL)
+		{
+			int i = cmds->Find(ct);
+			if (i >= 0) cmds->Delete(i, false);
+			if (!cmds->GetSize()) g_cmdsByFunc.Delete((INT_PTR)ct->doCommand);
+		}
 #ifdef ACTION_DEBUG
 		g_cmdFiles.Delete(id);
 #endif
@@ -348,17 +483,39 @@ void ActionsList(COMMAND_T*)
 		}
 	}
 }
+
+// Output poll rates of toggle states since the last call
+void ActionsStats(COMMAND_T*)
+{
+	DWORD now = GetTickCount();
+	double secs = g_toggleStatsTime ? (now - g_toggleStatsTime) / 1000.0 : 0.0;
+	if (secs > 0.0)
+	{
+		char cBuf[512];
+		_snprintf(cBuf, sizeof(cBuf), 
+			"SWS actions: %d, toggle state polls: %.1f/s, getEnabled() calls: %.1f/s (%.1f%% cached), menu items: %.1f/s\n",
+			g_commands.GetSize(), g_toggleStatsPolls/secs, g_toggleStatsEvals/secs, 
+			(g_toggleStatsPolls+g_toggleStatsMenuItems) ? 100.0 - 100.0*g_toggleStatsEvals/(g_toggleStatsPolls+g_toggleStatsMenuItems) : 0.0, 
+			g_toggleStatsMenuItems/secs);
+		ShowConsoleMsg(cBuf);
+	}
+	else
+		ShowConsoleMsg("SWS actions: poll counters reset, run this action again to display poll rates\n");
+	g_toggleStatsPolls = g_toggleStatsEvals = g_toggleStatsMenuItems = 0;
+	g_toggleStatsTime = now;
+}
 #endif
 
 //JFB questionnable func: ok most of the time but, for ex.,
 // 2 different cmds can share the same function pointer cmd->doCommand
 int SWSGetCommandID(void (*cmdFunc)(COMMAND_T*), INT_PTR user, const char** pMenuText)
 {
-	for (int i=0; i<g_commands.GetSize(); i++)
+	if (WDL_PtrList<COMMAND_T>* cmds = g_cmdsByFunc.Get((INT_PTR)cmdFunc, NULL))
 	{
-		if (COMMAND_T* cmd = g_commands.Enumerate(i, NULL, NULL))
+		for (int i=0; i<cmds->GetSize(); i++)
 		{
-			if (cmd->doCommand == cmdFunc && cmd->user == user)
+			COMMAND_T* cmd = cmds->Get(i);
+			if (cmd->user == user)
 			{
 				if (pMenuText)
 					*pMenuText = cmd->menuText;
@@ -370,8 +527,8 @@ int SWSGetCommandID(void (*cmdFunc)(COMMAND_T*), INT_PTR user, const char** pMen
 }
 
 COMMAND_T* SWSGetCommandByID(int cmdId) {
-	if (cmdId >= g_iFirstCommand && cmdId <= g_iLastCommand) // not enough to ensure it is a SWS action
-		return g_commands.Get(cmdId, NULL);
+	if (SWSCommandEntry* e = GetCommandEntry(cmdId))
+		return e->cmd;
 	return NULL;
 }
 
@@ -432,9 +589,9 @@ static void swsMenuHook(const char* menustr, HMENU hMenu, int flag)
 			GetMenuItemInfo(hMenu, i, true, &mi);
 			if (mi.hSubMenu)
 				swsMenuHook(menustr, mi.hSubMenu, flag);
-			else if (mi.wID >= (UINT)g_iFirstCommand && mi.wID <= (UINT)g_iLastCommand) {
-				if (COMMAND_T* t = g_commands.Get(mi.wID, NULL))
-					CheckMenuItem(hMenu, i, MF_BYPOSITION | (t->getEnabled && t->getEnabled(t) ? MF_CHECKED : MF_UNCHECKED));
+			else if (COMMAND_T* t = SWSGetCommandByID(mi.wID)) {
+				g_toggleStatsMenuItems++;
+				CheckMenuItem(hMenu, i, MF_BYPOSITION | (t->getEnabled && GetToggleState(mi.wID)>0 ? MF_CHECKED : MF_UNCHECKED));
 			}
 		}
 	}
@@ -459,6 +616,7 @@ public:
 
 	void Run() // BR: Removed some stuff from here and made it use plugin_register("timer"/"-timer") - it's the same thing as this but it enables us to remove unused stuff completely
 	{          // I guess we could do the rest too (and add user options to enable where needed)...
+		GuidIndexNewTimeSlice();
 		SNM_CSurfRun();
 		ZoomSlice();
 		MiscSlice();
@@ -475,6 +633,7 @@ public:
 
 	void SetPlayState(bool play, bool pause, bool rec)
 	{
+		InvalidateToggleStates();
 		SNM_CSurfSetPlayState(play, pause, rec);
 		AWDoAutoGroup(rec);
 		ItemPreviewPlayState(play, rec);
@@ -484,6 +643,8 @@ public:
 	// This is our only notification of active project tab change, so update everything
 	void SetTrackListChange()
 	{
+		GuidIndexInvalidate();
+		InvalidateToggleStates();
 		m_bChanged = true;
 		AutoColorTrack(false);
 		AutoColorMarkerRegion(false);
@@ -495,6 +656,7 @@ public:
 	// However, we still need to trap track name changes with no track list change.
 	void SetTrackTitle(MediaTrack *tr, const char *c)
 	{
+		InvalidateToggleStates();
 		ScheduleTracklistUpdate();
 		if (!m_iACIgnore)
 		{
@@ -505,12 +667,13 @@ public:
 			m_iACIgnore--;
 	}
 
-	void SetSurfaceSelected(MediaTrack *tr, bool bSel)	{ ScheduleTracklistUpdate(); UpdateSnapshotsDialog(true); }
-	void SetSurfaceMute(MediaTrack *tr, bool mute)		{ ScheduleTracklistUpdate(); UpdateTrackMute(); }
-	void SetSurfaceSolo(MediaTrack *tr, bool solo)		{ ScheduleTracklistUpdate(); UpdateTrackSolo(); }
-	void SetSurfaceRecArm(MediaTrack *tr, bool arm)		{ ScheduleTracklistUpdate(); UpdateTrackArm(); }
+	void SetSurfaceSelected(MediaTrack *tr, bool bSel)	{ InvalidateToggleStates(); ScheduleTracklistUpdate(); UpdateSnapshotsDialog(true); }
+	void SetSurfaceMute(MediaTrack *tr, bool mute)		{ InvalidateToggleStates(); ScheduleTracklistUpdate(); UpdateTrackMute(); }
+	void SetSurfaceSolo(MediaTrack *tr, bool solo)		{ InvalidateToggleStates(); ScheduleTracklistUpdate(); UpdateTrackSolo(); }
+	void SetSurfaceRecArm(MediaTrack *tr, bool arm)		{ InvalidateToggleStates(); ScheduleTracklistUpdate(); UpdateTrackArm(); }
 	int Extended(int call, void *parm1, void *parm2, void *parm3)
 	{
+		InvalidateToggleStates();
 		BR_CSurfExtended(call, parm1, parm2, parm3);
 		SNM_CSurfExtended(call, parm1, parm2, parm3);
 		return 0;
@@ -727,9 +890,6 @@ extern "C"
 		IMPAPI(GetPlayState);
 		IMPAPI(GetPlayStateEx);
 		IMPAPI(GetProjectPath);
-/*JFB commented: err in debug output "plugin_getapi fail:GetProjectStateChangeCount" - last check: v4.33rc1
-		IMPAPI(GetProjectStateChangeCount);
-*/
 		IMPAPI(GetProjectTimeSignature2);
 		IMPAPI(GetResourcePath);
 		IMPAPI(GetSelectedEnvelope);
@@ -971,6 +1131,9 @@ extern "C"
 			ERR_RETURN("SWS version incompatibility\n")
 		}
 
+		// optional imports: NULL when not available (older REAPER versions), callers must check
+		*((void **)&GetProjectStateChangeCount) = (void *)rec->GetFunc("GetProjectStateChangeCount");
+
 		// check for dupe/clone before registering any new action
 		{
 			int(*SNM_GetIntConfigVar)(const char* varname, int errvalue);
@@ -980,6 +1143,11 @@ extern "C"
 			errcnt=0;
 		}
 
+		// toggle states are cached, see toggleActionHook(): hook RefreshToolbar() to
+		// invalidate them (applies to all RefreshToolbar() calls made by this extension)
+		g_RefreshToolbar = RefreshToolbar;
+		RefreshToolbar = SWSRefreshToolbar;
+
 		// hookcommand2 must be registered before hookcommand
 		if (!rec->Register("hookcommand2", (void*)hookCommandProc2))
 		{
@@ -352,16 +352,219 @@ const GUID* TrackToGuid(MediaTrack* tr)
 	return NULL;
 }
 
-MediaTrack* GuidToTrack(const GUID* guid)
+
+///////////////////////////////////////////////////////////////////////////////
+// GUID -> track/item/take index (active project, main thread only)
+// Rebuilt lazily, invalidated on track list changes (incl. project switches),
+// see SWSTimeSlice::SetTrackListChange(). Items and takes do not get such 
+// notifications: hits are checked by position (stale pointers are never 
+// dereferenced) and misses rebuild the index once per time slice at most,
+// later misses in the same time slice fall back to a linear scan (objects
+// created meanwhile are still found).
+///////////////////////////////////////////////////////////////////////////////
+
+enum { GUIDIDX_TRACKS=0, GUIDIDX_ITEMS, GUIDIDX_TAKES, GUIDIDX_COUNT };
+
+struct GuidIndexEntry
+{
+	GUID guid;
+	void* obj;
+	int tr, item, take; // position: track id, item/take index (-1 if n/a)
+};
+
+static WDL_TypedBuf<GuidIndexEntry> g_guidIdx[GUIDIDX_COUNT];
+static bool g_guidIdxOk[GUIDIDX_COUNT];
+static unsigned int g_guidIdxTick[GUIDIDX_COUNT];
+static unsigned int g_guidTick = 1;
+
+// sorted by GUID, then by position (i.e. duplicate GUIDs: 1st object wins)
+static int CompareGuidEntries(const void* a, const void* b)
+{
+	const GuidIndexEntry* e1 = (const GuidIndexEntry*)a;
+	const GuidIndexEntry* e2 = (const GuidIndexEntry*)b;
+	if (int cmp = memcmp(&e1->guid, &e2->guid, sizeof(GUID))) return cmp;
+	if (e1->tr != e2->tr) return e1->tr < e2->tr ? -1 : 1;
+	if (e1->item != e2->item) return e1->item < e2->item ? -1 : 1;
+	return e1->take < e2->take ? -1 : (e1->take > e2->take ? 1 : 0);
+}
+
+static void AddGuidEntry(int kind, const GUID* g, void* obj, int tr, int item, int take)
+{
+	if (!g) return;
+	int sz = g_guidIdx[kind].GetSize();
+	if (GuidIndexEntry* e = g_guidIdx[kind].ResizeOK(sz+1, false))
+	{
+		e += sz;
+		memcpy(&e->guid, g, sizeof(GUID));
+		e->obj = obj;
+		e->tr = tr;
+		e->item = item;
+		e->take = take;
+	}
+}
+
+static void BuildGuidIndex(int kind)
 {
-	if (guid)
-		for (int i=0; i<=GetNumTracks(); i++)
+	if (kind == GUIDIDX_TRACKS)
+	{
+		g_guidIdx[GUIDIDX_TRACKS].Resize(0, false);
+		for (int i=0; i <= GetNumTracks(); i++)
 			if (MediaTrack* tr = CSurf_TrackFromID(i, false))
-				if (TrackMatchesGuid(tr, guid))
+			{
+				AddGuidEntry(GUIDIDX_TRACKS, GetTrackGUID(tr), tr, i, -1, -1);
+				if (!i) AddGuidEntry(GUIDIDX_TRACKS, &GUID_NULL, tr, i, -1, -1); // master, see TrackToGuid()
+			}
+	}
+	else // items and takes in one go
+	{
+		kind = GUIDIDX_ITEMS;
+		g_guidIdx[GUIDIDX_ITEMS].Resize(0, false);
+		g_guidIdx[GUIDIDX_TAKES].Resize(0, false);
+		for (int i=1; i <= GetNumTracks(); i++)
+		{
+			MediaTrack* tr = CSurf_TrackFromID(i, false);
+			int nbItems = tr ? GetTrackNumMediaItems(tr) : 0;
+			for (int j=0; j < nbItems; j++)
+				if (MediaItem* item = GetTrackMediaItem(tr, j))
+				{
+					AddGuidEntry(GUIDIDX_ITEMS, (GUID*)GetSetMediaItemInfo(item, "GUID", NULL), item, i, j, -1);
+					int nbTakes = GetMediaItemNumTakes(item);
+					for (int k=0; k < nbTakes; k++)
+						if (MediaItem_Take* tk = GetMediaItemTake(item, k))
+							AddGuidEntry(GUIDIDX_TAKES, (GUID*)GetSetMediaItemTakeInfo(tk, "GUID", NULL), tk, i, j, k);
+				}
+		}
+		qsort(g_guidIdx[GUIDIDX_TAKES].Get(), g_guidIdx[GUIDIDX_TAKES].GetSize(), sizeof(GuidIndexEntry), CompareGuidEntries);
+		g_guidIdxOk[GUIDIDX_TAKES] = true;
+		g_guidIdxTick[GUIDIDX_TAKES] = g_guidTick;
+	}
+	qsort(g_guidIdx[kind].Get(), g_guidIdx[kind].GetSize(), sizeof(GuidIndexEntry), CompareGuidEntries);
+	g_guidIdxOk[kind] = true;
+	g_guidIdxTick[kind] = g_guidTick;
+}
+
+// 1st entry matching g (lower bound), NULL if not found
+static GuidIndexEntry* FindGuidEntry(int kind, const GUID* g)
+{
+	GuidIndexEntry* entries = g_guidIdx[kind].Get();
+	int lo = 0, hi = g_guidIdx[kind].GetSize();
+	while (lo < hi)
+	{
+		int mid = (lo+hi)/2;
+		if (memcmp(&entries[mid].guid, g, sizeof(GUID)) < 0) lo = mid+1;
+		else hi = mid;
+	}
+	if (lo < g_guidIdx[kind].GetSize() && !memcmp(&entries[lo].guid, g, sizeof(GUID)))
+		return entries + lo;
+	return NULL;
+}
+
+// checks the indexed object is still there, without dereferencing it
+static bool CheckGuidEntry(int kind, GuidIndexEntry* e, const GUID* g)
+{
+	MediaTrack* tr = CSurf_TrackFromID(e->tr, false);
+	if (!tr) return false;
+	if (kind == GUIDIDX_TRACKS)
+		return (tr == (MediaTrack*)e->obj && TrackMatchesGuid(tr, g));
+
+	MediaItem* item = GetTrackMediaItem(tr, e->item);
+	if (!item) return false;
+	if (kind == GUIDIDX_ITEMS)
+		return (item == (MediaItem*)e->obj && GuidsEqual((GUID*)GetSetMediaItemInfo(item, "GUID", NULL), g));
+
+	MediaItem_Take* tk = GetMediaItemTake(item, e->take);
+	return (tk && tk == (MediaItem_Take*)e->obj && GuidsEqual((GUID*)GetSetMediaItemTakeInfo(tk, "GUID", NULL), g));
+}
+
+// linear scan, 1st object wins (like the index)
+static void* ScanGuidObject(int kind, const GUID* g)
+{
+	for (int i=0; i <= GetNumTracks(); i++)
+		if (MediaTrack* tr = CSurf_TrackFromID(i, false))
+		{
+			if (kind == GUIDIDX_TRACKS)
+			{
+				if (TrackMatchesGuid(tr, g))
 					return tr;
+				continue;
+			}
+			if (!i) continue; // no items on the master
+			int nbItems = GetTrackNumMediaItems(tr);
+			for (int j=0; j < nbItems; j++)
+				if (MediaItem* item = GetTrackMediaItem(tr, j))
+				{
+					if (kind == GUIDIDX_ITEMS)
+					{
+						if (GuidsEqual((GUID*)GetSetMediaItemInfo(item, "GUID", NULL), g))
+							return item;
+						continue;
+					}
+					int nbTakes = GetMediaItemNumTakes(item);
+					for (int k=0; k < nbTakes; k++)
+						if (MediaItem_Take* tk = GetMediaItemTake(item, k))
+							if (GuidsEqual((GUID*)GetSetMediaItemTakeInfo(tk, "GUID", NULL), g))
+								return tk;
+				}
+		}
+	return NULL;
+}
+
+static void* GuidToObject(int kind, const GUID* g)
+{
+	if (!g) return NULL;
+	bool built = false;
+	for (int pass=0; pass<2; pass++)
+	{
+		if (!g_guidIdxOk[kind]) {
+			BuildGuidIndex(kind);
+			built = true;
+		}
+		if (GuidIndexEntry* e = FindGuidEntry(kind, g))
+		{
+			if (CheckGuidEntry(kind, e, g))
+				return e->obj;
+		}
+		else if (g_guidIdxTick[kind] == g_guidTick)
+		{
+			if (built)
+				return NULL; // not found, index just rebuilt
+
+			// not indexed, but the object may have been created in this time slice:
+			// scan (no rebuild for each miss) and rebuild the index on the next lookup if found
+			void* obj = ScanGuidObject(kind, g);
+			if (obj) g_guidIdxOk[kind] = false;
+			return obj;
+		}
+		g_guidIdxOk[kind] = false; // stale
+	}
 	return NULL;
 }
 
+void GuidIndexInvalidate()
+{
+	for (int i=0; i < GUIDIDX_COUNT; i++)
+		g_guidIdxOk[i] = false;
+}
+
+// new time slice: objects may have been added (w/o track list change)
+void GuidIndexNewTimeSlice() {
+	g_guidTick++;
+}
+
+MediaTrack* GuidToTrack(const GUID* guid) {
+	return (MediaTrack*)GuidToObject(GUIDIDX_TRACKS, guid);
+}
+
+MediaItem* GuidToItem(const GUID* guid) {
+	return (MediaItem*)GuidToObject(GUIDIDX_ITEMS, guid);
+}
+
+MediaItem_Take* GuidToTake(const GUID* guid) {
+	return (MediaItem_Take*)GuidToObject(GUIDIDX_TAKES, guid);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 bool GuidsEqual(const GUID* g1, const GUID* g2)
 {
 	return g1 && g2 && !memcmp(g1, g2, sizeof(GUID));
@@ -211,6 +211,8 @@ int SWSCreateRegisterDynamicCmd(int uniqueSectionId, int cmdId, void(*doCommand)
 void SWSFreeUnregisterDynamicCmd(int id);
 
 void ActionsList(COMMAND_T*);
+void ActionsStats(COMMAND_T*);
+void InvalidateToggleStates(int cmdId = 0);
 int SWSGetCommandID(void (*cmdFunc)(COMMAND_T*), INT_PTR user = 0, const char** pMenuText = NULL);
 COMMAND_T* SWSGetCommandByID(int cmdId);
 int IsSwsAction(const char* _actionName);
@@ -239,6 +241,10 @@ HWND GetRulerWnd();
 char* GetHashString(const char* in, char* out);
 const GUID* TrackToGuid(MediaTrack* tr);
 MediaTrack* GuidToTrack(const GUID* guid);
+MediaItem* GuidToItem(const GUID* guid);
+MediaItem_Take* GuidToTake(const GUID* guid);
+void GuidIndexInvalidate();
+void GuidIndexNewTimeSlice();
 bool GuidsEqual(const GUID* g1, const GUID* g2);
 bool TrackMatchesGuid(MediaTrack* tr, const GUID* g);
 const char* stristr(const char* str1, const char* str2);
@@ -30,12 +30,13 @@
 class SWS_WaitDlg
 {
 public:
-	SWS_WaitDlg(const char* cTitle, double* dProgress, HWND hParent = NULL);
+	SWS_WaitDlg(const char* cTitle, double* dProgress, HWND hParent = NULL, bool* bCancel = NULL);
 	~SWS_WaitDlg() {}
 private:
 	static INT_PTR WINAPI sWaitDlgWndProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam); // static
 	int waitDlgWndProc(UINT uMsg, WPARAM wParam, LPARAM lParam);
 	const char* m_cTitle;
 	double* m_dProgress;
+	bool* m_bCancel;
 	HWND m_hwnd;
 };
\ No newline at end of file